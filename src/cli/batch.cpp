@@ -0,0 +1,556 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "batch.h"
+
+#include "assembler/simpleasm.h"
+#include "machine/machine.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <algorithm>
+#include <thread>
+
+using namespace machine;
+
+using ae = machine::AccessEffects; // For enum values, type is obvious from
+                                   // context.
+
+// Cycles run between checks of the wall clock limit
+constexpr unsigned BATCH_CHUNK_CYCLES = 10000;
+
+BatchRunner::BatchRunner(std::ostream &out) : out(out) {}
+
+bool BatchRunner::load(const QString &file_name, QString &error) {
+    QFile file(file_name);
+    if (!file.open(QFile::ReadOnly)) {
+        error = "Batch file cannot be open for read (" + file_name + ").";
+        return false;
+    }
+    QJsonParseError parse_error {};
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parse_error);
+    if (doc.isNull()) {
+        error = "Batch file parse error: " + parse_error.errorString();
+        return false;
+    }
+
+    QJsonArray job_array;
+    QJsonObject defaults;
+    if (doc.isArray()) {
+        job_array = doc.array();
+    } else {
+        job_array = doc.object().value("jobs").toArray();
+        defaults = doc.object().value("defaults").toObject();
+    }
+    for (const QJsonValue &value : job_array) {
+        if (!value.isObject()) {
+            error = QString("Batch job %1 is not an object.").arg(jobs.size());
+            return false;
+        }
+        QJsonObject job = defaults;
+        const QJsonObject spec = value.toObject();
+        for (auto it = spec.begin(); it != spec.end(); ++it) {
+            job.insert(it.key(), it.value());
+        }
+        if (!job.value("file").isString()) {
+            error = QString("Batch job %1 has no file.").arg(jobs.size());
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+size_t BatchRunner::job_count() const {
+    return jobs.size();
+}
+
+void BatchRunner::run(unsigned threads) {
+    threads = std::max(1u, std::min<unsigned>(threads, jobs.size()));
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(&BatchRunner::worker, this);
+    }
+    worker();
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+}
+
+void BatchRunner::worker() {
+    for (size_t index = next_job++; index < jobs.size(); index = next_job++) {
+        const QByteArray line = QJsonDocument(run_job(index)).toJson(QJsonDocument::Compact);
+        std::lock_guard<std::mutex> lock(out_mutex);
+        // Flushed, results of finished jobs are kept if the batch is killed.
+        out << line.constData() << std::endl;
+    }
+}
+
+static bool configure_cache(CacheConfig &cache, const QJsonValue &value, QString &error) {
+    if (value.isUndefined() || value.isNull()) {
+        return true;
+    }
+    const QJsonObject spec = value.toObject();
+    cache.set_enabled(true);
+    const QString policy = spec.value("policy").toString("lru").toLower();
+    if (policy == "random") {
+        cache.set_replacement_policy(CacheConfig::RP_RAND);
+    } else if (policy == "lru") {
+        cache.set_replacement_policy(CacheConfig::RP_LRU);
+    } else if (policy == "lfu") {
+        cache.set_replacement_policy(CacheConfig::RP_LFU);
+    } else {
+        error = "Cache policy is incorrect (correct random/lru/lfu).";
+        return false;
+    }
+    cache.set_set_count(spec.value("sets").toInt(1));
+    cache.set_block_size(spec.value("block_size").toInt(1));
+    cache.set_associativity(spec.value("associativity").toInt(1));
+    if (cache.set_count() == 0 || cache.block_size() == 0 || cache.associativity() == 0) {
+        error = "Cache parameters cannot have zero component.";
+        return false;
+    }
+    if (spec.contains("write")) {
+        const QString write = spec.value("write").toString().toLower();
+        if (write == "wb") {
+            cache.set_write_policy(CacheConfig::WP_BACK);
+        } else if (write == "wt" || write == "wtna") {
+            cache.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
+        } else if (write == "wta") {
+            cache.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+        } else {
+            error = "Cache write policy is incorrect (correct wb/wt/wtna/wta).";
+            return false;
+        }
+    }
+    if (spec.contains("prefetch")
+        && !cache.set_prefetch_policy(spec.value("prefetch").toString().toLower())) {
+        error = "Cache prefetch policy is incorrect (correct none/next-line/stride/stream).";
+        return false;
+    }
+    cache.set_prefetch_degree(spec.value("prefetch_degree").toInt(1));
+    cache.set_prefetch_distance(spec.value("prefetch_distance").toInt(1));
+    return true;
+}
+
+static bool configure_dram(MachineConfig &config, const QJsonValue &value, QString &error) {
+    if (value.isUndefined() || value.isNull()) {
+        return true;
+    }
+    const QJsonObject spec = value.toObject();
+    const int banks = spec.value("banks").toInt(4);
+    const int row_size = spec.value("row_size").toInt(1024);
+    if (banks <= 0 || row_size < 4) {
+        error = "DRAM parameters are out of range.";
+        return false;
+    }
+    config.set_dram_enabled(true);
+    config.set_dram_banks(banks);
+    config.set_dram_row_size(row_size);
+    if (spec.contains("page_policy")
+        && !config.set_dram_page_policy(spec.value("page_policy").toString().toLower())) {
+        error = "DRAM page policy is incorrect (correct open/closed).";
+        return false;
+    }
+    config.set_dram_t_rcd(spec.value("t_rcd").toInt(5));
+    config.set_dram_t_cas(spec.value("t_cas").toInt(5));
+    config.set_dram_t_rp(spec.value("t_rp").toInt(5));
+    config.set_dram_write_queue(spec.value("write_queue").toInt(8));
+    if (config.dram_banks() > MachineConfig::DRAM_BANKS_MAX
+        || config.dram_row_size() > MachineConfig::DRAM_ROW_SIZE_MAX
+        || config.dram_t_rcd() > MachineConfig::DRAM_TIMING_MAX
+        || config.dram_t_cas() > MachineConfig::DRAM_TIMING_MAX
+        || config.dram_t_rp() > MachineConfig::DRAM_TIMING_MAX
+        || config.dram_write_queue() > MachineConfig::DRAM_WRITE_QUEUE_MAX) {
+        error = "DRAM parameters are out of range.";
+        return false;
+    }
+    return true;
+}
+
+static bool configure_machine(MachineConfig &config, const QJsonObject &job, QString &error) {
+    config.set_elf(job.value("file").toString());
+    const bool superscalar = job.value("superscalar").toBool(false);
+    config.set_pipelined(job.value("pipelined").toBool(false) || superscalar);
+    config.set_superscalar(superscalar);
+    config.set_delay_slot(job.value("delay_slot").toBool(true));
+    if (job.contains("hazard_unit")
+        && !config.set_hazard_unit(job.value("hazard_unit").toString().toLower())) {
+        error = "Unknown kind of hazard unit specified.";
+        return false;
+    }
+    if (job.contains("branch_predictor")
+        && !config.set_branch_predictor(job.value("branch_predictor").toString().toLower())) {
+        error = "Unknown kind of branch predictor specified.";
+        return false;
+    }
+    if (job.contains("bp_table_bits")) {
+        config.set_branch_predictor_bits(job.value("bp_table_bits").toInt());
+    }
+    if (job.contains("bp_history_bits")) {
+        config.set_branch_history_bits(job.value("bp_history_bits").toInt());
+    }
+    if (job.contains("btb_bits")) {
+        config.set_btb_bits(job.value("btb_bits").toInt());
+    }
+    if (job.contains("ras_size")) {
+        config.set_ras_size(job.value("ras_size").toInt());
+    }
+    if (config.branch_predictor_bits() > MachineConfig::BP_BITS_MAX
+        || config.branch_history_bits() > MachineConfig::BP_BITS_MAX
+        || config.btb_bits() > MachineConfig::BP_BITS_MAX
+        || config.ras_size() > MachineConfig::BP_RAS_SIZE_MAX) {
+        error = "Branch predictor size is out of range.";
+        return false;
+    }
+    config.set_mult_latency(job.value("mult_latency").toInt(1));
+    config.set_div_latency(job.value("div_latency").toInt(1));
+    if (config.mult_latency() > MachineConfig::MULDIV_LATENCY_MAX
+        || config.div_latency() > MachineConfig::MULDIV_LATENCY_MAX) {
+        error = "Multiply or divide latency is out of range.";
+        return false;
+    }
+    if (job.contains("read_time")) {
+        config.set_memory_access_time_read(job.value("read_time").toInt());
+    }
+    if (job.contains("write_time")) {
+        config.set_memory_access_time_write(job.value("write_time").toInt());
+    }
+    if (job.contains("burst_time")) {
+        config.set_memory_access_time_burst(job.value("burst_time").toInt());
+    }
+    config.set_memory_stalls(job.value("memory_stalls").toBool(false));
+    if (!configure_dram(config, job.value("dram"), error)) {
+        return false;
+    }
+    if (job.contains("l2_hit_time")) {
+        config.set_cache_level2_hit_time(job.value("l2_hit_time").toInt());
+    }
+    if (job.contains("l2_inclusion")
+        && !config.set_cache_level2_inclusion(job.value("l2_inclusion").toString().toLower())) {
+        error = "Unknown level 2 cache inclusion specified.";
+        return false;
+    }
+    return configure_cache(*config.access_cache_program(), job.value("i_cache"), error)
+           && configure_cache(*config.access_cache_data(), job.value("d_cache"), error)
+           && configure_cache(*config.access_cache_level2(), job.value("l2_cache"), error);
+}
+
+static bool assemble(Machine &machine, const QString &file_name, QString &error) {
+    SymbolTableDb symtab(machine.symbol_table_rw(true));
+    machine.cache_sync();
+    SimpleAsm sasm;
+    // First error is reported, the messages are not printed from threads.
+    QObject::connect(
+        &sasm, &SimpleAsm::report_message,
+        [&error](
+            messagetype::Type type, const QString &file, int line, int column,
+            const QString &text, const QString &) {
+            if (type == messagetype::MSG_ERROR && error.isEmpty()) {
+                error = QString("%1:%2:%3:%4").arg(file).arg(line).arg(column).arg(text);
+            }
+        });
+    sasm.setup(machine.memory_data_bus_rw(), &symtab, 0x80020000_addr);
+    if (!sasm.process_file(file_name) || !sasm.finish()) {
+        if (error.isEmpty()) {
+            error = "Assembly of " + file_name + " failed.";
+        }
+        return false;
+    }
+    return true;
+}
+
+static QJsonObject report_registers(Machine &machine) {
+    QJsonObject regs;
+    regs.insert("pc", (qint64)machine.registers()->read_pc().get_raw());
+    QJsonArray gp;
+    for (int i = 0; i < 32; i++) {
+        gp.append((qint64)machine.registers()->read_gp(i).as_u32());
+    }
+    regs.insert("gp", gp);
+    regs.insert("hi", (qint64)machine.registers()->read_hi_lo(true).as_u32());
+    regs.insert("lo", (qint64)machine.registers()->read_hi_lo(false).as_u32());
+    QJsonObject cop0;
+    for (int i = 1; i < Cop0State::COP0REGS_CNT; i++) {
+        cop0.insert(
+            Cop0State::cop0reg_name((Cop0State::Cop0Registers)i),
+            (qint64)machine.cop0state()->read_cop0reg((Cop0State::Cop0Registers)i));
+    }
+    regs.insert("cop0", cop0);
+    return regs;
+}
+
+static QJsonObject report_cache(const Cache *cache) {
+    QJsonObject stats;
+    stats.insert("reads", (qint64)cache->get_read_count());
+    stats.insert("writes", (qint64)cache->get_write_count());
+    stats.insert("hit", (qint64)cache->get_hit_count());
+    stats.insert("miss", (qint64)cache->get_miss_count());
+    stats.insert("hit_rate", cache->get_hit_rate());
+    stats.insert("stalled_cycles", (qint64)cache->get_stall_count());
+    stats.insert("improved_speed", cache->get_speed_improvement());
+    if (cache->get_config().prefetch_policy() != CacheConfig::PF_NONE) {
+        stats.insert("prefetches", (qint64)cache->get_prefetch_count());
+        stats.insert("prefetch_useful", (qint64)cache->get_prefetch_useful_count());
+        stats.insert("prefetch_late", (qint64)cache->get_prefetch_late_count());
+        stats.insert("prefetch_useless", (qint64)cache->get_prefetch_useless_count());
+        stats.insert("prefetch_accuracy", cache->get_prefetch_accuracy());
+        stats.insert("prefetch_coverage", cache->get_prefetch_coverage());
+        stats.insert("prefetch_timeliness", cache->get_prefetch_timeliness());
+    }
+    return stats;
+}
+
+static QJsonObject report_dram(const Dram *dram) {
+    QJsonObject stats;
+    stats.insert("reads", (qint64)dram->get_read_count());
+    stats.insert("writes", (qint64)dram->get_write_count());
+    stats.insert("row_hits", (qint64)dram->get_row_hit_count());
+    stats.insert("row_misses", (qint64)dram->get_row_miss_count());
+    stats.insert("row_conflicts", (qint64)dram->get_row_conflict_count());
+    stats.insert("row_hit_rate", dram->get_row_hit_rate());
+    stats.insert("average_latency", dram->get_average_latency());
+    stats.insert("write_queue_drains", (qint64)dram->get_drain_count());
+    return stats;
+}
+
+static QJsonObject report_branch_prediction(const BranchPredictionUnit *unit) {
+    QJsonObject stats;
+    for (int i = BK_CONDITIONAL; i < BK_COUNT; i++) {
+        QJsonObject kind;
+        kind.insert("resolved", (qint64)unit->get_resolved_count((enum BranchKind)i));
+        kind.insert("mispredicted", (qint64)unit->get_mispredicted_count((enum BranchKind)i));
+        stats.insert(branch_kind_name((enum BranchKind)i), kind);
+    }
+    stats.insert("resolved", (qint64)unit->get_resolved_count());
+    stats.insert("mispredicted", (qint64)unit->get_mispredicted_count());
+    stats.insert("btb_misses", (qint64)unit->get_btb_miss_count());
+    stats.insert("accuracy", unit->get_accuracy());
+    return stats;
+}
+
+static QJsonObject report_issue(const CoreSuperscalar *core) {
+    QJsonObject stats;
+    stats.insert("instructions", (qint64)core->get_retired_count());
+    stats.insert("ipc", core->get_ipc());
+    stats.insert("dual_issue_rate", core->get_dual_issue_rate());
+    QJsonArray issue_cycles;
+    for (unsigned width = 0; width <= CoreSuperscalar::ISSUE_WIDTH; width++) {
+        issue_cycles.append((qint64)core->get_issue_count(width));
+    }
+    stats.insert("issue_cycles", issue_cycles);
+    QJsonObject empty_slots;
+    for (int i = 0; i < CoreSuperscalar::ES_COUNT; i++) {
+        const auto reason = (enum CoreSuperscalar::EmptySlotReason)i;
+        empty_slots.insert(
+            CoreSuperscalar::empty_slot_reason_name(reason),
+            (qint64)core->get_empty_slot_count(reason));
+    }
+    stats.insert("empty_slots", empty_slots);
+    return stats;
+}
+
+static bool report_dump_range(
+    Machine &machine,
+    const QJsonValue &range_spec,
+    QJsonArray &dumps,
+    QString &error) {
+    const QJsonObject range = range_spec.toObject();
+    const QJsonValue start_spec = range.value("start");
+    Address start;
+    if (start_spec.isString()) {
+        SymbolValue value;
+        if (machine.symbol_table() == nullptr
+            || !machine.symbol_table()->name_to_value(value, start_spec.toString())) {
+            error = "Unknown symbol " + start_spec.toString() + " in dump range.";
+            return false;
+        }
+        start = Address(value);
+    } else {
+        start = Address((uint64_t)start_spec.toDouble());
+    }
+    const uint64_t len = (uint64_t)range.value("length").toDouble();
+    Address end = start + len;
+    start = start & ~3;
+    if (end < start) {
+        end = 0xffffffff_addr;
+    }
+    QJsonArray data;
+    const MemoryDataBus *mem = machine.memory_data_bus();
+    for (Address addr = start; addr < end; addr += 4) {
+        data.append((qint64)mem->read_u32(addr, ae::INTERNAL));
+    }
+    QJsonObject dump;
+    dump.insert("start", (qint64)start.get_raw());
+    dump.insert("data", data);
+    dumps.append(dump);
+    return true;
+}
+
+QJsonObject BatchRunner::run_job(size_t index) const {
+    const QJsonObject &job = jobs[index];
+    QJsonObject result;
+    QElapsedTimer wall;
+    wall.start();
+    result.insert("index", (qint64)index);
+    if (job.contains("id")) {
+        result.insert("id", job.value("id"));
+    }
+
+    QString error;
+    MachineConfig config;
+    if (!configure_machine(config, job, error)) {
+        result.insert("status", "error");
+        result.insert("message", error);
+        return result;
+    }
+    const bool asm_source = job.value("asm").toBool(false);
+    const unsigned max_cycles = (unsigned)job.value("max_cycles").toDouble(0);
+    const qint64 timeout_ms = (qint64)job.value("timeout_ms").toDouble(0);
+
+    try {
+        Machine machine(config, !asm_source, !asm_source);
+        if (asm_source && !assemble(machine, config.elf(), error)) {
+            result.insert("status", "error");
+            result.insert("message", error);
+            return result;
+        }
+
+        QByteArray serial_out;
+        QObject::connect(
+            machine.serial_port(), &SerialPort::tx_byte,
+            [&serial_out](unsigned int data) { serial_out.append((char)data); });
+        QString trap_message;
+        QObject::connect(
+            &machine, &Machine::program_trap,
+            [&trap_message](SimulatorException &e) { trap_message = e.msg(false); });
+        // Same as in GUI, do not continue after stop on exception
+        bool stopped = false;
+        QObject::connect(machine.core(), &Core::stop_on_exception_reached, [&]() {
+            stopped = true;
+            machine.pause();
+        });
+
+        QString status;
+        for (;;) {
+            unsigned chunk = BATCH_CHUNK_CYCLES;
+            if (max_cycles != 0) {
+                chunk = std::min(chunk, max_cycles - machine.core()->get_cycle_count());
+            }
+            machine.run_cycles(chunk);
+            if (machine.status() == Machine::ST_EXIT) {
+                status = "exit";
+            } else if (machine.status() == Machine::ST_TRAPPED) {
+                status = "trap";
+            } else if (stopped) {
+                status = "stop";
+            } else if (max_cycles != 0 && machine.core()->get_cycle_count() >= max_cycles) {
+                status = "cycle-limit";
+            } else if (timeout_ms != 0 && wall.elapsed() >= timeout_ms) {
+                status = "timeout";
+            } else {
+                continue;
+            }
+            break;
+        }
+
+        result.insert("status", status);
+        if (!trap_message.isEmpty()) {
+            result.insert("message", trap_message);
+        }
+        if (stopped) {
+            result.insert("exception", (int)machine.get_exception_cause());
+        }
+        result.insert("cycles", (qint64)machine.core()->get_cycle_count());
+        result.insert("stalls", (qint64)machine.core()->get_stall_count());
+        QJsonObject stall_reasons;
+        for (int i = 0; i < SR_COUNT; i++) {
+            stall_reasons.insert(
+                stall_reason_name((enum StallReason)i),
+                (qint64)machine.core()->get_stall_count((enum StallReason)i));
+        }
+        result.insert("stall_reasons", stall_reasons);
+        if (config.memory_stalls()) {
+            result.insert("memory_stalls", (qint64)machine.core()->get_memory_stall_count());
+        }
+        if (config.dram_enabled()) {
+            result.insert("dram_stats", report_dram(machine.dram()));
+        }
+        if (machine.core_superscalar() != nullptr) {
+            result.insert("issue_stats", report_issue(machine.core_superscalar()));
+        }
+        if (machine.core()->get_branch_prediction() != nullptr) {
+            result.insert(
+                "branch_stats", report_branch_prediction(machine.core()->get_branch_prediction()));
+        }
+        if (job.value("registers").toBool(false)) {
+            result.insert("registers", report_registers(machine));
+        }
+        if (job.value("cache_stats").toBool(false)) {
+            QJsonObject caches;
+            caches.insert("i", report_cache(machine.cache_program()));
+            caches.insert("d", report_cache(machine.cache_data()));
+            if (machine.cache_level2()->get_config().enabled()) {
+                caches.insert("l2", report_cache(machine.cache_level2()));
+            }
+            result.insert("cache_stats", caches);
+        }
+        if (job.contains("dump_ranges")) {
+            // Dirty cache lines are written back, dumps show the program view.
+            machine.cache_sync();
+            QJsonArray dumps;
+            for (const QJsonValue &range : job.value("dump_ranges").toArray()) {
+                if (!report_dump_range(machine, range, dumps, error)) {
+                    result.insert("status", "error");
+                    result.insert("message", error);
+                    break;
+                }
+            }
+            result.insert("dump_ranges", dumps);
+        }
+        if (!serial_out.isEmpty()) {
+            result.insert(
+                "serial_out", QString::fromLatin1(serial_out.constData(), serial_out.size()));
+        }
+    } catch (SimulatorException &e) {
+        result.insert("status", "error");
+        result.insert("message", e.msg(false));
+    }
+    result.insert("wall_ms", wall.elapsed());
+    return result;
+}
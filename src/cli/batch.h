@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * Runs many independent programs on a pool of threads, every job gets its own
+ * machine. Result of each job is written as single JSON line in the order the
+ * jobs finish.
+ *
+ * Job file is JSON array of jobs or object with "jobs" array and optional
+ * "defaults" object, values of which are used for keys missing in a job.
+ * Recognized job keys:
+ *
+ *   id            any value, copied to the result
+ *   file          ELF executable or assembler source (required)
+ *   asm           treat file as assembler source
+ *   pipelined, delay_slot, hazard_unit
+ *   superscalar   pipelined core issues up to two instructions per cycle
+ *                 (implies pipelined),
+ *                 its statistics are reported as issue_stats
+ *   branch_predictor (not-taken/taken/bimodal/gshare/tournament),
+ *   bp_table_bits, bp_history_bits, btb_bits, ras_size
+ *                 branch prediction of pipelined core without delay slot,
+ *                 its statistics are reported as branch_stats
+ *   mult_latency, div_latency
+ *                 cycles of multiply and divide in pipelined core
+ *   read_time, write_time, burst_time
+ *   memory_stalls core waits for memory access times (see MachineConfig)
+ *   dram          object with banks, row_size (bytes), page_policy
+ *                 (open/closed), t_rcd, t_cas, t_rp and write_queue, main
+ *                 memory timing by DRAM model, its statistics are reported
+ *                 as dram_stats
+ *   i_cache, d_cache, l2_cache
+ *                 object with policy (random/lru/lfu), sets, block_size,
+ *                 associativity, write (wb/wt/wtna/wta), prefetch
+ *                 (none/next-line/stride/stream), prefetch_degree and
+ *                 prefetch_distance
+ *   l2_hit_time, l2_inclusion (nine/inclusive/exclusive)
+ *   max_cycles    stop the job after given number of cycles (0 no limit)
+ *   timeout_ms    stop the job after given wall clock time (0 no limit)
+ *   registers     report registers
+ *   cache_stats   report cache statistics
+ *   dump_ranges   array of objects with start (address or symbol) and length
+ *                 in bytes, memory content is reported as array of words
+ *
+ * Result contains id, index of the job, status (exit, trap, stop,
+ * cycle-limit, timeout or error), cycles, stalls, stall_reasons, wall_ms and
+ * the requested reports. Output of the serial port is reported as serial_out.
+ */
+class BatchRunner {
+public:
+    explicit BatchRunner(std::ostream &out);
+
+    // Returns false and sets error when the job file cannot be used
+    bool load(const QString &file_name, QString &error);
+    void run(unsigned threads);
+
+    size_t job_count() const;
+
+private:
+    void worker();
+    QJsonObject run_job(size_t index) const;
+
+    std::ostream &out;
+    std::vector<QJsonObject> jobs;
+    // Jobs are taken in order by any free thread, long jobs do not block
+    // the other threads.
+    std::atomic<size_t> next_job { 0 };
+    std::mutex out_mutex;
+};
+
+#endif // BATCH_H
@@ -34,10 +34,12 @@
  ******************************************************************************/
 
 #include "assembler/simpleasm.h"
+#include "batch.h"
 #include "chariohandler.h"
 #include "common/logging.h"
 #include "common/logging_format_colors.h"
 #include "machine/machineconfig.h"
+#include "machine/memory/cache/cache_replay.h"
 #include "msgreport.h"
 #include "reporter.h"
 #include "tracer.h"
@@ -46,8 +48,12 @@
 #include <QCoreApplication>
 #include <QFile>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <utility>
 
@@ -68,10 +74,21 @@ void create_parser(QCommandLineParser &p) {
     // p.addOptions({}); available only from Qt 5.4+
     p.addOption({ "asm", "Treat provided file argument as assembler source." });
     p.addOption({ "pipelined", "Configure CPU to use five stage pipeline." });
+    p.addOption({ "superscalar", "Issue up to two instructions per cycle (implies --pipelined)." });
     p.addOption({ "no-delay-slot", "Disable jump delay slot." });
     p.addOption({ "hazard-unit",
                   "Specify hazard unit imeplementation [none|stall|forward].",
                   "HUKIND" });
+    p.addOption({ "branch-predictor",
+                  "Branch predictor of pipelined core without delay slot "
+                  "[not-taken|taken|bimodal|gshare|tournament].",
+                  "BPKIND" });
+    p.addOption({ "bp-table-bits", "Log2 of branch predictor counter table size.", "BITS" });
+    p.addOption({ "bp-history-bits", "Global branch history length of gshare.", "BITS" });
+    p.addOption({ "btb-bits", "Log2 of branch target buffer entries.", "BITS" });
+    p.addOption({ "ras-size", "Return address stack depth (0 disables it).", "SIZE" });
+    p.addOption({ "mult-latency", "Cycles of multiply in pipelined core (default 1).", "CYCLES" });
+    p.addOption({ "div-latency", "Cycles of divide in pipelined core (default 1).", "CYCLES" });
     p.addOption(
         { { "trace-fetch", "tr-fetch" },
           "Trace fetched instruction (for both pipelined and not core)." });
@@ -99,6 +116,10 @@ void create_parser(QCommandLineParser &p) {
                   "Dump registers state at program exit." });
     p.addOption(
         { "dump-cache-stats", "Dump cache statistics at program exit." });
+    p.addOption(
+        { "dump-cache-misses",
+          "Dump classification of cache misses (compulsory, capacity, "
+          "conflict) and misses by symbol at program exit." });
     p.addOption(
         { "dump-cycles", "Dump number of CPU cycles till program end." });
     p.addOption({ "dump-range", "Dump memory range.", "START,LENGTH,FNAME" });
@@ -116,22 +137,95 @@ void create_parser(QCommandLineParser &p) {
     p.addOption(
         { "d-cache",
           "Data cache. Format policy,sets,words_in_blocks,associativity where "
-          "policy is random/lru/lfu",
+          "policy is random/lru/lfu, optionally followed by write policy "
+          "wb/wt/wtna/wta and prefetcher none/next-line/stride/stream with "
+          "optional :degree:distance",
           "DCACHE" });
     p.addOption(
         { "i-cache",
           "Instruction cache. Format policy,sets,words_in_blocks,associativity "
-          "where policy is random/lru/lfu",
+          "where policy is random/lru/lfu, optionally followed by write policy "
+          "and prefetcher as for d-cache",
           "ICACHE" });
+    p.addOption(
+        { "l2-cache",
+          "Unified level 2 cache between i-cache, d-cache and memory. Format "
+          "policy,sets,words_in_blocks,associativity where policy is "
+          "random/lru/lfu, optionally followed by write policy and prefetcher "
+          "as for d-cache",
+          "L2CACHE" });
+    p.addOption({ "l2-hit-time", "Level 2 cache access time (cycles).", "L2TIME" });
+    p.addOption({ "l2-inclusion",
+                  "Level 2 cache inclusion policy [nine|inclusive|exclusive].",
+                  "INCLUSION" });
     p.addOption({ "read-time", "Memory read access time (cycles).", "RTIME" });
     p.addOption({ "write-time", "Memory read access time (cycles).", "WTIME" });
     p.addOption({ "burst-time", "Memory read access time (cycles).", "BTIME" });
+    p.addOption(
+        { "memory-stalls",
+          "Core waits for memory access times of cache misses, write backs and "
+          "uncached accesses, cycle counts then include them." });
+    p.addOption(
+        { "dram",
+          "DRAM timing model of main memory instead of access times. Format "
+          "banks,row_bytes,page_policy where page policy is open/closed.",
+          "DRAM" });
+    p.addOption({ "dram-timing", "DRAM tRCD,tCAS,tRP (cycles).", "TIMING" });
+    p.addOption(
+        { "dram-write-queue", "DRAM write queue depth (0 writes immediately).", "DEPTH" });
     p.addOption({ { "serial-in", "serin" },
                   "File connected to the serial port input.",
                   "FNAME" });
     p.addOption({ { "serial-out", "serout" },
                   "File connected to the serial port output.",
                   "FNAME" });
+    p.addOption(
+        { "fast",
+          "Run simulation in a tight loop without returning to the event loop "
+          "after each instruction." });
+    p.addOption(
+        { "poll-interval",
+          "Number of cycles between serial input and event checks in fast "
+          "mode (default 10000).",
+          "CYCLES" });
+    p.addOption(
+        { "save-checkpoint-at",
+          "Save machine state to checkpoint file when given cycle is reached.",
+          "CYCLE,FNAME" });
+    p.addOption(
+        { "restore-checkpoint",
+          "Restore machine state from checkpoint file before start. Machine "
+          "has to be configured the same way as when it was saved.",
+          "FNAME" });
+    p.addOption(
+        { "memory-trace",
+          "Record accesses of caches to memory trace file for later replay.",
+          "FNAME" });
+    p.addOption(
+        { "replay-trace",
+          "Replay memory trace instead of running a program. Every i-cache and "
+          "d-cache option adds one cache to simulate, statistics of all of "
+          "them are printed.",
+          "FNAME" });
+    p.addOption(
+        { "cache-sweep",
+          "With replay-trace, compute hits of LRU write allocate caches of all "
+          "listed configurations in single pass. Range LOW..HIGH stands for "
+          "powers of two from LOW to HIGH, default "
+          "sets=1..1024,ways=1..16,block=1..16 (block in words).",
+          "SPEC" });
+    p.addOption(
+        { "batch",
+          "Run jobs described in JSON file in parallel threads (see batch.h), "
+          "result of every job is printed as JSON line.",
+          "FNAME" });
+    p.addOption(
+        { "batch-threads",
+          "Number of threads running batch jobs (default number of CPUs).",
+          "COUNT" });
+    p.addOption(
+        { "batch-output", "Write batch results to file instead of standard output.",
+          "FNAME" });
 }
 
 void configure_cache(
@@ -197,6 +291,137 @@ void configure_cache(
             exit(1);
         }
     }
+    if (pieces.size() > 4) {
+        // Prefetcher with optional degree and distance, e.g. stride:2:4
+        QStringList prefetch = pieces.at(4).split(":");
+        if (!cacheconf.set_prefetch_policy(prefetch.at(0).toLower())) {
+            std::cerr << "Prefetch policy for " << which.toLocal8Bit().data()
+                      << " cache is incorrect (correct none/next-line/stride/stream)."
+                      << std::endl;
+            exit(1);
+        }
+        for (int i = 1; i < prefetch.size(); i++) {
+            bool ok;
+            unsigned value = prefetch.at(i).toUInt(&ok);
+            if (!ok || value == 0 || value > CacheConfig::PREFETCH_MAX || i > 2) {
+                std::cerr << "Prefetch policy for " << which.toLocal8Bit().data()
+                          << " cache has to be POLICY[:DEGREE[:DISTANCE]], degree and "
+                             "distance from 1 to "
+                          << CacheConfig::PREFETCH_MAX << "." << std::endl;
+                exit(1);
+            }
+            if (i == 1) {
+                cacheconf.set_prefetch_degree(value);
+            } else {
+                cacheconf.set_prefetch_distance(value);
+            }
+        }
+    }
+}
+
+void configure_access_times(QCommandLineParser &p, MachineConfig &cc) {
+    int siz = p.values("read-time").size();
+    if (siz >= 1) {
+        cc.set_memory_access_time_read(
+            p.values("read-time").at(siz - 1).toLong());
+    }
+    siz = p.values("write-time").size();
+    if (siz >= 1) {
+        cc.set_memory_access_time_write(
+            p.values("write-time").at(siz - 1).toLong());
+    }
+    siz = p.values("burst-time").size();
+    if (siz >= 1) {
+        cc.set_memory_access_time_burst(
+            p.values("burst-time").at(siz - 1).toLong());
+    }
+    cc.set_memory_stalls(p.isSet("memory-stalls"));
+}
+
+static unsigned unsigned_option_value(QCommandLineParser &p, const char *name, unsigned max) {
+    bool ok;
+    unsigned value = p.values(name).last().toUInt(&ok);
+    if (!ok || value > max) {
+        std::cerr << "Value of --" << name << " has to be number up to " << max << std::endl;
+        exit(1);
+    }
+    return value;
+}
+
+void configure_branch_predictor(QCommandLineParser &p, MachineConfig &cc) {
+    if (p.isSet("branch-predictor")) {
+        QString bpkind = p.values("branch-predictor").last().toLower();
+        if (!cc.set_branch_predictor(bpkind)) {
+            std::cerr << "Unknown kind of branch predictor specified" << std::endl;
+            exit(1);
+        }
+    }
+    if (p.isSet("bp-table-bits")) {
+        cc.set_branch_predictor_bits(
+            unsigned_option_value(p, "bp-table-bits", MachineConfig::BP_BITS_MAX));
+    }
+    if (p.isSet("bp-history-bits")) {
+        cc.set_branch_history_bits(
+            unsigned_option_value(p, "bp-history-bits", MachineConfig::BP_BITS_MAX));
+    }
+    if (p.isSet("btb-bits")) {
+        cc.set_btb_bits(unsigned_option_value(p, "btb-bits", MachineConfig::BP_BITS_MAX));
+    }
+    if (p.isSet("ras-size")) {
+        cc.set_ras_size(unsigned_option_value(p, "ras-size", MachineConfig::BP_RAS_SIZE_MAX));
+    }
+}
+
+void configure_muldiv_latency(QCommandLineParser &p, MachineConfig &cc) {
+    if (p.isSet("mult-latency")) {
+        cc.set_mult_latency(
+            unsigned_option_value(p, "mult-latency", MachineConfig::MULDIV_LATENCY_MAX));
+    }
+    if (p.isSet("div-latency")) {
+        cc.set_div_latency(
+            unsigned_option_value(p, "div-latency", MachineConfig::MULDIV_LATENCY_MAX));
+    }
+}
+
+void configure_dram(QCommandLineParser &p, MachineConfig &cc) {
+    if (p.isSet("dram")) {
+        cc.set_dram_enabled(true);
+        QStringList pieces = p.values("dram").last().split(",");
+        bool ok_banks = false, ok_row = false;
+        const unsigned banks = pieces.at(0).toUInt(&ok_banks);
+        const unsigned row_size = pieces.size() > 1 ? pieces.at(1).toUInt(&ok_row) : 0;
+        if (!ok_banks || !ok_row || banks == 0 || banks > MachineConfig::DRAM_BANKS_MAX
+            || row_size < 4 || row_size > MachineConfig::DRAM_ROW_SIZE_MAX) {
+            std::cerr << "Parameters for DRAM incorrect (correct 4,1024,open)." << std::endl;
+            exit(1);
+        }
+        cc.set_dram_banks(banks);
+        cc.set_dram_row_size(row_size);
+        if (pieces.size() > 2 && !cc.set_dram_page_policy(pieces.at(2).toLower())) {
+            std::cerr << "DRAM page policy is incorrect (correct open/closed)." << std::endl;
+            exit(1);
+        }
+    }
+    if (p.isSet("dram-timing")) {
+        QStringList pieces = p.values("dram-timing").last().split(",");
+        unsigned timing[3];
+        for (int i = 0; i < 3; i++) {
+            bool ok = false;
+            timing[i] = i < pieces.size() ? pieces.at(i).toUInt(&ok) : 0;
+            if (!ok || timing[i] > MachineConfig::DRAM_TIMING_MAX) {
+                std::cerr << "DRAM timing incorrect (correct 5,5,5), values up to "
+                          << MachineConfig::DRAM_TIMING_MAX << "." << std::endl;
+                exit(1);
+            }
+        }
+        cc.set_dram_t_rcd(timing[0]);
+        cc.set_dram_t_cas(timing[1]);
+        cc.set_dram_t_rp(timing[2]);
+    }
+    if (p.isSet("dram-write-queue")) {
+        cc.set_dram_write_queue(
+            unsigned_option_value(p, "dram-write-queue", MachineConfig::DRAM_WRITE_QUEUE_MAX));
+    }
 }
 
 void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
@@ -209,7 +434,8 @@ void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
     cc.set_elf(pa[0]);
 
     cc.set_delay_slot(!p.isSet("no-delay-slot"));
-    cc.set_pipelined(p.isSet("pipelined"));
+    cc.set_pipelined(p.isSet("pipelined") || p.isSet("superscalar"));
+    cc.set_superscalar(p.isSet("superscalar"));
 
     siz = p.values("hazard-unit").size();
     if (siz >= 1) {
@@ -219,33 +445,36 @@ void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
             exit(1);
         }
     }
+    configure_branch_predictor(p, cc);
+    configure_muldiv_latency(p, cc);
 
-    siz = p.values("read-time").size();
-    if (siz >= 1) {
-        cc.set_memory_access_time_read(
-            p.values("read-time").at(siz - 1).toLong());
-    }
-    siz = p.values("write-time").size();
-    if (siz >= 1) {
-        cc.set_memory_access_time_write(
-            p.values("write-time").at(siz - 1).toLong());
-    }
-    siz = p.values("burst-time").size();
-    if (siz >= 1) {
-        cc.set_memory_access_time_burst(
-            p.values("burst-time").at(siz - 1).toLong());
-    }
+    configure_access_times(p, cc);
+    configure_dram(p, cc);
 
     configure_cache(*cc.access_cache_data(), p.values("d-cache"), "data");
     configure_cache(
         *cc.access_cache_program(), p.values("i-cache"), "instruction");
+    configure_cache(*cc.access_cache_level2(), p.values("l2-cache"), "level 2");
+    siz = p.values("l2-hit-time").size();
+    if (siz >= 1) {
+        cc.set_cache_level2_hit_time(p.values("l2-hit-time").at(siz - 1).toLong());
+    }
+    siz = p.values("l2-inclusion").size();
+    if (siz >= 1) {
+        QString inclusion = p.values("l2-inclusion").at(siz - 1).toLower();
+        if (!cc.set_cache_level2_inclusion(inclusion)) {
+            std::cerr << "Unknown level 2 cache inclusion specified" << std::endl;
+            exit(1);
+        }
+    }
 }
 
 void configure_tracer(QCommandLineParser &p, Tracer &tr) {
     if (p.isSet("trace-fetch")) {
         tr.fetch();
     }
-    if (p.isSet("pipelined")) { // Following are added only if we have stages
+    // Following are added only if we have stages
+    if (p.isSet("pipelined") || p.isSet("superscalar")) {
         if (p.isSet("trace-decode")) {
             tr.decode();
         }
@@ -303,6 +532,9 @@ void configure_reporter(
     if (p.isSet("dump-cache-stats")) {
         r.cache_stats();
     }
+    if (p.isSet("dump-cache-misses")) {
+        r.cache_misses();
+    }
     if (p.isSet("dump-cycles")) {
         r.cycles();
     }
@@ -477,6 +709,202 @@ void load_ranges(Machine &machine, const QStringList &ranges) {
     }
 }
 
+void configure_checkpoints(QCommandLineParser &p, Machine &machine) {
+    int siz = p.values("restore-checkpoint").size();
+    if (siz >= 1) {
+        try {
+            machine.restore_checkpoint(p.values("restore-checkpoint").at(siz - 1));
+        } catch (SimulatorException &e) {
+            cout << "Checkpoint restore failed: " << e.msg(false).toStdString()
+                 << endl;
+            exit(1);
+        }
+    }
+    siz = p.values("save-checkpoint-at").size();
+    if (siz >= 1) {
+        QString checkpoint_arg = p.values("save-checkpoint-at").at(siz - 1);
+        int comma = checkpoint_arg.indexOf(",");
+        bool ok = comma > 0;
+        unsigned cycle = 0;
+        if (ok) {
+            cycle = checkpoint_arg.mid(0, comma).toUInt(&ok, 0);
+        }
+        if (!ok || cycle == 0 || comma + 1 >= checkpoint_arg.size()) {
+            cout << "Checkpoint has to be specified as positive cycle number "
+                    "and file name."
+                 << endl;
+            exit(1);
+        }
+        machine.set_checkpoint_at(cycle, checkpoint_arg.mid(comma + 1));
+    }
+}
+
+void configure_memory_trace(QCommandLineParser &p, Machine &machine) {
+    int siz = p.values("memory-trace").size();
+    if (siz >= 1) {
+        try {
+            machine.set_memory_trace(p.values("memory-trace").at(siz - 1));
+        } catch (SimulatorException &e) {
+            cout << "Memory trace failed: " << e.msg(false).toStdString() << endl;
+            exit(1);
+        }
+    }
+}
+
+void print_replay_stats(const QString &name, const Cache *cache) {
+    const string prefix = name.toStdString() + ":";
+    cout << prefix << "reads:" << cache->get_read_count() << endl;
+    cout << prefix << "writes:" << cache->get_write_count() << endl;
+    cout << prefix << "hit:" << cache->get_hit_count() << endl;
+    cout << prefix << "miss:" << cache->get_miss_count() << endl;
+    cout << prefix << "hit-rate:" << cache->get_hit_rate() << endl;
+    cout << prefix << "stalled-cycles:" << cache->get_stall_count() << endl;
+    cout << prefix << "improved-speed:" << cache->get_speed_improvement() << endl;
+    if (cache->get_config().prefetch_policy() != CacheConfig::PF_NONE) {
+        cout << prefix << "prefetches:" << cache->get_prefetch_count() << endl;
+        cout << prefix << "prefetch-accuracy:" << cache->get_prefetch_accuracy() << endl;
+        cout << prefix << "prefetch-coverage:" << cache->get_prefetch_coverage() << endl;
+    }
+}
+
+// Returns associativities to report
+std::vector<size_t> configure_sweep(QCommandLineParser &p, CacheReplay &replay) {
+    std::vector<size_t> set_counts, ways, block_sizes;
+    CacheSweep::parse_range("1..1024", set_counts);
+    CacheSweep::parse_range("1..16", ways);
+    CacheSweep::parse_range("1..16", block_sizes);
+    int siz = p.values("cache-sweep").size();
+    if (siz >= 1 && !p.values("cache-sweep").at(siz - 1).isEmpty()) {
+        foreach (QString item, p.values("cache-sweep").at(siz - 1).split(",")) {
+            QStringList pair = item.split("=");
+            bool ok = pair.size() == 2;
+            if (ok && pair.at(0) == "sets") {
+                ok = CacheSweep::parse_range(pair.at(1), set_counts);
+            } else if (ok && pair.at(0) == "ways") {
+                ok = CacheSweep::parse_range(pair.at(1), ways);
+            } else if (ok && pair.at(0) == "block") {
+                ok = CacheSweep::parse_range(pair.at(1), block_sizes);
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                cout << "Cache sweep has to be specified as "
+                        "sets=LOW..HIGH,ways=LOW..HIGH,block=LOW..HIGH."
+                     << endl;
+                exit(1);
+            }
+        }
+    }
+    replay.add_sweep(TRACE_PROGRAM, set_counts, block_sizes, ways.back());
+    replay.add_sweep(TRACE_DATA, set_counts, block_sizes, ways.back());
+    return ways;
+}
+
+void print_sweep_table(const CacheSweep *sweep, const std::vector<size_t> &ways_list) {
+    const char *name = sweep->get_stream() == TRACE_PROGRAM ? "i-cache" : "d-cache";
+    for (size_t block_size : sweep->get_block_sizes()) {
+        const uint64_t accesses = sweep->get_access_count(block_size);
+        for (size_t set_count : sweep->get_set_counts()) {
+            for (size_t ways : ways_list) {
+                const uint64_t hits = sweep->get_hit_count(set_count, block_size, ways);
+                cout << left << setw(8) << name << right << setw(6) << block_size
+                     << setw(6) << set_count << setw(6) << ways << setw(12)
+                     << accesses << setw(12) << hits << setw(9) << fixed
+                     << setprecision(2)
+                     << (accesses == 0 ? 0.0 : 100.0 * hits / accesses) << endl;
+            }
+        }
+    }
+}
+
+int run_replay(QCommandLineParser &p) {
+    MachineConfig cc;
+    configure_access_times(p, cc);
+    CacheReplay replay(
+        cc.memory_access_time_read(), cc.memory_access_time_write(),
+        cc.memory_access_time_burst());
+    QStringList names;
+    for (const QString &value : p.values("i-cache")) {
+        CacheConfig conf;
+        configure_cache(conf, { value }, "instruction");
+        replay.add_cache(conf, TRACE_PROGRAM);
+        names.append("i-cache[" + value + "]");
+    }
+    for (const QString &value : p.values("d-cache")) {
+        CacheConfig conf;
+        configure_cache(conf, { value }, "data");
+        replay.add_cache(conf, TRACE_DATA);
+        names.append("d-cache[" + value + "]");
+    }
+    std::vector<size_t> sweep_ways;
+    if (p.isSet("cache-sweep")) {
+        sweep_ways = configure_sweep(p, replay);
+    }
+    if (replay.cache_count() == 0 && replay.sweep_count() == 0) {
+        cout << "At least one i-cache or d-cache or cache-sweep has to be "
+                "specified for replay."
+             << endl;
+        return 1;
+    }
+
+    uint64_t records;
+    try {
+        MemoryTraceReader reader(p.value("replay-trace"));
+        records = replay.replay(reader);
+    } catch (SimulatorException &e) {
+        cout << "Memory trace replay failed: " << e.msg(false).toStdString()
+             << endl;
+        return 1;
+    }
+    cout << "Replayed records:" << records << endl;
+    for (size_t i = 0; i < replay.cache_count(); i++) {
+        print_replay_stats(names.at(i), replay.cache(i));
+    }
+    if (replay.sweep_count() > 0) {
+        cout << "Cache sweep (LRU, write allocate):" << endl;
+        cout << left << setw(8) << "cache" << right << setw(6) << "block" << setw(6)
+             << "sets" << setw(6) << "ways" << setw(12) << "accesses" << setw(12)
+             << "hits" << setw(9) << "hit-rate" << endl;
+        for (size_t i = 0; i < replay.sweep_count(); i++) {
+            print_sweep_table(replay.sweep(i), sweep_ways);
+        }
+    }
+    return 0;
+}
+
+int run_batch(QCommandLineParser &p) {
+    unsigned threads = std::max(QThread::idealThreadCount(), 1);
+    int siz = p.values("batch-threads").size();
+    if (siz >= 1) {
+        bool ok;
+        threads = p.values("batch-threads").at(siz - 1).toUInt(&ok, 0);
+        if (!ok || threads == 0) {
+            cout << "Batch threads has to be positive number." << endl;
+            exit(1);
+        }
+    }
+    ofstream file_out;
+    siz = p.values("batch-output").size();
+    if (siz >= 1) {
+        file_out.open(
+            p.values("batch-output").at(siz - 1).toLocal8Bit().data(),
+            ios::out | ios::trunc);
+        if (!file_out.is_open()) {
+            cout << "Batch output file cannot be open for write." << endl;
+            exit(1);
+        }
+    }
+
+    BatchRunner runner(file_out.is_open() ? file_out : cout);
+    QString error;
+    if (!runner.load(p.value("batch"), error)) {
+        cout << error.toStdString() << endl;
+        return 1;
+    }
+    runner.run(threads);
+    return 0;
+}
+
 bool assemble(Machine &machine, MsgReport &msgrep, QString filename) {
     SymbolTableDb symtab(machine.symbol_table_rw(true));
     machine::FrontendMemory *mem = machine.memory_data_bus_rw();
@@ -508,6 +936,13 @@ int main(int argc, char *argv[]) {
     create_parser(p);
     p.process(app);
 
+    if (p.isSet("batch")) {
+        return run_batch(p);
+    }
+    if (p.isSet("replay-trace")) {
+        return run_replay(p);
+    }
+
     bool asm_source = p.isSet("asm");
 
     MachineConfig cc;
@@ -531,6 +966,32 @@ int main(int argc, char *argv[]) {
 
     load_ranges(machine, p.values("load-range"));
 
-    machine.play();
+    configure_memory_trace(p, machine);
+    configure_checkpoints(p, machine);
+
+    // Same as in GUI, do not continue after stop on exception
+    QObject::connect(
+        machine.core(), &Core::stop_on_exception_reached, &machine,
+        &Machine::pause);
+
+    if (p.isSet("fast")) {
+        unsigned int poll_cycles = 10000;
+        int siz = p.values("poll-interval").size();
+        if (siz >= 1) {
+            bool ok;
+            poll_cycles = p.values("poll-interval").at(siz - 1).toUInt(&ok, 0);
+            if (!ok || poll_cycles == 0) {
+                cout << "Poll interval has to be positive number of cycles."
+                     << endl;
+                exit(1);
+            }
+        }
+        // Run from the event loop so reporter can request application exit
+        QTimer::singleShot(0, &machine, [&machine, poll_cycles]() {
+            machine.run_until_exit(poll_cycles);
+        });
+    } else {
+        machine.play();
+    }
     return QCoreApplication::exec();
 }
@@ -35,11 +35,15 @@
 
 #include "reporter.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace machine;
 using namespace std;
@@ -56,6 +60,7 @@ Reporter::Reporter(QCoreApplication *app, Machine *machine) : QObject() {
 
     e_regs = false;
     e_cache_stats = false;
+    e_cache_misses = false;
     e_cycles = false;
     e_fail = (enum FailReason)0;
 }
@@ -68,6 +73,11 @@ void Reporter::cache_stats() {
     e_cache_stats = true;
 }
 
+void Reporter::cache_misses() {
+    e_cache_misses = true;
+    machine->set_cache_miss_analysis(true);
+}
+
 void Reporter::cycles() {
     e_cycles = true;
 }
@@ -161,6 +171,160 @@ static void out_hex(ostream &out, uint64_t val, int digits) {
     out.flags(saveflg);
 }
 
+void Reporter::report_cache_prefetch(const char *name, const Cache *cache) {
+    if (cache->get_config().prefetch_policy() == CacheConfig::PF_NONE) {
+        return;
+    }
+    cout << name << ":prefetches:" << cache->get_prefetch_count() << endl;
+    cout << name << ":prefetch-useful:" << cache->get_prefetch_useful_count() << endl;
+    cout << name << ":prefetch-late:" << cache->get_prefetch_late_count() << endl;
+    cout << name << ":prefetch-useless:" << cache->get_prefetch_useless_count() << endl;
+    cout << name << ":prefetch-accuracy:" << cache->get_prefetch_accuracy() << endl;
+    cout << name << ":prefetch-coverage:" << cache->get_prefetch_coverage() << endl;
+    cout << name << ":prefetch-timeliness:" << cache->get_prefetch_timeliness() << endl;
+}
+
+void Reporter::report_branch_prediction(const BranchPredictionUnit *unit) {
+    if (unit == nullptr) {
+        return;
+    }
+    for (int i = BK_CONDITIONAL; i < BK_COUNT; i++) {
+        const char *kind = branch_kind_name((enum BranchKind)i);
+        cout << "branch:" << kind << ":resolved:" << unit->get_resolved_count((enum BranchKind)i)
+             << endl;
+        cout << "branch:" << kind
+             << ":mispredicted:" << unit->get_mispredicted_count((enum BranchKind)i) << endl;
+    }
+    cout << "branch:resolved:" << unit->get_resolved_count() << endl;
+    cout << "branch:mispredicted:" << unit->get_mispredicted_count() << endl;
+    cout << "branch:btb-misses:" << unit->get_btb_miss_count() << endl;
+    cout << "branch:accuracy:" << unit->get_accuracy() << endl;
+}
+
+void Reporter::report_issue(const CoreSuperscalar *core) {
+    if (core == nullptr) {
+        return;
+    }
+    cout << "issue:instructions:" << core->get_retired_count() << endl;
+    cout << "issue:ipc:" << core->get_ipc() << endl;
+    cout << "issue:dual-issue-rate:" << core->get_dual_issue_rate() << endl;
+    for (unsigned width = 0; width <= CoreSuperscalar::ISSUE_WIDTH; width++) {
+        cout << "issue:cycles:" << width << ":" << core->get_issue_count(width) << endl;
+    }
+    for (int i = 0; i < CoreSuperscalar::ES_COUNT; i++) {
+        const auto reason = (enum CoreSuperscalar::EmptySlotReason)i;
+        cout << "issue:empty-slots:" << CoreSuperscalar::empty_slot_reason_name(reason) << ":"
+             << core->get_empty_slot_count(reason) << endl;
+    }
+}
+
+/**
+ * Prints stall cycles by reason and table of them by address of instruction,
+ * which caused them, most stalling instructions first.
+ */
+void Reporter::report_stalls() {
+    const Core *core = machine->core();
+    for (int reason = 0; reason < SR_COUNT; reason++) {
+        cout << "stalls:" << stall_reason_name((enum StallReason)reason) << ":"
+             << core->get_stall_count((enum StallReason)reason) << endl;
+    }
+
+    vector<pair<uint64_t, StallCounts>> rows(
+        core->get_pc_stalls().begin(), core->get_pc_stalls().end());
+    if (rows.empty()) {
+        return;
+    }
+    sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+        if (a.second.total() != b.second.total()) {
+            return a.second.total() > b.second.total();
+        }
+        return a.first < b.first;
+    });
+
+    const SymbolTable *symtab = machine->symbol_table();
+    cout << "stalls-by-address:" << endl;
+    cout << setw(10) << "address" << setw(8) << "stalls";
+    for (int reason = 0; reason < SR_COUNT; reason++) {
+        const char *name = stall_reason_name((enum StallReason)reason);
+        cout << setw(strlen(name) + 2) << name;
+    }
+    cout << "  symbol" << endl;
+    for (const auto &row : rows) {
+        cout << "  ";
+        out_hex(cout, row.first, 8);
+        cout << setw(8) << row.second.total();
+        for (int reason = 0; reason < SR_COUNT; reason++) {
+            cout << setw(strlen(stall_reason_name((enum StallReason)reason)) + 2)
+                 << row.second.count[reason];
+        }
+        QString symbol;
+        SymbolValue offset;
+        if (symtab != nullptr && symtab->location_to_symbol(symbol, offset, row.first)) {
+            cout << "  " << symbol.toStdString() << "+0x" << hex << offset << dec;
+        }
+        cout << endl;
+    }
+}
+
+void Reporter::report_dram(const Dram *dram) {
+    cout << "dram:reads:" << dram->get_read_count() << endl;
+    cout << "dram:writes:" << dram->get_write_count() << endl;
+    cout << "dram:row-hits:" << dram->get_row_hit_count() << endl;
+    cout << "dram:row-misses:" << dram->get_row_miss_count() << endl;
+    cout << "dram:row-conflicts:" << dram->get_row_conflict_count() << endl;
+    cout << "dram:row-hit-rate:" << dram->get_row_hit_rate() << endl;
+    cout << "dram:average-latency:" << dram->get_average_latency() << endl;
+    cout << "dram:write-queue-drains:" << dram->get_drain_count() << endl;
+}
+
+/**
+ * Prints 3C classification of misses and table of misses by symbol covering
+ * the instruction, which caused them, most missing symbols first.
+ */
+void Reporter::report_cache_misses(const char *name, const Cache *cache) {
+    const CacheMissAnalysis *analysis = cache->get_miss_analysis();
+    if (analysis == nullptr) {
+        return;
+    }
+    cout << name << ":miss-compulsory:"
+         << analysis->get_miss_count(MISS_COMPULSORY) << endl;
+    cout << name << ":miss-capacity:"
+         << analysis->get_miss_count(MISS_CAPACITY) << endl;
+    cout << name << ":miss-conflict:"
+         << analysis->get_miss_count(MISS_CONFLICT) << endl;
+
+    const SymbolTable *symtab = machine->symbol_table();
+    map<string, CacheMissCounts> symbol_misses;
+    for (const auto &pc_misses : analysis->get_pc_misses()) {
+        QString symbol;
+        SymbolValue offset;
+        if (symtab == nullptr
+            || !symtab->location_to_symbol(symbol, offset, pc_misses.first)) {
+            symbol = QString("0x%1").arg(pc_misses.first, 8, 16, QChar('0'));
+        }
+        CacheMissCounts &counts = symbol_misses[symbol.toStdString()];
+        for (int kind = 0; kind < MISS_KIND_COUNT; kind++) {
+            counts.count[kind] += pc_misses.second.count[kind];
+        }
+    }
+    vector<pair<string, CacheMissCounts>> rows(
+        symbol_misses.begin(), symbol_misses.end());
+    stable_sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+        return a.second.total() > b.second.total();
+    });
+
+    cout << name << ":misses-by-symbol:" << endl;
+    cout << setw(10) << "misses" << setw(12) << "compulsory" << setw(10)
+         << "capacity" << setw(10) << "conflict"
+         << "  symbol" << endl;
+    for (const auto &row : rows) {
+        cout << setw(10) << row.second.total() << setw(12)
+             << row.second.count[MISS_COMPULSORY] << setw(10)
+             << row.second.count[MISS_CAPACITY] << setw(10)
+             << row.second.count[MISS_CONFLICT] << "  " << row.first << endl;
+    }
+}
+
 void Reporter::report() {
     cout << dec;
     if (e_regs) {
@@ -226,6 +390,28 @@ void Reporter::report() {
              << machine->cache_data()->get_stall_count() << endl;
         cout << "d-cache:improved-speed:"
              << machine->cache_data()->get_speed_improvement() << endl;
+        const Cache *l2 = machine->cache_level2();
+        if (l2->get_config().enabled()) {
+            cout << "l2-cache:reads:" << l2->get_read_count() << endl;
+            cout << "l2-cache:writes:" << l2->get_write_count() << endl;
+            cout << "l2-cache:hit:" << l2->get_hit_count() << endl;
+            cout << "l2-cache:miss:" << l2->get_miss_count() << endl;
+            cout << "l2-cache:hit-rate:" << l2->get_hit_rate() << endl;
+            cout << "l2-cache:stalled-cycles:" << l2->get_stall_count() << endl;
+            cout << "l2-cache:improved-speed:" << l2->get_speed_improvement()
+                 << endl;
+        }
+        report_cache_prefetch("i-cache", machine->cache_program());
+        report_cache_prefetch("d-cache", machine->cache_data());
+        report_cache_prefetch("l2-cache", l2);
+        if (machine->config().dram_enabled()) {
+            report_dram(machine->dram());
+        }
+    }
+    if (e_cache_misses) {
+        report_cache_misses("i-cache", machine->cache_program());
+        report_cache_misses("d-cache", machine->cache_data());
+        report_cache_misses("l2-cache", machine->cache_level2());
     }
     if (e_cycles) {
         cout << "d-cache:stalled-cycles:"
@@ -236,6 +422,12 @@ void Reporter::report() {
     if (e_cycles) {
         cout << "cycles:" << machine->core()->get_cycle_count() << endl;
         cout << "stalls:" << machine->core()->get_stall_count() << endl;
+        if (machine->config().memory_stalls()) {
+            cout << "memory-stalls:" << machine->core()->get_memory_stall_count() << endl;
+        }
+        report_stalls();
+        report_branch_prediction(machine->core()->get_branch_prediction());
+        report_issue(machine->core_superscalar());
     }
     foreach (DumpRange range, dump_ranges) {
         ofstream out;
@@ -53,6 +53,8 @@ public:
 
     void regs(); // Report status of registers
     void cache_stats();
+    // Classify cache misses and attribute them to instructions (slows the run)
+    void cache_misses();
     void cycles();
 
     enum FailReason {
@@ -85,10 +87,17 @@ private:
 
     bool e_regs;
     bool e_cache_stats;
+    bool e_cache_misses;
     bool e_cycles;
     enum FailReason e_fail;
 
     void report();
+    void report_cache_prefetch(const char *name, const machine::Cache *cache);
+    void report_cache_misses(const char *name, const machine::Cache *cache);
+    void report_branch_prediction(const machine::BranchPredictionUnit *unit);
+    void report_stalls();
+    void report_issue(const machine::CoreSuperscalar *core);
+    void report_dram(const machine::Dram *dram);
 };
 
 #endif // REPORTER_H
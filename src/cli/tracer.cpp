@@ -63,26 +63,31 @@ Tracer::Tracer(Machine *machine) {
     } while (false)
 
 void Tracer::fetch() {
+    machine->core_rw()->subscribe_signals(Core::SG_INSTRUCTION);
     CON(con_fetch, machine->core(), &Core::instruction_fetched,
         &Tracer::instruction_fetch);
 }
 
 void Tracer::decode() {
+    machine->core_rw()->subscribe_signals(Core::SG_INSTRUCTION);
     CON(con_decode, machine->core(), &Core::instruction_decoded,
         &Tracer::instruction_decode);
 }
 
 void Tracer::execute() {
+    machine->core_rw()->subscribe_signals(Core::SG_INSTRUCTION);
     CON(con_execute, machine->core(), &Core::instruction_executed,
         &Tracer::instruction_execute);
 }
 
 void Tracer::memory() {
+    machine->core_rw()->subscribe_signals(Core::SG_INSTRUCTION);
     CON(con_memory, machine->core(), &Core::instruction_memory,
         &Tracer::instruction_memory);
 }
 
 void Tracer::writeback() {
+    machine->core_rw()->subscribe_signals(Core::SG_INSTRUCTION);
     CON(con_writeback, machine->core(), &Core::instruction_writeback,
         &Tracer::instruction_writeback);
 }
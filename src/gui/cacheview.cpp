@@ -442,10 +442,13 @@ void CacheViewBlock::cache_update(
     }
     last_highlighted = true;
 
-    curr_row = set;
     last_set = set;
     last_col = col;
-    update();
+    // Text items repaint themselves, only the row connection needs the block
+    if (curr_row != set) {
+        curr_row = set;
+        update();
+    }
 }
 
 CacheViewScene::CacheViewScene(const machine::Cache *cache) {
@@ -93,6 +93,7 @@
 
 CoreViewScene::CoreViewScene(machine::Machine *machine) : QGraphicsScene() {
     setSceneRect(0, 0, SC_WIDTH, SC_HEIGHT);
+    machine->core_rw()->subscribe_signals(machine::Core::SG_ALL);
 
     // Elements //
     // Primary points
@@ -96,6 +96,8 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     cache_program->hide();
     cache_data = new CacheDock(this, "Data");
     cache_data->hide();
+    cache_level2 = new CacheDock(this, "L2");
+    cache_level2->hide();
     peripherals = new PeripheralsDock(this, settings);
     peripherals->hide();
     terminal = new TerminalDock(this, settings);
@@ -164,6 +166,9 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     connect(
         ui->actionData_Cache, &QAction::triggered, this,
         &MainWindow::show_cache_data);
+    connect(
+        ui->actionL2_Cache, &QAction::triggered, this,
+        &MainWindow::show_cache_level2);
     connect(
         ui->actionPeripherals, &QAction::triggered, this,
         &MainWindow::show_peripherals);
@@ -247,6 +252,7 @@ MainWindow::~MainWindow() {
     delete memory;
     delete cache_program;
     delete cache_data;
+    delete cache_level2;
     delete peripherals;
     delete terminal;
     delete lcd_display;
@@ -333,6 +339,8 @@ void MainWindow::create_core(
     show_hide_coreview(coreview_shown);
 
     set_speed(); // Update machine speed to current settings
+    // History for stepping back, the oldest snapshots are dropped above 64 MiB
+    machine->set_history(64 << 20);
 
     if (config.osemu_enable()) {
         osemu::OsSyscallExceptionHandler *osemu_handler
@@ -363,6 +371,13 @@ void MainWindow::create_core(
         &machine::Machine::pause);
     connect(
         ui->actionStep, &QAction::triggered, machine, &machine::Machine::step);
+    connect(ui->actionStepBack, &QAction::triggered, machine, [this]() {
+        if (!machine->step_back()) {
+            ui->statusBar->showMessage(
+                "Cannot step back, history does not reach that far or serial "
+                "port input arrived since");
+        }
+    });
     connect(
         ui->actionRestart, &QAction::triggered, machine,
         &machine::Machine::restart);
@@ -372,6 +387,9 @@ void MainWindow::create_core(
     connect(
         machine, &machine::Machine::program_exit, this,
         &MainWindow::machine_exit);
+    connect(
+        machine, &machine::Machine::achieved_ips_update, this,
+        &MainWindow::machine_achieved_ips);
     connect(
         machine, &machine::Machine::program_trap, this,
         &MainWindow::machine_trap);
@@ -386,12 +404,14 @@ void MainWindow::create_core(
     memory->setup(machine);
     cache_program->setup(machine->cache_program());
     cache_data->setup(machine->cache_data());
+    cache_level2->setup(machine->cache_level2());
     terminal->setup(machine->serial_port());
     peripherals->setup(machine->peripheral_spi_led());
     lcd_display->setup(machine->peripheral_lcd_display());
     cop0dock->setup(machine);
 
     // Connect signals for instruction address followup
+    machine->core_rw()->subscribe_signals(machine::Core::SG_INST_ADDR);
     connect(
         machine->core(), &machine::Core::fetch_inst_addr_value, program,
         &ProgramDock::fetch_inst_addr);
@@ -487,6 +507,7 @@ SHOW_HANDLER(program, Qt::LeftDockWidgetArea)
 SHOW_HANDLER(memory, Qt::RightDockWidgetArea)
 SHOW_HANDLER(cache_program, Qt::RightDockWidgetArea)
 SHOW_HANDLER(cache_data, Qt::RightDockWidgetArea)
+SHOW_HANDLER(cache_level2, Qt::RightDockWidgetArea)
 SHOW_HANDLER(peripherals, Qt::RightDockWidgetArea)
 SHOW_HANDLER(terminal, Qt::RightDockWidgetArea)
 SHOW_HANDLER(lcd_display, Qt::RightDockWidgetArea)
@@ -633,12 +654,14 @@ void MainWindow::machine_status(enum machine::Machine::Status st) {
         ui->actionPause->setEnabled(false);
         ui->actionRun->setEnabled(true);
         ui->actionStep->setEnabled(true);
+        ui->actionStepBack->setEnabled(true);
         status = "Ready";
         break;
     case machine::Machine::ST_RUNNING:
         ui->actionPause->setEnabled(true);
         ui->actionRun->setEnabled(false);
         ui->actionStep->setEnabled(false);
+        ui->actionStepBack->setEnabled(false);
         status = "Running";
         break;
     case machine::Machine::ST_BUSY:
@@ -657,6 +680,15 @@ void MainWindow::machine_status(enum machine::Machine::Status st) {
     ui->statusBar->showMessage(status);
 }
 
+void MainWindow::machine_achieved_ips(unsigned int ips) {
+    if (machine == nullptr
+        || machine->status() != machine::Machine::ST_RUNNING) {
+        return;
+    }
+    ui->statusBar->showMessage(
+        QString("Running (%1 instructions per second)").arg(ips));
+}
+
 void MainWindow::machine_exit() {
     ui->actionPause->setEnabled(false);
     ui->actionRun->setEnabled(false);
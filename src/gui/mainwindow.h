@@ -110,6 +110,7 @@ public slots:
     void show_memory();
     void show_cache_data();
     void show_cache_program();
+    void show_cache_level2();
     void show_peripherals();
     void show_terminal();
     void show_lcd_display();
@@ -126,6 +127,7 @@ public slots:
     void machine_status(enum machine::Machine::Status st);
     void machine_exit();
     void machine_trap(machine::SimulatorException &e);
+    void machine_achieved_ips(unsigned int ips);
     void central_tab_changed(int index);
     void tab_widget_destroyed(QObject *obj);
     void view_mnemonics_registers(bool enable);
@@ -158,7 +160,7 @@ private:
     RegistersDock *registers {};
     ProgramDock *program {};
     MemoryDock *memory {};
-    CacheDock *cache_program {}, *cache_data {};
+    CacheDock *cache_program {}, *cache_data {}, *cache_level2 {};
     PeripheralsDock *peripherals {};
     TerminalDock *terminal {};
     LcdDisplayDock *lcd_display {};
@@ -106,6 +106,21 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     connect(
         ui->hazard_stall_forward, &QAbstractButton::clicked, this,
         &NewDialog::hazard_unit_change);
+    connect(
+        ui->bp_kind, QOverload<int>::of(&QComboBox::activated), this,
+        &NewDialog::bp_kind_change);
+    connect(
+        ui->bp_table_bits, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_table_bits_change);
+    connect(
+        ui->bp_history_bits, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_history_bits_change);
+    connect(
+        ui->btb_bits, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::btb_bits_change);
+    connect(
+        ui->ras_size, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ras_size_change);
 
     connect(
         ui->mem_protec_exec, &QAbstractButton::clicked, this,
@@ -122,6 +137,9 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     connect(
         ui->mem_time_burst, QOverload<int>::of(&QSpinBox::valueChanged), this,
         &NewDialog::mem_time_burst_change);
+    connect(
+        ui->mem_stalls, &QAbstractButton::clicked, this,
+        &NewDialog::mem_stalls_change);
 
     connect(
         ui->osemu_enable, &QAbstractButton::clicked, this,
@@ -268,6 +286,39 @@ void NewDialog::hazard_unit_change() {
     switch2custom();
 }
 
+void NewDialog::bp_kind_change(int index) {
+    config->set_branch_predictor((enum machine::MachineConfig::BranchPredictor)index);
+    switch2custom();
+}
+
+void NewDialog::bp_table_bits_change(int v) {
+    if (config->branch_predictor_bits() != (unsigned)v) {
+        config->set_branch_predictor_bits(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::bp_history_bits_change(int v) {
+    if (config->branch_history_bits() != (unsigned)v) {
+        config->set_branch_history_bits(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::btb_bits_change(int v) {
+    if (config->btb_bits() != (unsigned)v) {
+        config->set_btb_bits(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ras_size_change(int v) {
+    if (config->ras_size() != (unsigned)v) {
+        config->set_ras_size(v);
+        switch2custom();
+    }
+}
+
 void NewDialog::mem_protec_exec_change(bool v) {
     config->set_memory_execute_protection(v);
     switch2custom();
@@ -299,6 +350,11 @@ void NewDialog::mem_time_burst_change(int v) {
     }
 }
 
+void NewDialog::mem_stalls_change(bool v) {
+    config->set_memory_stalls(v);
+    switch2custom();
+}
+
 void NewDialog::osemu_enable_change(bool v) {
     config->set_osemu_enable(v);
 }
@@ -351,12 +407,18 @@ void NewDialog::config_gui() {
         config->hazard_unit() == machine::MachineConfig::HU_STALL);
     ui->hazard_stall_forward->setChecked(
         config->hazard_unit() == machine::MachineConfig::HU_STALL_FORWARD);
+    ui->bp_kind->setCurrentIndex(config->branch_predictor());
+    ui->bp_table_bits->setValue(config->branch_predictor_bits());
+    ui->bp_history_bits->setValue(config->branch_history_bits());
+    ui->btb_bits->setValue(config->btb_bits());
+    ui->ras_size->setValue(config->ras_size());
     // Memory
     ui->mem_protec_exec->setChecked(config->memory_execute_protection());
     ui->mem_protec_write->setChecked(config->memory_write_protection());
     ui->mem_time_read->setValue(config->memory_access_time_read());
     ui->mem_time_write->setValue(config->memory_access_time_write());
     ui->mem_time_burst->setValue(config->memory_access_time_burst());
+    ui->mem_stalls->setChecked(config->memory_stalls());
     // Cache
     cache_handler_d->config_gui();
     cache_handler_p->config_gui();
@@ -371,8 +433,8 @@ void NewDialog::config_gui() {
     ui->osemu_fs_root->setText(config->osemu_fs_root());
 
     // Disable various sections according to configuration
-    ui->delay_slot->setEnabled(!config->pipelined());
     ui->hazard_unit->setEnabled(config->pipelined());
+    ui->branch_prediction->setEnabled(config->pipelined() && !config->delay_slot());
 }
 
 unsigned NewDialog::preset_number() {
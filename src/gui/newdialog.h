@@ -68,11 +68,17 @@ private slots:
     void pipelined_change(bool);
     void delay_slot_change(bool);
     void hazard_unit_change();
+    void bp_kind_change(int);
+    void bp_table_bits_change(int);
+    void bp_history_bits_change(int);
+    void btb_bits_change(int);
+    void ras_size_change(int);
     void mem_protec_exec_change(bool);
     void mem_protec_write_change(bool);
     void mem_time_read_change(int);
     void mem_time_write_change(int);
     void mem_time_burst_change(int);
+    void mem_stalls_change(bool);
     void osemu_enable_change(bool);
     void osemu_known_syscall_stop_change(bool);
     void osemu_unknown_syscall_stop_change(bool);
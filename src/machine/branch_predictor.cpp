@@ -0,0 +1,459 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "branch_predictor.h"
+
+#include "checkpoint.h"
+#include "simulator_exception.h"
+#include "utils.h"
+
+namespace machine {
+
+const char *branch_kind_name(enum BranchKind kind) {
+    switch (kind) {
+    case BK_NONE: return "none";
+    case BK_CONDITIONAL: return "conditional";
+    case BK_JUMP: return "jump";
+    case BK_CALL: return "call";
+    case BK_RETURN: return "return";
+    case BK_INDIRECT: return "indirect";
+    case BK_COUNT: break;
+    }
+    return "unknown";
+}
+
+// Instructions are word aligned, low address bits carry no information
+static inline uint64_t address_index(Address address) {
+    return address.get_raw() >> 2;
+}
+
+std::unique_ptr<BranchPredictor>
+BranchPredictor::get_predictor_instance(const MachineConfig &config) {
+    switch (config.branch_predictor()) {
+    case MachineConfig::BP_NOT_TAKEN: return std::make_unique<BranchPredictorStatic>(false);
+    case MachineConfig::BP_TAKEN: return std::make_unique<BranchPredictorStatic>(true);
+    case MachineConfig::BP_BIMODAL:
+        return std::make_unique<BranchPredictorBimodal>(config.branch_predictor_bits());
+    case MachineConfig::BP_GSHARE:
+        return std::make_unique<BranchPredictorGshare>(
+            config.branch_predictor_bits(), config.branch_history_bits());
+    case MachineConfig::BP_TOURNAMENT:
+        return std::make_unique<BranchPredictorTournament>(
+            config.branch_predictor_bits(), config.branch_history_bits());
+    }
+    return std::make_unique<BranchPredictorStatic>(false);
+}
+
+void BranchPredictor::reset() {}
+
+void BranchPredictor::save_state(CheckpointWriter &writer) const {
+    UNUSED(writer)
+}
+
+void BranchPredictor::restore_state(CheckpointReader &reader) {
+    UNUSED(reader)
+}
+
+BranchPredictorStatic::BranchPredictorStatic(bool taken) : taken(taken) {}
+
+bool BranchPredictorStatic::predict(Address address) const {
+    UNUSED(address)
+    return taken;
+}
+
+void BranchPredictorStatic::update(Address address, bool taken) {
+    UNUSED(address)
+    UNUSED(taken)
+}
+
+BranchCounterTable::BranchCounterTable(unsigned bits)
+    : counters(1ULL << bits, WEAKLY_NOT_TAKEN)
+    , mask((1ULL << bits) - 1) {}
+
+bool BranchCounterTable::predict(uint64_t index) const {
+    return counters[index & mask] > WEAKLY_NOT_TAKEN;
+}
+
+void BranchCounterTable::update(uint64_t index, bool taken) {
+    uint8_t &counter = counters[index & mask];
+    if (taken && counter < STRONGLY_TAKEN) {
+        counter++;
+    } else if (!taken && counter > 0) {
+        counter--;
+    }
+}
+
+void BranchCounterTable::reset() {
+    std::fill(counters.begin(), counters.end(), WEAKLY_NOT_TAKEN);
+}
+
+void BranchCounterTable::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(counters.size());
+    writer.write_bytes(counters.data(), counters.size());
+}
+
+void BranchCounterTable::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(counters.size(), "branch predictor table size");
+    reader.read_bytes(counters.data(), counters.size());
+}
+
+BranchPredictorBimodal::BranchPredictorBimodal(unsigned bits) : table(bits) {}
+
+bool BranchPredictorBimodal::predict(Address address) const {
+    return table.predict(address_index(address));
+}
+
+void BranchPredictorBimodal::update(Address address, bool taken) {
+    table.update(address_index(address), taken);
+}
+
+void BranchPredictorBimodal::reset() {
+    table.reset();
+}
+
+void BranchPredictorBimodal::save_state(CheckpointWriter &writer) const {
+    table.save_state(writer);
+}
+
+void BranchPredictorBimodal::restore_state(CheckpointReader &reader) {
+    table.restore_state(reader);
+}
+
+BranchPredictorGshare::BranchPredictorGshare(unsigned bits, unsigned history_bits)
+    : table(bits)
+    , history_mask((1ULL << history_bits) - 1) {}
+
+uint64_t BranchPredictorGshare::index(Address address) const {
+    return address_index(address) ^ history;
+}
+
+bool BranchPredictorGshare::predict(Address address) const {
+    return table.predict(index(address));
+}
+
+void BranchPredictorGshare::update(Address address, bool taken) {
+    table.update(index(address), taken);
+    history = ((history << 1) | (taken ? 1 : 0)) & history_mask;
+}
+
+void BranchPredictorGshare::reset() {
+    table.reset();
+    history = 0;
+}
+
+void BranchPredictorGshare::save_state(CheckpointWriter &writer) const {
+    table.save_state(writer);
+    writer.write_u64(history);
+}
+
+void BranchPredictorGshare::restore_state(CheckpointReader &reader) {
+    table.restore_state(reader);
+    history = reader.read_u64() & history_mask;
+}
+
+BranchPredictorTournament::BranchPredictorTournament(unsigned bits, unsigned history_bits)
+    : bimodal(bits)
+    , gshare(bits, history_bits)
+    , chooser(bits) {}
+
+bool BranchPredictorTournament::predict(Address address) const {
+    if (chooser.predict(address_index(address))) {
+        return gshare.predict(address);
+    }
+    return bimodal.predict(address);
+}
+
+void BranchPredictorTournament::update(Address address, bool taken) {
+    const bool bimodal_taken = bimodal.predict(address);
+    const bool gshare_taken = gshare.predict(address);
+    if (bimodal_taken != gshare_taken) {
+        chooser.update(address_index(address), gshare_taken == taken);
+    }
+    bimodal.update(address, taken);
+    gshare.update(address, taken);
+}
+
+void BranchPredictorTournament::reset() {
+    bimodal.reset();
+    gshare.reset();
+    chooser.reset();
+}
+
+void BranchPredictorTournament::save_state(CheckpointWriter &writer) const {
+    bimodal.save_state(writer);
+    gshare.save_state(writer);
+    chooser.save_state(writer);
+}
+
+void BranchPredictorTournament::restore_state(CheckpointReader &reader) {
+    bimodal.restore_state(reader);
+    gshare.restore_state(reader);
+    chooser.restore_state(reader);
+}
+
+BranchTargetBuffer::BranchTargetBuffer(unsigned bits)
+    : entries(1ULL << bits)
+    , mask((1ULL << bits) - 1) {
+    reset();
+}
+
+size_t BranchTargetBuffer::index(Address inst_addr) const {
+    return address_index(inst_addr) & mask;
+}
+
+const BranchTargetBuffer::Entry *BranchTargetBuffer::lookup(Address inst_addr) const {
+    const Entry &entry = entries[index(inst_addr)];
+    if (!entry.valid || entry.inst_addr != inst_addr) {
+        return nullptr;
+    }
+    return &entry;
+}
+
+void BranchTargetBuffer::update(Address inst_addr, Address target, enum BranchKind kind) {
+    entries[index(inst_addr)]
+        = { .valid = true, .inst_addr = inst_addr, .target = target, .kind = kind };
+}
+
+void BranchTargetBuffer::invalidate(Address inst_addr) {
+    Entry &entry = entries[index(inst_addr)];
+    if (entry.inst_addr == inst_addr) {
+        entry.valid = false;
+    }
+}
+
+void BranchTargetBuffer::reset() {
+    for (Entry &entry : entries) {
+        entry = { .valid = false,
+                  .inst_addr = Address::null(),
+                  .target = Address::null(),
+                  .kind = BK_NONE };
+    }
+}
+
+void BranchTargetBuffer::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(entries.size());
+    for (const Entry &entry : entries) {
+        writer.write_bool(entry.valid);
+        writer.write_u64(entry.inst_addr.get_raw());
+        writer.write_u64(entry.target.get_raw());
+        writer.write_u8(entry.kind);
+    }
+}
+
+void BranchTargetBuffer::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(entries.size(), "BTB size");
+    for (Entry &entry : entries) {
+        entry.valid = reader.read_bool();
+        entry.inst_addr = Address(reader.read_u64());
+        entry.target = Address(reader.read_u64());
+        uint8_t kind = reader.read_u8();
+        entry.kind = kind < BK_COUNT ? (enum BranchKind)kind : BK_NONE;
+    }
+}
+
+ReturnAddressStack::ReturnAddressStack(unsigned size) : entries(size) {}
+
+bool ReturnAddressStack::empty() const {
+    return count == 0;
+}
+
+Address ReturnAddressStack::top() const {
+    return entries[top_index];
+}
+
+void ReturnAddressStack::push(Address address) {
+    if (entries.empty()) {
+        return;
+    }
+    top_index = (top_index + 1) % entries.size();
+    entries[top_index] = address;
+    if (count < entries.size()) {
+        count++;
+    }
+}
+
+void ReturnAddressStack::pop() {
+    if (count == 0) {
+        return;
+    }
+    top_index = (top_index + entries.size() - 1) % entries.size();
+    count--;
+}
+
+void ReturnAddressStack::reset() {
+    std::fill(entries.begin(), entries.end(), Address::null());
+    top_index = 0;
+    count = 0;
+}
+
+void ReturnAddressStack::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(entries.size());
+    writer.write_u32(top_index);
+    writer.write_u32(count);
+    for (const Address &address : entries) {
+        writer.write_u64(address.get_raw());
+    }
+}
+
+void ReturnAddressStack::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(entries.size(), "return address stack size");
+    top_index = reader.read_u32();
+    count = reader.read_u32();
+    if (top_index >= entries.size() || count > entries.size()) {
+        throw SIMULATOR_EXCEPTION(Input, "Checkpoint return address stack is corrupted", "");
+    }
+    for (Address &address : entries) {
+        address = Address(reader.read_u64());
+    }
+}
+
+BranchPredictionUnit::BranchPredictionUnit(const MachineConfig &config)
+    : predictor(BranchPredictor::get_predictor_instance(config))
+    , btb(config.btb_bits())
+    , ras(config.ras_size()) {}
+
+Address BranchPredictionUnit::predict(Address inst_addr) const {
+    const BranchTargetBuffer::Entry *entry = btb.lookup(inst_addr);
+    if (entry == nullptr) {
+        return inst_addr + 4;
+    }
+    switch (entry->kind) {
+    case BK_RETURN: return ras.empty() ? entry->target : ras.top();
+    case BK_CONDITIONAL: return predictor->predict(inst_addr) ? entry->target : inst_addr + 4;
+    default: return entry->target;
+    }
+}
+
+void BranchPredictionUnit::resolve(
+    Address inst_addr,
+    enum BranchKind kind,
+    bool taken,
+    Address next_addr,
+    Address predicted) {
+    if (predicted != next_addr) {
+        mispredicted[kind]++;
+    }
+    if (kind == BK_NONE) {
+        // Stale entry for instruction which is no longer a branch
+        btb.invalidate(inst_addr);
+        return;
+    }
+    resolved[kind]++;
+    if (btb.lookup(inst_addr) == nullptr) {
+        btb_misses++;
+    }
+    if (kind == BK_CONDITIONAL) {
+        predictor->update(inst_addr, taken);
+    }
+    if (taken) {
+        btb.update(inst_addr, next_addr, kind);
+    }
+    if (kind == BK_RETURN) {
+        ras.pop();
+    } else if (kind == BK_CALL && taken) {
+        ras.push(inst_addr + 8);
+    }
+}
+
+void BranchPredictionUnit::reset() {
+    predictor->reset();
+    btb.reset();
+    ras.reset();
+    resolved.fill(0);
+    mispredicted.fill(0);
+    btb_misses = 0;
+}
+
+void BranchPredictionUnit::save_state(CheckpointWriter &writer) const {
+    predictor->save_state(writer);
+    btb.save_state(writer);
+    ras.save_state(writer);
+    for (size_t i = 0; i < BK_COUNT; i++) {
+        writer.write_u32(resolved[i]);
+        writer.write_u32(mispredicted[i]);
+    }
+    writer.write_u32(btb_misses);
+}
+
+void BranchPredictionUnit::restore_state(CheckpointReader &reader) {
+    predictor->restore_state(reader);
+    btb.restore_state(reader);
+    ras.restore_state(reader);
+    for (size_t i = 0; i < BK_COUNT; i++) {
+        resolved[i] = reader.read_u32();
+        mispredicted[i] = reader.read_u32();
+    }
+    btb_misses = reader.read_u32();
+}
+
+unsigned BranchPredictionUnit::get_resolved_count(enum BranchKind kind) const {
+    return resolved[kind];
+}
+
+unsigned BranchPredictionUnit::get_resolved_count() const {
+    unsigned total = 0;
+    for (size_t i = BK_CONDITIONAL; i < BK_COUNT; i++) {
+        total += resolved[i];
+    }
+    return total;
+}
+
+unsigned BranchPredictionUnit::get_mispredicted_count(enum BranchKind kind) const {
+    return mispredicted[kind];
+}
+
+unsigned BranchPredictionUnit::get_mispredicted_count() const {
+    unsigned total = 0;
+    for (size_t i = BK_NONE; i < BK_COUNT; i++) {
+        total += mispredicted[i];
+    }
+    return total;
+}
+
+unsigned BranchPredictionUnit::get_btb_miss_count() const {
+    return btb_misses;
+}
+
+double BranchPredictionUnit::get_accuracy() const {
+    const unsigned total = get_resolved_count();
+    if (total == 0) {
+        return 0.0;
+    }
+    const unsigned wrong = get_mispredicted_count() - mispredicted[BK_NONE];
+    return (double)(total - wrong) / total * 100;
+}
+
+} // namespace machine
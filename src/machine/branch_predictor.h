@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include "machineconfig.h"
+#include "memory/address.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace machine {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Kind of control transfer instruction as seen by branch prediction
+enum BranchKind {
+    BK_NONE,        // Not a control transfer instruction
+    BK_CONDITIONAL, // Conditional branch
+    BK_JUMP,        // Direct jump
+    BK_CALL,        // Jump or branch writing return address
+    BK_RETURN,      // Register jump through $ra
+    BK_INDIRECT,    // Other register jump
+    BK_COUNT
+};
+
+const char *branch_kind_name(enum BranchKind kind);
+
+/**
+ * Direction predictor interface.
+ *
+ * Predicts whether a conditional branch at given address is taken. It is
+ * updated with the outcome of each conditional branch once it resolves.
+ */
+class BranchPredictor {
+public:
+    virtual bool predict(Address address) const = 0;
+    virtual void update(Address address, bool taken) = 0;
+
+    virtual void reset();
+
+    // Predictor state for machine checkpoint
+    virtual void save_state(CheckpointWriter &writer) const;
+    virtual void restore_state(CheckpointReader &reader);
+
+    virtual ~BranchPredictor() = default;
+
+    static std::unique_ptr<BranchPredictor> get_predictor_instance(const MachineConfig &config);
+};
+
+// Static prediction, same direction for all branches
+class BranchPredictorStatic final : public BranchPredictor {
+public:
+    explicit BranchPredictorStatic(bool taken);
+
+    bool predict(Address address) const final;
+    void update(Address address, bool taken) final;
+
+private:
+    const bool taken;
+};
+
+/**
+ * Table of two bit saturating counters indexed by instruction address.
+ *
+ * Base of bimodal predictor and of the pattern table of gshare.
+ */
+class BranchCounterTable {
+public:
+    explicit BranchCounterTable(unsigned bits);
+
+    bool predict(uint64_t index) const;
+    void update(uint64_t index, bool taken);
+
+    void reset();
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+private:
+    static constexpr uint8_t WEAKLY_NOT_TAKEN = 1;
+    static constexpr uint8_t STRONGLY_TAKEN = 3;
+
+    std::vector<uint8_t> counters;
+    const uint64_t mask;
+};
+
+// Two bit counters indexed by address
+class BranchPredictorBimodal final : public BranchPredictor {
+public:
+    explicit BranchPredictorBimodal(unsigned bits);
+
+    bool predict(Address address) const final;
+    void update(Address address, bool taken) final;
+
+    void reset() final;
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
+private:
+    BranchCounterTable table;
+};
+
+// Two bit counters indexed by address xor global history of branch outcomes
+class BranchPredictorGshare final : public BranchPredictor {
+public:
+    BranchPredictorGshare(unsigned bits, unsigned history_bits);
+
+    bool predict(Address address) const final;
+    void update(Address address, bool taken) final;
+
+    void reset() final;
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
+private:
+    BranchCounterTable table;
+    const uint64_t history_mask;
+    uint64_t history = 0;
+
+    uint64_t index(Address address) const;
+};
+
+/**
+ * Tournament predictor
+ *
+ * Bimodal and gshare predictors run side by side, table of two bit counters
+ * indexed by address chooses which one is used. The chooser moves towards
+ * the component that was right when they disagree.
+ */
+class BranchPredictorTournament final : public BranchPredictor {
+public:
+    BranchPredictorTournament(unsigned bits, unsigned history_bits);
+
+    bool predict(Address address) const final;
+    void update(Address address, bool taken) final;
+
+    void reset() final;
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
+private:
+    BranchPredictorBimodal bimodal;
+    BranchPredictorGshare gshare;
+    BranchCounterTable chooser; // Taken means use gshare
+};
+
+/**
+ * Direct mapped branch target buffer
+ *
+ * Entries are tagged by the full instruction address and hold target and
+ * kind of the last taken control transfer at that address.
+ */
+class BranchTargetBuffer {
+public:
+    struct Entry {
+        bool valid;
+        Address inst_addr;
+        Address target;
+        enum BranchKind kind;
+    };
+
+    explicit BranchTargetBuffer(unsigned bits);
+
+    // Returns nullptr on miss
+    const Entry *lookup(Address inst_addr) const;
+    void update(Address inst_addr, Address target, enum BranchKind kind);
+    void invalidate(Address inst_addr);
+
+    void reset();
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+private:
+    std::vector<Entry> entries;
+    const uint64_t mask;
+
+    size_t index(Address inst_addr) const;
+};
+
+// Return address stack, the oldest entry is overwritten when full
+class ReturnAddressStack {
+public:
+    explicit ReturnAddressStack(unsigned size); // Size 0 disables the stack
+
+    bool empty() const;
+    Address top() const;
+    void push(Address address);
+    void pop();
+
+    void reset();
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+private:
+    std::vector<Address> entries;
+    unsigned top_index = 0;
+    unsigned count = 0;
+};
+
+/**
+ * Next fetch address prediction of pipelined core without delay slot.
+ *
+ * BTB recognizes control transfer instructions when they are fetched.
+ * Returns are predicted by return address stack, conditional branches by
+ * direction predictor. Instruction missing in BTB is predicted to continue
+ * sequentially. Structures are updated when the instruction resolves.
+ * Branches writing return address are treated as calls.
+ */
+class BranchPredictionUnit {
+public:
+    explicit BranchPredictionUnit(const MachineConfig &config);
+
+    Address predict(Address inst_addr) const;
+    /**
+     * @param inst_addr  address of resolved instruction
+     * @param kind       kind of the instruction
+     * @param taken      control was transferred
+     * @param next_addr  address of the instruction really following it
+     * @param predicted  address predicted when it was fetched
+     */
+    void resolve(
+        Address inst_addr,
+        enum BranchKind kind,
+        bool taken,
+        Address next_addr,
+        Address predicted);
+
+    void reset();
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+    // Resolved control transfer instructions of given kind
+    unsigned get_resolved_count(enum BranchKind kind) const;
+    unsigned get_resolved_count() const;
+    // Mispredicted instructions, BK_NONE counts stale BTB hits
+    unsigned get_mispredicted_count(enum BranchKind kind) const;
+    unsigned get_mispredicted_count() const;
+    unsigned get_btb_miss_count() const;
+    double get_accuracy() const; // Correctly predicted branches in percents
+
+private:
+    std::unique_ptr<BranchPredictor> predictor;
+    BranchTargetBuffer btb;
+    ReturnAddressStack ras;
+
+    std::array<unsigned, BK_COUNT> resolved {};
+    std::array<unsigned, BK_COUNT> mispredicted {};
+    unsigned btb_misses = 0;
+};
+
+} // namespace machine
+
+#endif // BRANCH_PREDICTOR_H
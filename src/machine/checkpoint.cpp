@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "checkpoint.h"
+
+#include "common/endian.h"
+#include "simulator_exception.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+using namespace machine;
+
+// Payload of every chunk starts and ends at this alignment
+constexpr size_t CHUNK_ALIGN = 8;
+// Magic, version and reserved word
+constexpr size_t HEADER_SIZE = sizeof(CHECKPOINT_MAGIC) + 2 * sizeof(uint32_t);
+// Tag, reserved word and payload size
+constexpr size_t CHUNK_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+template<typename T>
+static void put_le(std::vector<uint8_t> &buffer, T value) {
+    value = byteswap_if(value, NATIVE_ENDIAN != LITTLE);
+    const auto *raw = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), raw, raw + sizeof(value));
+}
+
+template<typename T>
+static T get_le(const uint8_t *data) {
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return byteswap_if(value, NATIVE_ENDIAN != LITTLE);
+}
+
+CheckpointWriter::CheckpointWriter() {
+    begin_image();
+}
+
+void CheckpointWriter::begin_image() {
+    buffer.insert(buffer.end(), CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(CHECKPOINT_MAGIC));
+    put_le<uint32_t>(buffer, CHECKPOINT_VERSION);
+    put_le<uint32_t>(buffer, 0);
+}
+
+void CheckpointWriter::begin_chunk(uint32_t tag) {
+    SANITY_ASSERT(chunk_start == SIZE_MAX, "Checkpoint chunks cannot be nested");
+    put_le<uint32_t>(buffer, tag);
+    put_le<uint32_t>(buffer, 0);
+    put_le<uint64_t>(buffer, 0); // Size filled by end_chunk
+    chunk_start = buffer.size();
+}
+
+void CheckpointWriter::end_chunk() {
+    SANITY_ASSERT(chunk_start != SIZE_MAX, "No checkpoint chunk to end");
+    uint64_t size = byteswap_if<uint64_t>(buffer.size() - chunk_start, NATIVE_ENDIAN != LITTLE);
+    memcpy(&buffer[chunk_start - sizeof(size)], &size, sizeof(size));
+    chunk_start = SIZE_MAX;
+    align(CHUNK_ALIGN);
+}
+
+void CheckpointWriter::write_bool(bool value) {
+    buffer.push_back(value ? 1 : 0);
+}
+
+void CheckpointWriter::write_u8(uint8_t value) {
+    buffer.push_back(value);
+}
+
+void CheckpointWriter::write_u16(uint16_t value) {
+    put_le(buffer, value);
+}
+
+void CheckpointWriter::write_u32(uint32_t value) {
+    put_le(buffer, value);
+}
+
+void CheckpointWriter::write_u64(uint64_t value) {
+    put_le(buffer, value);
+}
+
+void CheckpointWriter::write_bytes(const void *data, size_t size) {
+    const auto *raw = static_cast<const uint8_t *>(data);
+    buffer.insert(buffer.end(), raw, raw + size);
+}
+
+void CheckpointWriter::align(size_t alignment) {
+    buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+void CheckpointWriter::save(const QString &file_name) const {
+    SANITY_ASSERT(chunk_start == SIZE_MAX, "Checkpoint chunk not ended");
+    QFile file(file_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Can't open checkpoint file for writing (") + file_name + ")",
+            std::strerror(errno));
+    }
+    if (file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size())
+        != (qint64)buffer.size()) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Write of checkpoint file failed (") + file_name + ")",
+            std::strerror(errno));
+    }
+}
+
+std::vector<uint8_t> CheckpointWriter::take_data() {
+    SANITY_ASSERT(chunk_start == SIZE_MAX, "Checkpoint chunk not ended");
+    std::vector<uint8_t> data = std::move(buffer);
+    buffer.clear();
+    begin_image();
+    return data;
+}
+
+CheckpointReader::CheckpointReader(const uint8_t *data, size_t size, size_t file_offset)
+    : data(data)
+    , size(size)
+    , file_offset(file_offset) {}
+
+const uint8_t *CheckpointReader::take(size_t count) {
+    if (count > size - pos) {
+        throw SIMULATOR_EXCEPTION(Input, "Checkpoint chunk is truncated", "");
+    }
+    const uint8_t *ret = data + pos;
+    pos += count;
+    return ret;
+}
+
+bool CheckpointReader::read_bool() {
+    return *take(1) != 0;
+}
+
+uint8_t CheckpointReader::read_u8() {
+    return *take(1);
+}
+
+uint16_t CheckpointReader::read_u16() {
+    return get_le<uint16_t>(take(sizeof(uint16_t)));
+}
+
+uint32_t CheckpointReader::read_u32() {
+    return get_le<uint32_t>(take(sizeof(uint32_t)));
+}
+
+uint64_t CheckpointReader::read_u64() {
+    return get_le<uint64_t>(take(sizeof(uint64_t)));
+}
+
+void CheckpointReader::read_bytes(void *destination, size_t count) {
+    memcpy(destination, take(count), count);
+}
+
+void CheckpointReader::align(size_t alignment) {
+    size_t offset = file_offset + pos;
+    take((offset + alignment - 1) / alignment * alignment - offset);
+}
+
+void CheckpointReader::expect_u32(uint32_t expected, const char *what) {
+    uint32_t value = read_u32();
+    if (value != expected) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Checkpoint does not match machine configuration (") + what + ")",
+            QString("stored %1, expected %2").arg(value).arg(expected));
+    }
+}
+
+CheckpointFile::CheckpointFile(const QString &file_name) : file(file_name) {
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Can't open checkpoint file for reading (") + file_name + ")",
+            std::strerror(errno));
+    }
+    const size_t file_size = file.size();
+    // Mapping keeps restore of large memory images without extra copy.
+    image = file.map(0, file_size);
+    if (image == nullptr) {
+        image_copy.resize(file_size);
+        if (file.read(reinterpret_cast<char *>(image_copy.data()), file_size)
+            != (qint64)file_size) {
+            throw SIMULATOR_EXCEPTION(
+                Input, QString("Read of checkpoint file failed (") + file_name + ")",
+                std::strerror(errno));
+        }
+        image = image_copy.data();
+    }
+
+    index_chunks(file_size);
+}
+
+CheckpointFile::CheckpointFile(std::vector<uint8_t> data) : image_copy(std::move(data)) {
+    image = image_copy.data();
+    index_chunks(image_copy.size());
+}
+
+void CheckpointFile::index_chunks(size_t image_size) {
+    const QString file_name = file.fileName();
+    if (image_size < HEADER_SIZE
+        || memcmp(image, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("File is not a machine checkpoint (") + file_name + ")", "");
+    }
+    uint32_t version = get_le<uint32_t>(image + sizeof(CHECKPOINT_MAGIC));
+    if (version != CHECKPOINT_VERSION) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Unsupported checkpoint version (") + file_name + ")",
+            QString("version %1, supported %2").arg(version).arg(CHECKPOINT_VERSION));
+    }
+
+    size_t offset = HEADER_SIZE;
+    while (offset < image_size) {
+        if (image_size - offset < CHUNK_HEADER_SIZE) {
+            throw SIMULATOR_EXCEPTION(
+                Input, QString("Checkpoint file is truncated (") + file_name + ")", "");
+        }
+        uint32_t tag = get_le<uint32_t>(image + offset);
+        uint64_t size = get_le<uint64_t>(image + offset + 2 * sizeof(uint32_t));
+        offset += CHUNK_HEADER_SIZE;
+        if (size > image_size - offset) {
+            throw SIMULATOR_EXCEPTION(
+                Input, QString("Checkpoint file is truncated (") + file_name + ")", "");
+        }
+        chunks[tag] = { .offset = offset, .size = (size_t)size };
+        offset += (size + CHUNK_ALIGN - 1) / CHUNK_ALIGN * CHUNK_ALIGN;
+    }
+}
+
+bool CheckpointFile::has_chunk(uint32_t tag) const {
+    return chunks.count(tag) != 0;
+}
+
+CheckpointReader CheckpointFile::chunk(uint32_t tag) const {
+    auto it = chunks.find(tag);
+    if (it == chunks.end()) {
+        char name[5] = { (char)tag, (char)(tag >> 8), (char)(tag >> 16), (char)(tag >> 24), 0 };
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Checkpoint is missing state chunk ") + name, file.fileName());
+    }
+    return { image + it->second.offset, it->second.size, it->second.offset };
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Binary checkpoint of machine state.
+ *
+ * File starts with magic and format version followed by chunks. Every chunk
+ * has four character tag, payload size and payload padded to 8 bytes. All
+ * integers are stored little endian. Bulk data (memory sections) are aligned
+ * to CHECKPOINT_PAGE_SIZE within the file, so the file can be mapped and the
+ * data used in place. Unknown chunks are skipped by the reader.
+ */
+constexpr char CHECKPOINT_MAGIC[8] = { 'Q', 't', 'M', 'i', 'p', 's', 'C', 'P' };
+constexpr uint32_t CHECKPOINT_VERSION = 10;
+constexpr size_t CHECKPOINT_PAGE_SIZE = 4096;
+
+constexpr uint32_t checkpoint_tag(const char (&name)[5]) {
+    return (uint32_t)(uint8_t)name[0] | (uint32_t)(uint8_t)name[1] << 8
+           | (uint32_t)(uint8_t)name[2] << 16 | (uint32_t)(uint8_t)name[3] << 24;
+}
+
+class CheckpointWriter {
+public:
+    CheckpointWriter();
+
+    void begin_chunk(uint32_t tag);
+    void end_chunk();
+
+    void write_bool(bool value);
+    void write_u8(uint8_t value);
+    void write_u16(uint16_t value);
+    void write_u32(uint32_t value);
+    void write_u64(uint64_t value);
+    void write_bytes(const void *data, size_t size);
+    // Pad with zeros up to the given alignment of file offset
+    void align(size_t alignment);
+
+    void save(const QString &file_name) const;
+    // Checkpoint image kept in memory, the writer starts a new image
+    std::vector<uint8_t> take_data();
+
+private:
+    void begin_image();
+    std::vector<uint8_t> buffer;
+    size_t chunk_start = SIZE_MAX;
+};
+
+/**
+ * Sequential reader of single chunk. Any read past the end of the chunk
+ * throws an input exception, therefore restored state never comes from
+ * outside of the file.
+ */
+class CheckpointReader {
+public:
+    CheckpointReader(const uint8_t *data, size_t size, size_t file_offset);
+
+    bool read_bool();
+    uint8_t read_u8();
+    uint16_t read_u16();
+    uint32_t read_u32();
+    uint64_t read_u64();
+    void read_bytes(void *data, size_t size);
+    // Data in place (in the file mapping), valid while the file is open
+    const uint8_t *take(size_t size);
+    void align(size_t alignment);
+
+    // Reads value and throws when it differs from the expected one
+    void expect_u32(uint32_t expected, const char *what);
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+    size_t file_offset; // Offset of the chunk payload in the file
+};
+
+class CheckpointFile {
+public:
+    explicit CheckpointFile(const QString &file_name);
+    // Checkpoint image in memory (see `CheckpointWriter::take_data`)
+    explicit CheckpointFile(std::vector<uint8_t> data);
+
+    bool has_chunk(uint32_t tag) const;
+    CheckpointReader chunk(uint32_t tag) const;
+
+private:
+    struct ChunkDesc {
+        size_t offset;
+        size_t size;
+    };
+    void index_chunks(size_t image_size);
+    QFile file;
+    const uint8_t *image = nullptr;
+    std::vector<uint8_t> image_copy; // Used when the file cannot be mapped
+    std::map<uint32_t, ChunkDesc> chunks;
+};
+
+} // namespace machine
+
+#endif // CHECKPOINT_H
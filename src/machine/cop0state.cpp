@@ -35,6 +35,7 @@
 
 #include "cop0state.h"
 
+#include "checkpoint.h"
 #include "core.h"
 #include "machinedefs.h"
 #include "simulator_exception.h"
@@ -213,6 +214,25 @@ void Cop0State::reset() {
     last_core_cycles = 0;
 }
 
+void Cop0State::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(COP0REGS_CNT);
+    for (uint32_t reg : cop0reg) {
+        writer.write_u32(reg);
+    }
+    writer.write_u32(last_core_cycles);
+}
+
+void Cop0State::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(COP0REGS_CNT, "coprocessor 0 registers");
+    for (int i = 0; i < COP0REGS_CNT; i++) {
+        this->cop0reg[i] = reader.read_u32();
+        if (i != Unsupported) {
+            emit cop0reg_update((enum Cop0Registers)i, cop0reg[i]);
+        }
+    }
+    last_core_cycles = reader.read_u32();
+}
+
 void Cop0State::update_execption_cause(enum ExceptionCause excause, bool in_delay_slot) {
     if (in_delay_slot) {
         cop0reg[(int)Cause] |= 0x80000000;
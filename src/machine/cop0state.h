@@ -47,6 +47,8 @@
 namespace machine {
 
 class Core;
+class CheckpointWriter;
+class CheckpointReader;
 
 class Cop0State : public QObject {
     Q_OBJECT
@@ -94,6 +96,9 @@ public:
 
     void reset(); // Reset all values to zero
 
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
     bool core_interrupt_request();
     Address exception_pc_address();
 
@@ -35,11 +35,37 @@
 
 #include "core.h"
 
+#include "checkpoint.h"
 #include "programloader.h"
 #include "utils.h"
 
+#include <algorithm>
+
 using namespace machine;
 
+const char *machine::stall_reason_name(enum StallReason reason) {
+    switch (reason) {
+    case SR_DATA_HAZARD: return "data-hazard";
+    case SR_LOAD_USE: return "load-use";
+    case SR_MUL_DIV: return "mul-div";
+    case SR_BRANCH_OPERAND: return "branch-operand";
+    case SR_STOP_IF: return "stop-if";
+    case SR_EXCEPTION_FLUSH: return "exception-flush";
+    case SR_BRANCH_MISPREDICT: return "branch-mispredict";
+    case SR_MEMORY: return "memory";
+    case SR_COUNT: break;
+    }
+    return "unknown";
+}
+
+uint32_t StallCounts::total() const {
+    uint32_t sum = 0;
+    for (uint32_t c : count) {
+        sum += c;
+    }
+    return sum;
+}
+
 Core::Core(
     Registers *regs,
     FrontendMemory *mem_program,
@@ -50,6 +76,7 @@ Core::Core(
     , hw_breaks() {
     cycle_c = 0;
     stall_c = 0;
+    subscribed_signals = SG_NONE;
     this->regs = regs;
     this->cop0state = cop0state;
     this->mem_program = mem_program;
@@ -73,16 +100,87 @@ Core::~Core() {
 
 void Core::step(bool skip_break) {
     cycle_c++;
-    emit cycle_c_value(cycle_c);
+    if (probe(SG_COUNTERS)) {
+        emit cycle_c_value(cycle_c);
+    }
+    if (!memory_stall_pending.empty()) {
+        // Whole core waits for memory, stages keep their state
+        MemoryStall &pending = memory_stall_pending.front();
+        if (probe(SG_DATAPATH)) {
+            emit hu_stall_value(true);
+        }
+        count_stall(SR_MEMORY, pending.inst_addr);
+        if (--pending.cycles == 0) {
+            memory_stall_pending.erase(memory_stall_pending.begin());
+        }
+        return;
+    }
     do_step(skip_break);
 }
 
 void Core::reset() {
     cycle_c = 0;
     stall_c = 0;
+    stall_counts = {};
+    pc_stalls.clear();
+    memory_stall_pending.clear();
+    invalidate_predecode();
     do_reset();
 }
 
+static void save_stall_counts(CheckpointWriter &writer, const StallCounts &counts) {
+    for (uint32_t c : counts.count) {
+        writer.write_u32(c);
+    }
+}
+
+static void restore_stall_counts(CheckpointReader &reader, StallCounts &counts) {
+    for (uint32_t &c : counts.count) {
+        c = reader.read_u32();
+    }
+}
+
+void Core::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(cycle_c);
+    writer.write_u32(stall_c);
+    save_stall_counts(writer, stall_counts);
+    writer.write_u32(pc_stalls.size());
+    for (const auto &pc_stall : pc_stalls) {
+        writer.write_u64(pc_stall.first);
+        save_stall_counts(writer, pc_stall.second);
+    }
+    writer.write_u32(memory_stall_pending.size());
+    for (const MemoryStall &pending : memory_stall_pending) {
+        writer.write_u64(pending.inst_addr.get_raw());
+        writer.write_u32(pending.cycles);
+    }
+    writer.write_u32(hwr_userlocal);
+    do_save_state(writer);
+}
+
+void Core::restore_state(CheckpointReader &reader) {
+    cycle_c = reader.read_u32();
+    stall_c = reader.read_u32();
+    restore_stall_counts(reader, stall_counts);
+    pc_stalls.clear();
+    for (uint32_t i = reader.read_u32(); i > 0; i--) {
+        uint64_t pc = reader.read_u64();
+        restore_stall_counts(reader, pc_stalls[pc]);
+    }
+    memory_stall_pending.resize(reader.read_u32());
+    for (MemoryStall &pending : memory_stall_pending) {
+        pending.inst_addr = Address(reader.read_u64());
+        pending.cycles = reader.read_u32();
+    }
+    hwr_userlocal = reader.read_u32();
+    invalidate_predecode();
+    do_restore_state(reader);
+    if (probe(SG_COUNTERS)) {
+        emit cycle_c_value(cycle_c);
+        emit stall_c_value(stall_c);
+    }
+}
+
 unsigned Core::get_cycle_count() const {
     return cycle_c;
 }
@@ -91,6 +189,41 @@ unsigned Core::get_stall_count() const {
     return stall_c;
 }
 
+unsigned Core::get_stall_count(enum StallReason reason) const {
+    return stall_counts.count[reason];
+}
+
+unsigned Core::get_memory_stall_count() const {
+    return stall_counts.count[SR_MEMORY];
+}
+
+const std::unordered_map<uint64_t, StallCounts> &Core::get_pc_stalls() const {
+    return pc_stalls;
+}
+
+void Core::count_stall(enum StallReason reason, Address inst_addr, unsigned cycles) {
+    stall_c += cycles;
+    stall_counts.count[reason] += cycles;
+    pc_stalls[inst_addr.get_raw()].count[reason] += cycles;
+    if (probe(SG_COUNTERS)) {
+        emit stall_c_value(stall_c);
+    }
+}
+
+void Core::add_memory_stall(Address inst_addr, uint64_t cycles) {
+    if (cycles > 0) {
+        memory_stall_pending.push_back({ .inst_addr = inst_addr, .cycles = (uint32_t)cycles });
+    }
+}
+
+const BranchPredictionUnit *Core::get_branch_prediction() const {
+    return nullptr;
+}
+
+void Core::set_memory_stalls(bool enable) {
+    memory_stalls = enable;
+}
+
 Registers *Core::get_regs() {
     return regs;
 }
@@ -211,6 +344,51 @@ void Core::set_c0_userlocal(uint32_t address) {
     }
 }
 
+void Core::subscribe_signals(unsigned groups) {
+    subscribed_signals |= groups;
+}
+
+unsigned Core::get_subscribed_signals() const {
+    return subscribed_signals;
+}
+
+void Core::invalidate_predecode() {
+    for (auto &pd : predecode_cache) {
+        pd.is_valid = false;
+    }
+}
+
+const struct Core::dtPredecode &
+Core::predecode(const Instruction &inst, Address inst_addr) {
+    struct dtPredecode &pd
+        = predecode_cache[(inst_addr.get_raw() >> 2) & (PREDECODE_CACHE_SIZE - 1)];
+    if (pd.is_valid && pd.inst_addr == inst_addr && pd.inst_data == inst.data()) {
+        return pd;
+    }
+
+    pd.is_valid = false;
+    inst.flags_alu_op_mem_ctl(pd.flags, pd.alu_op, pd.mem_ctl);
+    if (!(pd.flags & IMF_SUPPORTED)) {
+        throw SIMULATOR_EXCEPTION(
+            UnsupportedInstruction, "Instruction with following encoding is not supported",
+            QString::number(inst.data(), 16));
+    }
+
+    pd.inst_data = inst.data();
+    pd.inst_addr = inst_addr;
+    pd.excause = (pd.flags & IMF_EXCEPTION) ? inst.encoded_exception() : EXCAUSE_NONE;
+    pd.num_rs = inst.rs();
+    pd.num_rt = inst.rt();
+    pd.num_rd = inst.rd();
+    if (pd.flags & IMF_ZERO_EXTEND) {
+        pd.immediate_val = inst.immediate();
+    } else {
+        pd.immediate_val = sign_extend(inst.immediate());
+    }
+    pd.is_valid = true;
+    return pd;
+}
+
 enum ExceptionCause Core::memory_special(
     enum AccessControl memctl,
     int mode,
@@ -314,7 +492,12 @@ enum ExceptionCause Core::memory_special(
 struct Core::dtFetch Core::fetch(bool skip_break) {
     enum ExceptionCause excause = EXCAUSE_NONE;
     Address inst_addr = Address(regs->read_pc());
+    mem_program->set_access_pc(inst_addr);
+    const uint64_t wait_start = memory_stalls ? mem_program->get_wait_cycles() : 0;
     Instruction inst(mem_program->read_u32(inst_addr));
+    if (memory_stalls) {
+        add_memory_stall(inst_addr, mem_program->get_wait_cycles() - wait_start);
+    }
 
     if (!skip_break) {
         hwBreak *brk = hw_breaks.value(inst_addr);
@@ -328,8 +511,12 @@ struct Core::dtFetch Core::fetch(bool skip_break) {
         }
     }
 
-    emit fetch_inst_addr_value(inst_addr);
-    emit instruction_fetched(inst, inst_addr, excause, true);
+    if (probe(SG_INST_ADDR)) {
+        emit fetch_inst_addr_value(inst_addr);
+    }
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_fetched(inst, inst_addr, excause, true);
+    }
     return {
         .inst = inst,
         .inst_addr = inst_addr,
@@ -341,25 +528,17 @@ struct Core::dtFetch Core::fetch(bool skip_break) {
 
 struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
     uint8_t rwrite;
-    enum InstructionFlags flags;
-    enum AluOp alu_op;
-    enum AccessControl mem_ctl;
     enum ExceptionCause excause = dt.excause;
 
-    dt.inst.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
-
-    if (!(flags & IMF_SUPPORTED)) {
-        throw SIMULATOR_EXCEPTION(
-            UnsupportedInstruction, "Instruction with following encoding is not supported",
-            QString::number(dt.inst.data(), 16));
-    }
+    const struct dtPredecode &pd = predecode(dt.inst, dt.inst_addr);
+    const enum InstructionFlags flags = pd.flags;
 
-    uint8_t num_rs = dt.inst.rs();
-    uint8_t num_rt = dt.inst.rt();
-    uint8_t num_rd = dt.inst.rd();
+    uint8_t num_rs = pd.num_rs;
+    uint8_t num_rt = pd.num_rt;
+    uint8_t num_rd = pd.num_rd;
     RegisterValue val_rs = regs->read_gp(num_rs);
     RegisterValue val_rt = regs->read_gp(num_rt);
-    uint32_t immediate_val;
+    uint32_t immediate_val = pd.immediate_val;
     bool regwrite = flags & IMF_REGWRITE;
     bool regd = flags & IMF_REGD;
     bool regd31 = flags & IMF_PC_TO_R31;
@@ -370,32 +549,32 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
     // requires rt for beq, bne
     bool bjr_req_rt = flags & IMF_BJR_REQ_RT;
 
-    if (flags & IMF_ZERO_EXTEND) {
-        immediate_val = dt.inst.immediate();
-    } else {
-        immediate_val = sign_extend(dt.inst.immediate());
+    if ((flags & IMF_EXCEPTION) && (excause == EXCAUSE_NONE)) {
+        excause = pd.excause;
     }
 
-    if ((flags & IMF_EXCEPTION) && (excause == EXCAUSE_NONE)) {
-        excause = dt.inst.encoded_exception();
-    }
-
-    emit decode_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_decoded(dt.inst, dt.inst_addr, excause, dt.is_valid);
-    emit decode_instruction_value(dt.inst.data());
-    emit decode_reg1_value(val_rs.as_u32());
-    emit decode_reg2_value(val_rt.as_u32());
-    emit decode_immediate_value(immediate_val);
-    emit decode_regw_value((bool)(flags & IMF_REGWRITE));
-    emit decode_memtoreg_value((bool)(flags & IMF_MEMREAD));
-    emit decode_memwrite_value((bool)(flags & IMF_MEMWRITE));
-    emit decode_memread_value((bool)(flags & IMF_MEMREAD));
-    emit decode_alusrc_value((bool)(flags & IMF_ALUSRC));
-    emit decode_regdest_value((bool)(flags & IMF_REGD));
-    emit decode_rs_num_value(num_rs);
-    emit decode_rt_num_value(num_rt);
-    emit decode_rd_num_value(num_rd);
-    emit decode_regd31_value(regd31);
+    if (probe(SG_INST_ADDR)) {
+        emit decode_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+    }
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_decoded(dt.inst, dt.inst_addr, excause, dt.is_valid);
+    }
+    if (probe(SG_DATAPATH)) {
+        emit decode_instruction_value(dt.inst.data());
+        emit decode_reg1_value(val_rs.as_u32());
+        emit decode_reg2_value(val_rt.as_u32());
+        emit decode_immediate_value(immediate_val);
+        emit decode_regw_value((bool)(flags & IMF_REGWRITE));
+        emit decode_memtoreg_value((bool)(flags & IMF_MEMREAD));
+        emit decode_memwrite_value((bool)(flags & IMF_MEMWRITE));
+        emit decode_memread_value((bool)(flags & IMF_MEMREAD));
+        emit decode_alusrc_value((bool)(flags & IMF_ALUSRC));
+        emit decode_regdest_value((bool)(flags & IMF_REGD));
+        emit decode_rs_num_value(num_rs);
+        emit decode_rt_num_value(num_rt);
+        emit decode_rd_num_value(num_rd);
+        emit decode_regd31_value(regd31);
+    }
 
     if (regd31) { val_rt = (dt.inst_addr + 8).get_raw(); }
 
@@ -420,8 +599,8 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
         .nb_skip_ds = !!(flags & IMF_NB_SKIP_DS),
         .forward_m_d_rs = false,
         .forward_m_d_rt = false,
-        .aluop = alu_op,
-        .memctl = mem_ctl,
+        .aluop = pd.alu_op,
+        .memctl = pd.mem_ctl,
         .num_rs = num_rs,
         .num_rt = num_rt,
         .num_rd = num_rd,
@@ -514,30 +693,36 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
         }
     }
 
-    emit execute_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_executed(dt.inst, dt.inst_addr, excause, dt.is_valid);
-    emit execute_alu_value(alu_val.as_u32());
-    emit execute_reg1_value(dt.val_rs.as_u32());
-    emit execute_reg2_value(dt.val_rt.as_u32());
-    emit execute_reg1_ff_value(dt.ff_rs);
-    emit execute_reg2_ff_value(dt.ff_rt);
-    emit execute_immediate_value(dt.immediate_val);
-    emit execute_regw_value(dt.regwrite);
-    emit execute_memtoreg_value(dt.memread);
-    emit execute_memread_value(dt.memread);
-    emit execute_memwrite_value(dt.memwrite);
-    emit execute_alusrc_value(dt.alusrc);
-    emit execute_regdest_value(dt.regd);
-    emit execute_regw_num_value(dt.rwrite);
-    emit execute_rs_num_value(dt.num_rs);
-    emit execute_rt_num_value(dt.num_rt);
-    emit execute_rd_num_value(dt.num_rd);
-    if (dt.stall) {
-        emit execute_stall_forward_value(1);
-    } else if (dt.ff_rs != FORWARD_NONE || dt.ff_rt != FORWARD_NONE) {
-        emit execute_stall_forward_value(2);
-    } else {
-        emit execute_stall_forward_value(0);
+    if (probe(SG_INST_ADDR)) {
+        emit execute_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+    }
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_executed(dt.inst, dt.inst_addr, excause, dt.is_valid);
+    }
+    if (probe(SG_DATAPATH)) {
+        emit execute_alu_value(alu_val.as_u32());
+        emit execute_reg1_value(dt.val_rs.as_u32());
+        emit execute_reg2_value(dt.val_rt.as_u32());
+        emit execute_reg1_ff_value(dt.ff_rs);
+        emit execute_reg2_ff_value(dt.ff_rt);
+        emit execute_immediate_value(dt.immediate_val);
+        emit execute_regw_value(dt.regwrite);
+        emit execute_memtoreg_value(dt.memread);
+        emit execute_memread_value(dt.memread);
+        emit execute_memwrite_value(dt.memwrite);
+        emit execute_alusrc_value(dt.alusrc);
+        emit execute_regdest_value(dt.regd);
+        emit execute_regw_num_value(dt.rwrite);
+        emit execute_rs_num_value(dt.num_rs);
+        emit execute_rt_num_value(dt.num_rt);
+        emit execute_rd_num_value(dt.num_rd);
+        if (dt.stall) {
+            emit execute_stall_forward_value(1);
+        } else if (dt.ff_rs != FORWARD_NONE || dt.ff_rt != FORWARD_NONE) {
+            emit execute_stall_forward_value(2);
+        } else {
+            emit execute_stall_forward_value(0);
+        }
     }
 
     return {
@@ -566,6 +751,8 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
 
     enum ExceptionCause excause = dt.excause;
     if (excause == EXCAUSE_NONE) {
+        mem_data->set_access_pc(dt.inst_addr);
+        const uint64_t wait_start = memory_stalls ? mem_data->get_wait_cycles() : 0;
         if (is_special_access(dt.memctl)) {
             excause = memory_special(
                 dt.memctl, dt.inst.rt(), memread, memwrite, towrite_val,
@@ -581,6 +768,10 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
             Q_ASSERT(dt.memctl == AC_NONE);
             // AC_NONE is memory NOP
         }
+        if (memory_stalls) {
+            // Both stages of pipelined core share the memory, waits add up
+            add_memory_stall(dt.inst_addr, mem_data->get_wait_cycles() - wait_start);
+        }
     }
 
     if (dt.excause != EXCAUSE_NONE) {
@@ -589,17 +780,23 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
         regwrite = false;
     }
 
-    emit memory_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_memory(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
-    emit memory_alu_value(dt.alu_val.as_u32());
-    emit memory_rt_value(dt.val_rt.as_u32());
-    emit memory_mem_value(memread ? towrite_val.as_u32() : 0);
-    emit memory_regw_value(regwrite);
-    emit memory_memtoreg_value(dt.memread);
-    emit memory_memread_value(dt.memread);
-    emit memory_memwrite_value(memwrite);
-    emit memory_regw_num_value(dt.rwrite);
-    emit memory_excause_value(excause);
+    if (probe(SG_INST_ADDR)) {
+        emit memory_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+    }
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_memory(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
+    }
+    if (probe(SG_DATAPATH)) {
+        emit memory_alu_value(dt.alu_val.as_u32());
+        emit memory_rt_value(dt.val_rt.as_u32());
+        emit memory_mem_value(memread ? towrite_val.as_u32() : 0);
+        emit memory_regw_value(regwrite);
+        emit memory_memtoreg_value(dt.memread);
+        emit memory_memread_value(dt.memread);
+        emit memory_memwrite_value(memwrite);
+        emit memory_regw_num_value(dt.rwrite);
+        emit memory_excause_value(excause);
+    }
 
     return {
         .inst = dt.inst,
@@ -617,31 +814,39 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
 }
 
 void Core::writeback(const struct dtMemory &dt) {
-    emit writeback_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_writeback(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
-    emit writeback_value(dt.towrite_val.as_u32());
-    emit writeback_memtoreg_value(dt.memtoreg);
-    emit writeback_regw_value(dt.regwrite);
-    emit writeback_regw_num_value(dt.rwrite);
+    if (probe(SG_INST_ADDR)) {
+        emit writeback_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+    }
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_writeback(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
+    }
+    if (probe(SG_DATAPATH)) {
+        emit writeback_value(dt.towrite_val.as_u32());
+        emit writeback_memtoreg_value(dt.memtoreg);
+        emit writeback_regw_value(dt.regwrite);
+        emit writeback_regw_num_value(dt.rwrite);
+    }
     if (dt.regwrite) { regs->write_gp(dt.rwrite, dt.towrite_val); }
 }
 
 bool Core::handle_pc(const struct dtDecode &dt) {
     bool branch = false;
-    emit instruction_program_counter(
-        dt.inst, dt.inst_addr, EXCAUSE_NONE, dt.is_valid);
+    if (probe(SG_INSTRUCTION)) {
+        emit instruction_program_counter(
+            dt.inst, dt.inst_addr, EXCAUSE_NONE, dt.is_valid);
+    }
 
     if (dt.jump) {
         if (!dt.bjr_req_rs) {
             regs->pc_abs_jmp_28(dt.inst.address() << 2);
-            emit fetch_jump_value(true);
-            emit fetch_jump_reg_value(false);
         } else {
             regs->pc_abs_jmp(Address(dt.val_rs.as_u32()));
-            emit fetch_jump_value(false);
-            emit fetch_jump_reg_value(true);
         }
-        emit fetch_branch_value(false);
+        if (probe(SG_DATAPATH)) {
+            emit fetch_jump_value(!dt.bjr_req_rs);
+            emit fetch_jump_reg_value(dt.bjr_req_rs);
+            emit fetch_branch_value(false);
+        }
         return true;
     }
 
@@ -657,9 +862,11 @@ bool Core::handle_pc(const struct dtDecode &dt) {
         if (dt.bj_not) { branch = !branch; }
     }
 
-    emit fetch_jump_value(false);
-    emit fetch_jump_reg_value(false);
-    emit fetch_branch_value(branch);
+    if (probe(SG_DATAPATH)) {
+        emit fetch_jump_value(false);
+        emit fetch_jump_reg_value(false);
+        emit fetch_branch_value(branch);
+    }
 
     if (branch) {
         int32_t rel_offset = dt.inst.immediate() << 2;
@@ -671,6 +878,35 @@ bool Core::handle_pc(const struct dtDecode &dt) {
     return branch;
 }
 
+bool Core::is_mult(enum AluOp op) {
+    switch (op) {
+    case ALU_OP_MULT:
+    case ALU_OP_MULTU:
+    case ALU_OP_MADD:
+    case ALU_OP_MADDU:
+    case ALU_OP_MSUB:
+    case ALU_OP_MSUBU: return true;
+    default: return false;
+    }
+}
+
+bool Core::is_div(enum AluOp op) {
+    return op == ALU_OP_DIV || op == ALU_OP_DIVU;
+}
+
+bool Core::accesses_hilo(const struct dtDecode &dt) {
+    if (!dt.is_valid) {
+        return false;
+    }
+    switch (dt.aluop) {
+    case ALU_OP_MFHI:
+    case ALU_OP_MTHI:
+    case ALU_OP_MFLO:
+    case ALU_OP_MTLO: return true;
+    default: return is_mult(dt.aluop) || is_div(dt.aluop);
+    }
+}
+
 void Core::dtFetchInit(struct dtFetch &dt) {
     dt.inst = Instruction(0x00);
     dt.excause = EXCAUSE_NONE;
@@ -740,6 +976,136 @@ void Core::dtMemoryInit(struct dtMemory &dt) {
     dt.is_valid = false;
 }
 
+void Core::dtFetchSave(CheckpointWriter &writer, const struct dtFetch &dt) {
+    writer.write_u32(dt.inst.data());
+    writer.write_u64(dt.inst_addr.get_raw());
+    writer.write_u32(dt.excause);
+    writer.write_bool(dt.in_delay_slot);
+    writer.write_bool(dt.is_valid);
+}
+
+void Core::dtDecodeSave(CheckpointWriter &writer, const struct dtDecode &dt) {
+    writer.write_u32(dt.inst.data());
+    for (bool flag :
+         { dt.memread, dt.memwrite, dt.alusrc, dt.regd, dt.regd31, dt.regwrite, dt.alu_req_rs,
+           dt.alu_req_rt, dt.bjr_req_rs, dt.bjr_req_rt, dt.branch, dt.jump, dt.bj_not,
+           dt.bgt_blez, dt.nb_skip_ds, dt.forward_m_d_rs, dt.forward_m_d_rt }) {
+        writer.write_bool(flag);
+    }
+    writer.write_u32(dt.aluop);
+    writer.write_u32(dt.memctl);
+    writer.write_u8(dt.num_rs);
+    writer.write_u8(dt.num_rt);
+    writer.write_u8(dt.num_rd);
+    writer.write_u64(dt.val_rs.as_u64());
+    writer.write_u64(dt.val_rt.as_u64());
+    writer.write_u32(dt.immediate_val);
+    writer.write_u8(dt.rwrite);
+    writer.write_u32(dt.ff_rs);
+    writer.write_u32(dt.ff_rt);
+    writer.write_u64(dt.inst_addr.get_raw());
+    writer.write_u32(dt.excause);
+    writer.write_bool(dt.in_delay_slot);
+    writer.write_bool(dt.stall);
+    writer.write_bool(dt.stop_if);
+    writer.write_bool(dt.is_valid);
+}
+
+void Core::dtExecuteSave(CheckpointWriter &writer, const struct dtExecute &dt) {
+    writer.write_u32(dt.inst.data());
+    writer.write_bool(dt.memread);
+    writer.write_bool(dt.memwrite);
+    writer.write_bool(dt.regwrite);
+    writer.write_u32(dt.memctl);
+    writer.write_u64(dt.val_rt.as_u64());
+    writer.write_u8(dt.rwrite);
+    writer.write_u64(dt.alu_val.as_u64());
+    writer.write_u64(dt.inst_addr.get_raw());
+    writer.write_u32(dt.excause);
+    writer.write_bool(dt.in_delay_slot);
+    writer.write_bool(dt.stop_if);
+    writer.write_bool(dt.is_valid);
+}
+
+void Core::dtMemorySave(CheckpointWriter &writer, const struct dtMemory &dt) {
+    writer.write_u32(dt.inst.data());
+    writer.write_bool(dt.memtoreg);
+    writer.write_bool(dt.regwrite);
+    writer.write_u8(dt.rwrite);
+    writer.write_u64(dt.towrite_val.as_u64());
+    writer.write_u64(dt.mem_addr.get_raw());
+    writer.write_u64(dt.inst_addr.get_raw());
+    writer.write_u32(dt.excause);
+    writer.write_bool(dt.in_delay_slot);
+    writer.write_bool(dt.stop_if);
+    writer.write_bool(dt.is_valid);
+}
+
+void Core::dtFetchRestore(CheckpointReader &reader, struct dtFetch &dt) {
+    dt.inst = Instruction(reader.read_u32());
+    dt.inst_addr = Address(reader.read_u64());
+    dt.excause = (enum ExceptionCause)reader.read_u32();
+    dt.in_delay_slot = reader.read_bool();
+    dt.is_valid = reader.read_bool();
+}
+
+void Core::dtDecodeRestore(CheckpointReader &reader, struct dtDecode &dt) {
+    dt.inst = Instruction(reader.read_u32());
+    for (bool *flag :
+         { &dt.memread, &dt.memwrite, &dt.alusrc, &dt.regd, &dt.regd31, &dt.regwrite,
+           &dt.alu_req_rs, &dt.alu_req_rt, &dt.bjr_req_rs, &dt.bjr_req_rt, &dt.branch, &dt.jump,
+           &dt.bj_not, &dt.bgt_blez, &dt.nb_skip_ds, &dt.forward_m_d_rs, &dt.forward_m_d_rt }) {
+        *flag = reader.read_bool();
+    }
+    dt.aluop = (enum AluOp)reader.read_u32();
+    dt.memctl = (enum AccessControl)reader.read_u32();
+    dt.num_rs = reader.read_u8();
+    dt.num_rt = reader.read_u8();
+    dt.num_rd = reader.read_u8();
+    dt.val_rs = reader.read_u64();
+    dt.val_rt = reader.read_u64();
+    dt.immediate_val = reader.read_u32();
+    dt.rwrite = reader.read_u8();
+    dt.ff_rs = (enum ForwardFrom)reader.read_u32();
+    dt.ff_rt = (enum ForwardFrom)reader.read_u32();
+    dt.inst_addr = Address(reader.read_u64());
+    dt.excause = (enum ExceptionCause)reader.read_u32();
+    dt.in_delay_slot = reader.read_bool();
+    dt.stall = reader.read_bool();
+    dt.stop_if = reader.read_bool();
+    dt.is_valid = reader.read_bool();
+}
+
+void Core::dtExecuteRestore(CheckpointReader &reader, struct dtExecute &dt) {
+    dt.inst = Instruction(reader.read_u32());
+    dt.memread = reader.read_bool();
+    dt.memwrite = reader.read_bool();
+    dt.regwrite = reader.read_bool();
+    dt.memctl = (enum AccessControl)reader.read_u32();
+    dt.val_rt = reader.read_u64();
+    dt.rwrite = reader.read_u8();
+    dt.alu_val = reader.read_u64();
+    dt.inst_addr = Address(reader.read_u64());
+    dt.excause = (enum ExceptionCause)reader.read_u32();
+    dt.in_delay_slot = reader.read_bool();
+    dt.stop_if = reader.read_bool();
+    dt.is_valid = reader.read_bool();
+}
+
+void Core::dtMemoryRestore(CheckpointReader &reader, struct dtMemory &dt) {
+    dt.inst = Instruction(reader.read_u32());
+    dt.memtoreg = reader.read_bool();
+    dt.regwrite = reader.read_bool();
+    dt.rwrite = reader.read_u8();
+    dt.towrite_val = reader.read_u64();
+    dt.mem_addr = Address(reader.read_u64());
+    dt.inst_addr = Address(reader.read_u64());
+    dt.excause = (enum ExceptionCause)reader.read_u32();
+    dt.in_delay_slot = reader.read_bool();
+    dt.stop_if = reader.read_bool();
+    dt.is_valid = reader.read_bool();
+}
+
 CoreSingle::CoreSingle(
     Registers *regs,
     FrontendMemory *mem_program,
@@ -776,8 +1142,12 @@ void CoreSingle::do_step(bool skip_break) {
 
     if ((m.stop_if || (m.excause != EXCAUSE_NONE)) && dt_f != nullptr) {
         dtFetchInit(*dt_f);
-        emit instruction_fetched(dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
-        emit fetch_inst_addr_value(STAGEADDR_NONE);
+        if (probe(SG_INSTRUCTION)) {
+            emit instruction_fetched(dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
+        }
+        if (probe(SG_INST_ADDR)) {
+            emit fetch_inst_addr_value(STAGEADDR_NONE);
+        }
     } else {
         bool branch_taken = handle_pc(d);
         if (dt_f != nullptr) {
@@ -809,48 +1179,124 @@ void CoreSingle::do_reset() {
     prev_inst_addr = Address::null();
 }
 
+void CoreSingle::do_save_state(CheckpointWriter &writer) const {
+    writer.write_u64(prev_inst_addr.get_raw());
+    writer.write_u32(dt_f != nullptr);
+    if (dt_f != nullptr) {
+        dtFetchSave(writer, *dt_f);
+    }
+}
+
+void CoreSingle::do_restore_state(CheckpointReader &reader) {
+    prev_inst_addr = Address(reader.read_u64());
+    reader.expect_u32(dt_f != nullptr, "delay slot");
+    if (dt_f != nullptr) {
+        dtFetchRestore(reader, *dt_f);
+    }
+}
+
 CorePipelined::CorePipelined(
     Registers *regs,
     FrontendMemory *mem_program,
     FrontendMemory *mem_data,
     enum MachineConfig::HazardUnit hazard_unit,
     unsigned int min_cache_row_size,
-    Cop0State *cop0state)
-    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state) {
+    Cop0State *cop0state,
+    std::unique_ptr<BranchPredictionUnit> branch_unit)
+    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state)
+    , branch_unit(std::move(branch_unit))
+    , mult_latency(1)
+    , div_latency(1) {
     this->hazard_unit = hazard_unit;
     reset();
 }
 
+const BranchPredictionUnit *CorePipelined::get_branch_prediction() const {
+    return branch_unit.get();
+}
+
+void CorePipelined::set_muldiv_latency(unsigned mult, unsigned div) {
+    mult_latency = mult > 0 ? mult : 1;
+    div_latency = div > 0 ? div : 1;
+}
+
+enum BranchKind CorePipelined::branch_kind(const struct dtDecode &dt) {
+    if (dt.regd31 || (dt.jump && dt.bjr_req_rs && dt.regwrite && dt.rwrite != 0)) {
+        return BK_CALL;
+    }
+    if (dt.jump && dt.bjr_req_rs) {
+        return dt.num_rs == 31 ? BK_RETURN : BK_INDIRECT;
+    }
+    if (dt.jump) {
+        return BK_JUMP;
+    }
+    return dt.branch ? BK_CONDITIONAL : BK_NONE;
+}
+
 void CorePipelined::do_step(bool skip_break) {
     bool stall = false;
     bool branch_stall = false;
+    bool branch_flush = false;
     bool excpt_in_progress;
     Address jump_branch_pc = dt_m.inst_addr;
+    // Cause of the stall and instruction it is attributed to
+    enum StallReason stall_reason = SR_DATA_HAZARD;
+    unsigned flushed = 0;
 
     // Process stages
     writeback(dt_m);
     dt_m = memory(dt_e);
+    if (hilo_busy > 0) {
+        hilo_busy--;
+    }
+    if (dt_d.is_valid && is_mult(dt_d.aluop)) {
+        hilo_busy = std::max(hilo_busy, mult_latency - 1);
+    } else if (dt_d.is_valid && is_div(dt_d.aluop)) {
+        hilo_busy = std::max(hilo_busy, div_latency - 1);
+    }
     dt_e = execute(dt_d);
     dt_d = decode(dt_f);
+    Address stall_addr = dt_d.inst_addr;
 
     // Resolve exceptions
     excpt_in_progress = dt_m.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
+        flushed += dt_e.is_valid;
         dtExecuteInit(dt_e);
-        emit instruction_executed(dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
-        emit execute_inst_addr_value(STAGEADDR_NONE);
+        if (probe(SG_INSTRUCTION)) {
+            emit instruction_executed(dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
+        }
+        if (probe(SG_INST_ADDR)) {
+            emit execute_inst_addr_value(STAGEADDR_NONE);
+        }
     }
     excpt_in_progress = excpt_in_progress || dt_e.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
+        flushed += dt_d.is_valid;
         dtDecodeInit(dt_d);
-        emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
-        emit decode_inst_addr_value(STAGEADDR_NONE);
+        if (probe(SG_INSTRUCTION)) {
+            emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
+        }
+        if (probe(SG_INST_ADDR)) {
+            emit decode_inst_addr_value(STAGEADDR_NONE);
+        }
     }
     excpt_in_progress = excpt_in_progress || dt_e.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
+        flushed += dt_f.is_valid;
         dtFetchInit(dt_f);
-        emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
-        emit fetch_inst_addr_value(STAGEADDR_NONE);
+        if (probe(SG_INSTRUCTION)) {
+            emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+        }
+        if (probe(SG_INST_ADDR)) {
+            emit fetch_inst_addr_value(STAGEADDR_NONE);
+        }
+        if (flushed > 0) {
+            // Work of discarded instructions is lost
+            count_stall(
+                SR_EXCEPTION_FLUSH,
+                dt_m.excause != EXCAUSE_NONE ? dt_m.inst_addr : dt_e.inst_addr, flushed);
+        }
         if (dt_m.excause != EXCAUSE_NONE) {
             regs->pc_abs_jmp(dt_e.inst_addr);
             handle_exception(
@@ -890,6 +1336,7 @@ void CorePipelined::do_step(bool skip_break) {
                 }
             } else {
                 stall = true;
+                stall_reason = SR_DATA_HAZARD;
             }
         }
         if (HAZARD(dt_e)) {
@@ -897,6 +1344,7 @@ void CorePipelined::do_step(bool skip_break) {
             if (hazard_unit == MachineConfig::HU_STALL_FORWARD) {
                 if (dt_e.memread) {
                     stall = true;
+                    stall_reason = SR_LOAD_USE;
                 } else {
                     // Forward result value
                     if (dt_d.alu_req_rs && dt_e.rwrite == dt_d.num_rs) {
@@ -910,20 +1358,29 @@ void CorePipelined::do_step(bool skip_break) {
                 }
             } else {
                 stall = true;
+                stall_reason = dt_e.memread ? SR_LOAD_USE : SR_DATA_HAZARD;
             }
         }
 #undef HAZARD
+        if (hilo_busy > 0 && accesses_hilo(dt_d)) {
+            // Multiply and divide unit is not pipelined, HI and LO are not
+            // ready until it finishes
+            stall = true;
+            stall_reason = SR_MUL_DIV;
+        }
         if (dt_e.rwrite != 0 && dt_e.regwrite
             && ((dt_d.bjr_req_rs && dt_d.num_rs == dt_e.rwrite)
                 || (dt_d.bjr_req_rt && dt_d.num_rt == dt_e.rwrite))) {
             stall = true;
             branch_stall = true;
+            stall_reason = SR_BRANCH_OPERAND;
         } else {
             if (hazard_unit != MachineConfig::HU_STALL_FORWARD || dt_m.memtoreg) {
                 if (dt_m.rwrite != 0 && dt_m.regwrite
                     && ((dt_d.bjr_req_rs && dt_d.num_rs == dt_m.rwrite)
                         || (dt_d.bjr_req_rt && dt_d.num_rt == dt_m.rwrite))) {
                     stall = true;
+                    stall_reason = SR_BRANCH_OPERAND;
                 }
             } else {
                 if (dt_m.rwrite != 0 && dt_m.regwrite && dt_d.bjr_req_rs
@@ -938,10 +1395,14 @@ void CorePipelined::do_step(bool skip_break) {
                 }
             }
         }
-        emit forward_m_d_rs_value(dt_d.forward_m_d_rs);
-        emit forward_m_d_rt_value(dt_d.forward_m_d_rt);
+        if (probe(SG_DATAPATH)) {
+            emit forward_m_d_rs_value(dt_d.forward_m_d_rs);
+            emit forward_m_d_rt_value(dt_d.forward_m_d_rt);
+        }
+    }
+    if (probe(SG_DATAPATH)) {
+        emit branch_forward_value((dt_d.forward_m_d_rs || dt_d.forward_m_d_rt) ? 2 : branch_stall);
     }
-    emit branch_forward_value((dt_d.forward_m_d_rs || dt_d.forward_m_d_rt) ? 2 : branch_stall);
 #if 0
     if (stall)
         printf("STALL\n");
@@ -957,12 +1418,44 @@ void CorePipelined::do_step(bool skip_break) {
     printf("PC 0x%08lx\n", (unsigned long)dt_f.inst_addr);
 #endif
 
-    if (dt_e.stop_if || dt_m.stop_if) { stall = true; }
+    if (dt_e.stop_if || dt_m.stop_if) {
+        stall = true;
+        stall_reason = SR_STOP_IF;
+        stall_addr = dt_m.stop_if ? dt_m.inst_addr : dt_e.inst_addr;
+    }
 
-    emit hu_stall_value(stall);
+    if (probe(SG_DATAPATH)) {
+        emit hu_stall_value(stall);
+    }
 
     // Now process program counter (loop connections from decode stage)
-    if (!stall && !dt_d.stop_if) {
+    if (!stall && !dt_d.stop_if && branch_unit != nullptr) {
+        // No delay slot, fetch follows prediction and instruction resolved
+        // in decode stage flushes the fetched one when it was mispredicted.
+        dt_d.stall = false;
+        Address predicted = regs->read_pc();
+        dt_f = fetch(skip_break);
+        if (dt_d.is_valid) {
+            regs->pc_abs_jmp(dt_d.inst_addr);
+            bool taken = handle_pc(dt_d);
+            Address next_addr = regs->read_pc();
+            branch_unit->resolve(dt_d.inst_addr, branch_kind(dt_d), taken, next_addr, predicted);
+            branch_flush = next_addr != predicted;
+        }
+        if (branch_flush) {
+            dtFetchInit(dt_f);
+            // Bubble carries address execution continues at for exceptions
+            dt_f.inst_addr = regs->read_pc();
+            if (probe(SG_INSTRUCTION)) {
+                emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+            }
+            if (probe(SG_INST_ADDR)) {
+                emit fetch_inst_addr_value(STAGEADDR_NONE);
+            }
+        } else {
+            regs->pc_abs_jmp(branch_unit->predict(dt_f.inst_addr));
+        }
+    } else if (!stall && !dt_d.stop_if) {
         dt_d.stall = false;
         dt_f = fetch(skip_break);
         if (handle_pc(dt_d)) {
@@ -970,8 +1463,12 @@ void CorePipelined::do_step(bool skip_break) {
         } else {
             if (dt_d.nb_skip_ds) {
                 dtFetchInit(dt_f);
-                emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
-                emit fetch_inst_addr_value(STAGEADDR_NONE);
+                if (probe(SG_INSTRUCTION)) {
+                    emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+                }
+                if (probe(SG_INST_ADDR)) {
+                    emit fetch_inst_addr_value(STAGEADDR_NONE);
+                }
             }
         }
     } else {
@@ -987,9 +1484,13 @@ void CorePipelined::do_step(bool skip_break) {
         // emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause,
         // dt_d.is_valid);
     }
-    if (stall || dt_d.stop_if) {
-        stall_c++;
-        emit stall_c_value(stall_c);
+    if (branch_flush) {
+        stall_reason = SR_BRANCH_MISPREDICT;
+    } else if (!stall && dt_d.stop_if) {
+        stall_reason = SR_STOP_IF;
+    }
+    if (stall || dt_d.stop_if || branch_flush) {
+        count_stall(stall_reason, stall_addr);
     }
 }
 
@@ -1002,6 +1503,438 @@ void CorePipelined::do_reset() {
     dt_e.inst_addr = 0x0_addr;
     dtMemoryInit(dt_m);
     dt_m.inst_addr = 0x0_addr;
+    hilo_busy = 0;
+    if (branch_unit != nullptr) {
+        branch_unit->reset();
+    }
+}
+
+void CorePipelined::do_save_state(CheckpointWriter &writer) const {
+    dtFetchSave(writer, dt_f);
+    dtDecodeSave(writer, dt_d);
+    dtExecuteSave(writer, dt_e);
+    dtMemorySave(writer, dt_m);
+    writer.write_u32(hilo_busy);
+    writer.write_u32(branch_unit != nullptr);
+    if (branch_unit != nullptr) {
+        branch_unit->save_state(writer);
+    }
+}
+
+void CorePipelined::do_restore_state(CheckpointReader &reader) {
+    dtFetchRestore(reader, dt_f);
+    dtDecodeRestore(reader, dt_d);
+    dtExecuteRestore(reader, dt_e);
+    dtMemoryRestore(reader, dt_m);
+    hilo_busy = reader.read_u32();
+    reader.expect_u32(branch_unit != nullptr, "branch prediction");
+    if (branch_unit != nullptr) {
+        branch_unit->restore_state(reader);
+    }
+}
+
+const char *CoreSuperscalar::empty_slot_reason_name(enum EmptySlotReason reason) {
+    switch (reason) {
+    case ES_FETCH: return "fetch";
+    case ES_HAZARD: return "hazard";
+    case ES_DEPENDENCY: return "dependency";
+    case ES_MEMORY_PORT: return "memory-port";
+    case ES_HI_LO: return "hi-lo";
+    case ES_CONTROL: return "control";
+    case ES_SERIALIZE: return "serialize";
+    case ES_EXCEPTION: return "exception";
+    case ES_COUNT: break;
+    }
+    return "unknown";
+}
+
+CoreSuperscalar::CoreSuperscalar(
+    Registers *regs,
+    FrontendMemory *mem_program,
+    FrontendMemory *mem_data,
+    bool jmp_delay_slot,
+    enum MachineConfig::HazardUnit hazard_unit,
+    unsigned int min_cache_row_size,
+    Cop0State *cop0state)
+    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state)
+    , jmp_delay_slot(jmp_delay_slot)
+    , hazard_unit(hazard_unit) {
+    reset();
+}
+
+unsigned CoreSuperscalar::get_retired_count() const {
+    return retired_c;
+}
+
+unsigned CoreSuperscalar::get_issue_count(unsigned width) const {
+    return width <= ISSUE_WIDTH ? issue_c[width] : 0;
+}
+
+unsigned CoreSuperscalar::get_empty_slot_count(enum EmptySlotReason reason) const {
+    return reason < ES_COUNT ? empty_slot_c[reason] : 0;
+}
+
+double CoreSuperscalar::get_ipc() const {
+    if (get_cycle_count() == 0) {
+        return 0;
+    }
+    return (double)retired_c / get_cycle_count();
+}
+
+double CoreSuperscalar::get_dual_issue_rate() const {
+    const unsigned issuing = issue_c[1] + issue_c[2];
+    if (issuing == 0) {
+        return 0;
+    }
+    return (double)issue_c[2] / issuing;
+}
+
+enum CoreSuperscalar::EmptySlotReason
+CoreSuperscalar::pairing_conflict(const struct dtDecode &older, const struct dtDecode &younger) {
+    if (older.regwrite && older.rwrite != 0
+        && (((younger.alu_req_rs || younger.bjr_req_rs) && younger.num_rs == older.rwrite)
+            || ((younger.alu_req_rt || younger.bjr_req_rt) && younger.num_rt == older.rwrite))) {
+        return ES_DEPENDENCY;
+    }
+    if (older.memctl != AC_NONE && younger.memctl != AC_NONE) {
+        return ES_MEMORY_PORT;
+    }
+    if (accesses_hilo(older) && accesses_hilo(younger)) {
+        return ES_HI_LO;
+    }
+    if ((older.branch || older.jump) && (younger.branch || younger.jump)) {
+        return ES_CONTROL;
+    }
+    return ES_COUNT;
+}
+
+bool CoreSuperscalar::forward_operand(
+    bool alu_req,
+    bool bjr_req,
+    uint8_t num,
+    RegisterValue &val,
+    enum ForwardFrom &ff,
+    bool &forward_m_d,
+    enum StallReason &reason) const {
+    if ((!alu_req && !bjr_req) || num == 0) {
+        return false;
+    }
+    const bool forward = hazard_unit == MachineConfig::HU_STALL_FORWARD;
+    // The youngest instruction writing the register provides the value
+    for (unsigned lane = ISSUE_WIDTH; lane-- > 0;) {
+        const struct dtExecute &dt = dt_e[lane];
+        if (dt.regwrite && dt.rwrite == num) {
+            if (bjr_req || dt.memread || !forward) {
+                reason = bjr_req ? SR_BRANCH_OPERAND : dt.memread ? SR_LOAD_USE : SR_DATA_HAZARD;
+                return true;
+            }
+            val = dt.alu_val;
+            ff = FORWARD_FROM_M;
+            return false;
+        }
+    }
+    for (unsigned lane = ISSUE_WIDTH; lane-- > 0;) {
+        const struct dtMemory &dt = dt_m[lane];
+        if (dt.regwrite && dt.rwrite == num) {
+            if (!forward || (bjr_req && dt.memtoreg)) {
+                reason = bjr_req ? SR_BRANCH_OPERAND : SR_DATA_HAZARD;
+                return true;
+            }
+            val = dt.towrite_val;
+            if (alu_req) {
+                ff = FORWARD_FROM_W;
+            }
+            forward_m_d = bjr_req;
+            return false;
+        }
+    }
+    return false;
+}
+
+bool CoreSuperscalar::forward_operands(struct dtDecode &dt, enum StallReason &reason) const {
+    if (hazard_unit == MachineConfig::HU_NONE) {
+        return false;
+    }
+    return forward_operand(
+               dt.alu_req_rs, dt.bjr_req_rs, dt.num_rs, dt.val_rs, dt.ff_rs, dt.forward_m_d_rs,
+               reason)
+           || forward_operand(
+               dt.alu_req_rt, dt.bjr_req_rt, dt.num_rt, dt.val_rt, dt.ff_rt, dt.forward_m_d_rt,
+               reason);
+}
+
+void CoreSuperscalar::flush_after_exception(unsigned lane) {
+    // Younger instructions are discarded, the oldest of them (or fetch address
+    // when there is none) is where execution continues after the exception
+    Address next_addr = regs->read_pc();
+    unsigned flushed = 0;
+    for (unsigned i = ISSUE_WIDTH; i-- > 0;) {
+        if (dt_f[i].is_valid) {
+            next_addr = dt_f[i].inst_addr;
+            flushed++;
+        }
+        dtFetchInit(dt_f[i]);
+        fetch_empty[i] = ES_EXCEPTION;
+    }
+    for (unsigned i = ISSUE_WIDTH; i-- > lane + 1;) {
+        if (dt_d[i].is_valid) {
+            next_addr = dt_d[i].inst_addr;
+            flushed++;
+        }
+    }
+    // Bubbles carry the address until the exception is handled in memory stage
+    for (auto &dt : dt_d) {
+        dtDecodeInit(dt);
+        dt.inst_addr = next_addr;
+    }
+    if (flushed > 0) {
+        count_stall(SR_EXCEPTION_FLUSH, dt_e[lane].inst_addr, flushed);
+    }
+    issue_c[0]++;
+    empty_slot_c[ES_EXCEPTION] += ISSUE_WIDTH;
+}
+
+void CoreSuperscalar::do_step(bool skip_break) {
+    // Stages process lane 0 first, so instructions take effect in program order
+    for (auto &dt : dt_m) {
+        writeback(dt);
+        if (dt.is_valid && dt.excause == EXCAUSE_NONE) {
+            retired_c++;
+        }
+    }
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        dt_m[lane] = memory(dt_e[lane]);
+    }
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        const struct dtMemory &dt = dt_m[lane];
+        if (dt.excause != EXCAUSE_NONE) {
+            // Older instruction of the pair completes before the handler runs
+            for (unsigned older = 0; older < lane; older++) {
+                writeback(dt_m[older]);
+                retired_c += dt_m[older].is_valid;
+                dtMemoryInit(dt_m[older]);
+            }
+            for (auto &e : dt_e) {
+                dtExecuteInit(e);
+            }
+            Address next_addr = dt_d[0].inst_addr;
+            regs->pc_abs_jmp(next_addr);
+            issue_c[0]++;
+            empty_slot_c[ES_EXCEPTION] += ISSUE_WIDTH;
+            handle_exception(
+                this, regs, dt.excause, dt.inst_addr, next_addr, prev_inst_addr, dt.in_delay_slot,
+                dt.mem_addr);
+            return;
+        }
+        if (dt.is_valid) {
+            prev_inst_addr = dt.inst_addr;
+        }
+    }
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        if (lane > 0 && dt_e[lane - 1].excause != EXCAUSE_NONE) {
+            // Younger instruction of the pair must not change any state
+            dtExecuteInit(dt_e[lane]);
+            continue;
+        }
+        dt_e[lane] = execute(dt_d[lane]);
+    }
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        if (dt_e[lane].excause != EXCAUSE_NONE) {
+            flush_after_exception(lane);
+            return;
+        }
+    }
+
+    // Serializing instruction holds fetch until it leaves memory stage
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        const struct dtExecute &e = dt_e[lane];
+        const struct dtMemory &m = dt_m[lane];
+        if ((e.is_valid && e.stop_if) || (m.is_valid && m.stop_if)) {
+            for (auto &dt : dt_d) {
+                dtDecodeInit(dt);
+            }
+            count_stall(SR_STOP_IF, m.stop_if ? m.inst_addr : e.inst_addr);
+            issue_c[0]++;
+            for (unsigned slot = 0; slot < ISSUE_WIDTH; slot++) {
+                empty_slot_c[fetch_empty[slot]]++;
+            }
+            if (probe(SG_DATAPATH)) {
+                emit hu_stall_value(true);
+            }
+            return;
+        }
+    }
+
+    // Issue instructions from the fetch latch in program order
+    unsigned issued = 0;
+    unsigned keep_end = ISSUE_WIDTH; // Latch lanes from this one are discarded
+    enum EmptySlotReason empty_reason = ES_COUNT;
+    enum StallReason stall_reason = SR_DATA_HAZARD;
+    bool stall = false;
+    bool stop_fetch = false;
+    enum EmptySlotReason stop_reason = ES_CONTROL;
+    bool fetch_delay_slot = false;
+    Address redirect_addr = regs->read_pc();
+    Address fetch_addr = regs->read_pc();
+    for (auto &dt : dt_d) {
+        dtDecodeInit(dt);
+    }
+    for (unsigned lane = 0; lane < ISSUE_WIDTH && dt_f[lane].is_valid; lane++) {
+        struct dtDecode dt = decode(dt_f[lane]);
+        if (lane > 0) {
+            empty_reason = pairing_conflict(dt_d[lane - 1], dt);
+            if (empty_reason != ES_COUNT) {
+                break;
+            }
+        }
+        if (forward_operands(dt, stall_reason)) {
+            empty_reason = ES_HAZARD;
+            stall = lane == 0;
+            break;
+        }
+        dt_d[issued++] = dt;
+
+        const bool next_in_latch = lane + 1 < ISSUE_WIDTH && dt_f[lane + 1].is_valid;
+        if (dt.stop_if) {
+            // Younger instructions are fetched again when it completes
+            if (next_in_latch) {
+                empty_reason = ES_SERIALIZE;
+            }
+            keep_end = lane + 1;
+            fetch_addr = dt.inst_addr + 4;
+            stop_fetch = true;
+            stop_reason = ES_SERIALIZE;
+            count_stall(SR_STOP_IF, dt.inst_addr);
+            break;
+        }
+        if (!dt.branch && !dt.jump) {
+            continue;
+        }
+        regs->pc_abs_jmp(dt.inst_addr);
+        const bool taken = handle_pc(dt);
+        const Address target = regs->read_pc();
+        if (!jmp_delay_slot) {
+            if (taken) {
+                if (next_in_latch) {
+                    empty_reason = ES_CONTROL;
+                }
+                keep_end = lane + 1;
+                fetch_addr = target;
+                stop_fetch = true;
+                count_stall(SR_BRANCH_MISPREDICT, dt.inst_addr);
+                break;
+            }
+        } else if (taken) {
+            // Delay slot is the only instruction fetched before the target
+            if (next_in_latch) {
+                dt_f[lane + 1].in_delay_slot = true;
+                fetch_addr = target;
+            } else {
+                fetch_delay_slot = true;
+                redirect_addr = target;
+                stop_fetch = true;
+            }
+        } else if (dt.nb_skip_ds) {
+            // Delay slot of not taken likely branch is skipped
+            if (next_in_latch) {
+                empty_reason = ES_CONTROL;
+                keep_end = lane + 1;
+                break;
+            }
+            fetch_addr = dt.inst_addr + 8;
+        }
+    }
+    if (stall) {
+        count_stall(stall_reason, dt_f[0].inst_addr);
+    }
+    if (probe(SG_DATAPATH)) {
+        emit hu_stall_value(stall);
+    }
+    issue_c[issued]++;
+    for (unsigned slot = issued; slot < ISSUE_WIDTH; slot++) {
+        empty_slot_c[empty_reason != ES_COUNT ? empty_reason : fetch_empty[slot]]++;
+    }
+
+    // Instructions which did not issue move to the front of the fetch latch
+    // and fetch fills the rest
+    unsigned kept = 0;
+    for (unsigned lane = issued; lane < keep_end; lane++) {
+        if (dt_f[lane].is_valid) {
+            dt_f[kept++] = dt_f[lane];
+        }
+    }
+    regs->pc_abs_jmp(fetch_addr);
+    if (fetch_delay_slot) {
+        dt_f[kept] = fetch(skip_break);
+        dt_f[kept++].in_delay_slot = true;
+        regs->pc_abs_jmp(redirect_addr);
+    }
+    while (!stop_fetch && kept < ISSUE_WIDTH) {
+        dt_f[kept++] = fetch(skip_break);
+        regs->pc_inc();
+    }
+    for (unsigned lane = kept; lane < ISSUE_WIDTH; lane++) {
+        dtFetchInit(dt_f[lane]);
+        fetch_empty[lane] = stop_reason;
+    }
+}
+
+void CoreSuperscalar::do_reset() {
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        dtFetchInit(dt_f[lane]);
+        dt_f[lane].inst_addr = 0x0_addr;
+        fetch_empty[lane] = ES_FETCH;
+        dtDecodeInit(dt_d[lane]);
+        dt_d[lane].inst_addr = 0x0_addr;
+        dtExecuteInit(dt_e[lane]);
+        dt_e[lane].inst_addr = 0x0_addr;
+        dtMemoryInit(dt_m[lane]);
+        dt_m[lane].inst_addr = 0x0_addr;
+    }
+    prev_inst_addr = Address::null();
+    retired_c = 0;
+    std::fill(std::begin(issue_c), std::end(issue_c), 0);
+    std::fill(std::begin(empty_slot_c), std::end(empty_slot_c), 0);
+}
+
+void CoreSuperscalar::do_save_state(CheckpointWriter &writer) const {
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        dtFetchSave(writer, dt_f[lane]);
+        writer.write_u32(fetch_empty[lane]);
+        dtDecodeSave(writer, dt_d[lane]);
+        dtExecuteSave(writer, dt_e[lane]);
+        dtMemorySave(writer, dt_m[lane]);
+    }
+    writer.write_u64(prev_inst_addr.get_raw());
+    writer.write_u32(retired_c);
+    for (uint32_t c : issue_c) {
+        writer.write_u32(c);
+    }
+    for (uint32_t c : empty_slot_c) {
+        writer.write_u32(c);
+    }
+}
+
+void CoreSuperscalar::do_restore_state(CheckpointReader &reader) {
+    for (unsigned lane = 0; lane < ISSUE_WIDTH; lane++) {
+        dtFetchRestore(reader, dt_f[lane]);
+        const uint32_t reason = reader.read_u32();
+        if (reason >= ES_COUNT) {
+            throw SIMULATOR_EXCEPTION(Input, "Checkpoint issue slot state is corrupted", "");
+        }
+        fetch_empty[lane] = (enum EmptySlotReason)reason;
+        dtDecodeRestore(reader, dt_d[lane]);
+        dtExecuteRestore(reader, dt_e[lane]);
+        dtMemoryRestore(reader, dt_m[lane]);
+    }
+    prev_inst_addr = Address(reader.read_u64());
+    retired_c = reader.read_u32();
+    for (uint32_t &c : issue_c) {
+        c = reader.read_u32();
+    }
+    for (uint32_t &c : empty_slot_c) {
+        c = reader.read_u32();
+    }
 }
 
 bool StopExceptionHandler::handle_exception(
@@ -37,6 +37,7 @@
 #define CORE_H
 
 #include "alu.h"
+#include "branch_predictor.h"
 #include "cop0state.h"
 #include "instruction.h"
 #include "machineconfig.h"
@@ -47,10 +48,15 @@
 #include "simulator_exception.h"
 
 #include <QObject>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace machine {
 
 class Core;
+class CheckpointWriter;
+class CheckpointReader;
 
 class ExceptionHandler : public QObject {
     Q_OBJECT
@@ -81,6 +87,27 @@ public:
         Address mem_ref_addr) override;
 };
 
+// Reasons of cycles the core does not progress, each stall cycle has one
+enum StallReason {
+    SR_DATA_HAZARD,       // Operand not ready, forwarding would resolve it
+    SR_LOAD_USE,          // Operand loaded by instruction in execute stage
+    SR_MUL_DIV,           // HI or LO accessed while multiply or divide is running
+    SR_BRANCH_OPERAND,    // Operand of branch or jump in decode stage not ready
+    SR_STOP_IF,           // Serializing instruction stops fetch (SYSCALL, ERET...)
+    SR_EXCEPTION_FLUSH,   // Instruction discarded by exception
+    SR_BRANCH_MISPREDICT, // Instruction fetched from mispredicted address
+    SR_MEMORY,            // Waiting for memory access time
+    SR_COUNT
+};
+
+const char *stall_reason_name(enum StallReason reason);
+
+struct StallCounts {
+    uint32_t count[SR_COUNT] = {};
+
+    uint32_t total() const;
+};
+
 class Core : public QObject {
     Q_OBJECT
 public:
@@ -99,6 +126,21 @@ public:
     unsigned get_cycle_count() const; // Returns number of executed
                                       // get_cycle_count
     unsigned get_stall_count() const; // Returns number of stall get_cycle_count
+    unsigned get_stall_count(enum StallReason reason) const;
+    // Cycles stalled waiting for memory, included in stall count
+    unsigned get_memory_stall_count() const;
+    // Stall cycles by address of instruction, which caused them
+    const std::unordered_map<uint64_t, StallCounts> &get_pc_stalls() const;
+    // Returns nullptr when the core does not predict branches
+    virtual const BranchPredictionUnit *get_branch_prediction() const;
+
+    /**
+     * Make fetch and memory stage wait for memory. Cycles the accesses of a
+     * step waited (see `FrontendMemory::get_wait_cycles`) stall the whole
+     * core during following steps, so they are counted in cycle and stall
+     * counts. Disabled by default.
+     */
+    void set_memory_stalls(bool enable);
 
     Registers *get_regs();
     Cop0State *get_cop0state();
@@ -117,6 +159,26 @@ public:
 
     void set_c0_userlocal(uint32_t address);
 
+    void invalidate_predecode(); // Drop all predecoded instructions
+
+    // Counters and state of pipeline latches
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+    // Groups of instrumentation signals. Signals of group which no observer
+    // has subscribed to are not emitted at all.
+    enum SignalGroup {
+        SG_NONE = 0,
+        SG_INSTRUCTION = 1 << 0, // instruction_* of all stages
+        SG_INST_ADDR = 1 << 1,   // *_inst_addr_value of all stages
+        SG_DATAPATH = 1 << 2,    // Remaining stage and hazard unit values
+        SG_COUNTERS = 1 << 3,    // cycle_c_value and stall_c_value
+        SG_ALL = SG_INSTRUCTION | SG_INST_ADDR | SG_DATAPATH | SG_COUNTERS,
+    };
+    // Observer requests emission of given groups (mask of SignalGroup).
+    void subscribe_signals(unsigned groups);
+    unsigned get_subscribed_signals() const;
+
     enum ForwardFrom {
         FORWARD_NONE = 0b00,
         FORWARD_FROM_W = 0b01,
@@ -219,8 +281,21 @@ signals:
     void stop_on_exception_reached();
 
 protected:
+    // Groups which can be emitted at all. Build with CORE_NO_PROBES defined
+    // compiles out everything except signals used by command line tracer.
+#ifdef CORE_NO_PROBES
+    static constexpr unsigned SG_AVAILABLE = SG_INSTRUCTION;
+#else
+    static constexpr unsigned SG_AVAILABLE = SG_ALL;
+#endif
+    bool probe(enum SignalGroup group) const {
+        return (SG_AVAILABLE & group) && (subscribed_signals & group);
+    }
+
     virtual void do_step(bool skip_break = false) = 0;
     virtual void do_reset() = 0;
+    virtual void do_save_state(CheckpointWriter &writer) const = 0;
+    virtual void do_restore_state(CheckpointReader &reader) = 0;
 
     bool handle_exception(
         Core *core,
@@ -332,12 +407,49 @@ protected:
         RegisterValue rt_value,
         Address mem_addr);
 
+    // Decoding of instruction word which does not depend on register state.
+    // It is cached by instruction address and checked against fetched word
+    // so any change of program memory is noticed on the next fetch.
+    struct dtPredecode {
+        uint32_t inst_data;           // Instruction word the entry is valid for
+        Address inst_addr;            // Address the word was fetched from
+        enum InstructionFlags flags;  // Decoded flags (IMF_SUPPORTED set)
+        enum AluOp alu_op;            // Decoded ALU operation
+        enum AccessControl mem_ctl;   // Decoded memory access type
+        enum ExceptionCause excause;  // Exception encoded in instruction
+        uint8_t num_rs;               // Number of the register s
+        uint8_t num_rt;               // Number of the register t
+        uint8_t num_rd;               // Number of the register d
+        uint32_t immediate_val;       // zero or sign-extended immediate value
+        bool is_valid;
+    };
+    const struct dtPredecode &predecode(const Instruction &inst, Address inst_addr);
+
     // Initialize structures to NOPE instruction
     static void dtFetchInit(struct dtFetch &dt);
     static void dtDecodeInit(struct dtDecode &dt);
     static void dtExecuteInit(struct dtExecute &dt);
     static void dtMemoryInit(struct dtMemory &dt);
 
+    // Store and load structures in checkpoint
+    static void dtFetchSave(CheckpointWriter &writer, const struct dtFetch &dt);
+    static void dtDecodeSave(CheckpointWriter &writer, const struct dtDecode &dt);
+    static void dtExecuteSave(CheckpointWriter &writer, const struct dtExecute &dt);
+    static void dtMemorySave(CheckpointWriter &writer, const struct dtMemory &dt);
+    static void dtFetchRestore(CheckpointReader &reader, struct dtFetch &dt);
+    static void dtDecodeRestore(CheckpointReader &reader, struct dtDecode &dt);
+    static void dtExecuteRestore(CheckpointReader &reader, struct dtExecute &dt);
+    static void dtMemoryRestore(CheckpointReader &reader, struct dtMemory &dt);
+
+    static bool is_mult(enum AluOp op); // Multiply writing HI and LO
+    static bool is_div(enum AluOp op);
+    static bool accesses_hilo(const struct dtDecode &dt);
+
+    // Counts stall cycles caused by instruction at given address
+    void count_stall(enum StallReason reason, Address inst_addr, unsigned cycles = 1);
+    // Memory access of the instruction waited, core stalls in following steps
+    void add_memory_stall(Address inst_addr, uint64_t cycles);
+
 protected:
     unsigned int stall_c;
 
@@ -349,11 +461,24 @@ private:
         unsigned int count;
     };
     unsigned int cycle_c;
+    bool memory_stalls = false;
+    StallCounts stall_counts;
+    std::unordered_map<uint64_t, StallCounts> pc_stalls;
+    struct MemoryStall {
+        Address inst_addr;
+        uint32_t cycles;
+    };
+    // Memory stall cycles to spend before the next step
+    std::vector<MemoryStall> memory_stall_pending;
+    unsigned int subscribed_signals;
     unsigned int min_cache_row_size;
     uint32_t hwr_userlocal;
     QMap<Address, hwBreak *> hw_breaks;
     bool stop_on_exception[EXCAUSE_COUNT] {};
     bool step_over_exception[EXCAUSE_COUNT] {};
+    // Direct mapped by word address, size has to be power of two
+    static constexpr unsigned PREDECODE_CACHE_SIZE = 1024;
+    struct dtPredecode predecode_cache[PREDECODE_CACHE_SIZE] {};
 };
 
 class CoreSingle : public Core {
@@ -370,6 +495,8 @@ public:
 protected:
     void do_step(bool skip_break = false) override;
     void do_reset() override;
+    void do_save_state(CheckpointWriter &writer) const override;
+    void do_restore_state(CheckpointReader &reader) override;
 
 private:
     struct Core::dtFetch *dt_f;
@@ -385,11 +512,21 @@ public:
         enum MachineConfig::HazardUnit hazard_unit
         = MachineConfig::HU_STALL_FORWARD,
         unsigned int min_cache_row_size = 1,
-        Cop0State *cop0state = nullptr);
+        Cop0State *cop0state = nullptr,
+        std::unique_ptr<BranchPredictionUnit> branch_unit = nullptr);
+
+    // Core without branch prediction executes delay slot
+    const BranchPredictionUnit *get_branch_prediction() const override;
+
+    // Cycles multiply and divide occupy execute stage before HI and LO can be
+    // accessed again, 1 makes them available to the following instruction
+    void set_muldiv_latency(unsigned mult, unsigned div);
 
 protected:
     void do_step(bool skip_break = false) override;
     void do_reset() override;
+    void do_save_state(CheckpointWriter &writer) const override;
+    void do_restore_state(CheckpointReader &reader) override;
 
 private:
     struct Core::dtFetch dt_f;
@@ -398,6 +535,90 @@ private:
     struct Core::dtMemory dt_m;
 
     enum MachineConfig::HazardUnit hazard_unit;
+    std::unique_ptr<BranchPredictionUnit> branch_unit;
+    unsigned mult_latency, div_latency;
+    unsigned hilo_busy; // Cycles until running multiply or divide finishes
+
+    static enum BranchKind branch_kind(const struct dtDecode &dt);
+};
+
+/**
+ * In-order dual-issue variant of the five stage pipeline. Each pipeline latch
+ * has two lanes, lane 0 holds the older instruction. Two sequential
+ * instructions leave decode stage together unless the younger one cannot pair
+ * with the older one, it then waits for the next cycle in lane 0. Hazards
+ * against later stages, forwarding and branch resolution in decode stage
+ * follow CorePipelined. Without delay slot fetch continues sequentially and
+ * instructions fetched after taken branch are discarded.
+ */
+class CoreSuperscalar : public Core {
+public:
+    static constexpr unsigned ISSUE_WIDTH = 2;
+
+    // Reasons an issue slot of a cycle stayed empty
+    enum EmptySlotReason {
+        ES_FETCH,       // Pipeline is filling after reset
+        ES_HAZARD,      // Operand not ready, waiting for instruction in later stage
+        ES_DEPENDENCY,  // Operand produced by instruction in the older slot
+        ES_MEMORY_PORT, // Both instructions access data memory
+        ES_HI_LO,       // Both instructions access HI and LO
+        ES_CONTROL,     // Second control transfer or fetch redirected by taken one
+        ES_SERIALIZE,   // Fetch stopped by serializing instruction (ERET, SYNCI)
+        ES_EXCEPTION,   // Pipeline flushed by exception
+        ES_COUNT
+    };
+    static const char *empty_slot_reason_name(enum EmptySlotReason reason);
+
+    CoreSuperscalar(
+        Registers *regs,
+        FrontendMemory *mem_program,
+        FrontendMemory *mem_data,
+        bool jmp_delay_slot,
+        enum MachineConfig::HazardUnit hazard_unit = MachineConfig::HU_STALL_FORWARD,
+        unsigned int min_cache_row_size = 1,
+        Cop0State *cop0state = nullptr);
+
+    unsigned get_retired_count() const; // Instructions which passed writeback
+    // Cycles which issued given number of instructions, cycles waiting for
+    // memory are not included
+    unsigned get_issue_count(unsigned width) const;
+    unsigned get_empty_slot_count(enum EmptySlotReason reason) const;
+    double get_ipc() const;             // Retired instructions per cycle
+    double get_dual_issue_rate() const; // Share of issuing cycles which issued two
+
+protected:
+    void do_step(bool skip_break = false) override;
+    void do_reset() override;
+    void do_save_state(CheckpointWriter &writer) const override;
+    void do_restore_state(CheckpointReader &reader) override;
+
+private:
+    struct Core::dtFetch dt_f[ISSUE_WIDTH];
+    struct Core::dtDecode dt_d[ISSUE_WIDTH];
+    struct Core::dtExecute dt_e[ISSUE_WIDTH];
+    struct Core::dtMemory dt_m[ISSUE_WIDTH];
+    // Why fetch left the lane of fetch latch empty
+    enum EmptySlotReason fetch_empty[ISSUE_WIDTH];
+
+    bool jmp_delay_slot;
+    enum MachineConfig::HazardUnit hazard_unit;
+    Address prev_inst_addr; // Last instruction which passed memory stage
+    uint32_t retired_c;
+    uint32_t issue_c[ISSUE_WIDTH + 1];
+    uint32_t empty_slot_c[ES_COUNT];
+
+    void flush_after_exception(unsigned lane);
+    bool forward_operands(struct dtDecode &dt, enum StallReason &reason) const;
+    bool forward_operand(
+        bool alu_req,
+        bool bjr_req,
+        uint8_t num,
+        RegisterValue &val,
+        enum ForwardFrom &ff,
+        bool &forward_m_d,
+        enum StallReason &reason) const;
+    static enum EmptySlotReason
+    pairing_conflict(const struct dtDecode &older, const struct dtDecode &younger);
 };
 
 } // namespace machine
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "history.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace machine;
+
+MachineHistory::MachineHistory(size_t budget_bytes, unsigned interval)
+    : budget(budget_bytes)
+    , interval(interval) {}
+
+unsigned MachineHistory::get_interval() const {
+    return interval;
+}
+
+size_t MachineHistory::get_budget() const {
+    return budget;
+}
+
+unsigned MachineHistory::next_cycle() const {
+    if (snapshots.empty()) {
+        return 0;
+    }
+    return snapshots.back().cycle + interval;
+}
+
+void MachineHistory::push(Snapshot snapshot) {
+    snapshot.cost = snapshot.state.size() + snapshot.memory->footprint();
+    snapshot.pages_cost = 0;
+    if (!snapshots.empty()) {
+        Snapshot &previous = snapshots.back();
+        // Pages written since the previous snapshot are held by it only.
+        previous.pages_cost = previous.memory->unshared_footprint(*snapshot.memory);
+        total_cost += previous.pages_cost;
+    }
+    if (snapshots.empty() || snapshots.back().lcd_state != snapshot.lcd_state) {
+        snapshot.cost += snapshot.lcd_state->size();
+    }
+    total_cost += snapshot.cost;
+    snapshots.push_back(std::move(snapshot));
+
+    // At least one snapshot is kept, step back to it is always possible.
+    while (total_cost > budget && snapshots.size() > 1) {
+        Snapshot &oldest = snapshots.front();
+        Snapshot &following = snapshots[1];
+        if (following.lcd_state == oldest.lcd_state) {
+            // Framebuffer stays alive, it is accounted to the next owner
+            following.cost += oldest.lcd_state->size();
+            oldest.cost -= oldest.lcd_state->size();
+        }
+        total_cost -= oldest.cost + oldest.pages_cost;
+        snapshots.pop_front();
+    }
+    while (!skip_break_cycles.empty()
+           && skip_break_cycles.front() <= snapshots.front().cycle) {
+        skip_break_cycles.pop_front();
+    }
+}
+
+const MachineHistory::Snapshot *MachineHistory::find(unsigned cycle) const {
+    for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+        if (it->cycle <= cycle) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+void MachineHistory::truncate(unsigned cycle) {
+    while (!skip_break_cycles.empty() && skip_break_cycles.back() > cycle) {
+        skip_break_cycles.pop_back();
+    }
+    while (!snapshots.empty() && snapshots.back().cycle > cycle) {
+        total_cost -= snapshots.back().cost + snapshots.back().pages_cost;
+        snapshots.pop_back();
+    }
+    if (!snapshots.empty()) {
+        // Recomputed against the next snapshot
+        total_cost -= snapshots.back().pages_cost;
+        snapshots.back().pages_cost = 0;
+    }
+}
+
+void MachineHistory::mark_skip_break(unsigned cycle) {
+    if (skip_break_cycles.empty() || skip_break_cycles.back() < cycle) {
+        skip_break_cycles.push_back(cycle);
+    }
+}
+
+bool MachineHistory::is_skip_break(unsigned cycle) const {
+    return std::binary_search(skip_break_cycles.begin(), skip_break_cycles.end(), cycle);
+}
+
+void MachineHistory::mark_input(unsigned cycle) {
+    input_seen = true;
+    last_input_cycle = cycle;
+}
+
+bool MachineHistory::has_input_since(unsigned cycle) const {
+    return input_seen && last_input_cycle >= cycle;
+}
+
+void MachineHistory::clear() {
+    snapshots.clear();
+    skip_break_cycles.clear();
+    input_seen = false;
+    total_cost = 0;
+}
+
+size_t MachineHistory::size() const {
+    return snapshots.size();
+}
+
+size_t MachineHistory::size_bytes() const {
+    return total_cost;
+}
+
+const MachineHistory::Snapshot *MachineHistory::newest() const {
+    return snapshots.empty() ? nullptr : &snapshots.back();
+}
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef MACHINE_HISTORY_H
+#define MACHINE_HISTORY_H
+
+#include "memory/backend/memory.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Snapshots of machine state taken periodically during the run, they allow
+ * to step back in time (see `Machine::step_back`).
+ *
+ * Memory of a snapshot is a copy on write copy, it shares all sections not
+ * written since the snapshot was taken. Only the pages written between two
+ * snapshots are stored twice, so the cost of a snapshot is its state image
+ * plus the pages the program has written in the following interval. The
+ * oldest snapshots are dropped when the total cost exceeds the budget.
+ */
+class MachineHistory {
+public:
+    struct Snapshot {
+        unsigned cycle;
+        // Checkpoint image of registers, core, caches and peripherals
+        std::vector<uint8_t> state;
+        // LCD framebuffer is large and changes rarely, it is shared by the
+        // consecutive snapshots with the same LCD change counter
+        std::shared_ptr<const std::vector<uint8_t>> lcd_state;
+        uint32_t lcd_change_counter;
+        std::unique_ptr<Memory> memory;
+        // Bytes of state images and memory tree
+        size_t cost;
+        // Bytes of memory pages not shared with the following snapshot
+        size_t pages_cost;
+    };
+
+    MachineHistory(size_t budget_bytes, unsigned interval);
+
+    unsigned get_interval() const;
+    size_t get_budget() const;
+    // Cycle at which the next snapshot should be taken
+    unsigned next_cycle() const;
+
+    // Snapshot has to be newer than all stored ones, its cost is computed here
+    void push(Snapshot snapshot);
+    // Newest snapshot not newer than given cycle, nullptr if there is none
+    const Snapshot *find(unsigned cycle) const;
+    // Drop snapshots newer than given cycle (history diverges after step back)
+    void truncate(unsigned cycle);
+
+    /**
+     * Breakpoints are skipped by the first step after the machine is started,
+     * replay has to skip them at the same cycles to follow the same path.
+     */
+    void mark_skip_break(unsigned cycle);
+    bool is_skip_break(unsigned cycle) const;
+    /**
+     * Host input (serial port receive) is not recorded, replay from a
+     * snapshot not newer than the input cycle would run without it.
+     */
+    void mark_input(unsigned cycle);
+    bool has_input_since(unsigned cycle) const;
+    void clear();
+
+    size_t size() const;
+    // Estimated bytes of host memory held by snapshots
+    size_t size_bytes() const;
+    const Snapshot *newest() const;
+
+private:
+    const size_t budget;
+    const unsigned interval;
+    std::deque<Snapshot> snapshots;
+    std::deque<unsigned> skip_break_cycles; // Ascending
+    bool input_seen = false;
+    unsigned last_input_cycle = 0;
+    size_t total_cost = 0;
+};
+
+} // namespace machine
+
+#endif // MACHINE_HISTORY_H
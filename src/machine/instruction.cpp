@@ -44,6 +44,7 @@
 #include <QStringList>
 #include <cctype>
 #include <cstring>
+#include <mutex>
 #include <utility>
 
 using namespace machine;
@@ -2031,6 +2032,12 @@ void instruction_from_string_build_base(
 #endif
 }
 
+// Map is built once and only read afterwards, assembler can run in more threads.
+static void instruction_from_string_init() {
+    static std::once_flag once;
+    std::call_once(once, []() { instruction_from_string_build_base(); });
+}
+
 static int parse_reg_from_string(QString str, uint *chars_taken = nullptr) {
     int res;
     int i;
@@ -2120,15 +2127,14 @@ ssize_t Instruction::code_from_string(
     bool pseudo_opt,
     int options) {
     const char *err = "unknown instruction";
-    if (str_to_instruction_code_map.isEmpty()) {
-        instruction_from_string_build_base();
-    }
+    instruction_from_string_init();
 
     int field = 0;
     uint32_t inst_code = 0;
-    auto i = str_to_instruction_code_map.lowerBound(inst_base);
+    const auto &code_map = str_to_instruction_code_map;
+    auto i = code_map.lowerBound(inst_base);
     for (;; i++) {
-        if (i == str_to_instruction_code_map.end()) {
+        if (i == code_map.end()) {
             break;
         }
         if (i.key() != inst_base) {
@@ -2419,9 +2425,7 @@ bool Instruction::update(int64_t val, RelocExpression *relocexp) {
 }
 
 void Instruction::append_recognized_instructions(QStringList &list) {
-    if (str_to_instruction_code_map.isEmpty()) {
-        instruction_from_string_build_base();
-    }
+    instruction_from_string_init();
 
     foreach (const QString &str, str_to_instruction_code_map.keys())
         list.append(str);
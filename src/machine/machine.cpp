@@ -35,16 +35,47 @@
 
 #include "machine.h"
 
+#include "checkpoint.h"
 #include "programloader.h"
 
-#include <QTime>
+#include <QCoreApplication>
 #include <utility>
 
 using namespace machine;
 
+// Number of clock checks aimed for in single time chunk
+#define CHUNK_CLOCK_SAMPLES 16
+
+/**
+ * Level 1 blocks have to be whole level 2 blocks (exclusive) or fit into
+ * them (inclusive), so that moving a block between levels touches single
+ * line.
+ */
+static void check_cache_hierarchy(const MachineConfig &config) {
+    const MachineConfig::CacheInclusion inclusion = config.cache_level2_inclusion();
+    if (!config.cache_level2().enabled() || inclusion == MachineConfig::CI_NINE) {
+        return;
+    }
+    const unsigned l2_block = config.cache_level2().block_size();
+    for (const CacheConfig *l1 : { &config.cache_program(), &config.cache_data() }) {
+        if (!l1->enabled()) {
+            continue;
+        }
+        if (inclusion == MachineConfig::CI_EXCLUSIVE ? l1->block_size() != l2_block
+                                                     : l2_block % l1->block_size() != 0) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Level 1 cache block size does not fit level 2 cache inclusion",
+                QString("level 1 %1 words, level 2 %2 words")
+                    .arg(l1->block_size())
+                    .arg(l2_block));
+        }
+    }
+}
+
 Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     : machine_config(std::move(config))
     , stat(ST_READY) {
+    check_cache_hierarchy(machine_config);
     regs = new Registers();
 
     if (load_executable) {
@@ -73,16 +104,35 @@ Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     setup_perip_spi_led();
     setup_lcd_display();
 
-    cch_program = new Cache(
-        data_bus, &machine_config.cache_program(),
-        machine_config.memory_access_time_read(),
-        machine_config.memory_access_time_write(),
-        machine_config.memory_access_time_burst());
-    cch_data = new Cache(
-        data_bus, &machine_config.cache_data(),
+    // Caches pay DRAM latency instead of memory access times when enabled
+    dram_mem = new Dram(data_bus, machine_config);
+    FrontendMemory *main_memory = data_bus;
+    if (machine_config.dram_enabled()) {
+        main_memory = dram_mem;
+    }
+    cch_level2 = new Cache(
+        main_memory, &machine_config.cache_level2(),
         machine_config.memory_access_time_read(),
         machine_config.memory_access_time_write(),
         machine_config.memory_access_time_burst());
+    if (machine_config.cache_level2().enabled()) {
+        // Level 1 caches pay level 2 access time instead of memory access
+        const unsigned l2_time = machine_config.cache_level2_hit_time();
+        cch_program = new Cache(cch_level2, &machine_config.cache_program(), l2_time, l2_time);
+        cch_data = new Cache(cch_level2, &machine_config.cache_data(), l2_time, l2_time);
+        setup_cache_hierarchy();
+    } else {
+        cch_program = new Cache(
+            main_memory, &machine_config.cache_program(),
+            machine_config.memory_access_time_read(),
+            machine_config.memory_access_time_write(),
+            machine_config.memory_access_time_burst());
+        cch_data = new Cache(
+            main_memory, &machine_config.cache_data(),
+            machine_config.memory_access_time_read(),
+            machine_config.memory_access_time_write(),
+            machine_config.memory_access_time_burst());
+    }
 
     unsigned int min_cache_row_size = 16;
     if (machine_config.cache_data().enabled()) {
@@ -96,13 +146,25 @@ Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
 
     cop0st = new Cop0State();
 
-    if (machine_config.pipelined()) {
-        cr = new CorePipelined(
-            regs, cch_program, cch_data, machine_config.hazard_unit(), min_cache_row_size, cop0st);
+    if (machine_config.superscalar()) {
+        cr = new CoreSuperscalar(
+            regs, cch_program, cch_data, machine_config.delay_slot(),
+            machine_config.hazard_unit(), min_cache_row_size, cop0st);
+    } else if (machine_config.pipelined()) {
+        std::unique_ptr<BranchPredictionUnit> branch_unit;
+        if (!machine_config.delay_slot()) {
+            branch_unit = std::make_unique<BranchPredictionUnit>(machine_config);
+        }
+        auto *pipelined = new CorePipelined(
+            regs, cch_program, cch_data, machine_config.hazard_unit(), min_cache_row_size, cop0st,
+            std::move(branch_unit));
+        pipelined->set_muldiv_latency(machine_config.mult_latency(), machine_config.div_latency());
+        cr = pipelined;
     } else {
         cr = new CoreSingle(
             regs, cch_program, cch_data, machine_config.delay_slot(), min_cache_row_size, cop0st);
     }
+    cr->set_memory_stalls(machine_config.memory_stalls());
     connect(
         this, &Machine::set_interrupt_signal, cop0st,
         &Cop0State::set_interrupt_signal);
@@ -140,6 +202,7 @@ void Machine::setup_serial_port() {
     connect(
         ser_port, &SerialPort::signal_interrupt, this,
         &Machine::set_interrupt_signal);
+    connect(ser_port, &SerialPort::rx_byte_received, this, &Machine::serial_input);
 }
 
 Machine::~Machine() {
@@ -157,12 +220,20 @@ Machine::~Machine() {
     cch_program = nullptr;
     delete cch_data;
     cch_data = nullptr;
+    delete cch_level2;
+    cch_level2 = nullptr;
+    delete dram_mem;
+    dram_mem = nullptr;
     delete data_bus;
     data_bus = nullptr;
     delete mem_program_only;
     mem_program_only = nullptr;
     delete symtab;
     symtab = nullptr;
+    delete hist;
+    hist = nullptr;
+    delete mem_trace;
+    mem_trace = nullptr;
 }
 
 const MachineConfig &Machine::config() {
@@ -174,6 +245,10 @@ void Machine::set_speed(unsigned int ips, unsigned int time_chunk) {
     run_t->setInterval(ips);
 }
 
+unsigned int Machine::achieved_ips() const {
+    return ips;
+}
+
 const Registers *Machine::registers() {
     return regs;
 }
@@ -202,6 +277,24 @@ Cache *Machine::cache_data_rw() {
     return cch_data;
 }
 
+const Cache *Machine::cache_level2() {
+    return cch_level2;
+}
+
+const Dram *Machine::dram() {
+    return dram_mem;
+}
+
+// Inclusive and exclusive level 2 cache has to know enabled level 1 caches
+void Machine::setup_cache_hierarchy() {
+    const MachineConfig::CacheInclusion inclusion = machine_config.cache_level2_inclusion();
+    for (Cache *upper : { cch_program, cch_data }) {
+        if (upper->get_config().enabled()) {
+            cch_level2->add_upper_level(upper, inclusion);
+        }
+    }
+}
+
 void Machine::cache_sync() {
     if (cch_program != nullptr) {
         cch_program->sync();
@@ -209,6 +302,13 @@ void Machine::cache_sync() {
     if (cch_data != nullptr) {
         cch_data->sync();
     }
+    if (cch_level2 != nullptr) {
+        cch_level2->sync();
+    }
+    if (dram_mem != nullptr) {
+        dram_mem->sync();
+    }
+    publish_cache_updates();
 }
 
 const MemoryDataBus *Machine::memory_data_bus() {
@@ -258,12 +358,23 @@ const Core *Machine::core() {
     return cr;
 }
 
+Core *Machine::core_rw() {
+    return cr;
+}
+
 const CoreSingle *Machine::core_singe() {
     return machine_config.pipelined() ? nullptr : (const CoreSingle *)cr;
 }
 
 const CorePipelined *Machine::core_pipelined() {
-    return machine_config.pipelined() ? (const CorePipelined *)cr : nullptr;
+    if (!machine_config.pipelined() || machine_config.superscalar()) {
+        return nullptr;
+    }
+    return (const CorePipelined *)cr;
+}
+
+const CoreSuperscalar *Machine::core_superscalar() {
+    return machine_config.superscalar() ? (const CoreSuperscalar *)cr : nullptr;
 }
 
 bool Machine::executable_loaded() const {
@@ -289,6 +400,8 @@ bool Machine::exited() {
 void Machine::play() {
     CTL_GUARD;
     set_status(ST_RUNNING);
+    ips_steps = 0;
+    ips_timer.start();
     run_t->start();
     step_internal(true);
 }
@@ -304,17 +417,19 @@ void Machine::pause() {
 void Machine::step_internal(bool skip_break) {
     CTL_GUARD;
     enum Status stat_prev = stat;
+    unsigned int steps = 1;
     set_status(ST_BUSY);
     emit tick();
     try {
-        QTime start_time = QTime::currentTime();
-        do {
-            cr->step(skip_break);
-        } while (time_chunk != 0 && stat == ST_BUSY && !skip_break
-                 && start_time.msecsTo(QTime::currentTime()) < (int)time_chunk);
+        if (time_chunk != 0 && !skip_break) {
+            steps = step_chunk();
+        } else {
+            core_step(skip_break);
+        }
     } catch (SimulatorException &e) {
         run_t->stop();
         set_status(ST_TRAPPED);
+        publish_cache_updates();
         emit program_trap(e);
         return;
     }
@@ -327,13 +442,125 @@ void Machine::step_internal(bool skip_break) {
             set_status(stat_prev);
         }
     }
+    if (stat == ST_RUNNING) {
+        update_achieved_ips(steps);
+    }
+    publish_cache_updates();
     emit post_tick();
 }
 
+/**
+ * Run steps for time_chunk milliseconds. The clock is checked only after
+ * batch of chunk_batch steps and batch size is tuned from the measured speed
+ * so the clock is checked about CHUNK_CLOCK_SAMPLES times per chunk.
+ */
+unsigned int Machine::step_chunk() {
+    const qint64 chunk_ns = (qint64)time_chunk * 1000000;
+    QElapsedTimer chunk_timer;
+    qint64 elapsed_ns;
+    uint64_t steps = 0;
+
+    chunk_timer.start();
+    do {
+        for (unsigned int i = chunk_batch;
+             i > 0 && stat == ST_BUSY && regs->read_pc() < program_end; i--) {
+            steps++;
+            core_step(false);
+        }
+        elapsed_ns = chunk_timer.nsecsElapsed();
+    } while (stat == ST_BUSY && regs->read_pc() < program_end
+             && elapsed_ns < chunk_ns);
+
+    if (elapsed_ns > 0) {
+        uint64_t batch = steps * chunk_ns / ((uint64_t)elapsed_ns * CHUNK_CLOCK_SAMPLES);
+        chunk_batch = (unsigned int)qBound<uint64_t>(1, batch, UINT32_MAX);
+    }
+    return steps;
+}
+
+void Machine::update_achieved_ips(unsigned int steps) {
+    ips_steps += steps;
+    qint64 elapsed = ips_timer.elapsed();
+    if (elapsed >= 1000) {
+        ips = (unsigned int)(ips_steps * 1000 / elapsed);
+        ips_steps = 0;
+        ips_timer.restart();
+        emit achieved_ips_update(ips);
+    }
+}
+
 void Machine::step() {
     step_internal(true);
 }
 
+void Machine::run_until_exit(unsigned int poll_cycles) {
+    CTL_GUARD;
+    if (poll_cycles == 0) {
+        poll_cycles = 1;
+    }
+    set_status(ST_BUSY);
+    emit tick();
+    try {
+        bool skip_break = true; // Same as play, do not stop on current break
+        unsigned int poll_countdown = poll_cycles;
+        while (stat == ST_BUSY && regs->read_pc() < program_end) {
+            core_step(skip_break);
+            skip_break = false;
+            if (--poll_countdown == 0) {
+                poll_countdown = poll_cycles;
+                if (ser_port != nullptr) {
+                    ser_port->rx_queue_check();
+                }
+                QCoreApplication::processEvents();
+            }
+        }
+    } catch (SimulatorException &e) {
+        set_status(ST_TRAPPED);
+        publish_cache_updates();
+        emit program_trap(e);
+        return;
+    }
+    if (regs->read_pc() >= program_end) {
+        set_status(ST_EXIT);
+        emit program_exit();
+    } else if (stat == ST_BUSY) {
+        set_status(ST_READY);
+    }
+    publish_cache_updates();
+    emit post_tick();
+}
+
+unsigned int Machine::run_cycles(unsigned int cycles) {
+    if (exited() || stat == ST_BUSY) {
+        return 0;
+    }
+    set_status(ST_BUSY);
+    emit tick();
+    unsigned int steps = 0;
+    try {
+        bool skip_break = true;
+        while (steps < cycles && stat == ST_BUSY && regs->read_pc() < program_end) {
+            core_step(skip_break);
+            skip_break = false;
+            steps++;
+        }
+    } catch (SimulatorException &e) {
+        set_status(ST_TRAPPED);
+        publish_cache_updates();
+        emit program_trap(e);
+        return steps;
+    }
+    if (regs->read_pc() >= program_end) {
+        set_status(ST_EXIT);
+        emit program_exit();
+    } else if (stat == ST_BUSY) {
+        set_status(ST_READY);
+    }
+    publish_cache_updates();
+    emit post_tick();
+    return steps;
+}
+
 void Machine::step_timer() {
     step_internal();
 }
@@ -346,10 +573,282 @@ void Machine::restart() {
     }
     cch_program->reset();
     cch_data->reset();
+    cch_level2->reset();
+    dram_mem->reset();
     cr->reset();
+    if (hist != nullptr) {
+        hist->clear();
+        take_snapshot();
+    }
+    publish_cache_updates();
     set_status(ST_READY);
 }
 
+// Chunk tags, version of file format has to be changed with chunk content
+constexpr uint32_t CP_CONFIG = checkpoint_tag("CONF");
+constexpr uint32_t CP_REGISTERS = checkpoint_tag("REGS");
+constexpr uint32_t CP_COP0 = checkpoint_tag("COP0");
+constexpr uint32_t CP_CORE = checkpoint_tag("CORE");
+constexpr uint32_t CP_MEMORY = checkpoint_tag("MEM ");
+constexpr uint32_t CP_CACHE_PROGRAM = checkpoint_tag("ICCH");
+constexpr uint32_t CP_CACHE_DATA = checkpoint_tag("DCCH");
+constexpr uint32_t CP_CACHE_LEVEL2 = checkpoint_tag("L2CH");
+constexpr uint32_t CP_DRAM = checkpoint_tag("DRAM");
+constexpr uint32_t CP_SERIAL_PORT = checkpoint_tag("SERP");
+constexpr uint32_t CP_SPI_LED = checkpoint_tag("SPIL");
+constexpr uint32_t CP_LCD_DISPLAY = checkpoint_tag("LCD ");
+
+void Machine::save_checkpoint(const QString &file_name) {
+    CheckpointWriter writer;
+    writer.begin_chunk(CP_CONFIG);
+    writer.write_u32(machine_config.pipelined());
+    writer.write_u32(machine_config.superscalar());
+    writer.write_u32(machine_config.delay_slot());
+    writer.write_u32(machine_config.hazard_unit());
+    writer.write_u32(machine_config.branch_predictor());
+    writer.write_u32(machine_config.branch_predictor_bits());
+    writer.write_u32(machine_config.branch_history_bits());
+    writer.write_u32(machine_config.btb_bits());
+    writer.write_u32(machine_config.ras_size());
+    writer.write_u32(machine_config.mult_latency());
+    writer.write_u32(machine_config.div_latency());
+    writer.write_u32(machine_config.memory_stalls());
+    writer.write_u32(machine_config.get_simulated_endian());
+    writer.end_chunk();
+    save_machine_state(writer);
+    writer.begin_chunk(CP_LCD_DISPLAY);
+    perip_lcd_display->save_state(writer);
+    writer.end_chunk();
+    // Memory is the last one, so the preceding small chunks share first page.
+    writer.begin_chunk(CP_MEMORY);
+    mem->save_state(writer);
+    writer.end_chunk();
+    writer.save(file_name);
+}
+
+void Machine::restore_checkpoint(const QString &file_name) {
+    CheckpointFile file(file_name);
+    CheckpointReader config = file.chunk(CP_CONFIG);
+    config.expect_u32(machine_config.pipelined(), "pipelined core");
+    config.expect_u32(machine_config.superscalar(), "superscalar core");
+    config.expect_u32(machine_config.delay_slot(), "delay slot");
+    config.expect_u32(machine_config.hazard_unit(), "hazard unit");
+    config.expect_u32(machine_config.branch_predictor(), "branch predictor");
+    config.expect_u32(machine_config.branch_predictor_bits(), "branch predictor bits");
+    config.expect_u32(machine_config.branch_history_bits(), "branch history bits");
+    config.expect_u32(machine_config.btb_bits(), "BTB bits");
+    config.expect_u32(machine_config.ras_size(), "return address stack size");
+    config.expect_u32(machine_config.mult_latency(), "multiply latency");
+    config.expect_u32(machine_config.div_latency(), "divide latency");
+    config.expect_u32(machine_config.memory_stalls(), "memory stalls");
+    config.expect_u32(machine_config.get_simulated_endian(), "endian");
+
+    restore_machine_state(file);
+    CheckpointReader reader = file.chunk(CP_MEMORY);
+    mem->restore_state(reader);
+    reader = file.chunk(CP_LCD_DISPLAY);
+    perip_lcd_display->restore_state(reader);
+    if (hist != nullptr) {
+        hist->clear();
+        take_snapshot();
+    }
+    publish_cache_updates();
+    if (stat != ST_RUNNING && stat != ST_BUSY) {
+        set_status(ST_READY);
+    }
+}
+
+void Machine::set_checkpoint_at(unsigned cycle, const QString &file_name) {
+    checkpoint_cycle = cycle;
+    checkpoint_file = file_name;
+}
+
+// State of the machine except memory and LCD display, these are large and
+// history snapshots share them instead of copying.
+void Machine::save_machine_state(CheckpointWriter &writer) const {
+    writer.begin_chunk(CP_REGISTERS);
+    regs->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_COP0);
+    cop0st->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_CORE);
+    cr->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_CACHE_PROGRAM);
+    cch_program->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_CACHE_DATA);
+    cch_data->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_CACHE_LEVEL2);
+    cch_level2->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_DRAM);
+    dram_mem->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_SERIAL_PORT);
+    ser_port->save_state(writer);
+    writer.end_chunk();
+    writer.begin_chunk(CP_SPI_LED);
+    perip_spi_led->save_state(writer);
+    writer.end_chunk();
+}
+
+void Machine::restore_machine_state(const CheckpointFile &file) {
+    CheckpointReader reader = file.chunk(CP_REGISTERS);
+    regs->restore_state(reader);
+    reader = file.chunk(CP_COP0);
+    cop0st->restore_state(reader);
+    reader = file.chunk(CP_CORE);
+    cr->restore_state(reader);
+    reader = file.chunk(CP_CACHE_PROGRAM);
+    cch_program->restore_state(reader);
+    reader = file.chunk(CP_CACHE_DATA);
+    cch_data->restore_state(reader);
+    reader = file.chunk(CP_CACHE_LEVEL2);
+    cch_level2->restore_state(reader);
+    reader = file.chunk(CP_DRAM);
+    dram_mem->restore_state(reader);
+    reader = file.chunk(CP_SERIAL_PORT);
+    ser_port->restore_state(reader);
+    reader = file.chunk(CP_SPI_LED);
+    perip_spi_led->restore_state(reader);
+}
+
+void Machine::core_step(bool skip_break) {
+    if (skip_break && hist != nullptr) {
+        hist->mark_skip_break(cr->get_cycle_count() + 1);
+    }
+    cr->step(skip_break);
+    if (checkpoint_cycle != 0 && cr->get_cycle_count() == checkpoint_cycle) {
+        checkpoint_cycle = 0;
+        save_checkpoint(checkpoint_file);
+    }
+    if (hist != nullptr && cr->get_cycle_count() >= hist->next_cycle()) {
+        take_snapshot();
+    }
+}
+
+void Machine::set_history(size_t budget_bytes, unsigned interval) {
+    delete hist;
+    hist = nullptr;
+    if (budget_bytes != 0 && interval != 0) {
+        hist = new MachineHistory(budget_bytes, interval);
+        take_snapshot();
+    }
+}
+
+void Machine::set_memory_trace(const QString &file_name) {
+    MemoryTraceWriter *trace = nullptr;
+    if (!file_name.isEmpty()) {
+        trace = new MemoryTraceWriter(file_name);
+    }
+    cch_program->set_trace(trace, TRACE_PROGRAM);
+    cch_data->set_trace(trace, TRACE_DATA);
+    delete mem_trace;
+    mem_trace = trace;
+}
+
+void Machine::set_cache_miss_analysis(bool enable) {
+    cch_program->set_miss_analysis(enable);
+    cch_data->set_miss_analysis(enable);
+    cch_level2->set_miss_analysis(enable);
+}
+
+const MachineHistory *Machine::history() {
+    return hist;
+}
+
+bool Machine::can_step_back() const {
+    return hist != nullptr && stat != ST_BUSY && cr->get_cycle_count() > 0
+           && step_back_snapshot(cr->get_cycle_count() - 1) != nullptr;
+}
+
+const MachineHistory::Snapshot *Machine::step_back_snapshot(unsigned target) const {
+    const MachineHistory::Snapshot *snapshot = hist->find(target);
+    if (snapshot == nullptr || hist->has_input_since(snapshot->cycle)) {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+void Machine::serial_input() {
+    if (hist != nullptr) {
+        hist->mark_input(cr->get_cycle_count());
+    }
+}
+
+void Machine::take_snapshot() {
+    MachineHistory::Snapshot snapshot;
+    CheckpointWriter writer;
+    save_machine_state(writer);
+    snapshot.cycle = cr->get_cycle_count();
+    snapshot.state = writer.take_data();
+    const MachineHistory::Snapshot *newest = hist->newest();
+    snapshot.lcd_change_counter = perip_lcd_display->get_change_counter();
+    if (newest != nullptr && newest->lcd_change_counter == snapshot.lcd_change_counter) {
+        snapshot.lcd_state = newest->lcd_state;
+    } else {
+        writer.begin_chunk(CP_LCD_DISPLAY);
+        perip_lcd_display->save_state(writer);
+        writer.end_chunk();
+        snapshot.lcd_state = std::make_shared<const std::vector<uint8_t>>(writer.take_data());
+    }
+    snapshot.memory.reset(new Memory(*mem));
+    hist->push(std::move(snapshot));
+}
+
+bool Machine::step_back(unsigned cycles) {
+    if (hist == nullptr || stat == ST_BUSY) {
+        return false;
+    }
+    const unsigned cycle = cr->get_cycle_count();
+    const unsigned target = cycles < cycle ? cycle - cycles : 0;
+    const MachineHistory::Snapshot *snapshot = step_back_snapshot(target);
+    if (snapshot == nullptr) {
+        return false;
+    }
+    if (stat == ST_RUNNING) {
+        pause();
+    }
+    set_status(ST_BUSY);
+    emit tick();
+    restore_machine_state(CheckpointFile(snapshot->state));
+    CheckpointFile lcd_state(*snapshot->lcd_state);
+    CheckpointReader reader = lcd_state.chunk(CP_LCD_DISPLAY);
+    perip_lcd_display->restore_state(reader);
+    mem->reset(*snapshot->memory);
+    emit mem->external_backend_change_notify(mem, 0, UINT32_MAX, AccessEffects::REGULAR);
+    // Run after the target is a different future, snapshots of it are invalid.
+    hist->truncate(target);
+    // Input arriving now belongs after the target, it is left in the host queue.
+    ser_port->set_rx_hold(true);
+    try {
+        while (cr->get_cycle_count() < target) {
+            cr->step(hist->is_skip_break(cr->get_cycle_count() + 1));
+        }
+    } catch (SimulatorException &e) {
+        ser_port->set_rx_hold(false);
+        set_status(ST_TRAPPED);
+        emit program_trap(e);
+        publish_cache_updates();
+        emit post_tick();
+        return true;
+    }
+    ser_port->set_rx_hold(false);
+    set_status(regs->read_pc() >= program_end ? ST_EXIT : ST_READY);
+    publish_cache_updates();
+    emit post_tick();
+    return true;
+}
+
+void Machine::publish_cache_updates() {
+    cch_program->publish_updates();
+    cch_data->publish_updates();
+    cch_level2->publish_updates();
+}
+
 void Machine::set_status(enum Status st) {
     bool change = st != stat;
     stat = st;
@@ -37,23 +37,30 @@
 #define MACHINE_H
 
 #include "core.h"
+#include "history.h"
 #include "machineconfig.h"
 #include "memory/backend/lcddisplay.h"
 #include "memory/backend/peripheral.h"
 #include "memory/backend/peripspiled.h"
 #include "memory/backend/serialport.h"
 #include "memory/cache/cache.h"
+#include "memory/dram.h"
 #include "memory/memory_bus.h"
 #include "registers.h"
 #include "simulator_exception.h"
 #include "symboltable.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QTimer>
 #include <cstdint>
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointFile;
+class MemoryTraceWriter;
+
 class Machine : public QObject {
     Q_OBJECT
 public:
@@ -65,6 +72,8 @@ public:
 
     const MachineConfig &config();
     void set_speed(unsigned int ips, unsigned int time_chunk = 0);
+    // Instructions per second achieved while running (updated every second)
+    unsigned int achieved_ips() const;
 
     const Registers *registers();
     const Cop0State *cop0state();
@@ -73,6 +82,10 @@ public:
     const Cache *cache_program();
     const Cache *cache_data();
     Cache *cache_data_rw();
+    // Unified level 2 cache, disabled unless configured
+    const Cache *cache_level2();
+    // DRAM timing model, not part of the memory hierarchy unless configured
+    const Dram *dram();
     void cache_sync();
     const MemoryDataBus *memory_data_bus();
     MemoryDataBus *memory_data_bus_rw();
@@ -88,8 +101,10 @@ public:
         unsigned char info = 0,
         unsigned char other = 0);
     const Core *core();
+    Core *core_rw();
     const CoreSingle *core_singe();
     const CorePipelined *core_pipelined();
+    const CoreSuperscalar *core_superscalar();
     bool executable_loaded() const;
 
     enum Status {
@@ -120,6 +135,68 @@ public:
     bool get_step_over_exception(enum ExceptionCause excause) const;
     enum ExceptionCause get_exception_cause() const;
 
+    /**
+     * Run the program until it exits, traps or the machine is paused
+     * without returning to the event loop after each step.
+     * Serial port input is checked and pending events are processed once
+     * per poll_cycles cycles.
+     */
+    void run_until_exit(unsigned int poll_cycles = 10000);
+    /**
+     * Run at most given number of cycles and do not process any events, so
+     * independent machines can run in threads without an event loop.
+     * Stops earlier when the program exits, traps or the machine is paused.
+     *
+     * @return  number of executed cycles
+     */
+    unsigned int run_cycles(unsigned int cycles);
+
+    /**
+     * Store state of the simulation to binary checkpoint file (see
+     * `checkpoint.h`). Restore requires machine with the same configuration,
+     * it replaces registers, memory, caches, pipeline and peripherals state.
+     */
+    void save_checkpoint(const QString &file_name);
+    void restore_checkpoint(const QString &file_name);
+    // Save checkpoint once the core reaches given cycle count, zero disables.
+    void set_checkpoint_at(unsigned cycle, const QString &file_name);
+
+    /**
+     * Keep history of the run for stepping back, zero budget disables it.
+     * Snapshot of the machine is taken every `interval` cycles and the oldest
+     * ones are dropped when they take more than `budget_bytes` of host memory.
+     */
+    void set_history(size_t budget_bytes, unsigned interval = 1000);
+    const MachineHistory *history();
+    bool can_step_back() const;
+    /**
+     * Return the machine to the state it had given number of cycles ago.
+     * Nearest older snapshot is restored and the run is replayed from it.
+     * Effects outside of the machine (terminal output, emulated system calls)
+     * are not reverted and replay repeats them. Serial port input is not
+     * recorded, replay cannot start before the last received byte.
+     *
+     * @return  false when the history does not reach that far or serial port
+     *          input arrived since the snapshot the replay would start from
+     */
+    bool step_back(unsigned cycles = 1);
+
+    /**
+     * Record accesses of program and data cache to memory trace file (see
+     * `memory/memory_trace.h`), empty file name stops the recording. Replay
+     * starts with empty caches, so it matches the live run only when the
+     * recording starts before the run and no checkpoint is restored nor step
+     * back done meanwhile.
+     */
+    void set_memory_trace(const QString &file_name);
+
+    /**
+     * Classify misses of program and data cache and attribute them to
+     * instructions (see `memory/cache/cache_miss_analysis.h`). The analysis
+     * is not part of checkpoints, it counts from enabling or reset.
+     */
+    void set_cache_miss_analysis(bool enable);
+
 public slots:
     void play();
     void pause();
@@ -133,12 +210,26 @@ signals:
     void tick();      // Time tick
     void post_tick(); // Emitted after tick to allow updates
     void set_interrupt_signal(uint irq_num, bool active);
+    void achieved_ips_update(unsigned int ips);
 
 private slots:
     void step_timer();
+    void serial_input();
 
 private:
     void step_internal(bool skip_break = false);
+    unsigned int step_chunk();
+    void update_achieved_ips(unsigned int steps);
+    // Step of the core followed by checkpoint and history snapshot checks
+    void core_step(bool skip_break);
+    void save_machine_state(CheckpointWriter &writer) const;
+    void restore_machine_state(const CheckpointFile &file);
+    void take_snapshot();
+    // Snapshot replay to the target starts from, nullptr if step back is not possible
+    const MachineHistory::Snapshot *step_back_snapshot(unsigned target) const;
+    // Changes of caches are shown once per step or chunk of steps
+    void publish_cache_updates();
+    void setup_cache_hierarchy();
     MachineConfig machine_config;
 
     Registers *regs = nullptr;
@@ -155,14 +246,25 @@ private:
     LcdDisplay *perip_lcd_display = nullptr;
     Cache *cch_program = nullptr;
     Cache *cch_data = nullptr;
+    Cache *cch_level2 = nullptr;
+    Dram *dram_mem = nullptr;
     Cop0State *cop0st = nullptr;
     Core *cr = nullptr;
 
     QTimer *run_t = nullptr;
     unsigned int time_chunk = { 0 };
+    // Steps executed between clock checks in time chunk, tuned after each
+    unsigned int chunk_batch = { 1 };
+    QElapsedTimer ips_timer;
+    uint64_t ips_steps = { 0 };
+    unsigned int ips = { 0 };
 
     SymbolTable *symtab = nullptr;
     Address program_end = 0xffff0000_addr;
+    unsigned checkpoint_cycle = 0;
+    QString checkpoint_file;
+    MachineHistory *hist = nullptr;
+    MemoryTraceWriter *mem_trace = nullptr;
     enum Status stat = ST_READY;
     void set_status(enum Status st);
     void setup_serial_port();
@@ -45,14 +45,33 @@ using namespace machine;
 //////////////////////////////////////////////////////////////////////////////
 /// Default config of MachineConfig
 #define DF_PIPELINE false
+#define DF_SUPERSCALAR false
 #define DF_DELAYSLOT true
 #define DF_HUNIT HU_STALL_FORWARD
+#define DF_BP BP_NOT_TAKEN
+#define DF_BP_BITS 10
+#define DF_BP_HISTORY_BITS 8
+#define DF_BTB_BITS 6
+#define DF_RAS_SIZE 4
+#define DF_MULT_LATENCY 1
+#define DF_DIV_LATENCY 1
 #define DF_EXEC_PROTEC false
 #define DF_WRITE_PROTEC false
 #define DF_MEM_ACC_READ 10
 #define DF_MEM_ACC_WRITE 10
 #define DF_MEM_ACC_BURST 0
+#define DF_MEM_STALLS false
+#define DF_DRAM false
+#define DF_DRAM_BANKS 4
+#define DF_DRAM_ROW_SIZE 1024
+#define DF_DRAM_PAGE_POLICY DP_OPEN
+#define DF_DRAM_T_RCD 5
+#define DF_DRAM_T_CAS 5
+#define DF_DRAM_T_RP 5
+#define DF_DRAM_WRITE_QUEUE 8
 #define DF_ELF QString("")
+#define DF_L2_HIT_TIME 4
+#define DF_L2_INCLUSION CI_NINE
 //////////////////////////////////////////////////////////////////////////////
 /// Default config of CacheConfig
 #define DFC_EN false
@@ -61,6 +80,9 @@ using namespace machine;
 #define DFC_ASSOC 1
 #define DFC_REPLAC RP_RAND
 #define DFC_WRITE WP_THROUGH_NOALLOC
+#define DFC_PREFETCH PF_NONE
+#define DFC_PF_DEGREE 1
+#define DFC_PF_DISTANCE 1
 //////////////////////////////////////////////////////////////////////////////
 
 CacheConfig::CacheConfig() {
@@ -70,6 +92,9 @@ CacheConfig::CacheConfig() {
     d_associativity = DFC_ASSOC;
     replac_pol = DFC_REPLAC;
     write_pol = DFC_WRITE;
+    prefetch_pol = DFC_PREFETCH;
+    pf_degree = DFC_PF_DEGREE;
+    pf_distance = DFC_PF_DISTANCE;
 }
 
 CacheConfig::CacheConfig(const CacheConfig *cc) {
@@ -79,6 +104,9 @@ CacheConfig::CacheConfig(const CacheConfig *cc) {
     d_associativity = cc->associativity();
     replac_pol = cc->replacement_policy();
     write_pol = cc->write_policy();
+    prefetch_pol = cc->prefetch_policy();
+    pf_degree = cc->prefetch_degree();
+    pf_distance = cc->prefetch_distance();
 }
 
 #define N(STR) (prefix + QString(STR))
@@ -92,6 +120,10 @@ CacheConfig::CacheConfig(const QSettings *sts, const QString &prefix) {
         = (enum ReplacementPolicy)sts->value(N("Replacement"), DFC_REPLAC)
               .toUInt();
     write_pol = (enum WritePolicy)sts->value(N("Write"), DFC_WRITE).toUInt();
+    prefetch_pol
+        = (enum PrefetchPolicy)sts->value(N("Prefetch"), DFC_PREFETCH).toUInt();
+    pf_degree = sts->value(N("PrefetchDegree"), DFC_PF_DEGREE).toUInt();
+    pf_distance = sts->value(N("PrefetchDistance"), DFC_PF_DISTANCE).toUInt();
 }
 
 void CacheConfig::store(QSettings *sts, const QString &prefix) const {
@@ -101,6 +133,9 @@ void CacheConfig::store(QSettings *sts, const QString &prefix) const {
     sts->setValue(N("Associativity"), associativity());
     sts->setValue(N("Replacement"), (unsigned)replacement_policy());
     sts->setValue(N("Write"), (unsigned)write_policy());
+    sts->setValue(N("Prefetch"), (unsigned)prefetch_policy());
+    sts->setValue(N("PrefetchDegree"), prefetch_degree());
+    sts->setValue(N("PrefetchDistance"), prefetch_distance());
 }
 
 #undef N
@@ -115,6 +150,7 @@ void CacheConfig::preset(enum ConfigPresets p) {
         set_associativity(2);
         set_replacement_policy(RP_RAND);
         set_write_policy(WP_THROUGH_NOALLOC);
+        set_prefetch_policy(PF_NONE);
         break;
     case CP_SINGLE:
     case CP_PIPE_NO_HAZARD: set_enabled(false);
@@ -145,6 +181,32 @@ void CacheConfig::set_write_policy(enum WritePolicy v) {
     write_pol = v;
 }
 
+void CacheConfig::set_prefetch_policy(enum PrefetchPolicy v) {
+    prefetch_pol = v;
+}
+
+bool CacheConfig::set_prefetch_policy(const QString &policy) {
+    static QMap<QString, enum PrefetchPolicy> policy_map = {
+        { "none", PF_NONE },
+        { "next-line", PF_NEXT_LINE },
+        { "stride", PF_STRIDE },
+        { "stream", PF_STREAM },
+    };
+    if (!policy_map.contains(policy)) {
+        return false;
+    }
+    set_prefetch_policy(policy_map.value(policy));
+    return true;
+}
+
+void CacheConfig::set_prefetch_degree(unsigned v) {
+    pf_degree = v > 0 ? v : 1;
+}
+
+void CacheConfig::set_prefetch_distance(unsigned v) {
+    pf_distance = v > 0 ? v : 1;
+}
+
 bool CacheConfig::enabled() const {
     return en;
 }
@@ -169,11 +231,24 @@ enum CacheConfig::WritePolicy CacheConfig::write_policy() const {
     return write_pol;
 }
 
+enum CacheConfig::PrefetchPolicy CacheConfig::prefetch_policy() const {
+    return prefetch_pol;
+}
+
+unsigned CacheConfig::prefetch_degree() const {
+    return pf_degree > 0 ? pf_degree : 1;
+}
+
+unsigned CacheConfig::prefetch_distance() const {
+    return pf_distance > 0 ? pf_distance : 1;
+}
+
 bool CacheConfig::operator==(const CacheConfig &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
     return CMP(enabled) && CMP(set_count) && CMP(block_size)
            && CMP(associativity) && CMP(replacement_policy)
-           && CMP(write_policy);
+           && CMP(write_policy) && CMP(prefetch_policy) && CMP(prefetch_degree)
+           && CMP(prefetch_distance);
 #undef CMP
 }
 
@@ -183,13 +258,30 @@ bool CacheConfig::operator!=(const CacheConfig &c) const {
 
 MachineConfig::MachineConfig() {
     pipeline = DF_PIPELINE;
+    dual_issue = DF_SUPERSCALAR;
     delayslot = DF_DELAYSLOT;
     hunit = DF_HUNIT;
+    bp_kind = DF_BP;
+    bp_bits = DF_BP_BITS;
+    bp_history_bits = DF_BP_HISTORY_BITS;
+    bp_btb_bits = DF_BTB_BITS;
+    bp_ras_size = DF_RAS_SIZE;
+    mul_latency = DF_MULT_LATENCY;
+    dv_latency = DF_DIV_LATENCY;
     exec_protect = DF_EXEC_PROTEC;
     write_protect = DF_WRITE_PROTEC;
     mem_acc_read = DF_MEM_ACC_READ;
     mem_acc_write = DF_MEM_ACC_WRITE;
     mem_acc_burst = DF_MEM_ACC_BURST;
+    mem_stalls = DF_MEM_STALLS;
+    dram_en = DF_DRAM;
+    dram_n_banks = DF_DRAM_BANKS;
+    dram_row_bytes = DF_DRAM_ROW_SIZE;
+    dram_page_pol = DF_DRAM_PAGE_POLICY;
+    dram_rcd = DF_DRAM_T_RCD;
+    dram_cas = DF_DRAM_T_CAS;
+    dram_rp = DF_DRAM_T_RP;
+    dram_queue = DF_DRAM_WRITE_QUEUE;
     osem_enable = true;
     osem_known_syscall_stop = true;
     osem_unknown_syscall_stop = true;
@@ -200,17 +292,37 @@ MachineConfig::MachineConfig() {
     elf_path = DF_ELF;
     cch_program = CacheConfig();
     cch_data = CacheConfig();
+    cch_level2 = CacheConfig();
+    l2_hit_time = DF_L2_HIT_TIME;
+    l2_inclusion = DF_L2_INCLUSION;
 }
 
 MachineConfig::MachineConfig(const MachineConfig *config) {
     pipeline = config->pipelined();
+    dual_issue = config->superscalar();
     delayslot = config->delay_slot();
     hunit = config->hazard_unit();
+    bp_kind = config->branch_predictor();
+    bp_bits = config->branch_predictor_bits();
+    bp_history_bits = config->branch_history_bits();
+    bp_btb_bits = config->btb_bits();
+    bp_ras_size = config->ras_size();
+    mul_latency = config->mult_latency();
+    dv_latency = config->div_latency();
     exec_protect = config->memory_execute_protection();
     write_protect = config->memory_write_protection();
     mem_acc_read = config->memory_access_time_read();
     mem_acc_write = config->memory_access_time_write();
     mem_acc_burst = config->memory_access_time_burst();
+    mem_stalls = config->memory_stalls();
+    dram_en = config->dram_enabled();
+    dram_n_banks = config->dram_banks();
+    dram_row_bytes = config->dram_row_size();
+    dram_page_pol = config->dram_page_policy();
+    dram_rcd = config->dram_t_rcd();
+    dram_cas = config->dram_t_cas();
+    dram_rp = config->dram_t_rp();
+    dram_queue = config->dram_write_queue();
     osem_enable = config->osemu_enable();
     osem_known_syscall_stop = config->osemu_known_syscall_stop();
     osem_unknown_syscall_stop = config->osemu_unknown_syscall_stop();
@@ -221,14 +333,25 @@ MachineConfig::MachineConfig(const MachineConfig *config) {
     elf_path = config->elf();
     cch_program = config->cache_program();
     cch_data = config->cache_data();
+    cch_level2 = config->cache_level2();
+    l2_hit_time = config->cache_level2_hit_time();
+    l2_inclusion = config->cache_level2_inclusion();
 }
 
 #define N(STR) (prefix + QString(STR))
 
 MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) {
     pipeline = sts->value(N("Pipelined"), DF_PIPELINE).toBool();
+    dual_issue = sts->value(N("Superscalar"), DF_SUPERSCALAR).toBool();
     delayslot = sts->value(N("DelaySlot"), DF_DELAYSLOT).toBool();
     hunit = (enum HazardUnit)sts->value(N("HazardUnit"), DF_HUNIT).toUInt();
+    bp_kind = (enum BranchPredictor)sts->value(N("BranchPredictor"), DF_BP).toUInt();
+    bp_bits = sts->value(N("BranchPredictorBits"), DF_BP_BITS).toUInt();
+    bp_history_bits = sts->value(N("BranchHistoryBits"), DF_BP_HISTORY_BITS).toUInt();
+    bp_btb_bits = sts->value(N("BtbBits"), DF_BTB_BITS).toUInt();
+    bp_ras_size = sts->value(N("RasSize"), DF_RAS_SIZE).toUInt();
+    mul_latency = sts->value(N("MultLatency"), DF_MULT_LATENCY).toUInt();
+    dv_latency = sts->value(N("DivLatency"), DF_DIV_LATENCY).toUInt();
     exec_protect
         = sts->value(N("MemoryExecuteProtection"), DF_EXEC_PROTEC).toBool();
     write_protect
@@ -236,6 +359,16 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) {
     mem_acc_read = sts->value(N("MemoryRead"), DF_MEM_ACC_READ).toUInt();
     mem_acc_write = sts->value(N("MemoryWrite"), DF_MEM_ACC_WRITE).toUInt();
     mem_acc_burst = sts->value(N("MemoryBurts"), DF_MEM_ACC_BURST).toUInt();
+    mem_stalls = sts->value(N("MemoryStalls"), DF_MEM_STALLS).toBool();
+    dram_en = sts->value(N("Dram"), DF_DRAM).toBool();
+    dram_n_banks = sts->value(N("DramBanks"), DF_DRAM_BANKS).toUInt();
+    dram_row_bytes = sts->value(N("DramRowSize"), DF_DRAM_ROW_SIZE).toUInt();
+    dram_page_pol
+        = (enum DramPagePolicy)sts->value(N("DramPagePolicy"), DF_DRAM_PAGE_POLICY).toUInt();
+    dram_rcd = sts->value(N("DramTrcd"), DF_DRAM_T_RCD).toUInt();
+    dram_cas = sts->value(N("DramTcas"), DF_DRAM_T_CAS).toUInt();
+    dram_rp = sts->value(N("DramTrp"), DF_DRAM_T_RP).toUInt();
+    dram_queue = sts->value(N("DramWriteQueue"), DF_DRAM_WRITE_QUEUE).toUInt();
     osem_enable = sts->value(N("OsemuEnable"), true).toBool();
     osem_known_syscall_stop
         = sts->value(N("OsemuKnownSyscallStop"), true).toBool();
@@ -248,15 +381,36 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) {
     elf_path = sts->value(N("Elf"), DF_ELF).toString();
     cch_program = CacheConfig(sts, N("ProgramCache_"));
     cch_data = CacheConfig(sts, N("DataCache_"));
+    cch_level2 = CacheConfig(sts, N("Level2Cache_"));
+    l2_hit_time = sts->value(N("Level2HitTime"), DF_L2_HIT_TIME).toUInt();
+    l2_inclusion = (enum CacheInclusion)sts->value(N("Level2Inclusion"), DF_L2_INCLUSION)
+                       .toUInt();
 }
 
 void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("Pipelined"), pipelined());
+    sts->setValue(N("Superscalar"), superscalar());
     sts->setValue(N("DelaySlot"), delay_slot());
     sts->setValue(N("HazardUnit"), (unsigned)hazard_unit());
+    sts->setValue(N("BranchPredictor"), (unsigned)branch_predictor());
+    sts->setValue(N("BranchPredictorBits"), branch_predictor_bits());
+    sts->setValue(N("BranchHistoryBits"), branch_history_bits());
+    sts->setValue(N("BtbBits"), btb_bits());
+    sts->setValue(N("RasSize"), ras_size());
+    sts->setValue(N("MultLatency"), mult_latency());
+    sts->setValue(N("DivLatency"), div_latency());
     sts->setValue(N("MemoryRead"), memory_access_time_read());
     sts->setValue(N("MemoryWrite"), memory_access_time_write());
     sts->setValue(N("MemoryBurts"), memory_access_time_burst());
+    sts->setValue(N("MemoryStalls"), memory_stalls());
+    sts->setValue(N("Dram"), dram_enabled());
+    sts->setValue(N("DramBanks"), dram_banks());
+    sts->setValue(N("DramRowSize"), dram_row_size());
+    sts->setValue(N("DramPagePolicy"), (unsigned)dram_page_policy());
+    sts->setValue(N("DramTrcd"), dram_t_rcd());
+    sts->setValue(N("DramTcas"), dram_t_cas());
+    sts->setValue(N("DramTrp"), dram_t_rp());
+    sts->setValue(N("DramWriteQueue"), dram_write_queue());
     sts->setValue(N("OsemuEnable"), osemu_enable());
     sts->setValue(N("OsemuKnownSyscallStop"), osemu_known_syscall_stop());
     sts->setValue(N("OsemuUnknownSyscallStop"), osemu_unknown_syscall_stop());
@@ -267,6 +421,9 @@ void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("Elf"), elf_path);
     cch_program.store(sts, N("ProgramCache_"));
     cch_data.store(sts, N("DataCache_"));
+    cch_level2.store(sts, N("Level2Cache_"));
+    sts->setValue(N("Level2HitTime"), cache_level2_hit_time());
+    sts->setValue(N("Level2Inclusion"), (unsigned)cache_level2_inclusion());
 }
 
 #undef N
@@ -282,28 +439,52 @@ void MachineConfig::preset(enum ConfigPresets p) {
         break;
     case CP_PIPE_NO_HAZARD:
         set_pipelined(true);
+        set_delay_slot(true);
         set_hazard_unit(MachineConfig::HU_NONE);
         break;
     case CP_PIPE:
         set_pipelined(true);
+        set_delay_slot(true);
         set_hazard_unit(MachineConfig::HU_STALL_FORWARD);
         break;
     }
     // Some common configurations
+    set_superscalar(DF_SUPERSCALAR);
     set_memory_execute_protection(DF_EXEC_PROTEC);
     set_memory_write_protection(DF_WRITE_PROTEC);
     set_memory_access_time_read(DF_MEM_ACC_READ);
     set_memory_access_time_write(DF_MEM_ACC_WRITE);
     set_memory_access_time_burst(DF_MEM_ACC_BURST);
+    set_memory_stalls(DF_MEM_STALLS);
+    set_dram_enabled(DF_DRAM);
+    set_dram_banks(DF_DRAM_BANKS);
+    set_dram_row_size(DF_DRAM_ROW_SIZE);
+    set_dram_page_policy(DF_DRAM_PAGE_POLICY);
+    set_dram_t_rcd(DF_DRAM_T_RCD);
+    set_dram_t_cas(DF_DRAM_T_CAS);
+    set_dram_t_rp(DF_DRAM_T_RP);
+    set_dram_write_queue(DF_DRAM_WRITE_QUEUE);
+    set_branch_predictor(DF_BP);
+    set_branch_predictor_bits(DF_BP_BITS);
+    set_branch_history_bits(DF_BP_HISTORY_BITS);
+    set_btb_bits(DF_BTB_BITS);
+    set_ras_size(DF_RAS_SIZE);
+    set_mult_latency(DF_MULT_LATENCY);
+    set_div_latency(DF_DIV_LATENCY);
 
     access_cache_program()->preset(p);
     access_cache_data()->preset(p);
+    access_cache_level2()->set_enabled(false);
 }
 
 void MachineConfig::set_pipelined(bool v) {
     pipeline = v;
 }
 
+void MachineConfig::set_superscalar(bool v) {
+    dual_issue = v;
+}
+
 void MachineConfig::set_delay_slot(bool v) {
     delayslot = v;
 }
@@ -312,6 +493,47 @@ void MachineConfig::set_hazard_unit(enum MachineConfig::HazardUnit hu) {
     hunit = hu;
 }
 
+void MachineConfig::set_branch_predictor(enum BranchPredictor bp) {
+    bp_kind = bp;
+}
+
+bool MachineConfig::set_branch_predictor(const QString &name) {
+    static QMap<QString, enum BranchPredictor> bp_map = {
+        { "not-taken", BP_NOT_TAKEN },     { "taken", BP_TAKEN },
+        { "bimodal", BP_BIMODAL },         { "gshare", BP_GSHARE },
+        { "tournament", BP_TOURNAMENT },
+    };
+    if (!bp_map.contains(name)) {
+        return false;
+    }
+    set_branch_predictor(bp_map.value(name));
+    return true;
+}
+
+void MachineConfig::set_branch_predictor_bits(unsigned v) {
+    bp_bits = v;
+}
+
+void MachineConfig::set_branch_history_bits(unsigned v) {
+    bp_history_bits = v;
+}
+
+void MachineConfig::set_btb_bits(unsigned v) {
+    bp_btb_bits = v;
+}
+
+void MachineConfig::set_ras_size(unsigned v) {
+    bp_ras_size = v;
+}
+
+void MachineConfig::set_mult_latency(unsigned v) {
+    mul_latency = v;
+}
+
+void MachineConfig::set_div_latency(unsigned v) {
+    dv_latency = v;
+}
+
 bool MachineConfig::set_hazard_unit(const QString &hukind) {
     static QMap<QString, enum HazardUnit> hukind_map = {
         { "none", HU_NONE },
@@ -346,6 +568,54 @@ void MachineConfig::set_memory_access_time_burst(unsigned v) {
     mem_acc_burst = v;
 }
 
+void MachineConfig::set_memory_stalls(bool v) {
+    mem_stalls = v;
+}
+
+void MachineConfig::set_dram_enabled(bool v) {
+    dram_en = v;
+}
+
+void MachineConfig::set_dram_banks(unsigned v) {
+    dram_n_banks = v;
+}
+
+void MachineConfig::set_dram_row_size(unsigned v) {
+    dram_row_bytes = v;
+}
+
+void MachineConfig::set_dram_page_policy(enum DramPagePolicy policy) {
+    dram_page_pol = policy;
+}
+
+bool MachineConfig::set_dram_page_policy(const QString &policy) {
+    static QMap<QString, enum DramPagePolicy> policy_map = {
+        { "open", DP_OPEN },
+        { "closed", DP_CLOSED },
+    };
+    if (!policy_map.contains(policy)) {
+        return false;
+    }
+    set_dram_page_policy(policy_map.value(policy));
+    return true;
+}
+
+void MachineConfig::set_dram_t_rcd(unsigned v) {
+    dram_rcd = v;
+}
+
+void MachineConfig::set_dram_t_cas(unsigned v) {
+    dram_cas = v;
+}
+
+void MachineConfig::set_dram_t_rp(unsigned v) {
+    dram_rp = v;
+}
+
+void MachineConfig::set_dram_write_queue(unsigned v) {
+    dram_queue = v;
+}
+
 void MachineConfig::set_osemu_enable(bool v) {
     osem_enable = v;
 }
@@ -386,6 +656,31 @@ void MachineConfig::set_cache_data(const CacheConfig &c) {
     cch_data = c;
 }
 
+void MachineConfig::set_cache_level2(const CacheConfig &c) {
+    cch_level2 = c;
+}
+
+void MachineConfig::set_cache_level2_hit_time(unsigned v) {
+    l2_hit_time = v;
+}
+
+void MachineConfig::set_cache_level2_inclusion(enum CacheInclusion ci) {
+    l2_inclusion = ci;
+}
+
+bool MachineConfig::set_cache_level2_inclusion(const QString &inclusion) {
+    static QMap<QString, enum CacheInclusion> inclusion_map = {
+        { "nine", CI_NINE },
+        { "inclusive", CI_INCLUSIVE },
+        { "exclusive", CI_EXCLUSIVE },
+    };
+    if (!inclusion_map.contains(inclusion)) {
+        return false;
+    }
+    set_cache_level2_inclusion(inclusion_map.value(inclusion));
+    return true;
+}
+
 void MachineConfig::set_simulated_endian(Endian endian) {
     MachineConfig::simulated_endian = endian;
 }
@@ -394,9 +689,13 @@ bool MachineConfig::pipelined() const {
     return pipeline;
 }
 
+bool MachineConfig::superscalar() const {
+    // Only pipelined core can issue more instructions at once
+    return pipeline && dual_issue;
+}
+
 bool MachineConfig::delay_slot() const {
-    // Delay slot is always on when pipeline is enabled
-    return pipeline || delayslot;
+    return delayslot;
 }
 
 enum MachineConfig::HazardUnit MachineConfig::hazard_unit() const {
@@ -404,6 +703,34 @@ enum MachineConfig::HazardUnit MachineConfig::hazard_unit() const {
     return pipeline ? hunit : machine::MachineConfig::HU_NONE;
 }
 
+enum MachineConfig::BranchPredictor MachineConfig::branch_predictor() const {
+    return bp_kind;
+}
+
+unsigned MachineConfig::branch_predictor_bits() const {
+    return bp_bits;
+}
+
+unsigned MachineConfig::branch_history_bits() const {
+    return bp_history_bits;
+}
+
+unsigned MachineConfig::btb_bits() const {
+    return bp_btb_bits;
+}
+
+unsigned MachineConfig::ras_size() const {
+    return bp_ras_size;
+}
+
+unsigned MachineConfig::mult_latency() const {
+    return mul_latency;
+}
+
+unsigned MachineConfig::div_latency() const {
+    return dv_latency;
+}
+
 bool MachineConfig::memory_execute_protection() const {
     return exec_protect;
 }
@@ -424,6 +751,43 @@ unsigned MachineConfig::memory_access_time_burst() const {
     return mem_acc_burst;
 }
 
+bool MachineConfig::memory_stalls() const {
+    return mem_stalls;
+}
+
+bool MachineConfig::dram_enabled() const {
+    return dram_en;
+}
+
+unsigned MachineConfig::dram_banks() const {
+    return dram_n_banks > 1 ? dram_n_banks : 1;
+}
+
+unsigned MachineConfig::dram_row_size() const {
+    // Row holds at least one word
+    return dram_row_bytes > 4 ? dram_row_bytes : 4;
+}
+
+enum MachineConfig::DramPagePolicy MachineConfig::dram_page_policy() const {
+    return dram_page_pol;
+}
+
+unsigned MachineConfig::dram_t_rcd() const {
+    return dram_rcd;
+}
+
+unsigned MachineConfig::dram_t_cas() const {
+    return dram_cas > 1 ? dram_cas : 1;
+}
+
+unsigned MachineConfig::dram_t_rp() const {
+    return dram_rp;
+}
+
+unsigned MachineConfig::dram_write_queue() const {
+    return dram_queue;
+}
+
 bool MachineConfig::osemu_enable() const {
     return osem_enable;
 }
@@ -460,6 +824,18 @@ const CacheConfig &MachineConfig::cache_data() const {
     return cch_data;
 }
 
+const CacheConfig &MachineConfig::cache_level2() const {
+    return cch_level2;
+}
+
+unsigned MachineConfig::cache_level2_hit_time() const {
+    return l2_hit_time > 1 ? l2_hit_time : 1;
+}
+
+enum MachineConfig::CacheInclusion MachineConfig::cache_level2_inclusion() const {
+    return l2_inclusion;
+}
+
 CacheConfig *MachineConfig::access_cache_program() {
     return &cch_program;
 }
@@ -468,17 +844,27 @@ CacheConfig *MachineConfig::access_cache_data() {
     return &cch_data;
 }
 
+CacheConfig *MachineConfig::access_cache_level2() {
+    return &cch_level2;
+}
+
 Endian MachineConfig::get_simulated_endian() const {
     return simulated_endian;
 }
 
 bool MachineConfig::operator==(const MachineConfig &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
-    return CMP(pipelined) && CMP(delay_slot) && CMP(hazard_unit)
+    return CMP(pipelined) && CMP(superscalar) && CMP(delay_slot) && CMP(hazard_unit)
+           && CMP(branch_predictor) && CMP(branch_predictor_bits)
+           && CMP(branch_history_bits) && CMP(btb_bits) && CMP(ras_size)
+           && CMP(mult_latency) && CMP(div_latency)
            && CMP(memory_execute_protection) && CMP(memory_write_protection)
            && CMP(memory_access_time_read) && CMP(memory_access_time_write)
-           && CMP(memory_access_time_burst) && CMP(elf) && CMP(cache_program)
-           && CMP(cache_data);
+           && CMP(memory_access_time_burst) && CMP(memory_stalls) && CMP(dram_enabled)
+           && CMP(dram_banks) && CMP(dram_row_size) && CMP(dram_page_policy) && CMP(dram_t_rcd)
+           && CMP(dram_t_cas) && CMP(dram_t_rp) && CMP(dram_write_queue) && CMP(elf)
+           && CMP(cache_program) && CMP(cache_data) && CMP(cache_level2)
+           && CMP(cache_level2_hit_time) && CMP(cache_level2_inclusion);
 #undef CMP
 }
 
@@ -72,6 +72,13 @@ public:
         WP_BACK             // Write back
     };
 
+    enum PrefetchPolicy {
+        PF_NONE,      // No prefetching
+        PF_NEXT_LINE, // Blocks following missed or prefetched block
+        PF_STRIDE,    // Stride of accesses of each instruction
+        PF_STREAM     // Sequential streams following misses
+    };
+
     // If cache should be used or not
     void set_enabled(bool);
     void set_set_count(unsigned);     // Number of sets
@@ -80,6 +87,12 @@ public:
                                       // ways)
     void set_replacement_policy(enum ReplacementPolicy);
     void set_write_policy(enum WritePolicy);
+    void set_prefetch_policy(enum PrefetchPolicy);
+    // none/next-line/stride/stream, returns false for unknown name
+    bool set_prefetch_policy(const QString &);
+    void set_prefetch_degree(unsigned);   // Blocks prefetched at once
+    void set_prefetch_distance(unsigned); // Blocks ahead of the access
+    static constexpr unsigned PREFETCH_MAX = 64; // Limit of prefetch degree and distance
 
     bool enabled() const;
     unsigned set_count() const;
@@ -87,6 +100,9 @@ public:
     unsigned associativity() const;
     enum ReplacementPolicy replacement_policy() const;
     enum WritePolicy write_policy() const;
+    enum PrefetchPolicy prefetch_policy() const;
+    unsigned prefetch_degree() const;
+    unsigned prefetch_distance() const;
 
     bool operator==(const CacheConfig &c) const;
     bool operator!=(const CacheConfig &c) const;
@@ -96,6 +112,8 @@ private:
     unsigned n_sets, n_blocks, d_associativity;
     enum ReplacementPolicy replac_pol;
     enum WritePolicy write_pol;
+    enum PrefetchPolicy prefetch_pol;
+    unsigned pf_degree, pf_distance;
 };
 
 class MachineConfig {
@@ -110,16 +128,58 @@ public:
 
     enum HazardUnit { HU_NONE, HU_STALL, HU_STALL_FORWARD };
 
+    // Direction predictor of conditional branches
+    enum BranchPredictor {
+        BP_NOT_TAKEN, // Static, never taken
+        BP_TAKEN,     // Static, always taken when target is known
+        BP_BIMODAL,   // Two bit counters indexed by address
+        BP_GSHARE,    // Two bit counters indexed by address xor global history
+        BP_TOURNAMENT // Bimodal and gshare with two bit chooser
+    };
+
+    // Relation of blocks in level 2 cache to blocks in level 1 caches
+    enum CacheInclusion {
+        CI_NINE,      // Non-inclusive non-exclusive, levels are independent
+        CI_INCLUSIVE, // Level 2 holds all blocks of level 1 caches
+        CI_EXCLUSIVE  // Level 2 holds only blocks evicted from level 1 caches
+    };
+
+    // When DRAM bank closes its row buffer
+    enum DramPagePolicy {
+        DP_OPEN,  // Row stays open until other row of the bank is accessed
+        DP_CLOSED // Row is closed (precharged) after each access
+    };
+
     // Configure if CPU is pipelined
     // In default disabled.
     void set_pipelined(bool);
-    // Configure if cpu should simulate delay slot in non-pipelined core
-    // In default enabled. When disabled it also automatically disables
-    // pipelining.
+    // Pipelined CPU issues up to two instructions per cycle (see
+    // CoreSuperscalar). Branch predictor and multiply and divide latency
+    // settings apply only to the scalar pipeline. In default disabled.
+    void set_superscalar(bool);
+    // Configure if cpu should simulate delay slot
+    // In default enabled. Pipelined core without delay slot predicts the
+    // next fetch address (see branch predictor below).
     void set_delay_slot(bool);
     // Hazard unit
     void set_hazard_unit(enum HazardUnit);
     bool set_hazard_unit(const QString &hukind);
+    // Branch prediction of pipelined core without delay slot
+    static constexpr unsigned BP_BITS_MAX = 24;      // Limit of table, history and BTB bits
+    static constexpr unsigned BP_RAS_SIZE_MAX = 256; // Limit of return address stack depth
+    void set_branch_predictor(enum BranchPredictor);
+    bool set_branch_predictor(const QString &name);
+    void set_branch_predictor_bits(unsigned); // Log2 of counter table size
+    void set_branch_history_bits(unsigned);   // Length of global history
+    void set_btb_bits(unsigned);              // Log2 of BTB entries
+    void set_ras_size(unsigned);              // Return address stack depth
+    static constexpr unsigned MULDIV_LATENCY_MAX = 256; // Limit of multiply and divide latency
+    // Cycles multiply (MULT, MADD, MSUB and unsigned variants) and divide
+    // (DIV, DIVU) take in execute stage of pipelined core. Hazard unit stalls
+    // instructions accessing HI and LO until the operation finishes. In
+    // default 1, results are available for the following instruction.
+    void set_mult_latency(unsigned);
+    void set_div_latency(unsigned);
     // Protect data memory from execution. Only program sections can be
     // executed.
     void set_memory_execute_protection(bool);
@@ -129,6 +189,27 @@ public:
     void set_memory_access_time_read(unsigned);
     void set_memory_access_time_write(unsigned);
     void set_memory_access_time_burst(unsigned);
+    // Stall core for memory access times of cache misses, write backs and
+    // uncached accesses. In default disabled, times are then statistics only.
+    void set_memory_stalls(bool);
+    // Main memory timing by DRAM model (see `Dram`) instead of the flat
+    // memory access times, which then apply only to cache statistics. Words
+    // following the first one of an access take burst time (at least one
+    // cycle). In default disabled.
+    static constexpr unsigned DRAM_BANKS_MAX = 64;
+    static constexpr unsigned DRAM_ROW_SIZE_MAX = 65536; // Bytes
+    static constexpr unsigned DRAM_TIMING_MAX = 256;     // Limit of tRCD, tCAS and tRP
+    static constexpr unsigned DRAM_WRITE_QUEUE_MAX = 64;
+    void set_dram_enabled(bool);
+    void set_dram_banks(unsigned);
+    void set_dram_row_size(unsigned); // Bytes in row buffer of a bank
+    void set_dram_page_policy(enum DramPagePolicy);
+    bool set_dram_page_policy(const QString &policy);
+    void set_dram_t_rcd(unsigned); // Row activation to column access (cycles)
+    void set_dram_t_cas(unsigned); // Column access to data (cycles)
+    void set_dram_t_rp(unsigned);  // Row precharge (cycles)
+    // Write backs waiting for scheduling, zero writes immediately
+    void set_dram_write_queue(unsigned);
     // Operating system and exceptions setup
     void set_osemu_enable(bool);
     void set_osemu_known_syscall_stop(bool);
@@ -144,16 +225,40 @@ public:
     // Configure cache
     void set_cache_program(const CacheConfig &);
     void set_cache_data(const CacheConfig &);
+    // Unified cache between program and data caches and memory
+    void set_cache_level2(const CacheConfig &);
+    // Level 2 cache access time (cycles), used instead of memory access
+    // times for level 1 caches when level 2 cache is enabled.
+    void set_cache_level2_hit_time(unsigned);
+    void set_cache_level2_inclusion(enum CacheInclusion);
+    bool set_cache_level2_inclusion(const QString &inclusion);
     void set_simulated_endian(Endian endian);
 
     bool pipelined() const;
+    bool superscalar() const;
     bool delay_slot() const;
     enum HazardUnit hazard_unit() const;
+    enum BranchPredictor branch_predictor() const;
+    unsigned branch_predictor_bits() const;
+    unsigned branch_history_bits() const;
+    unsigned btb_bits() const;
+    unsigned ras_size() const;
+    unsigned mult_latency() const;
+    unsigned div_latency() const;
     bool memory_execute_protection() const;
     bool memory_write_protection() const;
     unsigned memory_access_time_read() const;
     unsigned memory_access_time_write() const;
     unsigned memory_access_time_burst() const;
+    bool memory_stalls() const;
+    bool dram_enabled() const;
+    unsigned dram_banks() const;
+    unsigned dram_row_size() const;
+    enum DramPagePolicy dram_page_policy() const;
+    unsigned dram_t_rcd() const;
+    unsigned dram_t_cas() const;
+    unsigned dram_t_rp() const;
+    unsigned dram_write_queue() const;
     bool osemu_enable() const;
     bool osemu_known_syscall_stop() const;
     bool osemu_unknown_syscall_stop() const;
@@ -164,25 +269,39 @@ public:
     QString elf() const;
     const CacheConfig &cache_program() const;
     const CacheConfig &cache_data() const;
+    const CacheConfig &cache_level2() const;
+    unsigned cache_level2_hit_time() const;
+    enum CacheInclusion cache_level2_inclusion() const;
     Endian get_simulated_endian() const;
 
     CacheConfig *access_cache_program();
     CacheConfig *access_cache_data();
+    CacheConfig *access_cache_level2();
 
     bool operator==(const MachineConfig &c) const;
     bool operator!=(const MachineConfig &c) const;
 
 private:
-    bool pipeline, delayslot;
+    bool pipeline, dual_issue, delayslot;
     enum HazardUnit hunit;
+    enum BranchPredictor bp_kind;
+    unsigned bp_bits, bp_history_bits, bp_btb_bits, bp_ras_size;
+    unsigned mul_latency, dv_latency;
     bool exec_protect, write_protect;
     unsigned mem_acc_read, mem_acc_write, mem_acc_burst;
+    bool mem_stalls;
+    bool dram_en;
+    unsigned dram_n_banks, dram_row_bytes;
+    enum DramPagePolicy dram_page_pol;
+    unsigned dram_rcd, dram_cas, dram_rp, dram_queue;
     bool osem_enable, osem_known_syscall_stop, osem_unknown_syscall_stop;
     bool osem_interrupt_stop, osem_exception_stop;
     bool res_at_compile;
     QString osem_fs_root;
     QString elf_path;
-    CacheConfig cch_program, cch_data;
+    CacheConfig cch_program, cch_data, cch_level2;
+    unsigned l2_hit_time;
+    enum CacheInclusion l2_inclusion;
     Endian simulated_endian = BIG;
 };
 
@@ -131,6 +131,15 @@ public:
      */
     virtual enum LocationStatus location_status(Offset offset) const = 0;
 
+    /**
+     * Window of host memory backing given offset (window bounds are offsets
+     * too), see `DirectAccessWindow`.
+     *
+     * Only plain memory provides host storage. Default window covers whole
+     * device and forces regular access path.
+     */
+    virtual DirectAccessWindow direct_access_window(Offset offset) const;
+
     /**
      * Endian of the simulated CPU/memory system.
      * @see BackendMemory docs
@@ -156,6 +165,12 @@ signals:
 inline BackendMemory::BackendMemory(Endian simulated_machine_endian)
     : simulated_machine_endian(simulated_machine_endian) {}
 
+inline DirectAccessWindow
+BackendMemory::direct_access_window(Offset offset) const {
+    UNUSED(offset)
+    return { .start = 0, .last = UINT64_MAX };
+}
+
 } // namespace machine
 
 #endif // BACKEND_MEMORY_H
@@ -37,6 +37,7 @@
 
 #include "lcddisplay.h"
 
+#include "checkpoint.h"
 #include "common/endian.h"
 
 #ifdef DEBUG_LCD
@@ -129,6 +130,7 @@ bool LcdDisplay::write_raw_pixel(Offset destination, uint16_t value) {
     }
 
     memcpy(&fb_data[destination], &value, sizeof(value));
+    change_counter++;
 
     size_t x, y;
     std::tie(x, y) = get_pixel_from_address(destination);
@@ -187,6 +189,30 @@ size_t LcdDisplay::get_fb_line_size() const {
 size_t LcdDisplay::get_fb_size_bytes() const {
     return get_fb_line_size() * fb_height;
 }
+void LcdDisplay::save_state(CheckpointWriter &writer) const {
+    writer.write_u64(fb_data.size());
+    for (size_t offset = 0; offset + 1 < fb_data.size(); offset += 2) {
+        uint16_t pixel;
+        memcpy(&pixel, &fb_data[offset], sizeof(pixel));
+        writer.write_u16(pixel);
+    }
+}
+
+void LcdDisplay::restore_state(CheckpointReader &reader) {
+    if (reader.read_u64() != fb_data.size()) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Checkpoint does not match machine configuration (LCD size)", "");
+    }
+    // Only changed pixels are redrawn
+    for (size_t offset = 0; offset + 1 < fb_data.size(); offset += 2) {
+        write_raw_pixel(offset, reader.read_u16());
+    }
+}
+
+uint32_t LcdDisplay::get_change_counter() const {
+    return change_counter;
+}
+
 LocationStatus LcdDisplay::location_status(Offset offset) const {
     if ((offset | ~3u) >= get_fb_size_bytes()) {
         return LOCSTAT_ILLEGAL;
@@ -49,6 +49,9 @@
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class LcdDisplay final : public BackendMemory {
     Q_OBJECT
 public:
@@ -75,6 +78,12 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+    // Incremented on every change of framebuffer content
+    uint32_t get_change_counter() const;
+
     /**
      * @return  framebuffer width in pixels
      */
@@ -108,6 +117,7 @@ private:
     const size_t fb_height; //> Height in pixels
     const size_t fb_bits_per_pixel;
     std::vector<byte> fb_data;
+    uint32_t change_counter = 0;
 };
 
 } // namespace machine
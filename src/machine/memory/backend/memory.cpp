@@ -37,10 +37,13 @@
 
 #include "memory/backend/memory.h"
 
+#include "checkpoint.h"
 #include "common/endian.h"
 #include "simulator_exception.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 namespace machine {
 
@@ -48,11 +51,30 @@ MemorySection::MemorySection(
     size_t length_bytes,
     Endian simulated_machine_endian)
     : BackendMemory(simulated_machine_endian)
-    , dt(length_bytes, 0) {}
+    , storage(new byte[length_bytes](), std::default_delete<byte[]>())
+    , dt(storage.get())
+    , dt_length(length_bytes)
+    , pool(nullptr) {}
+
+MemorySection::MemorySection(
+    std::shared_ptr<byte> storage,
+    size_t length_bytes,
+    Endian simulated_machine_endian,
+    MemorySectionPool *pool)
+    : BackendMemory(simulated_machine_endian)
+    , storage(std::move(storage))
+    , dt(this->storage.get())
+    , dt_length(length_bytes)
+    , pool(pool) {}
 
 MemorySection::MemorySection(const MemorySection &other)
     : BackendMemory(other.simulated_machine_endian)
-    , dt(other.dt) {}
+    , storage(new byte[other.dt_length], std::default_delete<byte[]>())
+    , dt(storage.get())
+    , dt_length(other.dt_length)
+    , pool(nullptr) {
+    memcpy(dt, other.dt, dt_length);
+}
 
 WriteResult MemorySection::write(
     Offset dst_offset,
@@ -76,6 +98,18 @@ WriteResult MemorySection::write(
     // TODO, make swap conditional for big endian machines
     bool changed = memcmp(source, &dt[destination], available_size) != 0;
     if (changed) {
+        if (is_shared()) {
+            // Copy on write, other sections keep the original storage.
+            std::shared_ptr<byte> copy;
+            if (pool != nullptr) {
+                copy = pool->allocate_storage(false);
+            } else {
+                copy.reset(new byte[dt_length], std::default_delete<byte[]>());
+            }
+            memcpy(copy.get(), dt, dt_length);
+            storage = std::move(copy);
+            dt = storage.get();
+        }
         memcpy(&dt[destination], source, available_size);
     }
 
@@ -110,21 +144,138 @@ LocationStatus MemorySection::location_status(Offset offset) const {
 }
 
 size_t MemorySection::length() const {
-    return this->dt.size();
+    return this->dt_length;
 }
 
 const byte *MemorySection::data() const {
-    return this->dt.data();
+    return this->dt;
+}
+
+byte *MemorySection::data() {
+    return this->dt;
+}
+
+void MemorySection::share(const MemorySection &other) {
+    storage = other.storage;
+    dt = storage.get();
+    dt_length = other.dt_length;
+}
+
+bool MemorySection::is_shared() const {
+    return storage.use_count() > 1;
 }
 
 bool MemorySection::operator==(const MemorySection &other) const {
-    return this->dt == other.dt;
+    return this->dt_length == other.dt_length
+           && (this->dt == other.dt
+               || memcmp(this->dt, other.dt, this->dt_length) == 0);
 }
 
 bool MemorySection::operator!=(const MemorySection &ms) const {
     return !this->operator==(ms);
 }
 
+// Number of sections in the first pool chunk, following chunks double in size
+constexpr size_t MEMORY_POOL_FIRST_CHUNK = 4;
+// Maximal number of sections in one pool chunk
+constexpr size_t MEMORY_POOL_MAX_CHUNK = 256;
+
+/**
+ * Storage of the pool. Blocks are returned from deleters of storage pointers,
+ * which may be held by sections of other memories (possibly in other thread).
+ */
+struct MemorySectionPool::Arena {
+    std::mutex lock;
+    std::vector<std::unique_ptr<byte[]>> chunks;
+    std::vector<byte *> free_blocks;
+    size_t chunk_size = 0;
+    size_t chunk_used = 0;
+    size_t chunks_total_size = 0;
+};
+
+MemorySectionPool::MemorySectionPool(size_t section_size)
+    : section_size(section_size)
+    , arena(std::make_shared<Arena>()) {}
+
+std::shared_ptr<byte> MemorySectionPool::allocate_storage(bool zeroed) {
+    byte *block;
+    {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        if (!arena->free_blocks.empty()) {
+            block = arena->free_blocks.back();
+            arena->free_blocks.pop_back();
+            if (zeroed) {
+                memset(block, 0, section_size);
+            }
+        } else {
+            if (arena->chunks.empty()
+                || arena->chunk_used + section_size > arena->chunk_size) {
+                size_t sections_in_chunk = MEMORY_POOL_FIRST_CHUNK;
+                if (!arena->chunks.empty()) {
+                    sections_in_chunk = std::min(
+                        2 * arena->chunk_size / section_size,
+                        MEMORY_POOL_MAX_CHUNK);
+                }
+                arena->chunk_size = sections_in_chunk * section_size;
+                arena->chunks.emplace_back(new byte[arena->chunk_size]());
+                arena->chunks_total_size += arena->chunk_size;
+                arena->chunk_used = 0;
+            }
+            block = arena->chunks.back().get() + arena->chunk_used;
+            arena->chunk_used += section_size;
+        }
+    }
+    std::shared_ptr<Arena> owner = arena;
+    return std::shared_ptr<byte>(block, [owner](byte *released) {
+        std::lock_guard<std::mutex> guard(owner->lock);
+        owner->free_blocks.push_back(released);
+    });
+}
+
+MemorySection *MemorySectionPool::allocate(Endian simulated_machine_endian) {
+    if (!free_sections.empty()) {
+        MemorySection *sec = free_sections.back();
+        free_sections.pop_back();
+        sec->storage = allocate_storage(true);
+        sec->dt = sec->storage.get();
+        return sec;
+    }
+    sections.emplace_back(
+        allocate_storage(true), section_size, simulated_machine_endian, this);
+    return &sections.back();
+}
+
+MemorySection *MemorySectionPool::allocate_shared(const MemorySection &other) {
+    MemorySection *sec;
+    if (!free_sections.empty()) {
+        sec = free_sections.back();
+        free_sections.pop_back();
+    } else {
+        sections.emplace_back(
+            nullptr, section_size, other.simulated_machine_endian, this);
+        sec = &sections.back();
+    }
+    sec->share(other);
+    return sec;
+}
+
+void MemorySectionPool::release(MemorySection *section) {
+    section->storage.reset();
+    section->dt = nullptr;
+    free_sections.push_back(section);
+}
+
+void MemorySectionPool::clear() {
+    free_sections.clear();
+    sections.clear();
+    // Blocks still shared by other memories keep the old arena alive.
+    arena = std::make_shared<Arena>();
+}
+
+size_t MemorySectionPool::footprint() const {
+    return arena->chunks_total_size + sections.size() * sizeof(MemorySection);
+}
+
 // Settings sanity checks
 static_assert(
     MEMORY_SECTION_SIZE != 0,
@@ -177,8 +328,11 @@ Memory::Memory(Endian simulated_machine_endian)
 }
 
 Memory::Memory(const Memory &other)
-    : BackendMemory(other.simulated_machine_endian) {
-    this->mt_root = copy_section_tree(other.get_memory_tree_root(), 0);
+    : BackendMemory(other.simulated_machine_endian)
+    , cow_source_id(other.memory_id)
+    , cow_source_generation(other.share_sections()) {
+    this->mt_root = copy_section_tree(
+        other.get_memory_tree_root(), 0, this->section_pool);
 }
 
 Memory::~Memory() {
@@ -189,15 +343,77 @@ Memory::~Memory() {
 void Memory::reset() {
     free_section_tree(this->mt_root, 0);
     delete[] this->mt_root;
+    this->section_pool.clear();
+    this->last_section_index = SIZE_MAX;
+    this->last_section = nullptr;
+    this->tree_generation++;
+    this->cow_source_id = 0;
+    this->cow_touched.clear();
     this->mt_root = allocate_section_tree();
 }
 
 void Memory::reset(const Memory &m) {
+    this->last_section_index = SIZE_MAX;
+    this->last_section = nullptr;
+    this->tree_generation++;
+    if (m.memory_id == this->cow_source_id
+        && m.tree_generation == this->cow_source_generation) {
+        // All other sections still share storage with the source.
+        for (size_t section_index : this->cow_touched) {
+            const size_t offset = section_index << MEMORY_SECTION_BITS;
+            union MemoryTree *slot = get_section_slot(offset, false);
+            const union MemoryTree *source_slot = m.get_section_slot(offset, false);
+            if (source_slot != nullptr && source_slot->sec != nullptr) {
+                slot->sec->share(*source_slot->sec);
+            } else {
+                this->section_pool.release(slot->sec);
+                slot->sec = nullptr;
+            }
+        }
+        this->cow_source_generation = m.share_sections();
+        this->cow_touched.clear();
+        return;
+    }
     free_section_tree(this->mt_root, 0);
-    this->mt_root = copy_section_tree(m.get_memory_tree_root(), 0);
+    delete[] this->mt_root;
+    this->section_pool.clear();
+    this->cow_source_id = m.memory_id;
+    this->cow_source_generation = m.share_sections();
+    this->cow_touched.clear();
+    this->mt_root = copy_section_tree(m.get_memory_tree_root(), 0, this->section_pool);
 }
 
 MemorySection *Memory::get_section(size_t offset, bool create) const {
+    const size_t section_index = offset >> MEMORY_SECTION_BITS;
+    if (section_index == last_section_index) {
+        return last_section;
+    }
+    union MemoryTree *slot = get_section_slot(offset, create);
+    if (slot == nullptr) {
+        return nullptr;
+    }
+    if (slot->sec == nullptr) {
+        if (!create) {
+            return nullptr;
+        }
+        slot->sec = section_pool.allocate(simulated_machine_endian);
+        tree_generation++;
+        if (cow_source_id != 0) {
+            cow_touched.insert(section_index);
+        }
+    }
+    last_section_index = section_index;
+    last_section = slot->sec;
+    return slot->sec;
+}
+
+/**
+ * Find leaf of the tree holding section for given offset.
+ *
+ * Does not use the last section cache, so lookups of other memory (copy on
+ * write source) do not modify it.
+ */
+union MemoryTree *Memory::get_section_slot(size_t offset, bool create) const {
     union MemoryTree *w = this->mt_root;
     size_t row_num;
     // Walk memory tree branch from root to leaf and create new nodes when
@@ -215,14 +431,11 @@ MemorySection *Memory::get_section(size_t offset, bool create) const {
         w = w[row_num].subtree;
     }
     row_num = get_tree_row(offset, MEMORY_TREE_DEPTH - 1);
-    if (w[row_num].sec == nullptr) {
-        if (!create) {
-            return nullptr;
-        }
-        w[row_num].sec
-            = new MemorySection(MEMORY_SECTION_SIZE, simulated_machine_endian);
-    }
-    return w[row_num].sec;
+    return &w[row_num];
+}
+
+uint32_t Memory::share_sections() const {
+    return ++tree_generation;
 }
 
 size_t get_section_offset_mask(size_t addr) {
@@ -234,15 +447,30 @@ WriteResult Memory::write(
     const void *source,
     size_t size,
     WriteOptions options) {
+    // Fast path for accesses within single section (all aligned accesses).
+    if (get_section_offset_mask(destination) + size <= MEMORY_SECTION_SIZE) {
+        return write_section(destination, source, size);
+    }
     return repeat_access_until_completed<WriteResult>(
         destination, source, size, options,
         [this](
             Offset _destination, const void *_source, size_t _size,
-            WriteOptions) {
-            MemorySection *section = this->get_section(_destination, true);
-            return section->write(
-                get_section_offset_mask(_destination), _source, _size, {});
-        });
+            WriteOptions) { return write_section(_destination, _source, _size); });
+}
+
+WriteResult Memory::write_section(Offset destination, const void *source, size_t size) {
+    MemorySection *section = get_section(destination, true);
+    const byte *storage = section->data();
+    WriteResult result
+        = section->write(get_section_offset_mask(destination), source, size, {});
+    if (section->data() != storage) {
+        // Section was copied on write.
+        tree_generation++;
+        if (cow_source_id != 0) {
+            cow_touched.insert(destination >> MEMORY_SECTION_BITS);
+        }
+    }
+    return result;
 }
 
 ReadResult Memory::read(
@@ -250,6 +478,15 @@ ReadResult Memory::read(
     Offset source,
     size_t size,
     ReadOptions options) const {
+    if (get_section_offset_mask(source) + size <= MEMORY_SECTION_SIZE) {
+        MemorySection *section = get_section(source, false);
+        if (section == nullptr) {
+            memset(destination, 0, size);
+            return { .n_bytes = size };
+        }
+        return section->read(
+            destination, get_section_offset_mask(source), size, options);
+    }
     return repeat_access_until_completed<ReadResult>(
         destination, source, size, options,
         [this](
@@ -268,6 +505,11 @@ ReadResult Memory::read(
         });
 }
 
+uint64_t Memory::next_memory_id() {
+    static std::atomic<uint64_t> last_memory_id { 0 };
+    return ++last_memory_id;
+}
+
 uint32_t Memory::get_change_counter() const {
     return change_counter;
 }
@@ -284,13 +526,88 @@ const union machine::MemoryTree *Memory::get_memory_tree_root() const {
     return this->mt_root;
 }
 
+DirectAccessWindow Memory::direct_access_window(Offset offset) const {
+    const uint64_t section_start = offset & ~(uint64_t)(MEMORY_SECTION_SIZE - 1);
+    // Sections are not allocated here, reads of unallocated memory are slow
+    // path and first write allocates the section and bumps generation.
+    MemorySection *section = get_section(offset, false);
+    return { .start = section_start,
+             .last = section_start + MEMORY_SECTION_SIZE - 1,
+             .host = section != nullptr ? section->data() : nullptr,
+             .writable = section != nullptr && !section->is_shared(),
+             .generation = &tree_generation,
+             .valid_generation = tree_generation };
+}
+
+size_t Memory::footprint() const {
+    return count_section_tree(this->mt_root, 0) * MEMORY_TREE_ROW_SIZE
+               * sizeof(union MemoryTree)
+           + section_pool.footprint();
+}
+
+size_t Memory::unshared_footprint(const Memory &other) const {
+    std::vector<std::pair<size_t, const MemorySection *>> sections;
+    collect_section_tree(this->mt_root, 0, 0, sections);
+    size_t unshared = 0;
+    for (const auto &section : sections) {
+        const union MemoryTree *other_slot
+            = other.get_section_slot(section.first << MEMORY_SECTION_BITS, false);
+        if (other_slot == nullptr || other_slot->sec == nullptr
+            || other_slot->sec->data() != section.second->data()) {
+            unshared += section.second->length();
+        }
+    }
+    return unshared;
+}
+
+void Memory::save_state(CheckpointWriter &writer) const {
+    std::vector<std::pair<size_t, const MemorySection *>> sections;
+    collect_section_tree(this->mt_root, 0, 0, sections);
+    writer.write_u32(MEMORY_SECTION_BITS);
+    writer.write_u32(0);
+    writer.write_u64(sections.size());
+    for (const auto &section : sections) {
+        writer.write_u64(section.first);
+    }
+    writer.align(CHECKPOINT_PAGE_SIZE);
+    for (const auto &section : sections) {
+        writer.write_bytes(section.second->data(), MEMORY_SECTION_SIZE);
+    }
+}
+
+void Memory::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(MEMORY_SECTION_BITS, "memory section size");
+    reader.read_u32();
+    uint64_t count = reader.read_u64();
+    std::vector<size_t> indices;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t section_index = reader.read_u64();
+        if (section_index >= (1ull << (32 - MEMORY_SECTION_BITS))) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Checkpoint memory section is out of address space", "");
+        }
+        indices.push_back(section_index);
+    }
+    reader.align(CHECKPOINT_PAGE_SIZE);
+    reset();
+    for (size_t section_index : indices) {
+        MemorySection *section = get_section(section_index << MEMORY_SECTION_BITS, true);
+        memcpy(section->data(), reader.take(MEMORY_SECTION_SIZE), MEMORY_SECTION_SIZE);
+    }
+    emit external_backend_change_notify(this, 0, UINT32_MAX, AccessEffects::REGULAR);
+}
+
 union machine::MemoryTree *Memory::allocate_section_tree() {
     auto *mt = new union MemoryTree[MEMORY_TREE_ROW_SIZE];
     memset(mt, 0, sizeof *mt * MEMORY_TREE_ROW_SIZE);
     return mt;
 }
 
+// Sections are owned by the section pool, only tree rows are freed here.
 void Memory::free_section_tree(union MemoryTree *mt, size_t depth) {
+    if (mt == nullptr) {
+        return;
+    }
     if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
             if (mt[i].subtree != nullptr) {
@@ -298,9 +615,37 @@ void Memory::free_section_tree(union MemoryTree *mt, size_t depth) {
                 delete[] mt[i].subtree;
             }
         }
-    } else { // Following level is memory section
+    }
+}
+
+size_t Memory::count_section_tree(const union MemoryTree *mt, size_t depth) {
+    if (mt == nullptr) {
+        return 0;
+    }
+    size_t rows = 1;
+    if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            delete mt[i].sec;
+            if (mt[i].subtree != nullptr) {
+                rows += count_section_tree(mt[i].subtree, depth + 1);
+            }
+        }
+    }
+    return rows;
+}
+
+void Memory::collect_section_tree(
+    const union MemoryTree *mt,
+    size_t depth,
+    size_t section_index,
+    std::vector<std::pair<size_t, const MemorySection *>> &sections) {
+    for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
+        const size_t index = (section_index << MEMORY_TREE_BITS) | i;
+        if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
+            if (mt[i].subtree != nullptr) {
+                collect_section_tree(mt[i].subtree, depth + 1, index, sections);
+            }
+        } else if (mt[i].sec != nullptr) { // Following level is memory section
+            sections.emplace_back(index, mt[i].sec);
         }
     }
 }
@@ -311,11 +656,14 @@ bool Memory::compare_section_tree(
     size_t depth) {
     if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (((mt1[i].subtree == nullptr || mt2[i].subtree == nullptr)
-                 && mt1[i].subtree != mt2[i].subtree)
-                || (mt1[i].subtree != nullptr && mt2[i].subtree != nullptr
-                    && !compare_section_tree(
-                        mt1[i].subtree, mt2[i].subtree, depth + 1))) {
+            const union MemoryTree *st1 = mt1[i].subtree;
+            const union MemoryTree *st2 = mt2[i].subtree;
+            if (st1 == nullptr || st2 == nullptr) {
+                // Subtree without sections (left by restart) equals to none.
+                if (!is_empty_section_tree(st1 != nullptr ? st1 : st2, depth + 1)) {
+                    return false;
+                }
+            } else if (!compare_section_tree(st1, st2, depth + 1)) {
                 return false;
             }
         }
@@ -332,19 +680,38 @@ bool Memory::compare_section_tree(
     return true;
 }
 
-union machine::MemoryTree *
-Memory::copy_section_tree(const union MemoryTree *mt, size_t depth) {
+bool Memory::is_empty_section_tree(const union MemoryTree *mt, size_t depth) {
+    if (mt == nullptr) {
+        return true;
+    }
+    for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
+        if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
+            if (!is_empty_section_tree(mt[i].subtree, depth + 1)) {
+                return false;
+            }
+        } else if (mt[i].sec != nullptr) { // Following level is memory section
+            return false;
+        }
+    }
+    return true;
+}
+
+union machine::MemoryTree *Memory::copy_section_tree(
+    const union MemoryTree *mt,
+    size_t depth,
+    MemorySectionPool &pool) {
     union MemoryTree *nmt = allocate_section_tree();
     if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
             if (mt[i].subtree != nullptr) {
-                nmt[i].subtree = copy_section_tree(mt[i].subtree, depth + 1);
+                nmt[i].subtree
+                    = copy_section_tree(mt[i].subtree, depth + 1, pool);
             }
         }
     } else { // Following level is memory section
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
             if (mt[i].sec != nullptr) {
-                nmt[i].sec = new MemorySection(*mt[i].sec);
+                nmt[i].sec = pool.allocate_shared(*mt[i].sec);
             }
         }
     }
@@ -48,16 +48,37 @@
 
 #include <QObject>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <vector>
 
 namespace machine {
 
+class MemorySectionPool;
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * NOTE: Internal endian of memory must be the same as endian of the whole
  * simulated machine. Therefore it does not have internal_endian field.
+ *
+ * Storage of a section can be shared by sections of more memories (see
+ * `MemorySection::share`). Shared storage is copied on the first write, which
+ * changes the content (copy on write).
  */
 class MemorySection final : public BackendMemory {
 public:
     explicit MemorySection(size_t length_bytes, Endian simulated_machine_endian);
+    /**
+     * Section with storage allocated from the pool. Pool has to outlive the
+     * section.
+     */
+    MemorySection(
+        std::shared_ptr<byte> storage,
+        size_t length_bytes,
+        Endian simulated_machine_endian,
+        MemorySectionPool *pool);
     MemorySection(const MemorySection &other);
     ~MemorySection() override = default;
 
@@ -77,20 +98,65 @@ public:
 
     size_t length() const;
     const byte *data() const;
+    /**
+     * Writable storage, valid only while the section is not shared.
+     */
+    byte *data();
+
+    // Use storage of other section (of the same length) until written.
+    void share(const MemorySection &other);
+    bool is_shared() const;
 
     bool operator==(const MemorySection &) const;
     bool operator!=(const MemorySection &) const;
 
 private:
-    std::vector<byte> dt;
+    std::shared_ptr<byte> storage;
+    byte *dt;
+    size_t dt_length;
+    MemorySectionPool *pool; // Source of private storage, nullptr for heap.
+
+    friend class MemorySectionPool;
+};
+
+/**
+ * Arena of memory sections of one `Memory` instance.
+ *
+ * Section data are carved from chunks growing geometrically, so a sparse
+ * program touching few pages stays small and a dense one does not pay a heap
+ * allocation per section. Storage released by sections returns to the arena
+ * free list. The arena stays alive while any section (possibly of other
+ * memory) references its storage.
+ */
+class MemorySectionPool {
+public:
+    explicit MemorySectionPool(size_t section_size);
+
+    MemorySection *allocate(Endian simulated_machine_endian);
+    // Section sharing storage with other section (copy on write)
+    MemorySection *allocate_shared(const MemorySection &other);
+    // Return section object for reuse, it must not be referenced anymore.
+    void release(MemorySection *section);
+    std::shared_ptr<byte> allocate_storage(bool zeroed);
+    void clear();
+    // Bytes of host memory held by the pool (data chunks and section objects)
+    size_t footprint() const;
+
+private:
+    struct Arena;
+    const size_t section_size;
+    std::shared_ptr<Arena> arena;
+    std::deque<MemorySection> sections;
+    std::vector<MemorySection *> free_sections;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 /// Some optimisation options
-// How big memory sections will be in bits (2^8=256 bytes)
-constexpr size_t MEMORY_SECTION_BITS = 8;
-// How big one row of lookup tree will be in bits (2^4=16)
-constexpr size_t MEMORY_TREE_BITS = 4;
+// How big memory sections will be in bits (2^12=4096 bytes)
+constexpr size_t MEMORY_SECTION_BITS = 12;
+// How big one row of lookup tree will be in bits (2^10=1024), with sections
+// above it gives two level page table
+constexpr size_t MEMORY_TREE_BITS = 10;
 //////////////////////////////////////////////////////////////////////////////
 // Size of one section
 constexpr size_t MEMORY_SECTION_SIZE = (1u << MEMORY_SECTION_BITS);
@@ -115,10 +181,18 @@ public:
     // This is dummy constructor for qt internal uses only.
     Memory();
     explicit Memory(Endian simulated_machine_endian);
+    // Copy shares sections with the original until they are written.
     Memory(const Memory &);
     ~Memory() override;
     void reset(); // Reset whole content of memory (removes old tree and creates
                   // new one)
+    /**
+     * Make content equal to given memory, sections are shared until written.
+     *
+     * When this memory was last reset from (or copied from) the same memory
+     * and that memory has not changed its sections since, only the sections
+     * written since then are reverted.
+     */
     void reset(const Memory &);
 
     // returns section containing given address
@@ -143,18 +217,61 @@ public:
 
     const union MemoryTree *get_memory_tree_root() const;
 
+    // Window of one section, changes of tree (including copy on write of a
+    // section) invalidate it.
+    DirectAccessWindow direct_access_window(Offset offset) const override;
+
+    // Bytes of host memory used to store simulated memory content
+    size_t footprint() const;
+    // Bytes of sections data, which are not shared with the other memory
+    size_t unshared_footprint(const Memory &other) const;
+
+    // Only allocated sections are stored, page aligned (see `checkpoint.h`).
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
 private:
     union MemoryTree *mt_root;
+    mutable MemorySectionPool section_pool { MEMORY_SECTION_SIZE };
+    // Last translated section, sequential accesses skip the tree walk.
+    mutable size_t last_section_index = SIZE_MAX;
+    mutable MemorySection *last_section = nullptr;
+    // Bumped on every change of tree, invalidates direct access windows.
+    mutable uint32_t tree_generation = 0;
+    // Identity of memory which is never reused (unlike its address).
+    const uint64_t memory_id = next_memory_id();
+    // Memory last used by `reset(const Memory &)` and indices of sections that
+    // do not share its storage anymore (allocated or copied on write). Section
+    // copied again after it was shared by a snapshot is listed once.
+    uint64_t cow_source_id = 0;
+    uint32_t cow_source_generation = 0;
+    mutable std::unordered_set<size_t> cow_touched;
     uint32_t change_counter = 0;
+    union MemoryTree *get_section_slot(size_t offset, bool create) const;
+    // Sections become shared with other memory, so writable direct access
+    // windows are stale. Returns the new generation.
+    uint32_t share_sections() const;
+    WriteResult write_section(Offset destination, const void *source, size_t size);
     static union MemoryTree *allocate_section_tree();
     static void free_section_tree(union MemoryTree *, size_t depth);
     static bool compare_section_tree(
         const union MemoryTree *,
         const union MemoryTree *,
         size_t depth);
-    static union MemoryTree *
-    copy_section_tree(const union MemoryTree *, size_t depth);
+    // Copy of tree sharing sections storage
+    static union MemoryTree *copy_section_tree(
+        const union MemoryTree *,
+        size_t depth,
+        MemorySectionPool &pool);
+    static bool is_empty_section_tree(const union MemoryTree *, size_t depth);
+    static size_t count_section_tree(const union MemoryTree *, size_t depth);
+    static void collect_section_tree(
+        const union MemoryTree *,
+        size_t depth,
+        size_t section_index,
+        std::vector<std::pair<size_t, const MemorySection *>> &sections);
     uint32_t get_change_counter() const;
+    static uint64_t next_memory_id();
 };
 } // namespace machine
 
@@ -37,6 +37,7 @@
 
 #include "memory/backend/peripspiled.h"
 
+#include "checkpoint.h"
 #include "common/endian.h"
 
 using namespace machine;
@@ -186,6 +187,23 @@ void PeripSpiLed::green_knob_push(bool state) {
 void PeripSpiLed::blue_knob_push(bool state) {
     knob_update_notify(state ? 1 : 0, 1, 24);
 }
+void PeripSpiLed::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(spiled_reg_led_line);
+    writer.write_u32(spiled_reg_led_rgb1);
+    writer.write_u32(spiled_reg_led_rgb2);
+    writer.write_u32(spiled_reg_led_kbdwr_direct);
+}
+
+void PeripSpiLed::restore_state(CheckpointReader &reader) {
+    spiled_reg_led_line = reader.read_u32();
+    spiled_reg_led_rgb1 = reader.read_u32();
+    spiled_reg_led_rgb2 = reader.read_u32();
+    spiled_reg_led_kbdwr_direct = reader.read_u32();
+    emit led_line_changed(spiled_reg_led_line);
+    emit led_rgb1_changed(spiled_reg_led_rgb1);
+    emit led_rgb2_changed(spiled_reg_led_rgb2);
+}
+
 LocationStatus PeripSpiLed::location_status(Offset offset) const {
     switch (offset & ~3U) {
     case SPILED_REG_LED_LINE_o: FALLTROUGH
@@ -48,6 +48,9 @@
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class PeripSpiLed final : public BackendMemory {
     Q_OBJECT
 public:
@@ -85,6 +88,10 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    // Registers written by the program, knobs stay controlled by the host.
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
 private:
     uint32_t read_reg(Offset source) const;
     bool write_reg(Offset destination, uint32_t value);
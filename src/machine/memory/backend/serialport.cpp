@@ -37,6 +37,7 @@
 
 #include "memory/backend/serialport.h"
 
+#include "checkpoint.h"
 #include "common/endian.h"
 
 using ae = machine::AccessEffects; // For enum values, type is obvious from
@@ -67,12 +68,13 @@ SerialPort::~SerialPort() = default;
 void SerialPort::pool_rx_byte() const {
     unsigned int byte = 0;
     bool available = false;
-    if (!(rx_st_reg & SERP_RX_ST_REG_READY_m)) {
+    if (!(rx_st_reg & SERP_RX_ST_REG_READY_m) && !rx_hold) {
         rx_st_reg |= SERP_RX_ST_REG_READY_m;
         emit rx_byte_pool(0, byte, available);
         if (available) {
             change_counter++;
             rx_data_reg = byte;
+            emit rx_byte_received(byte);
         } else {
             rx_st_reg &= ~SERP_RX_ST_REG_READY_m;
         }
@@ -229,6 +231,25 @@ LocationStatus SerialPort::location_status(Offset offset) const {
     }
 }
 
+void SerialPort::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(tx_st_reg);
+    writer.write_u32(rx_st_reg);
+    writer.write_u32(rx_data_reg);
+}
+
+void SerialPort::restore_state(CheckpointReader &reader) {
+    tx_st_reg = reader.read_u32();
+    rx_st_reg = reader.read_u32();
+    rx_data_reg = reader.read_u32();
+    change_counter++;
+    update_rx_irq();
+    update_tx_irq();
+}
+
+void SerialPort::set_rx_hold(bool hold) {
+    rx_hold = hold;
+}
+
 uint32_t SerialPort::get_change_counter() const {
     return change_counter;
 }
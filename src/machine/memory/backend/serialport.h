@@ -45,6 +45,9 @@
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class SerialPort : public BackendMemory {
     Q_OBJECT
 public:
@@ -54,6 +57,7 @@ public:
 signals:
     void tx_byte(unsigned int data);
     void rx_byte_pool(int fd, unsigned int &data, bool &available) const;
+    void rx_byte_received(unsigned int data) const;
     void write_notification(Offset address, uint32_t value);
     void read_notification(Offset address, uint32_t value) const;
     void signal_interrupt(uint irq_level, bool active) const;
@@ -76,6 +80,12 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    // Registers visible to the program, interrupt lines are recomputed.
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+    // Host is not asked for received bytes while held (replay of history).
+    void set_rx_hold(bool hold);
+
 private:
     uint32_t read_reg(Offset source, AccessEffects type) const;
     bool write_reg(Offset destination, uint32_t value);
@@ -95,6 +105,7 @@ private:
     mutable uint32_t rx_data_reg = { 0 };
     mutable bool tx_irq_active = false;
     mutable bool rx_irq_active = false;
+    bool rx_hold = false;
 };
 
 } // namespace machine
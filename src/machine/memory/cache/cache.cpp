@@ -37,11 +37,17 @@
 
 #include "memory/cache/cache.h"
 
+#include "checkpoint.h"
 #include "memory/cache/cache_types.h"
 
+#include <algorithm>
+
 using ae = machine::AccessEffects; // For enum values, type is obvious from
                                    // context.
 
+// Tag of invalid line, address tags are much shorter
+constexpr uint64_t INVALID_TAG = UINT64_MAX;
+
 namespace machine {
 
 Cache::Cache(
@@ -58,20 +64,20 @@ Cache::Cache(
     , access_pen_r(memory_access_penalty_r)
     , access_pen_w(memory_access_penalty_w)
     , access_pen_b(memory_access_penalty_b)
-    , replacement_policy(CachePolicy::get_policy_instance(config)) {
+    , replacement_policy(CachePolicy::get_policy_instance(config))
+    , prefetcher(CachePrefetcher::get_prefetcher_instance(config)) {
     // Skip memory allocation if cache is disabled
     if (!config->enabled()) {
         return;
     }
 
-    dt.resize(
-        config->associativity(),
-        std::vector<CacheLine>(
-            config->set_count(),
-            { .valid = false,
-              .dirty = false,
-              .tag = 0,
-              .data = std::vector<uint32_t>(config->block_size()) }));
+    const size_t line_count = config->associativity() * config->set_count();
+    line_tags.assign(line_count, INVALID_TAG);
+    line_dirty.assign(line_count, false);
+    line_data.assign(line_count * config->block_size(), 0);
+    line_changed.assign(line_count, false);
+    line_prefetched.assign(line_count, false);
+    line_prefetch_time.assign(line_count, 0);
 }
 
 Cache::~Cache() = default;
@@ -81,11 +87,15 @@ WriteResult Cache::write(
     const void *source,
     size_t size,
     WriteOptions options) {
+    if (trace != nullptr) { trace->record(TRACE_WRITE, trace_stream, destination, size); }
+    // Exclusive cache does not allocate blocks written by upper level
     if (!cache_config.enabled() || is_in_uncached_area(destination)
-        || is_in_uncached_area(destination + size)) {
+        || is_in_uncached_area(destination + size)
+        || (inclusion == MachineConfig::CI_EXCLUSIVE
+            && !is_cached(destination))) {
         mem_writes++;
-        emit memory_writes_update(mem_writes);
-        update_all_statistics();
+        stats_changed = true;
+        wait_cycles += direct_wait_cycles(size, access_pen_w);
         return mem->write(destination, source, size, options);
     }
 
@@ -97,8 +107,8 @@ WriteResult Cache::write(
 
     if (cache_config.write_policy() != CacheConfig::WP_BACK) {
         mem_writes++;
-        emit memory_writes_update(mem_writes);
-        update_all_statistics();
+        stats_changed = true;
+        wait_cycles += direct_wait_cycles(size, access_pen_w);
         return mem->write(destination, source, size, options);
     }
 
@@ -110,16 +120,23 @@ ReadResult Cache::read(
     Address source,
     size_t size,
     ReadOptions options) const {
-    if (!cache_config.enabled() || is_in_uncached_area(source)
-        || is_in_uncached_area(source + size)) {
+    const bool uncached = !cache_config.enabled() || is_in_uncached_area(source)
+                          || is_in_uncached_area(source + size);
+    // Internal read of cached area does not change any state
+    if (trace != nullptr && (uncached || options.type != ae::INTERNAL)) {
+        trace->record(TRACE_READ, trace_stream, source, size, options.type == ae::INTERNAL);
+    }
+    if (uncached) {
         mem_reads++;
-        emit memory_reads_update(mem_reads);
-        update_all_statistics();
+        stats_changed = true;
+        if (options.type != ae::INTERNAL) {
+            wait_cycles += direct_wait_cycles(size, access_pen_r);
+        }
         return mem->read(destination, source, size, options);
     }
 
     if (options.type == ae::INTERNAL) {
-        if (!(location_status(source) & LOCSTAT_CACHED)) {
+        if (!is_cached(source)) {
             mem->read(destination, source, size, options);
         } else {
             internal_read(source, destination, size);
@@ -136,6 +153,7 @@ bool Cache::is_in_uncached_area(Address source) const {
 }
 
 void Cache::flush() {
+    if (trace != nullptr) { trace->record(TRACE_SYNC, trace_stream); }
     if (!cache_config.enabled()) {
         return;
     }
@@ -144,29 +162,32 @@ void Cache::flush() {
          assoc_index += 1) {
         for (size_t set_index = 0; set_index < cache_config.set_count();
              set_index += 1) {
-            if (dt[assoc_index][set_index].valid) {
+            if (is_line_valid(line_index(assoc_index, set_index))) {
                 kick(assoc_index, set_index);
-                emit cache_update(
-                    assoc_index, set_index, 0, false, false, 0, nullptr, false);
             }
         }
     }
+    if (miss_analysis != nullptr) { miss_analysis->flush(); }
     change_counter++;
-    update_all_statistics();
+    stats_changed = true;
 }
 
 void Cache::sync() {
     flush();
 }
 
+void Cache::set_access_pc(Address pc) {
+    access_pc = pc;
+    if (trace != nullptr) { trace->set_pc(pc); }
+    mem->set_access_pc(pc);
+}
+
 void Cache::reset() {
+    if (trace != nullptr) { trace->record(TRACE_RESET, trace_stream); }
     // Set all cells to invalid
     if (cache_config.enabled()) {
-        for (auto &set : dt) {
-            for (auto &block : set) {
-                block.valid = false;
-            }
-        }
+        std::fill(line_tags.begin(), line_tags.end(), INVALID_TAG);
+        std::fill(line_prefetched.begin(), line_prefetched.end(), false);
         // Note: We don't have to zero replacement policy data as those are
         // zeroed when first used on invalid cell.
     }
@@ -179,37 +200,122 @@ void Cache::reset() {
     mem_writes = 0;
     burst_reads = 0;
     burst_writes = 0;
+    direct_reads = 0;
+    direct_writes = 0;
+    demand_accesses = 0;
+    pf_issued = 0;
+    pf_useful = 0;
+    pf_late = 0;
+    pf_useless = 0;
+    if (miss_analysis != nullptr) { miss_analysis->reset(); }
+    if (prefetcher != nullptr) { prefetcher->reset(); }
+
+    mark_all_changed();
+}
 
-    emit hit_update(get_hit_count());
-    emit miss_update(get_miss_count());
-    emit memory_reads_update(get_read_count());
-    emit memory_writes_update(get_write_count());
-    update_all_statistics();
-
+void Cache::save_state(CheckpointWriter &writer) const {
+    account_direct_accesses();
+    writer.write_u32(cache_config.enabled());
+    writer.write_u32(cache_config.set_count());
+    writer.write_u32(cache_config.block_size());
+    writer.write_u32(cache_config.associativity());
+    writer.write_u32(cache_config.replacement_policy());
+    writer.write_u32(cache_config.prefetch_policy());
+    writer.write_u32(cache_config.write_policy());
+    writer.write_u32(inclusion);
+    for (uint32_t counter :
+         { hit_read, miss_read, hit_write, miss_write, mem_reads, mem_writes, burst_reads,
+           burst_writes }) {
+        writer.write_u32(counter);
+    }
+    // Disabled cache has no lines
+    const size_t way_count = cache_config.enabled() ? cache_config.associativity() : 0;
+    for (size_t way = 0; way < way_count; way++) {
+        for (size_t row = 0; row < cache_config.set_count(); row++) {
+            const size_t index = line_index(way, row);
+            const bool valid = is_line_valid(index);
+            writer.write_bool(valid);
+            writer.write_bool(line_dirty[index]);
+            writer.write_u64(valid ? line_tags[index] : 0);
+            const uint32_t *data = get_line_data(index);
+            for (size_t col = 0; col < cache_config.block_size(); col++) {
+                writer.write_u32(data[col]);
+            }
+        }
+    }
     if (cache_config.enabled()) {
-        for (size_t assoc_index = 0; assoc_index < cache_config.associativity();
-             assoc_index++) {
-            for (size_t set_index = 0; set_index < cache_config.set_count();
-                 set_index++) {
-                emit cache_update(
-                    assoc_index, set_index, 0, false, false, 0, nullptr, false);
+        replacement_policy->save_state(writer);
+    }
+    if (prefetcher != nullptr) {
+        for (uint32_t counter :
+             { demand_accesses, pf_issued, pf_useful, pf_late, pf_useless }) {
+            writer.write_u32(counter);
+        }
+        for (size_t index = 0; index < line_tags.size(); index++) {
+            writer.write_bool(line_prefetched[index]);
+            writer.write_u32(line_prefetch_time[index]);
+        }
+        prefetcher->save_state(writer);
+    }
+}
+
+void Cache::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(cache_config.enabled(), "cache enabled");
+    reader.expect_u32(cache_config.set_count(), "cache set count");
+    reader.expect_u32(cache_config.block_size(), "cache block size");
+    reader.expect_u32(cache_config.associativity(), "cache associativity");
+    reader.expect_u32(cache_config.replacement_policy(), "cache replacement policy");
+    reader.expect_u32(cache_config.prefetch_policy(), "cache prefetch policy");
+    reader.expect_u32(cache_config.write_policy(), "cache write policy");
+    reader.expect_u32(inclusion, "cache inclusion policy");
+    for (uint32_t *counter :
+         { &hit_read, &miss_read, &hit_write, &miss_write, &mem_reads, &mem_writes, &burst_reads,
+           &burst_writes }) {
+        *counter = reader.read_u32();
+    }
+    direct_reads = 0;
+    direct_writes = 0;
+    const size_t way_count = cache_config.enabled() ? cache_config.associativity() : 0;
+    for (size_t way = 0; way < way_count; way++) {
+        for (size_t row = 0; row < cache_config.set_count(); row++) {
+            const size_t index = line_index(way, row);
+            const bool valid = reader.read_bool();
+            line_dirty[index] = reader.read_bool();
+            const uint64_t tag = reader.read_u64();
+            line_tags[index] = valid ? tag : INVALID_TAG;
+            uint32_t *data = get_line_data(index);
+            for (size_t col = 0; col < cache_config.block_size(); col++) {
+                data[col] = reader.read_u32();
             }
         }
     }
+    if (cache_config.enabled()) {
+        replacement_policy->restore_state(reader);
+    }
+    if (prefetcher != nullptr) {
+        for (uint32_t *counter :
+             { &demand_accesses, &pf_issued, &pf_useful, &pf_late, &pf_useless }) {
+            *counter = reader.read_u32();
+        }
+        for (size_t index = 0; index < line_tags.size(); index++) {
+            line_prefetched[index] = reader.read_bool();
+            line_prefetch_time[index] = reader.read_u32();
+        }
+        prefetcher->restore_state(reader);
+    }
+    change_counter++;
+
+    mark_all_changed();
 }
 
 void Cache::internal_read(Address source, void *destination, size_t size) const {
     CacheLocation loc = compute_location(source);
-    for (size_t assoc_index = 0; assoc_index < cache_config.associativity();
-         assoc_index++) {
-        if (dt[assoc_index][loc.row].valid
-            && dt[assoc_index][loc.row].tag == loc.tag) {
-            memcpy(
-                destination,
-                (byte *)&dt[assoc_index][loc.row].data[loc.col] + loc.byte,
-                size);
-            return;
-        }
+    const size_t way = find_block_index(loc);
+    if (way < cache_config.associativity()) {
+        memcpy(
+            destination,
+            (byte *)&get_line_data(line_index(way, loc.row))[loc.col] + loc.byte, size);
+        return;
     }
     memset(destination, 0, size); // TODO is this correct
 }
@@ -222,10 +328,10 @@ bool Cache::access(
     const CacheLocation loc = compute_location(address);
     size_t way = find_block_index(loc);
 
-    // check for zero because else last_affected_col can became
-    // ULONG_MAX / BLOCK_ITEM_SIZE and update can take forever
+    // Zero sized access touches no line
     if (size == 0)
         return false;
+    demand_accesses++;
 
     // search failed - cache miss
     if (way >= cache_config.associativity()) {
@@ -234,8 +340,11 @@ bool Cache::access(
         if (access_type == WRITE
             && cache_config.write_policy() == CacheConfig::WP_THROUGH_NOALLOC) {
             miss_write++;
-            emit miss_update(get_miss_count());
-            update_all_statistics();
+            stats_changed = true;
+            if (miss_analysis != nullptr) {
+                miss_analysis->access(block_number(loc), true, false, access_pc);
+            }
+            if (prefetcher != nullptr) { run_prefetcher(address, true, false); }
 
             const size_t size_overflow
                 = calculate_overflow_to_next_blocks(size, loc);
@@ -258,42 +367,35 @@ bool Cache::access(
             "Probably unimplemented replacement policy");
     }
 
-    struct CacheLine &cd = dt[way][loc.row];
+    const size_t index = line_index(way, loc.row);
+    uint32_t *const cd_data = get_line_data(index);
+    const bool miss = !is_line_valid(index);
+    bool prefetch_hit = false;
+
+    if (miss_analysis != nullptr) {
+        miss_analysis->access(block_number(loc), miss, true, access_pc);
+    }
 
     // Update statistics and otherwise read from memory
-    if (cd.valid) {
+    if (!miss) {
         if (access_type == WRITE) {
             hit_write++;
         } else {
             hit_read++;
         }
-        emit hit_update(get_hit_count());
-        update_all_statistics();
+        prefetch_hit = use_prefetched_line(index);
+        stats_changed = true;
     } else {
         if (access_type == WRITE) {
             miss_write++;
         } else {
             miss_read++;
         }
-        emit miss_update(get_miss_count());
-
-        mem->read(
-            cd.data.data(), calc_base_address(loc.tag, loc.row),
-            cache_config.block_size() * BLOCK_ITEM_SIZE,
-            { .type = ae::REGULAR });
-
-        cd.valid = true;
-        cd.dirty = false;
-        cd.tag = loc.tag;
-
-        change_counter += cache_config.block_size();
-        mem_reads += cache_config.block_size();
-        burst_reads += cache_config.block_size() - 1;
-        emit memory_reads_update(mem_reads);
-        update_all_statistics();
+        fill_line(index, loc);
+        wait_cycles += transfer_cycles(cache_config.block_size(), access_pen_r);
     }
 
-    replacement_policy->update_stats(way, loc.row, cd.valid);
+    replacement_policy->update_stats(way, loc.row, true);
 
     const size_t size_overflow = calculate_overflow_to_next_blocks(size, loc);
     const size_t size_within_block = size - size_overflow;
@@ -301,27 +403,26 @@ bool Cache::access(
     bool changed = false;
 
     if (access_type == READ) {
-        memcpy(buffer, (byte *)&cd.data[loc.col] + loc.byte, size_within_block);
+        memcpy(buffer, (byte *)&cd_data[loc.col] + loc.byte, size_within_block);
     } else if (access_type == WRITE) {
-        cd.dirty = true;
+        line_dirty[index] = true;
         changed = memcmp(
-                      (byte *)&cd.data[loc.col] + loc.byte, buffer,
+                      (byte *)&cd_data[loc.col] + loc.byte, buffer,
                       size_within_block)
                   != 0;
         if (changed) {
             memcpy(
-                ((byte *)&cd.data[loc.col]) + loc.byte, buffer,
+                ((byte *)&cd_data[loc.col]) + loc.byte, buffer,
                 size_within_block);
             change_counter++;
         }
     }
-    const auto last_affected_col
-        = (loc.col * BLOCK_ITEM_SIZE + loc.byte + size_within_block - 1) / BLOCK_ITEM_SIZE;
-    for (auto col = loc.col; col <= last_affected_col; col++) {
-        emit cache_update(
-            way, loc.row, col, cd.valid, cd.dirty, cd.tag, cd.data.data(),
-            access_type);
-    }
+    mark_line_changed(index);
+    last_line = index;
+    last_col = loc.col;
+    last_write = access_type == WRITE;
+
+    if (prefetcher != nullptr) { run_prefetcher(address, miss, prefetch_hit); }
 
     if (size_overflow > 0) {
         // If access overlaps single cache row, perform access to next row.
@@ -342,36 +443,264 @@ size_t Cache::calculate_overflow_to_next_blocks(
 }
 
 size_t Cache::find_block_index(const CacheLocation &loc) const {
-    uint32_t index = 0;
-    while (
-        index < cache_config.associativity()
-        and (!dt[index][loc.row].valid or dt[index][loc.row].tag != loc.tag)) {
-        index++;
+    const size_t associativity = cache_config.associativity();
+    const uint64_t *tags = &line_tags[line_index(0, loc.row)];
+    // Valid tags in a set are unique, so the loop without early exit sums
+    // index of at most one matching way. Compiler vectorizes it for high
+    // associativity.
+    size_t match_way = 0;
+    size_t matches = 0;
+    for (size_t way = 0; way < associativity; way++) {
+        const bool match = tags[way] == loc.tag;
+        match_way += match ? way : 0;
+        matches += match;
     }
-    return index;
+    return matches != 0 ? match_way : associativity;
+}
+
+size_t Cache::line_index(size_t way, size_t row) const {
+    return row * cache_config.associativity() + way;
+}
+
+bool Cache::is_line_valid(size_t index) const {
+    return line_tags[index] != INVALID_TAG;
+}
+
+uint32_t *Cache::get_line_data(size_t index) const {
+    return &line_data[index * cache_config.block_size()];
 }
 
 void Cache::kick(size_t way, size_t row) const {
-    struct CacheLine &cd = dt[way][row];
-    if (cd.dirty && cache_config.write_policy() == CacheConfig::WP_BACK) {
+    const size_t index = line_index(way, row);
+    const bool write_back = cache_config.write_policy() == CacheConfig::WP_BACK;
+    if (is_line_valid(index)) {
+        const Address base = calc_base_address(line_tags[index], row);
+        // Upper levels write their dirty copies back into this line first
+        for (Cache *upper : inclusive_upper_levels) {
+            upper->invalidate_range(base, cache_config.block_size() * BLOCK_ITEM_SIZE);
+        }
+        if (exclusive_lower != nullptr) {
+            exclusive_lower->fill_victim(
+                base, get_line_data(index), line_dirty[index] && write_back);
+            line_dirty[index] = false;
+        }
+        if (line_prefetched[index]) {
+            line_prefetched[index] = false;
+            pf_useless++;
+        }
+    }
+    if (line_dirty[index] && write_back) {
         mem->write(
-            calc_base_address(cd.tag, row), cd.data.data(),
+            calc_base_address(line_tags[index], row), get_line_data(index),
             cache_config.block_size() * BLOCK_ITEM_SIZE, {});
+        wait_cycles += transfer_cycles(cache_config.block_size(), access_pen_w);
         mem_writes += cache_config.block_size();
         burst_writes += cache_config.block_size() - 1;
-        emit memory_writes_update(mem_writes);
+        stats_changed = true;
     }
-    cd.valid = false;
-    cd.dirty = false;
+    line_tags[index] = INVALID_TAG;
+    line_dirty[index] = false;
+    mark_line_changed(index);
 
     change_counter++;
 
     replacement_policy->update_stats(way, row, false);
 }
 
-void Cache::update_all_statistics() const {
-    emit statistics_update(
-        get_stall_count(), get_speed_improvement(), get_hit_rate());
+void Cache::fill_line(size_t index, const CacheLocation &loc) const {
+    const Address base = calc_base_address(loc.tag, loc.row);
+    const size_t block_bytes = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    if (exclusive_lower != nullptr) {
+        exclusive_lower->take_block(get_line_data(index), base, block_bytes);
+    } else {
+        mem->read(get_line_data(index), base, block_bytes, { .type = ae::REGULAR });
+    }
+
+    line_tags[index] = loc.tag;
+    line_dirty[index] = false;
+
+    change_counter += cache_config.block_size();
+    mem_reads += cache_config.block_size();
+    burst_reads += cache_config.block_size() - 1;
+    stats_changed = true;
+}
+
+void Cache::run_prefetcher(Address address, bool miss, bool prefetch_hit) const {
+    prefetch_blocks.clear();
+    prefetcher->access(
+        address.get_raw(), miss, prefetch_hit, access_pc.get_raw(), prefetch_blocks);
+    for (uint64_t block : prefetch_blocks) {
+        prefetch_block(block);
+    }
+}
+
+// First demand use of prefetched line, returns whether it was prefetched
+bool Cache::use_prefetched_line(size_t index) const {
+    if (!line_prefetched[index]) {
+        return false;
+    }
+    line_prefetched[index] = false;
+    pf_useful++;
+    // Memory would not deliver the whole block before this access
+    const uint32_t fill_time = transfer_cycles(cache_config.block_size(), access_pen_r);
+    const uint32_t elapsed = demand_accesses - line_prefetch_time[index];
+    if (elapsed < fill_time) {
+        pf_late++;
+        wait_cycles += fill_time - elapsed;
+    }
+    return true;
+}
+
+/**
+ * Fill block the same way as demand miss does, so the read is charged to
+ * memory statistics. Blocks already present, out of address space or
+ * uncached are skipped.
+ */
+void Cache::prefetch_block(uint64_t block) const {
+    const uint64_t block_bytes = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    if (block >= (UINT64_C(1) << 32) / block_bytes) {
+        return;
+    }
+    const Address base(block * block_bytes);
+    if (is_in_uncached_area(base) || is_in_uncached_area(base + (block_bytes - 1))) {
+        return;
+    }
+    const CacheLocation loc = compute_location(base);
+    if (find_block_index(loc) < cache_config.associativity()) {
+        return;
+    }
+
+    // Prefetch proceeds in background, demand accesses do not wait for it
+    const uint64_t wait_start = get_wait_cycles();
+    const size_t way = replacement_policy->select_way_to_evict(loc.row);
+    kick(way, loc.row);
+    const size_t index = line_index(way, loc.row);
+    fill_line(index, loc);
+    hidden_wait_cycles += get_wait_cycles() - wait_start;
+    replacement_policy->update_stats(way, loc.row, true);
+    line_prefetched[index] = true;
+    line_prefetch_time[index] = demand_accesses;
+    pf_issued++;
+    mark_line_changed(index);
+}
+
+void Cache::invalidate_range(Address start, size_t size) const {
+    if (!cache_config.enabled()) {
+        return;
+    }
+    const size_t block_bytes = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    for (size_t offset = 0; offset < size; offset += block_bytes) {
+        const CacheLocation loc = compute_location(start + offset);
+        const size_t way = find_block_index(loc);
+        if (way < cache_config.associativity()) {
+            kick(way, loc.row);
+        }
+    }
+}
+
+/**
+ * Miss of upper level in exclusive hierarchy. Found block moves up (dirty
+ * data are written back to keep single owner simple), missing block is read
+ * from memory without allocation.
+ */
+void Cache::take_block(void *destination, Address address, size_t size) const {
+    const CacheLocation loc = compute_location(address);
+    const size_t way = find_block_index(loc);
+    const bool miss = way >= cache_config.associativity();
+    bool prefetch_hit = false;
+    demand_accesses++;
+    if (!miss) {
+        const size_t index = line_index(way, loc.row);
+        hit_read++;
+        memcpy(destination, get_line_data(index), size);
+        prefetch_hit = use_prefetched_line(index);
+        kick(way, loc.row);
+    } else {
+        miss_read++;
+        mem->read(destination, address, size, { .type = ae::REGULAR });
+        wait_cycles += transfer_cycles(size / BLOCK_ITEM_SIZE, access_pen_r);
+        mem_reads += size / BLOCK_ITEM_SIZE;
+        burst_reads += size / BLOCK_ITEM_SIZE - 1;
+    }
+    stats_changed = true;
+    if (prefetcher != nullptr) { run_prefetcher(address, miss, prefetch_hit); }
+}
+
+// Block evicted from upper level in exclusive hierarchy
+void Cache::fill_victim(Address address, const uint32_t *data, bool dirty) const {
+    const CacheLocation loc = compute_location(address);
+    size_t way = find_block_index(loc);
+    if (way >= cache_config.associativity()) {
+        way = replacement_policy->select_way_to_evict(loc.row);
+        kick(way, loc.row);
+    }
+    const size_t index = line_index(way, loc.row);
+    memcpy(get_line_data(index), data, cache_config.block_size() * BLOCK_ITEM_SIZE);
+    if (dirty && cache_config.write_policy() != CacheConfig::WP_BACK) {
+        mem->write(address, data, cache_config.block_size() * BLOCK_ITEM_SIZE, {});
+        wait_cycles += transfer_cycles(cache_config.block_size(), access_pen_w);
+        mem_writes += cache_config.block_size();
+        burst_writes += cache_config.block_size() - 1;
+        dirty = false;
+    }
+    line_tags[index] = loc.tag;
+    line_dirty[index] = line_dirty[index] || dirty;
+    line_prefetched[index] = false;
+    replacement_policy->update_stats(way, loc.row, true);
+
+    change_counter += cache_config.block_size();
+    stats_changed = true;
+    mark_line_changed(index);
+}
+
+void Cache::mark_line_changed(size_t index) const {
+    if (!line_changed[index]) {
+        line_changed[index] = true;
+        changed_lines.push_back(index);
+    }
+}
+
+void Cache::mark_all_changed() const {
+    for (size_t index = 0; index < line_tags.size(); index++) {
+        mark_line_changed(index);
+    }
+    stats_changed = true;
+}
+
+void Cache::emit_line_update(size_t index, size_t col, bool write) const {
+    const size_t associativity = cache_config.associativity();
+    const bool valid = is_line_valid(index);
+    emit cache_update(
+        index % associativity, index / associativity, col, valid, line_dirty[index],
+        valid ? line_tags[index] : 0, get_line_data(index), write);
+}
+
+void Cache::publish_updates() const {
+    account_direct_accesses();
+    if (stats_changed) {
+        stats_changed = false;
+        emit hit_update(get_hit_count());
+        emit miss_update(get_miss_count());
+        emit memory_reads_update(get_read_count());
+        emit memory_writes_update(get_write_count());
+        emit statistics_update(get_stall_count(), get_speed_improvement(), get_hit_rate());
+    }
+    for (size_t index : changed_lines) {
+        line_changed[index] = false;
+        if (index != last_line) {
+            emit_line_update(index, 0, false);
+        }
+    }
+    changed_lines.clear();
+    // Last accessed line goes last, views highlight it
+    if (last_line != SIZE_MAX) {
+        emit_line_update(last_line, last_col, last_write);
+        last_line = SIZE_MAX;
+    }
+}
+
+uint64_t Cache::block_number(const CacheLocation &loc) const {
+    return loc.tag * cache_config.set_count() + loc.row;
 }
 
 Address Cache::calc_base_address(size_t tag, size_t row) const {
@@ -399,21 +728,23 @@ CacheLocation Cache::compute_location(Address address) const {
              .byte = byte };
 }
 
+// Only lines of this cache, lower levels are not considered
+bool Cache::is_cached(Address address) const {
+    return cache_config.enabled()
+           && find_block_index(compute_location(address)) < cache_config.associativity();
+}
+
 enum LocationStatus Cache::location_status(Address address) const {
     const CacheLocation loc = compute_location(address);
 
     if (cache_config.enabled()) {
-        for (auto const &set : dt) {
-            auto const &block = set[loc.row];
-
-            if (block.valid && block.tag == loc.tag) {
-                if (block.dirty
-                    && cache_config.write_policy() == CacheConfig::WP_BACK) {
-                    return (enum LocationStatus)(
-                        LOCSTAT_CACHED | LOCSTAT_DIRTY);
-                } else {
-                    return LOCSTAT_CACHED;
-                }
+        const size_t way = find_block_index(loc);
+        if (way < cache_config.associativity()) {
+            if (line_dirty[line_index(way, loc.row)]
+                && cache_config.write_policy() == CacheConfig::WP_BACK) {
+                return (enum LocationStatus)(LOCSTAT_CACHED | LOCSTAT_DIRTY);
+            } else {
+                return LOCSTAT_CACHED;
             }
         }
     }
@@ -424,10 +755,84 @@ const CacheConfig &Cache::get_config() const {
     return cache_config;
 }
 
+void Cache::set_miss_analysis(bool enable) {
+    if (!enable) {
+        miss_analysis.reset();
+    } else if (miss_analysis == nullptr && cache_config.enabled()) {
+        miss_analysis.reset(new CacheMissAnalysis(
+            cache_config.associativity() * cache_config.set_count()));
+    }
+}
+
+const CacheMissAnalysis *Cache::get_miss_analysis() const {
+    return miss_analysis.get();
+}
+
+void Cache::add_upper_level(Cache *upper, MachineConfig::CacheInclusion inclusion) {
+    this->inclusion = inclusion;
+    if (inclusion == MachineConfig::CI_INCLUSIVE) {
+        inclusive_upper_levels.push_back(upper);
+    } else if (inclusion == MachineConfig::CI_EXCLUSIVE) {
+        upper->exclusive_lower = this;
+    }
+}
+
+void Cache::set_trace(MemoryTraceWriter *trace, MemoryTraceStream stream) {
+    this->trace = trace;
+    trace_stream = stream;
+    // Traced accesses have to take the regular path
+    invalidate_direct_access();
+}
+
+DirectAccessWindow Cache::direct_access_window(Address address) const {
+    if (cache_config.enabled() || trace != nullptr) {
+        return FrontendMemory::direct_access_window(address);
+    }
+    DirectAccessWindow window = mem->direct_access_window(address);
+    if (window.read_counter != nullptr) {
+        // Window counts accesses of another disabled cache
+        return FrontendMemory::direct_access_window(address);
+    }
+    window.read_counter = &direct_reads;
+    window.write_counter = &direct_writes;
+    return window;
+}
+
+void Cache::account_direct_accesses() const {
+    if (direct_reads == 0 && direct_writes == 0) {
+        return;
+    }
+    mem_reads += direct_reads;
+    mem_writes += direct_writes;
+    wait_cycles += (uint64_t)direct_reads * direct_wait_cycles(BLOCK_ITEM_SIZE, access_pen_r)
+                   + (uint64_t)direct_writes * direct_wait_cycles(BLOCK_ITEM_SIZE, access_pen_w);
+    direct_reads = 0;
+    direct_writes = 0;
+    stats_changed = true;
+}
+
 uint32_t Cache::get_change_counter() const {
     return change_counter;
 }
 
+uint64_t Cache::get_wait_cycles() const {
+    account_direct_accesses();
+    // Memory with latency model reports time of the transfers itself
+    const uint64_t own_wait_cycles = mem->has_latency_model() ? 0 : wait_cycles;
+    return own_wait_cycles + mem->get_wait_cycles() - hidden_wait_cycles;
+}
+
+uint32_t Cache::transfer_cycles(size_t words, uint32_t penalty) const {
+    const uint32_t burst_pen = access_pen_b != 0 ? access_pen_b : penalty;
+    return penalty + (words - 1) * burst_pen;
+}
+
+uint32_t Cache::direct_wait_cycles(size_t size, uint32_t penalty) const {
+    const size_t words = std::max((size + BLOCK_ITEM_SIZE - 1) / BLOCK_ITEM_SIZE, (size_t)1);
+    // The access itself takes the cycle of cache access
+    return std::max(transfer_cycles(words, penalty), 1u) - 1;
+}
+
 uint32_t Cache::get_hit_count() const {
     return hit_read + hit_write;
 }
@@ -437,14 +842,17 @@ uint32_t Cache::get_miss_count() const {
 }
 
 uint32_t Cache::get_read_count() const {
+    account_direct_accesses();
     return mem_reads;
 }
 
 uint32_t Cache::get_write_count() const {
+    account_direct_accesses();
     return mem_writes;
 }
 
 uint32_t Cache::get_stall_count() const {
+    account_direct_accesses();
     uint32_t st_cycles
         = mem_reads * (access_pen_r - 1) + mem_writes * (access_pen_w - 1);
     st_cycles += (miss_read + miss_write) * cache_config.block_size();
@@ -456,6 +864,7 @@ uint32_t Cache::get_stall_count() const {
 }
 
 double Cache::get_speed_improvement() const {
+    account_direct_accesses();
     uint32_t lookup_time;
     uint32_t mem_access_time;
     uint32_t comp = hit_read + hit_write + miss_read + miss_write;
@@ -476,6 +885,45 @@ double Cache::get_speed_improvement() const {
         / (double)(lookup_time + mem_access_time) * 100);
 }
 
+uint32_t Cache::get_prefetch_count() const {
+    return pf_issued;
+}
+
+uint32_t Cache::get_prefetch_useful_count() const {
+    return pf_useful;
+}
+
+uint32_t Cache::get_prefetch_late_count() const {
+    return pf_late;
+}
+
+uint32_t Cache::get_prefetch_useless_count() const {
+    return pf_useless;
+}
+
+double Cache::get_prefetch_accuracy() const {
+    if (pf_issued == 0) {
+        return 0.0;
+    }
+    return (double)pf_useful / (double)pf_issued * 100.0;
+}
+
+double Cache::get_prefetch_coverage() const {
+    // Each useful prefetch turned a miss into a hit
+    const uint32_t comp = pf_useful + get_miss_count();
+    if (comp == 0) {
+        return 0.0;
+    }
+    return (double)pf_useful / (double)comp * 100.0;
+}
+
+double Cache::get_prefetch_timeliness() const {
+    if (pf_useful == 0) {
+        return 0.0;
+    }
+    return (double)(pf_useful - pf_late) / (double)pf_useful * 100.0;
+}
+
 double Cache::get_hit_rate() const {
     uint32_t comp = hit_read + hit_write + miss_read + miss_write;
     if (comp == 0) {
@@ -39,12 +39,16 @@
 #define CACHE_H
 
 #include "machineconfig.h"
+#include "memory/cache/cache_miss_analysis.h"
 #include "memory/cache/cache_policy.h"
+#include "memory/cache/cache_prefetcher.h"
 #include "memory/cache/cache_types.h"
 #include "memory/frontend_memory.h"
+#include "memory/memory_trace.h"
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace machine {
 
@@ -81,9 +85,9 @@ public:
      * @param memory_access_penalty_b   cycles to perform burst access (stats
      *                                  only)
      *
-     * NOTE: Memory access penalties apply only to statistics and are not taken
-     * into account during simulation itself. There is no point in doing so
-     * without superscalar execution.
+     * NOTE: Memory access penalties apply to statistics and to wait cycles
+     * (see `get_wait_cycles`). Core takes the wait cycles into account only
+     * when memory stalls are enabled.
      */
     Cache(
         FrontendMemory *memory,
@@ -108,8 +112,20 @@ public:
 
     uint32_t get_change_counter() const override;
 
+    /**
+     * Misses wait for the whole block (burst penalty applies to the words
+     * following the first one), so do write backs. Uncached and write
+     * through accesses wait for the words accessed less the cycle of the
+     * cache access itself. Prefetch fills do not wait, demand access to
+     * block still being prefetched (see `get_prefetch_late_count`) waits
+     * for the rest of the fill. Access penalties are not used when the next
+     * level has its own latency model (see `Dram`), only its waits count.
+     */
+    uint64_t get_wait_cycles() const override;
+
     void flush();         // flush cache
     void sync() override; // Same as flush
+    void set_access_pc(Address pc) override;
 
     uint32_t get_hit_count() const;       // Number of recorded hits
     uint32_t get_miss_count() const;      // Number of recorded misses
@@ -121,13 +137,66 @@ public:
                                           // comare with no used cache
     double get_hit_rate() const;          // Usage efficiency in percents
 
+    /**
+     * Prefetch statistics. Useful prefetch filled a block later used by
+     * demand access, useless one was evicted unused. Late prefetch was used
+     * sooner after its issue (counted in demand accesses to this cache) than
+     * memory would deliver the block. This is only a proxy, as the cache
+     * itself has no notion of time.
+     */
+    uint32_t get_prefetch_count() const;    // Number of prefetched blocks
+    uint32_t get_prefetch_useful_count() const;
+    uint32_t get_prefetch_late_count() const;
+    uint32_t get_prefetch_useless_count() const;
+    double get_prefetch_accuracy() const;   // Useful of issued in percents
+    double get_prefetch_coverage() const;   // Misses avoided in percents
+    double get_prefetch_timeliness() const; // Not late of useful in percents
+
     void reset(); // Reset whole state of cache
 
+    // Lines, statistics and replacement policy state
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
     const CacheConfig &get_config() const;
 
+    /**
+     * Emit changes accumulated since the last call: statistics signals once
+     * and `cache_update` once per changed line, the last accessed line is the
+     * last one. Cache itself emits nothing, owner calls this once per frame of
+     * visualization (see `Machine`), so runs without views pay only for
+     * marking of changed lines.
+     */
+    void publish_updates() const;
+
+    /**
+     * Make this cache the next level of `upper` cache, which has to use this
+     * cache as its backing memory. Inclusive cache invalidates blocks it
+     * evicts in upper caches (its block size must not be smaller). Exclusive
+     * cache (with the same block size) receives blocks evicted from upper
+     * caches and gives its block away on their miss, blocks missing in both
+     * levels and writes missing this level go directly to memory.
+     */
+    void add_upper_level(Cache *upper, MachineConfig::CacheInclusion inclusion);
+
+    // Record all accesses, flushes and resets to trace (nullptr disables)
+    void set_trace(MemoryTraceWriter *trace, MemoryTraceStream stream);
+
+    // Classify misses and attribute them to instructions (off by default)
+    void set_miss_analysis(bool enable);
+    // Analysis of misses since enabled or reset, nullptr when disabled
+    const CacheMissAnalysis *get_miss_analysis() const;
+
     enum LocationStatus location_status(Address address) const override;
 
+    /**
+     * Disabled cache passes window of the next level through, untraced
+     * accesses through it are only counted (see `account_direct_accesses`).
+     */
+    DirectAccessWindow direct_access_window(Address address) const override;
+
 signals:
+    // Emitted only from `publish_updates`
     void hit_update(uint32_t) const;
     void miss_update(uint32_t) const;
     void statistics_update(
@@ -153,12 +222,51 @@ private:
     const Address uncached_last;
     const uint32_t access_pen_r, access_pen_w, access_pen_b;
     const std::unique_ptr<CachePolicy> replacement_policy;
+    MemoryTraceWriter *trace = nullptr;
+    MemoryTraceStream trace_stream = TRACE_DATA;
+    std::unique_ptr<CacheMissAnalysis> miss_analysis;
+    const std::unique_ptr<CachePrefetcher> prefetcher;
+    Address access_pc = Address::null();
+    MachineConfig::CacheInclusion inclusion = MachineConfig::CI_NINE;
+    std::vector<Cache *> inclusive_upper_levels;
+    // Lower level cache in exclusive relation
+    Cache *exclusive_lower = nullptr;
+
+    /**
+     * Cache lines in structure of arrays layout. Line of `way` in set `row`
+     * has index `row * associativity + way` (see `line_index`), so tags of a
+     * set are contiguous and compared at once. Invalid line has tag
+     * `INVALID_TAG`, that never matches any address. Data of the line are
+     * `block_size` words from `line_index * block_size` in `line_data`.
+     */
+    mutable std::vector<uint64_t> line_tags;
+    mutable std::vector<uint8_t> line_dirty;
+    mutable std::vector<uint32_t> line_data;
+    // Line filled by prefetch and not used yet, demand access count at fill
+    mutable std::vector<uint8_t> line_prefetched;
+    mutable std::vector<uint32_t> line_prefetch_time;
 
-    mutable std::vector<std::vector<CacheLine>> dt;
+    // Changes not published yet (see `publish_updates`)
+    mutable std::vector<uint8_t> line_changed;
+    mutable std::vector<size_t> changed_lines;
+    mutable bool stats_changed = false;
+    mutable size_t last_line = SIZE_MAX, last_col = 0;
+    mutable bool last_write = false;
 
     mutable uint32_t hit_read = 0, miss_read = 0, hit_write = 0, miss_write = 0,
                      mem_reads = 0, mem_writes = 0, burst_reads = 0,
                      burst_writes = 0, change_counter = 0;
+    mutable uint32_t demand_accesses = 0, pf_issued = 0, pf_useful = 0, pf_late = 0,
+                     pf_useless = 0;
+    // Reused to avoid allocation per access
+    mutable std::vector<uint64_t> prefetch_blocks;
+    // Waits of this cache and waits of the next level caused by prefetches
+    mutable uint64_t wait_cycles = 0, hidden_wait_cycles = 0;
+    // Accesses of disabled cache through direct access window
+    mutable uint32_t direct_reads = 0, direct_writes = 0;
+
+    // Add direct accesses to memory access counts and wait cycles
+    void account_direct_accesses() const;
 
     void internal_read(Address source, void *destination, size_t size) const;
 
@@ -169,10 +277,32 @@ private:
         AccessType access_type) const;
 
     void kick(size_t way, size_t row) const;
+    // Cycles to transfer `words` from/to the next level
+    uint32_t transfer_cycles(size_t words, uint32_t penalty) const;
+    // Wait of access of `size` bytes bypassing the cache
+    uint32_t direct_wait_cycles(size_t size, uint32_t penalty) const;
+    // Read block of `loc` from the next level into the line
+    void fill_line(size_t index, const CacheLocation &loc) const;
+
+    void run_prefetcher(Address address, bool miss, bool prefetch_hit) const;
+    void prefetch_block(uint64_t block) const;
+    bool use_prefetched_line(size_t index) const;
+
+    // Cache hierarchy (see `add_upper_level`)
+    void invalidate_range(Address start, size_t size) const;
+    void take_block(void *destination, Address address, size_t size) const;
+    void fill_victim(Address address, const uint32_t *data, bool dirty) const;
+
+    size_t line_index(size_t way, size_t row) const;
+    bool is_line_valid(size_t index) const;
+    uint32_t *get_line_data(size_t index) const;
 
     Address calc_base_address(size_t tag, size_t row) const;
+    uint64_t block_number(const CacheLocation &loc) const;
 
-    void update_all_statistics() const;
+    void mark_line_changed(size_t index) const;
+    void mark_all_changed() const;
+    void emit_line_update(size_t index, size_t col, bool write) const;
 
     CacheLocation compute_location(Address address) const;
 
@@ -186,6 +316,7 @@ private:
     size_t find_block_index(const CacheLocation &loc) const;
 
     bool is_in_uncached_area(Address source) const;
+    bool is_cached(Address address) const;
 
     /**
      * RW access to cache may span multiple blocks but it needs to be
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/cache/cache_miss_analysis.h"
+
+namespace machine {
+
+uint32_t CacheMissCounts::total() const {
+    uint32_t sum = 0;
+    for (uint32_t c : count) {
+        sum += c;
+    }
+    return sum;
+}
+
+CacheMissAnalysis::CacheMissAnalysis(size_t line_count) : line_count(line_count) {}
+
+void CacheMissAnalysis::access(uint64_t block, bool miss, bool allocate, Address pc) {
+    const bool first_access = seen_blocks.insert(block).second;
+    const bool shadow_hit = shadow_access(block, allocate);
+    if (!miss) {
+        return;
+    }
+
+    CacheMissKind kind;
+    if (first_access) {
+        kind = MISS_COMPULSORY;
+    } else if (!shadow_hit) {
+        kind = MISS_CAPACITY;
+    } else {
+        kind = MISS_CONFLICT;
+    }
+    misses.count[kind]++;
+    pc_misses[pc.get_raw()].count[kind]++;
+}
+
+/**
+ * Moves block to the front of the shadow cache, missing block is inserted
+ * there and the least recently used block is evicted when full.
+ */
+bool CacheMissAnalysis::shadow_access(uint64_t block, bool allocate) {
+    auto it = lru_index.find(block);
+    if (it != lru_index.end()) {
+        lru_blocks.splice(lru_blocks.begin(), lru_blocks, it->second);
+        return true;
+    }
+    if (!allocate || line_count == 0) {
+        return false;
+    }
+    if (lru_blocks.size() >= line_count) {
+        lru_index.erase(lru_blocks.back());
+        lru_blocks.pop_back();
+    }
+    lru_blocks.push_front(block);
+    lru_index.emplace(block, lru_blocks.begin());
+    return false;
+}
+
+void CacheMissAnalysis::flush() {
+    lru_blocks.clear();
+    lru_index.clear();
+}
+
+void CacheMissAnalysis::reset() {
+    flush();
+    seen_blocks.clear();
+    misses = CacheMissCounts();
+    pc_misses.clear();
+}
+
+uint32_t CacheMissAnalysis::get_miss_count(CacheMissKind kind) const {
+    return misses.count[kind];
+}
+
+const std::unordered_map<uint64_t, CacheMissCounts> &CacheMissAnalysis::get_pc_misses() const {
+    return pc_misses;
+}
+
+} // namespace machine
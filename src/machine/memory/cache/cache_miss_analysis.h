@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef CACHE_MISS_ANALYSIS_H
+#define CACHE_MISS_ANALYSIS_H
+
+#include "memory/address.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace machine {
+
+/**
+ * Classes of cache misses (Hill's "3C" model).
+ */
+enum CacheMissKind {
+    MISS_COMPULSORY, // First access to the block ever
+    MISS_CAPACITY,   // Misses in fully associative cache of the same size
+    MISS_CONFLICT,   // Hits in fully associative cache, set was too small
+    MISS_KIND_COUNT
+};
+
+struct CacheMissCounts {
+    uint32_t count[MISS_KIND_COUNT] = {};
+
+    uint32_t total() const;
+};
+
+/**
+ * Classification of misses of a cache and their attribution to the
+ * instructions, which caused them.
+ *
+ * Keeps set of all blocks ever accessed and shadow fully associative LRU
+ * cache with the same number of lines as analyzed cache. Every access of the
+ * analyzed cache is passed through the shadow cache, so when analyzed cache
+ * misses, the miss is compulsory if the block was never seen, capacity if
+ * shadow cache misses too and conflict otherwise.
+ */
+class CacheMissAnalysis {
+public:
+    explicit CacheMissAnalysis(size_t line_count);
+
+    /**
+     * Pass single access of the analyzed cache.
+     *
+     * @param block     block number (address divided by block size)
+     * @param miss      analyzed cache missed
+     * @param allocate  analyzed cache allocates the block (false for write
+     *                  misses of non-allocating caches)
+     * @param pc        address of instruction doing the access
+     */
+    void access(uint64_t block, bool miss, bool allocate, Address pc);
+
+    void flush(); // Analyzed cache was invalidated
+    void reset(); // Analyzed cache was reset, clears all counts
+
+    uint32_t get_miss_count(CacheMissKind kind) const;
+    // Misses by address of instruction, which caused them
+    const std::unordered_map<uint64_t, CacheMissCounts> &get_pc_misses() const;
+
+private:
+    const size_t line_count;
+    std::unordered_set<uint64_t> seen_blocks;
+    // Shadow cache, most recently used block first
+    std::list<uint64_t> lru_blocks;
+    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> lru_index;
+    CacheMissCounts misses;
+    std::unordered_map<uint64_t, CacheMissCounts> pc_misses;
+
+    bool shadow_access(uint64_t block, bool allocate);
+};
+
+} // namespace machine
+
+#endif // CACHE_MISS_ANALYSIS_H
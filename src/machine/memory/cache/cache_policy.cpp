@@ -37,6 +37,7 @@
 
 #include "cache_policy.h"
 
+#include "checkpoint.h"
 #include "simulator_exception.h"
 #include "utils.h"
 
@@ -63,6 +64,45 @@ CachePolicy::get_policy_instance(const CacheConfig *config) {
     Q_UNREACHABLE();
 }
 
+void CachePolicy::save_state(CheckpointWriter &writer) const {
+    UNUSED(writer)
+}
+
+void CachePolicy::restore_state(CheckpointReader &reader) {
+    UNUSED(reader)
+}
+
+static void save_policy_stats(
+    CheckpointWriter &writer,
+    const std::vector<std::vector<uint32_t>> &stats) {
+    for (const auto &row : stats) {
+        writer.write_u32(row.size());
+        for (uint32_t value : row) {
+            writer.write_u32(value);
+        }
+    }
+}
+
+/**
+ * Stored rows have to have the same shape as the current ones. Values above
+ * max_value (way index for LRU) are rejected.
+ */
+static void restore_policy_stats(
+    CheckpointReader &reader,
+    std::vector<std::vector<uint32_t>> &stats,
+    uint32_t max_value) {
+    for (auto &row : stats) {
+        reader.expect_u32(row.size(), "cache replacement policy");
+        for (uint32_t &value : row) {
+            value = reader.read_u32();
+            if (value > max_value) {
+                throw SIMULATOR_EXCEPTION(
+                    Input, "Checkpoint cache replacement state is corrupted", "");
+            }
+        }
+    }
+}
+
 CachePolicyLRU::CachePolicyLRU(size_t associativity, size_t set_count)
     : associativity(associativity) {
     stats.resize(set_count);
@@ -108,6 +148,14 @@ size_t CachePolicyLRU::select_way_to_evict(size_t row) const {
     return stats.at(row).at(0);
 }
 
+void CachePolicyLRU::save_state(CheckpointWriter &writer) const {
+    save_policy_stats(writer, stats);
+}
+
+void CachePolicyLRU::restore_state(CheckpointReader &reader) {
+    restore_policy_stats(reader, stats, associativity - 1);
+}
+
 CachePolicyLFU::CachePolicyLFU(size_t associativity, size_t set_count) {
     stats.resize(set_count, std::vector<uint32_t>(associativity, 0));
 }
@@ -145,15 +193,17 @@ size_t CachePolicyLFU::select_way_to_evict(size_t row) const {
     return index;
 }
 
-CachePolicyRAND::CachePolicyRAND(size_t associativity)
-    : associativity(associativity) {
-    // Reset random generator to make result reproducible.
-    // Random is by default seeded by 1 (by cpp standard), so this makes it
-    // consistent across multiple runs.
-    // NOTE: Reproducibility applies only on the same execution environment.
-    std::srand(1); // NOLINT(cert-msc51-cpp)
+void CachePolicyLFU::save_state(CheckpointWriter &writer) const {
+    save_policy_stats(writer, stats);
+}
+
+void CachePolicyLFU::restore_state(CheckpointReader &reader) {
+    restore_policy_stats(reader, stats, UINT32_MAX);
 }
 
+CachePolicyRAND::CachePolicyRAND(size_t associativity)
+    : associativity(associativity) {}
+
 void CachePolicyRAND::update_stats(size_t way, size_t row, bool is_valid) {
     UNUSED(way) UNUSED(row) UNUSED(is_valid)
     // NOP
@@ -161,6 +211,17 @@ void CachePolicyRAND::update_stats(size_t way, size_t row, bool is_valid) {
 
 size_t CachePolicyRAND::select_way_to_evict(size_t row) const {
     UNUSED(row)
-    return std::rand() % associativity; // NOLINT(cert-msc50-cpp)
+    // Linear congruential generator with constants of the C standard example
+    // rand(), fixed seed keeps results reproducible on every platform.
+    random_state = random_state * 1103515245 + 12345;
+    return (random_state >> 16) % associativity;
+}
+
+void CachePolicyRAND::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(random_state);
+}
+
+void CachePolicyRAND::restore_state(CheckpointReader &reader) {
+    random_state = reader.read_u32();
 }
 } // namespace machine
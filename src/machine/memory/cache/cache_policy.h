@@ -49,6 +49,9 @@ using std::size_t;
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * Cache replacement policy interface.
  *
@@ -67,6 +70,13 @@ public:
      */
     virtual void update_stats(size_t way, size_t row, bool is_valid) = 0;
 
+    /**
+     * Replacement state for machine checkpoint. Policy without any state
+     * stores nothing.
+     */
+    virtual void save_state(CheckpointWriter &writer) const;
+    virtual void restore_state(CheckpointReader &reader);
+
     virtual ~CachePolicy() = default;
 
     static std::unique_ptr<CachePolicy>
@@ -93,6 +103,9 @@ public:
 
     void update_stats(size_t way, size_t row, bool is_valid) final;
 
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
 private:
     /**
      * Last access order queues for each cache set (row)
@@ -120,6 +133,9 @@ public:
 
     void update_stats(size_t way, size_t row, bool is_valid) final;
 
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
 private:
     std::vector<std::vector<uint32_t>> stats;
 };
@@ -135,8 +151,14 @@ public:
 
     void update_stats(size_t way, size_t row, bool is_valid) final;
 
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
 private:
     size_t associativity;
+    // Generator state is kept per cache, so the sequence does not depend on
+    // other caches (replay of memory trace) or threads (batch mode).
+    mutable uint32_t random_state = 1;
 };
 
 } // namespace machine
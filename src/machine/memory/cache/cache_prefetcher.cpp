@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/cache/cache_prefetcher.h"
+
+#include "checkpoint.h"
+#include "utils.h"
+
+namespace machine {
+
+std::unique_ptr<CachePrefetcher>
+CachePrefetcher::get_prefetcher_instance(const CacheConfig *config) {
+    if (!config->enabled()) {
+        return { nullptr };
+    }
+    const size_t block_bytes = config->block_size() * sizeof(uint32_t);
+    switch (config->prefetch_policy()) {
+    case CacheConfig::PF_NONE: return { nullptr };
+    case CacheConfig::PF_NEXT_LINE:
+        return std::make_unique<CachePrefetcherNextLine>(
+            block_bytes, config->prefetch_degree(), config->prefetch_distance());
+    case CacheConfig::PF_STRIDE:
+        return std::make_unique<CachePrefetcherStride>(
+            block_bytes, config->prefetch_degree(), config->prefetch_distance());
+    case CacheConfig::PF_STREAM:
+        return std::make_unique<CachePrefetcherStream>(
+            block_bytes, config->prefetch_degree(), config->prefetch_distance());
+    }
+    return { nullptr };
+}
+
+void CachePrefetcher::reset() {}
+
+void CachePrefetcher::save_state(CheckpointWriter &writer) const {
+    UNUSED(writer)
+}
+
+void CachePrefetcher::restore_state(CheckpointReader &reader) {
+    UNUSED(reader)
+}
+
+CachePrefetcherNextLine::CachePrefetcherNextLine(
+    size_t block_bytes,
+    size_t degree,
+    size_t distance)
+    : block_bytes(block_bytes)
+    , degree(degree)
+    , distance(distance) {}
+
+void CachePrefetcherNextLine::access(
+    uint64_t address,
+    bool miss,
+    bool prefetch_hit,
+    uint64_t pc,
+    std::vector<uint64_t> &prefetch) {
+    UNUSED(pc)
+    if (!miss && !prefetch_hit) {
+        return;
+    }
+    const uint64_t block = address / block_bytes;
+    for (size_t i = 0; i < degree; i++) {
+        prefetch.push_back(block + distance + i);
+    }
+}
+
+CachePrefetcherStride::CachePrefetcherStride(
+    size_t block_bytes,
+    size_t degree,
+    size_t distance)
+    : block_bytes(block_bytes)
+    , degree(degree)
+    , distance(distance) {}
+
+void CachePrefetcherStride::access(
+    uint64_t address,
+    bool miss,
+    bool prefetch_hit,
+    uint64_t pc,
+    std::vector<uint64_t> &prefetch) {
+    UNUSED(miss)
+    UNUSED(prefetch_hit)
+    Entry &entry = table[(pc >> 2) % TABLE_SIZE];
+    if (entry.pc != pc) {
+        entry = { .pc = pc, .last_address = address, .stride = 0, .confidence = 0 };
+        return;
+    }
+
+    const int64_t stride = (int64_t)(address - entry.last_address);
+    if (stride == entry.stride) {
+        if (entry.confidence < CONFIDENCE_MAX) {
+            entry.confidence++;
+        }
+    } else if (entry.confidence > 0) {
+        entry.confidence--;
+    } else {
+        entry.stride = stride;
+    }
+    entry.last_address = address;
+
+    if (entry.confidence < CONFIDENCE_PREFETCH || entry.stride == 0) {
+        return;
+    }
+    uint64_t last_block = address / block_bytes;
+    for (size_t i = 0; i < degree; i++) {
+        const uint64_t target = address + entry.stride * (int64_t)(distance + i);
+        // Strides shorter than block hit the same block repeatedly
+        if (target / block_bytes != last_block) {
+            last_block = target / block_bytes;
+            prefetch.push_back(last_block);
+        }
+    }
+}
+
+void CachePrefetcherStride::reset() {
+    table.fill({});
+}
+
+void CachePrefetcherStride::save_state(CheckpointWriter &writer) const {
+    for (const Entry &entry : table) {
+        writer.write_u64(entry.pc);
+        writer.write_u64(entry.last_address);
+        writer.write_u64((uint64_t)entry.stride);
+        writer.write_u8(entry.confidence);
+    }
+}
+
+void CachePrefetcherStride::restore_state(CheckpointReader &reader) {
+    for (Entry &entry : table) {
+        entry.pc = reader.read_u64();
+        entry.last_address = reader.read_u64();
+        entry.stride = (int64_t)reader.read_u64();
+        entry.confidence = reader.read_u8();
+    }
+}
+
+CachePrefetcherStream::CachePrefetcherStream(
+    size_t block_bytes,
+    size_t degree,
+    size_t distance)
+    : block_bytes(block_bytes)
+    , degree(degree)
+    , distance(distance) {}
+
+void CachePrefetcherStream::access(
+    uint64_t address,
+    bool miss,
+    bool prefetch_hit,
+    uint64_t pc,
+    std::vector<uint64_t> &prefetch) {
+    UNUSED(prefetch_hit)
+    UNUSED(pc)
+    const uint64_t block = address / block_bytes;
+    use_counter++;
+    for (Stream &stream : streams) {
+        if (stream.valid && block > stream.last_block && block <= stream.next_block) {
+            stream.last_block = block;
+            stream.last_use = use_counter;
+            advance(stream, block, prefetch);
+            return;
+        }
+    }
+    if (!miss) {
+        return;
+    }
+
+    Stream *victim = &streams[0];
+    for (Stream &stream : streams) {
+        if (!stream.valid) {
+            victim = &stream;
+            break;
+        }
+        if (stream.last_use < victim->last_use) {
+            victim = &stream;
+        }
+    }
+    *victim = { .valid = true,
+                .last_block = block,
+                .next_block = block + 1,
+                .last_use = use_counter };
+    advance(*victim, block, prefetch);
+}
+
+void CachePrefetcherStream::advance(
+    Stream &stream,
+    uint64_t block,
+    std::vector<uint64_t> &prefetch) const {
+    if (stream.next_block <= block) {
+        stream.next_block = block + 1;
+    }
+    for (size_t i = 0; i < degree && stream.next_block <= block + distance; i++) {
+        prefetch.push_back(stream.next_block);
+        stream.next_block++;
+    }
+}
+
+void CachePrefetcherStream::reset() {
+    streams.fill({});
+    use_counter = 0;
+}
+
+void CachePrefetcherStream::save_state(CheckpointWriter &writer) const {
+    for (const Stream &stream : streams) {
+        writer.write_bool(stream.valid);
+        writer.write_u64(stream.last_block);
+        writer.write_u64(stream.next_block);
+        writer.write_u32(stream.last_use);
+    }
+    writer.write_u32(use_counter);
+}
+
+void CachePrefetcherStream::restore_state(CheckpointReader &reader) {
+    for (Stream &stream : streams) {
+        stream.valid = reader.read_bool();
+        stream.last_block = reader.read_u64();
+        stream.next_block = reader.read_u64();
+        stream.last_use = reader.read_u32();
+    }
+    use_counter = reader.read_u32();
+}
+
+} // namespace machine
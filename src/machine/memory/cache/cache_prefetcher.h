@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef CACHE_PREFETCHER_H
+#define CACHE_PREFETCHER_H
+
+#include "machineconfig.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace machine {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Hardware prefetcher interface.
+ *
+ * Prefetcher observes demand accesses of a cache and proposes blocks to be
+ * filled into the cache ahead of use. Blocks are identified by their number
+ * (address divided by block size in bytes), cache skips blocks it already
+ * holds. Degree limits number of blocks proposed at once, distance is how
+ * many blocks (or strides) ahead of the access prefetching starts.
+ */
+class CachePrefetcher {
+public:
+    /**
+     * @param address       accessed address
+     * @param miss          the access missed in the cache
+     * @param prefetch_hit  first access to block filled by prefetch
+     * @param pc            address of instruction doing the access
+     * @param prefetch      numbers of blocks to prefetch are appended here
+     */
+    virtual void access(
+        uint64_t address,
+        bool miss,
+        bool prefetch_hit,
+        uint64_t pc,
+        std::vector<uint64_t> &prefetch)
+        = 0;
+
+    virtual void reset();
+
+    // Prefetcher state for machine checkpoint
+    virtual void save_state(CheckpointWriter &writer) const;
+    virtual void restore_state(CheckpointReader &reader);
+
+    virtual ~CachePrefetcher() = default;
+
+    // Returns nullptr when the cache does not prefetch
+    static std::unique_ptr<CachePrefetcher> get_prefetcher_instance(const CacheConfig *config);
+};
+
+/**
+ * Next line (tagged) prefetcher
+ *
+ * Miss or first use of prefetched block prefetches blocks following it.
+ */
+class CachePrefetcherNextLine final : public CachePrefetcher {
+public:
+    CachePrefetcherNextLine(size_t block_bytes, size_t degree, size_t distance);
+
+    void access(
+        uint64_t address,
+        bool miss,
+        bool prefetch_hit,
+        uint64_t pc,
+        std::vector<uint64_t> &prefetch) final;
+
+private:
+    const size_t block_bytes, degree, distance;
+};
+
+/**
+ * Stride prefetcher with reference prediction table
+ *
+ * Table indexed by instruction address remembers the last address accessed
+ * by the instruction and the stride between its accesses. When the same
+ * stride repeats, addresses the following accesses of the instruction will
+ * use are prefetched.
+ */
+class CachePrefetcherStride final : public CachePrefetcher {
+public:
+    CachePrefetcherStride(size_t block_bytes, size_t degree, size_t distance);
+
+    void access(
+        uint64_t address,
+        bool miss,
+        bool prefetch_hit,
+        uint64_t pc,
+        std::vector<uint64_t> &prefetch) final;
+
+    void reset() final;
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
+private:
+    static constexpr size_t TABLE_SIZE = 64;
+    // Confidence needed to prefetch, it saturates at `CONFIDENCE_MAX`
+    static constexpr uint8_t CONFIDENCE_PREFETCH = 2;
+    static constexpr uint8_t CONFIDENCE_MAX = 3;
+
+    struct Entry {
+        uint64_t pc;
+        uint64_t last_address;
+        int64_t stride;
+        uint8_t confidence;
+    };
+
+    const size_t block_bytes, degree, distance;
+    std::array<Entry, TABLE_SIZE> table {};
+};
+
+/**
+ * Stream prefetcher
+ *
+ * Miss outside of tracked streams starts new stream (replacing the least
+ * recently used one). Accesses within prefetched part of a stream advance
+ * it, so prefetching runs `distance` blocks ahead of the accesses. Only
+ * ascending streams are detected.
+ */
+class CachePrefetcherStream final : public CachePrefetcher {
+public:
+    CachePrefetcherStream(size_t block_bytes, size_t degree, size_t distance);
+
+    void access(
+        uint64_t address,
+        bool miss,
+        bool prefetch_hit,
+        uint64_t pc,
+        std::vector<uint64_t> &prefetch) final;
+
+    void reset() final;
+    void save_state(CheckpointWriter &writer) const final;
+    void restore_state(CheckpointReader &reader) final;
+
+private:
+    static constexpr size_t STREAM_COUNT = 4;
+
+    struct Stream {
+        bool valid;
+        uint64_t last_block; // Last accessed block
+        uint64_t next_block; // First block not prefetched yet
+        uint32_t last_use;   // For replacement of streams
+    };
+
+    const size_t block_bytes, degree, distance;
+    std::array<Stream, STREAM_COUNT> streams {};
+    uint32_t use_counter = 0;
+
+    void advance(Stream &stream, uint64_t block, std::vector<uint64_t> &prefetch) const;
+};
+
+} // namespace machine
+
+#endif // CACHE_PREFETCHER_H
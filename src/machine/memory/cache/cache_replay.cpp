@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/cache/cache_replay.h"
+
+#include "utils.h"
+
+#include <cstring>
+
+using ae = machine::AccessEffects; // For enum values, type is obvious from
+                                   // context.
+
+namespace machine {
+
+/**
+ * Backing memory for replayed caches. Reads return zeros and writes are
+ * dropped, the cache statistics do not depend on the data.
+ */
+class CacheReplay::NullMemory final : public FrontendMemory {
+public:
+    NullMemory() : FrontendMemory(BIG) {}
+
+    WriteResult write(
+        Address destination,
+        const void *source,
+        size_t size,
+        WriteOptions options) override {
+        UNUSED(destination) UNUSED(source) UNUSED(options)
+        return { .n_bytes = size, .changed = false };
+    }
+
+    ReadResult read(
+        void *destination,
+        Address source,
+        size_t size,
+        ReadOptions options) const override {
+        UNUSED(source) UNUSED(options)
+        memset(destination, 0, size);
+        return {};
+    }
+
+    uint32_t get_change_counter() const override {
+        return 0;
+    }
+};
+
+CacheReplay::CacheReplay(
+    uint32_t memory_access_penalty_r,
+    uint32_t memory_access_penalty_w,
+    uint32_t memory_access_penalty_b)
+    : access_pen_r(memory_access_penalty_r)
+    , access_pen_w(memory_access_penalty_w)
+    , access_pen_b(memory_access_penalty_b)
+    , backing(std::make_unique<NullMemory>()) {}
+
+CacheReplay::~CacheReplay() {
+    // Caches have to go before the memory backing them
+    caches.clear();
+}
+
+size_t CacheReplay::add_cache(const CacheConfig &config, MemoryTraceStream stream) {
+    caches.push_back(
+        { .stream = stream,
+          .cache = std::make_unique<Cache>(
+              backing.get(), &config, access_pen_r, access_pen_w, access_pen_b) });
+    return caches.size() - 1;
+}
+
+size_t CacheReplay::cache_count() const {
+    return caches.size();
+}
+
+const Cache *CacheReplay::cache(size_t index) const {
+    return caches.at(index).cache.get();
+}
+
+MemoryTraceStream CacheReplay::cache_stream(size_t index) const {
+    return caches.at(index).stream;
+}
+
+size_t CacheReplay::add_sweep(
+    MemoryTraceStream stream,
+    const std::vector<size_t> &set_counts,
+    const std::vector<size_t> &block_sizes,
+    size_t max_associativity) {
+    sweeps.push_back(
+        std::make_unique<CacheSweep>(stream, set_counts, block_sizes, max_associativity));
+    return sweeps.size() - 1;
+}
+
+size_t CacheReplay::sweep_count() const {
+    return sweeps.size();
+}
+
+const CacheSweep *CacheReplay::sweep(size_t index) const {
+    return sweeps.at(index).get();
+}
+
+uint64_t CacheReplay::replay(MemoryTraceReader &reader) {
+    // Content is dropped by the backing memory, buffer only has to be large enough
+    std::vector<uint8_t> buffer(sizeof(uint64_t));
+    uint64_t count = 0;
+    MemoryTraceRecord rec {};
+    while (reader.next(rec)) {
+        count++;
+        if (rec.size > buffer.size()) { buffer.resize(rec.size); }
+        for (auto &entry : caches) {
+            if (entry.stream != rec.stream) { continue; }
+            Cache &cache = *entry.cache;
+            // Stride prefetchers and miss attribution need the instruction
+            cache.set_access_pc(rec.pc);
+            switch (rec.kind) {
+            case TRACE_READ:
+                cache.read(
+                    buffer.data(), rec.address, rec.size,
+                    { .type = rec.internal ? ae::INTERNAL : ae::REGULAR });
+                break;
+            case TRACE_WRITE:
+                cache.write(rec.address, buffer.data(), rec.size, { .type = ae::REGULAR });
+                break;
+            case TRACE_SYNC: cache.sync(); break;
+            case TRACE_RESET: cache.reset(); break;
+            }
+        }
+        for (auto &sweep : sweeps) {
+            sweep->record(rec);
+        }
+    }
+    return count;
+}
+
+} // namespace machine
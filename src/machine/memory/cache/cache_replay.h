@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef CACHE_REPLAY_H
+#define CACHE_REPLAY_H
+
+#include "machineconfig.h"
+#include "memory/cache/cache.h"
+#include "memory/cache/cache_sweep.h"
+#include "memory/memory_trace.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Drives caches by recorded memory trace (see `memory/memory_trace.h`).
+ *
+ * Any number of cache configurations is simulated in single pass through the
+ * trace, each cache receives records of its stream only. Caches are backed by
+ * memory without content, therefore only statistics are meaningful. With the
+ * configuration and access penalties of the recorded run they are the same
+ * as the statistics of the live run. Stack distance analysis of LRU caches
+ * (see `CacheSweep`) can be done in the same pass.
+ */
+class CacheReplay {
+public:
+    explicit CacheReplay(
+        uint32_t memory_access_penalty_r = 1,
+        uint32_t memory_access_penalty_w = 1,
+        uint32_t memory_access_penalty_b = 0);
+    ~CacheReplay();
+
+    // Returns index of the added cache
+    size_t add_cache(const CacheConfig &config, MemoryTraceStream stream);
+    size_t cache_count() const;
+    const Cache *cache(size_t index) const;
+    MemoryTraceStream cache_stream(size_t index) const;
+
+    // Returns index of the added sweep
+    size_t add_sweep(
+        MemoryTraceStream stream,
+        const std::vector<size_t> &set_counts,
+        const std::vector<size_t> &block_sizes,
+        size_t max_associativity);
+    size_t sweep_count() const;
+    const CacheSweep *sweep(size_t index) const;
+
+    // Replays the whole trace, returns number of replayed records
+    uint64_t replay(MemoryTraceReader &reader);
+
+private:
+    class NullMemory;
+    struct Entry {
+        MemoryTraceStream stream;
+        std::unique_ptr<Cache> cache;
+    };
+    const uint32_t access_pen_r, access_pen_w, access_pen_b;
+    const std::unique_ptr<NullMemory> backing;
+    std::vector<Entry> caches;
+    std::vector<std::unique_ptr<CacheSweep>> sweeps;
+};
+
+} // namespace machine
+
+#endif // CACHE_REPLAY_H
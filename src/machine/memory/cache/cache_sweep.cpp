@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/cache/cache_sweep.h"
+
+#include "memory/cache/cache.h"
+#include "simulator_exception.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+
+namespace machine {
+
+// Accesses not cached by `Cache`
+constexpr uint64_t UNCACHED_START = 0xf0000000;
+constexpr uint64_t UNCACHED_LAST = 0xfffffffe;
+
+static bool is_in_uncached_area(uint64_t address) {
+    return address >= UNCACHED_START && address <= UNCACHED_LAST;
+}
+
+static bool is_power_of_two(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+CacheSweep::CacheSweep(
+    MemoryTraceStream stream,
+    const std::vector<size_t> &set_counts,
+    const std::vector<size_t> &block_sizes,
+    size_t max_associativity)
+    : stream(stream)
+    , set_counts(set_counts)
+    , block_sizes(block_sizes)
+    , max_associativity(max_associativity)
+    , access_counts(block_sizes.size()) {
+    SANITY_ASSERT(max_associativity > 0, "Cache sweep without any way");
+    for (size_t block_size : block_sizes) {
+        for (size_t set_count : set_counts) {
+            SANITY_ASSERT(
+                block_size > 0 && set_count > 0, "Cache sweep with empty configuration");
+            stacks.push_back(
+                { .set_count = set_count,
+                  .block_size = block_size,
+                  .blocks = std::vector<uint64_t>(set_count * max_associativity),
+                  .depth = std::vector<uint32_t>(set_count),
+                  .distance_hist = std::vector<uint64_t>(max_associativity) });
+        }
+    }
+}
+
+void CacheSweep::record(const MemoryTraceRecord &rec) {
+    if (rec.stream != stream) { return; }
+    switch (rec.kind) {
+    case TRACE_READ:
+    case TRACE_WRITE:
+        // Internal reads are recorded only when they bypass the cache
+        if (!rec.internal) { access(rec.address, rec.size); }
+        break;
+    case TRACE_SYNC: flush(); break;
+    case TRACE_RESET: reset(); break;
+    }
+}
+
+/**
+ * Moves the block to the top of its set LRU stack and counts the hit at its
+ * original distance. Blocks pushed below `ways` are forgotten, they would
+ * miss in all analyzed caches.
+ */
+static void touch_block(
+    std::vector<uint64_t> &blocks,
+    std::vector<uint32_t> &depths,
+    std::vector<uint64_t> &distance_hist,
+    size_t set,
+    size_t ways,
+    uint64_t block) {
+    uint64_t *stack = &blocks[set * ways];
+    uint32_t &depth = depths[set];
+    size_t pos = 0;
+    while (pos < depth && stack[pos] != block) {
+        pos++;
+    }
+    if (pos < depth) {
+        distance_hist[pos]++;
+    } else if (depth < ways) {
+        depth++;
+    } else {
+        pos = ways - 1;
+    }
+    memmove(stack + 1, stack, pos * sizeof(*stack));
+    stack[0] = block;
+}
+
+void CacheSweep::access(Address address, size_t size) {
+    const uint64_t start = address.get_raw();
+    if (size == 0 || is_in_uncached_area(start) || is_in_uncached_area(start + size)) {
+        return;
+    }
+    for (size_t b = 0; b < block_sizes.size(); b++) {
+        const uint64_t block_bytes = block_sizes[b] * BLOCK_ITEM_SIZE;
+        const uint64_t first = start / block_bytes;
+        const uint64_t last = (start + size - 1) / block_bytes;
+        access_counts[b] += last - first + 1;
+        for (size_t s = 0; s < set_counts.size(); s++) {
+            Stacks &st = stacks[b * set_counts.size() + s];
+            for (uint64_t block = first; block <= last; block++) {
+                touch_block(
+                    st.blocks, st.depth, st.distance_hist, block % st.set_count,
+                    max_associativity, block);
+            }
+        }
+    }
+}
+
+void CacheSweep::flush() {
+    for (auto &st : stacks) {
+        std::fill(st.depth.begin(), st.depth.end(), 0);
+    }
+}
+
+void CacheSweep::reset() {
+    flush();
+    for (auto &st : stacks) {
+        std::fill(st.distance_hist.begin(), st.distance_hist.end(), 0);
+    }
+    std::fill(access_counts.begin(), access_counts.end(), 0);
+}
+
+MemoryTraceStream CacheSweep::get_stream() const {
+    return stream;
+}
+
+const std::vector<size_t> &CacheSweep::get_set_counts() const {
+    return set_counts;
+}
+
+const std::vector<size_t> &CacheSweep::get_block_sizes() const {
+    return block_sizes;
+}
+
+size_t CacheSweep::get_max_associativity() const {
+    return max_associativity;
+}
+
+size_t CacheSweep::block_index(size_t block_size) const {
+    for (size_t b = 0; b < block_sizes.size(); b++) {
+        if (block_sizes[b] == block_size) { return b; }
+    }
+    throw SANITY_EXCEPTION("Block size is not part of the cache sweep");
+}
+
+const CacheSweep::Stacks &CacheSweep::find_stacks(size_t set_count, size_t block_size) const {
+    const size_t b = block_index(block_size);
+    for (size_t s = 0; s < set_counts.size(); s++) {
+        if (set_counts[s] == set_count) { return stacks[b * set_counts.size() + s]; }
+    }
+    throw SANITY_EXCEPTION("Set count is not part of the cache sweep");
+}
+
+uint64_t CacheSweep::get_access_count(size_t block_size) const {
+    return access_counts[block_index(block_size)];
+}
+
+uint64_t
+CacheSweep::get_hit_count(size_t set_count, size_t block_size, size_t associativity) const {
+    SANITY_ASSERT(
+        associativity <= max_associativity, "Associativity is not part of the cache sweep");
+    const Stacks &st = find_stacks(set_count, block_size);
+    uint64_t hits = 0;
+    for (size_t distance = 0; distance < associativity; distance++) {
+        hits += st.distance_hist[distance];
+    }
+    return hits;
+}
+
+bool CacheSweep::parse_range(const QString &text, std::vector<size_t> &values) {
+    QStringList bounds = text.split("..");
+    bool ok_low, ok_high = true;
+    size_t low = bounds.at(0).toUInt(&ok_low, 0);
+    size_t high = bounds.size() == 2 ? bounds.at(1).toUInt(&ok_high, 0) : low;
+    if (bounds.size() > 2 || !ok_low || !ok_high || !is_power_of_two(low)
+        || !is_power_of_two(high) || high < low) {
+        return false;
+    }
+    values.clear();
+    for (size_t value = low; value <= high; value *= 2) {
+        values.push_back(value);
+    }
+    return true;
+}
+
+} // namespace machine
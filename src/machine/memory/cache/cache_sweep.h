@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef CACHE_SWEEP_H
+#define CACHE_SWEEP_H
+
+#include "memory/memory_trace.h"
+
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Hit counts of LRU caches of many configurations from single pass through
+ * memory accesses.
+ *
+ * LRU caches have the inclusion property, block present in a cache with N
+ * ways is present in the same set of any cache with more ways. Therefore,
+ * for each pair of block size and set count it is enough to keep LRU stack of
+ * every set and histogram of distances from the top of the stack at which
+ * the accessed blocks are found (Mattson's stack distance). Access hits in a
+ * cache with N ways exactly when its distance is lower than N.
+ *
+ * Counts are the same as of `Cache` with LRU replacement and write allocation
+ * (write back or write through with allocation) fed by the same accesses.
+ */
+class CacheSweep {
+public:
+    /**
+     * @param stream            stream of trace records to analyze
+     * @param set_counts        set counts to analyze
+     * @param block_sizes       block sizes (in words) to analyze
+     * @param max_associativity highest associativity hits are counted for
+     */
+    CacheSweep(
+        MemoryTraceStream stream,
+        const std::vector<size_t> &set_counts,
+        const std::vector<size_t> &block_sizes,
+        size_t max_associativity);
+
+    // Records of other streams are ignored
+    void record(const MemoryTraceRecord &rec);
+    void access(Address address, size_t size);
+    void flush(); // Invalidate all blocks
+    void reset(); // Invalidate all blocks and clear counts
+
+    MemoryTraceStream get_stream() const;
+    const std::vector<size_t> &get_set_counts() const;
+    const std::vector<size_t> &get_block_sizes() const;
+    size_t get_max_associativity() const;
+
+    // Accesses of blocks (access spanning blocks counts for each of them)
+    uint64_t get_access_count(size_t block_size) const;
+    uint64_t get_hit_count(size_t set_count, size_t block_size, size_t associativity) const;
+
+    /**
+     * Parses range of sweep values given as LOW..HIGH or single value, both
+     * bounds have to be powers of two.
+     *
+     * @param values    all powers of two from LOW to HIGH
+     * @return          false when the text is not a valid range
+     */
+    static bool parse_range(const QString &text, std::vector<size_t> &values);
+
+private:
+    struct Stacks {
+        size_t set_count;
+        size_t block_size;
+        // LRU stacks of all sets, `max_associativity` block numbers per set,
+        // the most recently used first
+        std::vector<uint64_t> blocks;
+        std::vector<uint32_t> depth; // Valid blocks in stack of each set
+        // Hits at each stack distance
+        std::vector<uint64_t> distance_hist;
+    };
+    const Stacks &find_stacks(size_t set_count, size_t block_size) const;
+    size_t block_index(size_t block_size) const;
+
+    const MemoryTraceStream stream;
+    const std::vector<size_t> set_counts;
+    const std::vector<size_t> block_sizes;
+    const size_t max_associativity;
+    std::vector<Stacks> stacks;
+    std::vector<uint64_t> access_counts; // Indexed as `block_sizes`
+};
+
+} // namespace machine
+
+#endif // CACHE_SWEEP_H
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/dram.h"
+
+#include "checkpoint.h"
+
+#include <algorithm>
+
+namespace machine {
+
+// Row buffer of precharged bank, row numbers are much smaller
+constexpr uint64_t NO_ROW = UINT64_MAX;
+
+Dram::Dram(FrontendMemory *memory, const MachineConfig &config)
+    : FrontendMemory(memory->simulated_machine_endian)
+    , mem(memory)
+    , dram_last(0xefffffff_addr)
+    , enabled(config.dram_enabled())
+    , banks(config.dram_banks())
+    , row_size(config.dram_row_size())
+    , page_policy(config.dram_page_policy())
+    , t_rcd(config.dram_t_rcd())
+    , t_cas(config.dram_t_cas())
+    , t_rp(config.dram_t_rp())
+    , t_burst(config.memory_access_time_burst() > 1 ? config.memory_access_time_burst() : 1)
+    , queue_depth(config.dram_write_queue())
+    , open_row(banks, NO_ROW) {
+    write_queue.reserve(queue_depth);
+}
+
+WriteResult Dram::write(
+    Address destination,
+    const void *source,
+    size_t size,
+    WriteOptions options) {
+    if (is_timed(destination, options.type)) {
+        if (queue_depth == 0) {
+            wait_cycles += serve(make_request(destination, size));
+        } else {
+            if (write_queue.size() >= queue_depth) {
+                wait_cycles += drain_writes();
+            }
+            write_queue.push_back(make_request(destination, size));
+        }
+    }
+    return mem->write(destination, source, size, options);
+}
+
+ReadResult Dram::read(
+    void *destination,
+    Address source,
+    size_t size,
+    ReadOptions options) const {
+    if (is_timed(source, options.type)) {
+        reads++;
+        wait_cycles += serve(make_request(source, size));
+    }
+    return mem->read(destination, source, size, options);
+}
+
+uint32_t Dram::get_change_counter() const {
+    return mem->get_change_counter();
+}
+
+void Dram::sync() {
+    wait_cycles += drain_writes();
+    mem->sync();
+}
+
+void Dram::set_access_pc(Address pc) {
+    mem->set_access_pc(pc);
+}
+
+uint64_t Dram::get_wait_cycles() const {
+    return wait_cycles + mem->get_wait_cycles();
+}
+
+bool Dram::has_latency_model() const {
+    return true;
+}
+
+enum LocationStatus Dram::location_status(Address address) const {
+    return mem->location_status(address);
+}
+
+bool Dram::is_timed(Address address, AccessEffects type) const {
+    return type != ae::INTERNAL && address <= dram_last;
+}
+
+Dram::Request Dram::make_request(Address address, size_t size) const {
+    // Consecutive rows go to consecutive banks
+    const uint64_t row_index = address.get_raw() / row_size;
+    const uint32_t words = std::max((size + 3) / 4, (size_t)1);
+    return { .bank = (uint32_t)(row_index % banks), .row = row_index / banks, .words = words };
+}
+
+uint32_t Dram::serve(const Request &request) const {
+    uint64_t &row = open_row[request.bank];
+    uint32_t latency = t_cas + (request.words - 1) * t_burst;
+    if (row == request.row) {
+        row_hits++;
+    } else if (row == NO_ROW) {
+        row_misses++;
+        latency += t_rcd;
+    } else {
+        row_conflicts++;
+        latency += t_rp + t_rcd;
+    }
+    row = page_policy == MachineConfig::DP_OPEN ? request.row : NO_ROW;
+    total_latency += latency;
+    return latency;
+}
+
+uint32_t Dram::drain_writes() const {
+    if (write_queue.empty()) {
+        return 0;
+    }
+    drains++;
+    uint32_t time = 0;
+    while (!write_queue.empty()) {
+        auto next = write_queue.begin();
+        for (auto it = write_queue.begin(); it != write_queue.end(); ++it) {
+            if (open_row[it->bank] == it->row) {
+                next = it;
+                break;
+            }
+        }
+        writes++;
+        time += serve(*next);
+        write_queue.erase(next);
+    }
+    return time;
+}
+
+uint32_t Dram::get_read_count() const {
+    return reads;
+}
+
+uint32_t Dram::get_write_count() const {
+    return writes;
+}
+
+uint32_t Dram::get_row_hit_count() const {
+    return row_hits;
+}
+
+uint32_t Dram::get_row_miss_count() const {
+    return row_misses;
+}
+
+uint32_t Dram::get_row_conflict_count() const {
+    return row_conflicts;
+}
+
+uint32_t Dram::get_drain_count() const {
+    return drains;
+}
+
+double Dram::get_row_hit_rate() const {
+    const uint32_t accesses = row_hits + row_misses + row_conflicts;
+    if (accesses == 0) {
+        return 0.0;
+    }
+    return (double)row_hits / accesses * 100;
+}
+
+double Dram::get_average_latency() const {
+    const uint32_t accesses = reads + writes;
+    if (accesses == 0) {
+        return 0.0;
+    }
+    return (double)total_latency / accesses;
+}
+
+void Dram::reset() {
+    std::fill(open_row.begin(), open_row.end(), NO_ROW);
+    write_queue.clear();
+    reads = 0;
+    writes = 0;
+    row_hits = 0;
+    row_misses = 0;
+    row_conflicts = 0;
+    drains = 0;
+    total_latency = 0;
+}
+
+void Dram::save_state(CheckpointWriter &writer) const {
+    writer.write_u32(enabled);
+    writer.write_u32(banks);
+    writer.write_u32(row_size);
+    writer.write_u32(page_policy);
+    writer.write_u32(queue_depth);
+    writer.write_u32(t_rcd);
+    writer.write_u32(t_cas);
+    writer.write_u32(t_rp);
+    for (uint32_t counter : { reads, writes, row_hits, row_misses, row_conflicts, drains }) {
+        writer.write_u32(counter);
+    }
+    writer.write_u64(total_latency);
+    for (uint64_t row : open_row) {
+        writer.write_u64(row);
+    }
+    writer.write_u32(write_queue.size());
+    for (const Request &request : write_queue) {
+        writer.write_u32(request.bank);
+        writer.write_u64(request.row);
+        writer.write_u32(request.words);
+    }
+}
+
+void Dram::restore_state(CheckpointReader &reader) {
+    reader.expect_u32(enabled, "DRAM enabled");
+    reader.expect_u32(banks, "DRAM bank count");
+    reader.expect_u32(row_size, "DRAM row size");
+    reader.expect_u32(page_policy, "DRAM page policy");
+    reader.expect_u32(queue_depth, "DRAM write queue depth");
+    reader.expect_u32(t_rcd, "DRAM tRCD");
+    reader.expect_u32(t_cas, "DRAM tCAS");
+    reader.expect_u32(t_rp, "DRAM tRP");
+    for (uint32_t *counter :
+         { &reads, &writes, &row_hits, &row_misses, &row_conflicts, &drains }) {
+        *counter = reader.read_u32();
+    }
+    total_latency = reader.read_u64();
+    for (uint64_t &row : open_row) {
+        row = reader.read_u64();
+    }
+    const uint32_t queued = reader.read_u32();
+    if (queued > queue_depth) {
+        throw SIMULATOR_EXCEPTION(Input, "Checkpoint DRAM write queue is corrupted", "");
+    }
+    write_queue.clear();
+    for (uint32_t i = 0; i < queued; i++) {
+        Request request;
+        request.bank = reader.read_u32();
+        request.row = reader.read_u64();
+        request.words = reader.read_u32();
+        if (request.bank >= banks || request.words == 0) {
+            throw SIMULATOR_EXCEPTION(Input, "Checkpoint DRAM write queue is corrupted", "");
+        }
+        write_queue.push_back(request);
+    }
+}
+
+} // namespace machine
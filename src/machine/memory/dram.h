@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include "machineconfig.h"
+#include "memory/frontend_memory.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Timing model of DRAM main memory.
+ *
+ * Dram sits between caches and the memory bus. Data pass through unchanged,
+ * only time of the accesses is modelled. Consecutive rows of the address
+ * space are interleaved across banks and each bank has one row buffer.
+ * Access to the open row takes tCAS, access to a bank without open row
+ * tRCD + tCAS and access to other than the open row tRP + tRCD + tCAS.
+ * Closed page policy precharges the row after each access in background, so
+ * every access takes tRCD + tCAS. Words following the first one of an access
+ * take burst time each. Banks serve one access at a time, there is no overlap
+ * of accesses to different banks.
+ *
+ * Writes wait in the write queue and the writer continues. Write to full
+ * queue drains it and waits for that. Drain schedules the writes first-ready
+ * first-come-first-served: the oldest write to an open row goes first, the
+ * oldest write when no write hits an open row.
+ *
+ * Accesses above main memory range (peripherals) pass without timing.
+ */
+class Dram : public FrontendMemory {
+    Q_OBJECT
+public:
+    Dram(FrontendMemory *memory, const MachineConfig &config);
+
+    WriteResult write(
+        Address destination,
+        const void *source,
+        size_t size,
+        WriteOptions options) override;
+
+    ReadResult read(
+        void *destination,
+        Address source,
+        size_t size,
+        ReadOptions options) const override;
+
+    uint32_t get_change_counter() const override;
+
+    void sync() override; // Drains the write queue
+    void set_access_pc(Address pc) override;
+    // Reads and writes which drained the queue wait for their whole latency
+    uint64_t get_wait_cycles() const override;
+    bool has_latency_model() const override;
+    enum LocationStatus location_status(Address address) const override;
+
+    uint32_t get_read_count() const;         // Reads served by banks
+    uint32_t get_write_count() const;        // Writes served by banks
+    uint32_t get_row_hit_count() const;      // Accesses to open row
+    uint32_t get_row_miss_count() const;     // Accesses to bank without open row
+    uint32_t get_row_conflict_count() const; // Accesses to other than open row
+    uint32_t get_drain_count() const;        // Drains of the write queue
+    double get_row_hit_rate() const;         // Row hits of served accesses in percents
+    double get_average_latency() const;      // Cycles per served access
+
+    void reset(); // Closes all rows, drops queued writes and statistics
+
+    // Open rows, queued writes and statistics
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
+private:
+    struct Request {
+        uint32_t bank;
+        uint64_t row;
+        uint32_t words;
+    };
+
+    FrontendMemory *const mem;
+    const Address dram_last;
+    const bool enabled; // Dram is part of the memory hierarchy
+    const uint32_t banks, row_size;
+    const enum MachineConfig::DramPagePolicy page_policy;
+    const uint32_t t_rcd, t_cas, t_rp, t_burst;
+    const size_t queue_depth;
+
+    // Row in row buffer of each bank, `NO_ROW` when the bank is precharged
+    mutable std::vector<uint64_t> open_row;
+    mutable std::vector<Request> write_queue;
+
+    mutable uint32_t reads = 0, writes = 0, row_hits = 0, row_misses = 0, row_conflicts = 0,
+                     drains = 0;
+    mutable uint64_t total_latency = 0, wait_cycles = 0;
+
+    bool is_timed(Address address, AccessEffects type) const;
+    Request make_request(Address address, size_t size) const;
+    // Performs the access in its bank, returns its latency
+    uint32_t serve(const Request &request) const;
+    // Serves all queued writes, returns the time it took
+    uint32_t drain_writes() const;
+};
+
+} // namespace machine
+
+#endif // DRAM_H
@@ -141,15 +141,53 @@ FrontendMemory::read_ctl(enum AccessControl ctl, Address address) const {
 
 void FrontendMemory::sync() {}
 
+void FrontendMemory::set_access_pc(Address pc) {
+    (void)pc;
+}
+
+uint64_t FrontendMemory::get_wait_cycles() const {
+    return 0;
+}
+
+bool FrontendMemory::has_latency_model() const {
+    return false;
+}
+
 LocationStatus FrontendMemory::location_status(Address address) const {
     (void)address;
     return LOCSTAT_NONE;
 }
 
+DirectAccessWindow
+FrontendMemory::direct_access_window(Address address) const {
+    (void)address;
+    return { .start = 0, .last = UINT64_MAX };
+}
+
+void FrontendMemory::invalidate_direct_access() const {
+    direct_window = DirectAccessWindow();
+}
+
 template<typename T>
 T FrontendMemory::read_generic(Address address, AccessEffects type) const {
     T value;
-    read(&value, address, sizeof(T), { .type = type });
+    const uint64_t raw_address = address.get_raw();
+    if (!direct_window.covers(raw_address, sizeof(T))) {
+        direct_window = direct_access_window(address);
+    }
+    if (direct_window.host != nullptr
+        && direct_window.covers(raw_address, sizeof(T))
+        && (direct_window.read_counter == nullptr
+            || (sizeof(T) <= sizeof(uint32_t) && type != ae::INTERNAL))) {
+        memcpy(
+            &value, direct_window.host + (raw_address - direct_window.start),
+            sizeof(T));
+        if (direct_window.read_counter != nullptr) {
+            (*direct_window.read_counter)++;
+        }
+    } else {
+        read(&value, address, sizeof(T), { .type = type });
+    }
     // When cross-simulating (BIG simulator on LITTLE host machine and vice
     // versa) data needs to be swapped before writing to memory and after
     // reading from memory to achieve correct results of misaligned reads. See
@@ -184,6 +222,32 @@ bool FrontendMemory::write_generic(
     // See example in read_generic for byteswap explanation.
     const T swapped_value
         = byteswap_if(value, this->simulated_machine_endian != NATIVE_ENDIAN);
+    const uint64_t raw_address = address.get_raw();
+    if (!direct_window.covers(raw_address, sizeof(T))) {
+        direct_window = direct_access_window(address);
+    }
+    if (direct_window.host != nullptr && direct_window.writable
+        && direct_window.covers(raw_address, sizeof(T))
+        && (direct_window.write_counter == nullptr
+            || (sizeof(T) <= sizeof(uint32_t) && type != ae::INTERNAL))) {
+        byte *host = direct_window.host + (raw_address - direct_window.start);
+        if (direct_window.write_counter != nullptr) {
+            (*direct_window.write_counter)++;
+        }
+        if (memcmp(host, &swapped_value, sizeof(T)) == 0) {
+            return false;
+        }
+        memcpy(host, &swapped_value, sizeof(T));
+        if (direct_window.change_counter != nullptr) {
+            (*direct_window.change_counter)++;
+        }
+        return true;
+    }
+    if (direct_window.host != nullptr) {
+        // Storage may become writable by this write, get fresh window next
+        // time.
+        invalidate_direct_access();
+    }
     return write(address, &swapped_value, sizeof(T), { .type = type }).changed;
 }
 FrontendMemory::FrontendMemory(Endian simulated_endian)
@@ -122,6 +122,20 @@ public:
     RegisterValue read_ctl(enum AccessControl ctl, Address source) const;
 
     virtual void sync();
+    // Address of instruction doing following accesses, used by statistics
+    virtual void set_access_pc(Address pc);
+    /**
+     * Cycles accesses waited for slower memory beyond single cycle access,
+     * including waits of the memory below. Only difference of two values is
+     * meaningful, memory without timing model returns 0.
+     */
+    virtual uint64_t get_wait_cycles() const;
+    /**
+     * Wait cycles include whole latency of the accesses, so memory above it
+     * does not add its own access time. Memory without timing model and
+     * memories reporting only waits beyond their access time return false.
+     */
+    virtual bool has_latency_model() const;
     virtual LocationStatus location_status(Address address) const;
     virtual uint32_t get_change_counter() const = 0;
 
@@ -155,6 +169,17 @@ public:
         size_t size,
         ReadOptions options) const = 0;
 
+    /**
+     * Window of host memory backing given address, see `DirectAccessWindow`.
+     *
+     * Used by `read_XX` and `write_XX` to access plain RAM without going
+     * through `read` and `write`. Only memory components without side effects
+     * of the access (buses) may provide host storage, components above them
+     * may pass it through. Default window covers whole address space and
+     * forces regular access path.
+     */
+    virtual DirectAccessWindow direct_access_window(Address address) const;
+
     /**
      * Endian of the simulated CPU/memory system.
      *
@@ -174,7 +199,16 @@ signals:
         Address last_addr,
         AccessEffects type) const;
 
+protected:
+    /**
+     * Drop cached direct access window. Must be called whenever mapping of
+     * addresses to host memory changes.
+     */
+    void invalidate_direct_access() const;
+
 private:
+    mutable DirectAccessWindow direct_window;
+
     /**
      * Read any type from memory
      *
@@ -38,10 +38,18 @@
 #include "common/endian.h"
 #include "memory/memory_utils.h"
 
+#include <QVector>
+
 using namespace machine;
 
+// Size of page of bus page directory in bits (2^20 = 1 MiB)
+constexpr size_t BUS_PAGE_BITS = 20;
+constexpr uint64_t BUS_ADDRESS_SPACE_SIZE = 1ull << 32;
+constexpr size_t BUS_PAGE_COUNT = BUS_ADDRESS_SPACE_SIZE >> BUS_PAGE_BITS;
+
 MemoryDataBus::MemoryDataBus(Endian simulated_endian)
-    : FrontendMemory(simulated_endian) {};
+    : FrontendMemory(simulated_endian)
+    , page_directory(BUS_PAGE_COUNT, nullptr) {};
 
 MemoryDataBus::~MemoryDataBus() {
     ranges_by_addr.clear(); // No stored values are owned.
@@ -130,24 +138,81 @@ enum LocationStatus MemoryDataBus::location_status(Address address) const {
     return range->device->location_status(address - range->start_addr);
 }
 
+DirectAccessWindow
+MemoryDataBus::direct_access_window(Address address) const {
+    const RangeDesc *range = find_range(address);
+    if (range == nullptr) {
+        // Window of single byte, unmapped accesses are rare.
+        return { .start = address.get_raw(), .last = address.get_raw() };
+    }
+    const uint64_t range_start = range->start_addr.get_raw();
+    DirectAccessWindow window
+        = range->device->direct_access_window(address - range->start_addr);
+    window.last = std::min<uint64_t>(
+        window.last, range->last_addr - range->start_addr);
+    window.start += range_start;
+    window.last += range_start;
+    window.map_generation = &map_generation;
+    window.valid_map_generation = map_generation;
+    window.change_counter = &change_counter;
+    return window;
+}
+
 const MemoryDataBus::RangeDesc *
 MemoryDataBus::find_range(Address address) const {
-    // lowerBound finds range what has highest key (which is range->last_addr)
-    // less then or equal to address.
-    // See comment in insert_device_to_range for description, why this works.
-    auto iter = ranges_by_addr.lowerBound(address);
-    if (iter == ranges_by_addr.end()) {
-        return nullptr;
+    if (last_range != nullptr && last_range->contains(address)) {
+        return last_range;
     }
 
-    const RangeDesc *range = iter.value();
-    if (address >= range->start_addr && address <= range->last_addr) {
+    const RangeDesc *range = nullptr;
+    if (address.get_raw() < BUS_ADDRESS_SPACE_SIZE) {
+        // Directory entry is the lowerBound of page start, which is also the
+        // lowerBound of any address in the page up to the entry last address.
+        range = page_directory[address.get_raw() >> BUS_PAGE_BITS];
+        if (range == nullptr) {
+            return nullptr; // No range intersects the page.
+        }
+    }
+    if (range == nullptr || address > range->last_addr) {
+        // lowerBound finds range what has highest key (which is
+        // range->last_addr) less then or equal to address.
+        // See comment in insert_device_to_range for description, why this
+        // works.
+        auto iter = ranges_by_addr.lowerBound(address);
+        if (iter == ranges_by_addr.end()) {
+            return nullptr;
+        }
+        range = iter.value();
+    }
+
+    if (range->contains(address)) {
+        last_range = range;
         return range;
     }
 
     return nullptr;
 }
 
+void MemoryDataBus::rebuild_page_directory() {
+    last_range = nullptr;
+    map_generation++;
+    invalidate_direct_access();
+    auto iter = ranges_by_addr.constBegin();
+    for (size_t page = 0; page < BUS_PAGE_COUNT; page++) {
+        const Address page_start(page << BUS_PAGE_BITS);
+        const Address page_last = page_start + ((1u << BUS_PAGE_BITS) - 1);
+        while (iter != ranges_by_addr.constEnd() && iter.key() < page_start) {
+            iter++;
+        }
+        if (iter != ranges_by_addr.constEnd()
+            && iter.value()->start_addr <= page_last) {
+            page_directory[page] = iter.value();
+        } else {
+            page_directory[page] = nullptr;
+        }
+    }
+}
+
 bool MemoryDataBus::insert_device_to_range(
     BackendMemory *device,
     Address start_addr,
@@ -172,6 +237,7 @@ bool MemoryDataBus::insert_device_to_range(
     // searched address for case that range is not present.
     ranges_by_addr.insert(last_addr, range);
     ranges_by_device.insert(device, range);
+    rebuild_page_directory();
     connect(
         device, &BackendMemory::external_backend_change_notify, this,
         &MemoryDataBus::range_backend_external_change);
@@ -185,6 +251,7 @@ bool MemoryDataBus::remove_device(BackendMemory *device) {
     }
 
     ranges_by_addr.remove(range->last_addr);
+    rebuild_page_directory();
     if (range->owns_device) {
         delete range->device;
     }
@@ -194,15 +261,21 @@ bool MemoryDataBus::remove_device(BackendMemory *device) {
 }
 
 void MemoryDataBus::clean_range(Address start_addr, Address last_addr) {
+    // Devices are collected first, removal invalidates ranges_by_addr
+    // iterators.
+    QVector<BackendMemory *> devices;
     for (auto iter = ranges_by_addr.lowerBound(start_addr);
          iter != ranges_by_addr.end(); iter++) {
         const RangeDesc *range = iter.value();
         if (range->start_addr <= last_addr) {
-            remove_device(range->device);
+            devices.append(range->device);
         } else {
             break;
         }
     }
+    for (BackendMemory *device : devices) {
+        remove_device(device);
+    }
 }
 
 void MemoryDataBus::range_backend_external_change(
@@ -266,3 +339,9 @@ ReadResult TrivialBus::read(
 uint32_t TrivialBus::get_change_counter() const {
     return change_counter;
 }
+
+DirectAccessWindow TrivialBus::direct_access_window(Address address) const {
+    DirectAccessWindow window = device->direct_access_window(address.get_raw());
+    window.change_counter = &change_counter;
+    return window;
+}
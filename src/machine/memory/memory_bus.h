@@ -46,6 +46,7 @@
 #include <QMultiMap>
 #include <QObject>
 #include <cstdint>
+#include <vector>
 
 namespace machine {
 
@@ -146,6 +147,9 @@ public:
 
     enum LocationStatus location_status(Address address) const override;
 
+protected:
+    DirectAccessWindow direct_access_window(Address address) const override;
+
 private slots:
     /**
      * Receive external changes in underlying memory devices.
@@ -164,7 +168,17 @@ private:
      * once.
      */
     QMap<Address, const RangeDesc *> ranges_by_addr;
+    /*
+     * Page directory caches `ranges_by_addr.lowerBound` of each page start
+     * (first range ending in the page or after it), or nullptr when no range
+     * intersects the page. Does not own any value it holds.
+     */
+    std::vector<const RangeDesc *> page_directory;
+    mutable const RangeDesc *last_range = nullptr;
     mutable uint32_t change_counter = 0;
+    // Bumped on every change of ranges, invalidates direct access windows
+    // held by frontends above the bus.
+    uint32_t map_generation = 0;
 
     /**
      * Helper to write into single range. Used by `write`.
@@ -197,6 +211,12 @@ private:
      * Get range (or nullptr) for arbitrary address (not just start or last).
      */
     const MemoryDataBus::RangeDesc *find_range(Address address) const;
+
+    /**
+     * Recompute page directory from `ranges_by_addr`. Has to be called on
+     * every change of ranges.
+     */
+    void rebuild_page_directory();
 };
 
 /**
@@ -253,6 +273,9 @@ public:
 
     uint32_t get_change_counter() const override;
 
+protected:
+    DirectAccessWindow direct_access_window(Address address) const override;
+
 private:
     BackendMemory *const device;
     mutable uint32_t change_counter = 0;
@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "memory/memory_trace.h"
+
+#include "common/endian.h"
+#include "simulator_exception.h"
+
+#include <cerrno>
+#include <cstring>
+
+using namespace machine;
+
+// Magic, version and reserved word
+constexpr size_t HEADER_SIZE = sizeof(MEMORY_TRACE_MAGIC) + 2 * sizeof(uint32_t);
+// Buffered records are written out when the buffer reaches this size
+constexpr size_t WRITE_CHUNK = 64 * 1024;
+
+// Header byte layout
+constexpr uint8_t KIND_MASK = 0x03;
+constexpr uint8_t STREAM_SHIFT = 2;
+constexpr uint8_t SIZE_SHIFT = 3;
+constexpr uint8_t SIZE_MASK = 0x07;
+constexpr uint8_t SIZE_EXPLICIT = 4;
+constexpr uint8_t FLAG_PC = 0x40;
+constexpr uint8_t FLAG_INTERNAL = 0x80;
+
+static void put_u32_le(std::vector<uint8_t> &buffer, uint32_t value) {
+    value = byteswap_if(value, NATIVE_ENDIAN != LITTLE);
+    const auto *raw = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), raw, raw + sizeof(value));
+}
+
+static void put_varint(std::vector<uint8_t> &buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint8_t size_code(size_t size) {
+    switch (size) {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    case 8: return 3;
+    default: return SIZE_EXPLICIT;
+    }
+}
+
+MemoryTraceWriter::MemoryTraceWriter(const QString &file_name) : file(file_name) {
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Can't open memory trace file for writing (") + file_name + ")",
+            std::strerror(errno));
+    }
+    buffer.reserve(WRITE_CHUNK + 64);
+    buffer.insert(
+        buffer.end(), MEMORY_TRACE_MAGIC, MEMORY_TRACE_MAGIC + sizeof(MEMORY_TRACE_MAGIC));
+    put_u32_le(buffer, MEMORY_TRACE_VERSION);
+    put_u32_le(buffer, 0);
+}
+
+MemoryTraceWriter::~MemoryTraceWriter() {
+    try {
+        flush();
+    } catch (const SimulatorException &e) {
+        // Destructor must not throw, the trace is just incomplete.
+        qWarning("%s", e.msg(false).toLocal8Bit().constData());
+    }
+}
+
+void MemoryTraceWriter::record(
+    MemoryTraceKind kind,
+    MemoryTraceStream stream,
+    Address address,
+    size_t size,
+    bool internal) {
+    uint8_t header = kind | stream << STREAM_SHIFT;
+    record_count++;
+    if (kind == TRACE_SYNC || kind == TRACE_RESET) {
+        buffer.push_back(header);
+    } else {
+        const uint8_t code = size_code(size);
+        const Address expected_pc = stream == TRACE_PROGRAM ? address : last_pc[stream];
+        header |= code << SIZE_SHIFT;
+        if (current_pc != expected_pc) { header |= FLAG_PC; }
+        if (internal) { header |= FLAG_INTERNAL; }
+        buffer.push_back(header);
+        put_varint(buffer, zigzag((int64_t)(address - last_address[stream])));
+        if (code == SIZE_EXPLICIT) { put_varint(buffer, size); }
+        if (header & FLAG_PC) {
+            put_varint(buffer, zigzag((int64_t)(current_pc - expected_pc)));
+        }
+        last_address[stream] = address;
+        last_pc[stream] = current_pc;
+    }
+    if (buffer.size() >= WRITE_CHUNK) { flush(); }
+}
+
+void MemoryTraceWriter::flush() {
+    if (buffer.empty()) { return; }
+    if (file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size())
+        != (qint64)buffer.size()) {
+        buffer.clear();
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Write of memory trace file failed (") + file.fileName() + ")",
+            std::strerror(errno));
+    }
+    buffer.clear();
+    file.flush();
+}
+
+uint64_t MemoryTraceWriter::get_record_count() const {
+    return record_count;
+}
+
+MemoryTraceReader::MemoryTraceReader(const QString &file_name) : file(file_name) {
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Can't open memory trace file for reading (") + file_name + ")",
+            std::strerror(errno));
+    }
+    size = file.size();
+    // Whole trace is decoded sequentially, mapping avoids the copy.
+    data = file.map(0, size);
+    if (data == nullptr) {
+        data_copy.resize(size);
+        if (file.read(reinterpret_cast<char *>(data_copy.data()), size) != (qint64)size) {
+            throw SIMULATOR_EXCEPTION(
+                Input, QString("Read of memory trace file failed (") + file_name + ")",
+                std::strerror(errno));
+        }
+        data = data_copy.data();
+    }
+    if (size < HEADER_SIZE
+        || memcmp(data, MEMORY_TRACE_MAGIC, sizeof(MEMORY_TRACE_MAGIC)) != 0) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("File is not a memory trace (") + file_name + ")", "");
+    }
+    uint32_t version;
+    memcpy(&version, data + sizeof(MEMORY_TRACE_MAGIC), sizeof(version));
+    version = byteswap_if(version, NATIVE_ENDIAN != LITTLE);
+    if (version != MEMORY_TRACE_VERSION) {
+        throw SIMULATOR_EXCEPTION(
+            Input, QString("Unsupported memory trace version (") + file_name + ")",
+            QString("version %1, supported %2").arg(version).arg(MEMORY_TRACE_VERSION));
+    }
+    rewind();
+}
+
+void MemoryTraceReader::rewind() {
+    pos = HEADER_SIZE;
+    for (size_t i = 0; i < 2; i++) {
+        last_address[i] = Address::null();
+        last_pc[i] = Address::null();
+    }
+}
+
+uint64_t MemoryTraceReader::read_varint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) { break; }
+        uint8_t byte = data[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) { return value; }
+    }
+    throw SIMULATOR_EXCEPTION(
+        Input, QString("Memory trace is truncated (") + file.fileName() + ")", "");
+}
+
+bool MemoryTraceReader::next(MemoryTraceRecord &record) {
+    if (pos >= size) { return false; }
+    const uint8_t header = data[pos++];
+    record.kind = (MemoryTraceKind)(header & KIND_MASK);
+    record.stream = (MemoryTraceStream)((header >> STREAM_SHIFT) & 1);
+    record.internal = header & FLAG_INTERNAL;
+    if (record.kind == TRACE_SYNC || record.kind == TRACE_RESET) {
+        record.size = 0;
+        record.address = Address::null();
+        record.pc = Address::null();
+        return true;
+    }
+    const uint8_t code = (header >> SIZE_SHIFT) & SIZE_MASK;
+    Address &address = last_address[record.stream];
+    address += unzigzag(read_varint());
+    record.address = address;
+    record.size = code == SIZE_EXPLICIT ? read_varint() : 1U << code;
+    Address expected_pc = record.stream == TRACE_PROGRAM ? address : last_pc[record.stream];
+    if (header & FLAG_PC) { expected_pc += unzigzag(read_varint()); }
+    record.pc = last_pc[record.stream] = expected_pc;
+    return true;
+}
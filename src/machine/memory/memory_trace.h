@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#ifndef MEMORY_TRACE_H
+#define MEMORY_TRACE_H
+
+#include "memory/address.h"
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Trace of accesses seen by program and data cache.
+ *
+ * File starts with magic and format version followed by records. Each record
+ * starts with a header byte (kind, stream, size code, flags). Reads and writes
+ * continue with the address as a zigzag varint delta from the previous address
+ * of the same stream, then with the size (only if it is not a power of two up
+ * to 8) and the PC delta (only if the PC differs from the expected one; that is
+ * the address itself for the program stream and the previous PC for the data
+ * stream). A sequential fetch therefore takes two bytes.
+ *
+ * Cache state depends only on the recorded sequence, so replay into caches
+ * with the same configuration gives exactly the same statistics as the live
+ * run.
+ */
+constexpr char MEMORY_TRACE_MAGIC[8] = { 'Q', 't', 'M', 'i', 'p', 's', 'T', 'R' };
+constexpr uint32_t MEMORY_TRACE_VERSION = 1;
+
+enum MemoryTraceStream : uint8_t {
+    TRACE_PROGRAM = 0,
+    TRACE_DATA = 1,
+};
+
+enum MemoryTraceKind : uint8_t {
+    TRACE_READ = 0,
+    TRACE_WRITE = 1,
+    TRACE_SYNC = 2,  // Cache flush
+    TRACE_RESET = 3, // Cache reset (simulation restart)
+};
+
+struct MemoryTraceRecord {
+    MemoryTraceKind kind;
+    MemoryTraceStream stream;
+    bool internal; // Read without side effects (AccessEffects::INTERNAL)
+    uint32_t size;
+    Address address;
+    Address pc;
+};
+
+/**
+ * Records are buffered and streamed to the file, so the trace of long run does
+ * not have to fit into the memory.
+ */
+class MemoryTraceWriter {
+public:
+    explicit MemoryTraceWriter(const QString &file_name);
+    ~MemoryTraceWriter();
+
+    // Address of instruction accessing memory (see `Cache::set_access_pc`)
+    void set_pc(Address pc) {
+        current_pc = pc;
+    }
+
+    void record(
+        MemoryTraceKind kind,
+        MemoryTraceStream stream,
+        Address address = Address::null(),
+        size_t size = 0,
+        bool internal = false);
+
+    void flush();
+    uint64_t get_record_count() const;
+
+private:
+    QFile file;
+    std::vector<uint8_t> buffer;
+    Address current_pc;
+    Address last_address[2];
+    Address last_pc[2];
+    uint64_t record_count = 0;
+};
+
+class MemoryTraceReader {
+public:
+    explicit MemoryTraceReader(const QString &file_name);
+
+    // Returns false at the end of the trace
+    bool next(MemoryTraceRecord &record);
+    // Start again from the first record
+    void rewind();
+
+private:
+    QFile file;
+    const uint8_t *data = nullptr;
+    std::vector<uint8_t> data_copy; // Used when the file cannot be mapped
+    size_t size = 0;
+    size_t pos = 0;
+    Address last_address[2];
+    Address last_pc[2];
+
+    uint64_t read_varint();
+};
+
+} // namespace machine
+
+#endif // MEMORY_TRACE_H
@@ -125,6 +125,46 @@ struct WriteResult {
     }
 };
 
+/**
+ * Range of addresses (or device offsets) directly backed by host memory.
+ *
+ * Plain RAM hands these out so that `read_XX` and `write_XX` of the frontend
+ * memory can skip the chain of virtual accesses. A window with `host` set to
+ * nullptr marks a range which has to use the regular access path (periphery,
+ * unallocated memory). Writes through a window, which is not writable
+ * (shared copy on write storage), use the regular path too.
+ *
+ * Window is valid while `*generation` equals `valid_generation`, the owner of
+ * the storage bumps it whenever host storage moves or appears. Bus mapping the
+ * storage does the same with `map_generation` when its ranges change. Window
+ * without generations is valid until its holder drops it.
+ *
+ * Frontend passing accesses through (disabled cache) only counts them, it
+ * sets the access counters. Such window serves only regular (not internal)
+ * reads and writes of a word or less.
+ */
+struct DirectAccessWindow {
+    uint64_t start = UINT64_MAX;
+    uint64_t last = 0;
+    byte *host = nullptr; // Host memory corresponding to `start`.
+    bool writable = false;
+    const uint32_t *generation = nullptr;
+    uint32_t valid_generation = 0;
+    const uint32_t *map_generation = nullptr;
+    uint32_t valid_map_generation = 0;
+    // Counter incremented by direct writes, which change the memory.
+    uint32_t *change_counter = nullptr;
+    // Counters of direct reads and writes
+    uint32_t *read_counter = nullptr;
+    uint32_t *write_counter = nullptr;
+
+    inline bool covers(uint64_t address, size_t size) const {
+        return address >= start && address + (size - 1) <= last
+               && (generation == nullptr || *generation == valid_generation)
+               && (map_generation == nullptr || *map_generation == valid_map_generation);
+    }
+};
+
 /**
  * Perform n-byte read into periphery that only supports u32 access.
  *
@@ -66,8 +66,17 @@ ProgramLoader::ProgramLoader(const QString &file) : elf_file(file) {
                 + QString(")"),
             std::strerror(errno));
     }
+    // Map the whole file, loaded segments are then copied straight from the
+    // mapping. Mapping is private as libelf may modify the image in place.
+    // Fall back to reading by libelf when file cannot be mapped.
+    elf_image = elf_file.map(0, elf_file.size(), QFileDevice::MapPrivateOption);
+    if (elf_image != nullptr) {
+        this->elf = elf_memory(reinterpret_cast<char *>(elf_image), elf_file.size());
+    } else {
+        this->elf = elf_begin(elf_file.handle(), ELF_C_READ, nullptr);
+    }
     // Initialize elf
-    if (!(this->elf = elf_begin(elf_file.handle(), ELF_C_READ, nullptr))) {
+    if (!this->elf) {
         throw SIMULATOR_EXCEPTION(
             Input, "Elf read begin failed", elf_errmsg(-1));
     }
@@ -129,19 +138,24 @@ ProgramLoader::ProgramLoader(const char *file)
 ProgramLoader::~ProgramLoader() {
     // Close elf
     elf_end(this->elf);
-    // Close file
+    // Close file (removes mapping too)
     elf_file.close();
 }
 
 void ProgramLoader::to_memory(Memory *mem) {
-    // Load program to memory (just dump it byte by byte)
+    size_t file_size = 0;
+    const char *f = elf_rawfile(this->elf, &file_size);
+    // Load program to memory segment by segment. Part of segment past its
+    // file size (.bss) is not written, memory never written reads as zero.
     for (size_t phdrs_i : this->map) {
-        uint32_t base_address = this->phdrs[phdrs_i].p_vaddr;
-        char *f = elf_rawfile(this->elf, nullptr);
-        for (unsigned y = 0; y < this->phdrs[phdrs_i].p_filesz; y++) {
-            const auto buffer = (uint8_t)f[this->phdrs[phdrs_i].p_offset + y];
-            memory_write_u8(mem, base_address + y, buffer);
+        const Elf32_Phdr &phdr = this->phdrs[phdrs_i];
+        if (phdr.p_filesz == 0) { continue; }
+        if (phdr.p_offset > file_size || phdr.p_filesz > file_size - phdr.p_offset) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Elf program section exceeds file size",
+                QString::number(phdr.p_vaddr, 16));
         }
+        mem->write(phdr.p_vaddr, f + phdr.p_offset, phdr.p_filesz, { .type = ae::INTERNAL });
     }
 }
 
@@ -66,6 +66,7 @@ public:
 
 private:
     QFile elf_file;
+    uchar *elf_image = nullptr; // Private mapping of whole elf_file
     Elf *elf;
     GElf_Ehdr hdr {};    // elf file header
     size_t n_secs {};    // number of sections in elf program header
@@ -35,6 +35,7 @@
 
 #include "registers.h"
 
+#include "checkpoint.h"
 #include "memory/address.h"
 #include "simulator_exception.h"
 
@@ -156,3 +157,22 @@ void Registers::reset() {
     write_hi_lo(false, 0);
     write_hi_lo(true, 0);
 }
+
+void Registers::save_state(CheckpointWriter &writer) const {
+    writer.write_u64(pc.get_raw());
+    for (const auto &reg : gp) {
+        writer.write_u64(reg.as_u64());
+    }
+    writer.write_u64(hi.as_u64());
+    writer.write_u64(lo.as_u64());
+}
+
+void Registers::restore_state(CheckpointReader &reader) {
+    pc_abs_jmp(Address(reader.read_u64()));
+    reader.read_u64(); // Zero register
+    for (int i = 1; i < 32; i++) {
+        write_gp(i, reader.read_u64());
+    }
+    write_hi_lo(true, reader.read_u64());
+    write_hi_lo(false, reader.read_u64());
+}
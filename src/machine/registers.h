@@ -46,6 +46,9 @@
 
 namespace machine {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * General-purpose register count
  */
@@ -108,6 +111,9 @@ public:
 
     void reset(); // Reset all values to zero (except pc)
 
+    void save_state(CheckpointWriter &writer) const;
+    void restore_state(CheckpointReader &reader);
+
 signals:
     void pc_update(Address val);
     void gp_update(RegisterId reg, RegisterValue val);
@@ -118,6 +118,26 @@ bool SymbolTable::location_to_name(QString &name, SymbolValue value) const {
     return true;
 }
 
+// TODO cpp17 - return optional
+bool SymbolTable::location_to_symbol(
+    QString &name,
+    SymbolValue &offset,
+    SymbolValue value) const {
+    auto it = map_value_to_symbol.upperBound(value);
+    while (it != map_value_to_symbol.begin()) {
+        --it;
+        const SymbolTableEntry *p_entry = it.value();
+        if (p_entry->size == 0 || value - p_entry->value < p_entry->size) {
+            name = p_entry->name;
+            offset = value - p_entry->value;
+            return true;
+        }
+    }
+    name = "";
+    offset = 0;
+    return false;
+}
+
 QStringList SymbolTable::names() const {
     return map_name_to_symbol.keys();
 }
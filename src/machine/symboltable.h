@@ -103,6 +103,11 @@ public slots:
      * single location as it is multimap.
      */
     bool location_to_name(QString &name, SymbolValue value) const;
+    /**
+     * Find the symbol covering the location: the nearest one below it which
+     * has no size or whose size reaches the location.
+     */
+    bool location_to_symbol(QString &name, SymbolValue &offset, SymbolValue value) const;
 
 private:
     // QString cannot be made const, because it would not fit into QT gui API.
@@ -37,6 +37,7 @@
 #include "machine/memory/backend/memory.h"
 #include "machine/memory/cache/cache.h"
 #include "machine/memory/cache/cache_policy.h"
+#include "machine/memory/dram.h"
 #include "machine/memory/memory_bus.h"
 #include "tests/data/cache_test_performance_data.h"
 #include "tst_machine.h"
@@ -285,3 +286,589 @@ void MachineTests::cache_correctness() {
         QCOMPARE(performance, cache_test_performance_data.at(case_number));
     }
 }
+
+void MachineTests::cache_lookup_benchmark_data() {
+    QTest::addColumn<unsigned>("associativity");
+
+    for (unsigned associativity : { 1, 2, 4, 8, 16, 32 }) {
+        QTest::addRow("associativity=%u", associativity) << associativity;
+    }
+}
+
+void MachineTests::cache_lookup_benchmark() {
+    QFETCH(unsigned, associativity);
+
+    CacheConfig cache_config;
+    cache_config.set_enabled(true);
+    cache_config.set_set_count(16);
+    cache_config.set_block_size(2);
+    cache_config.set_associativity(associativity);
+    cache_config.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_config.set_write_policy(CacheConfig::WP_BACK);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_config);
+
+    // Working set fills all ways of every set, so each access is a hit which
+    // has to compare tags of the whole set.
+    const uint32_t way_bytes = 16 * 2 * 4;
+    const uint32_t block_count = 16 * associativity;
+    QBENCHMARK {
+        for (int k = 0; k < 100; k++) {
+            for (uint32_t i = 0; i < block_count; i++) {
+                Address address((i % associativity) * way_bytes + (i / associativity) * 8);
+                cache.read_u32(address);
+            }
+        }
+    }
+    QCOMPARE(cache.get_miss_count(), block_count);
+}
+
+void MachineTests::cache_publish_updates() {
+    CacheConfig cache_config;
+    cache_config.set_enabled(true);
+    cache_config.set_set_count(4);
+    cache_config.set_block_size(2);
+    cache_config.set_associativity(2);
+    cache_config.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_config.set_write_policy(CacheConfig::WP_BACK);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_config);
+
+    unsigned stats_updates = 0;
+    std::vector<pair<size_t, size_t>> lines;
+    size_t last_col = 0;
+    bool last_write = false;
+    QObject::connect(&cache, &Cache::statistics_update, [&stats_updates]() { stats_updates++; });
+    QObject::connect(
+        &cache, &Cache::cache_update,
+        [&](size_t way, size_t row, size_t col, bool, bool, size_t, const uint32_t *, bool write) {
+            lines.emplace_back(way, row);
+            last_col = col;
+            last_write = write;
+        });
+
+    // Two lines in set 0 and one line in set 1, all accessed many times
+    for (int i = 0; i < 10; i++) {
+        cache.read_u32(0x0_addr);
+        cache.read_u32(0x20_addr);
+        cache.write_u32(0xc_addr, i);
+    }
+    QCOMPARE(stats_updates, 0u);
+    QVERIFY(lines.empty());
+
+    cache.publish_updates();
+    QCOMPARE(stats_updates, 1u);
+    QCOMPARE(lines.size(), (size_t)3);
+    QCOMPARE(lines.back(), std::make_pair((size_t)0, (size_t)1));
+    QCOMPARE(last_col, (size_t)1);
+    QVERIFY(last_write);
+
+    // Nothing changed, nothing published
+    cache.publish_updates();
+    QCOMPARE(stats_updates, 1u);
+    QCOMPARE(lines.size(), (size_t)3);
+}
+
+void MachineTests::cache_miss_analysis() {
+    CacheConfig cache_config;
+    cache_config.set_enabled(true);
+    cache_config.set_set_count(4);
+    cache_config.set_block_size(2);
+    cache_config.set_associativity(1);
+    cache_config.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_config.set_write_policy(CacheConfig::WP_BACK);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_config);
+    QVERIFY(cache.get_miss_analysis() == nullptr);
+    cache.set_miss_analysis(true);
+    const CacheMissAnalysis *analysis = cache.get_miss_analysis();
+    QVERIFY(analysis != nullptr);
+
+    // Blocks 0 and 4 share set 0 of direct mapped cache
+    cache.set_access_pc(0x100_addr);
+    cache.read_u32(0x0_addr);
+    cache.read_u32(0x20_addr);
+    cache.set_access_pc(0x104_addr);
+    cache.read_u32(0x0_addr);
+    // Four more blocks push block 4 out of fully associative cache too
+    cache.set_access_pc(0x10c_addr);
+    cache.read_u32(0x8_addr);
+    cache.read_u32(0x10_addr);
+    cache.read_u32(0x18_addr);
+    cache.read_u32(0x28_addr);
+    cache.set_access_pc(0x108_addr);
+    cache.read_u32(0x20_addr);
+    cache.read_u32(0x24_addr);
+
+    QCOMPARE(cache.get_miss_count(), 8u);
+    QCOMPARE(analysis->get_miss_count(MISS_COMPULSORY), 6u);
+    QCOMPARE(analysis->get_miss_count(MISS_CAPACITY), 1u);
+    QCOMPARE(analysis->get_miss_count(MISS_CONFLICT), 1u);
+    const auto &pc_misses = analysis->get_pc_misses();
+    QCOMPARE(pc_misses.size(), (size_t)4);
+    QCOMPARE(pc_misses.at(0x100).count[MISS_COMPULSORY], 2u);
+    QCOMPARE(pc_misses.at(0x104).count[MISS_CONFLICT], 1u);
+    QCOMPARE(pc_misses.at(0x108).count[MISS_CAPACITY], 1u);
+    QCOMPARE(pc_misses.at(0x108).total(), 1u);
+    QCOMPARE(pc_misses.at(0x10c).count[MISS_COMPULSORY], 4u);
+
+    // Block seen before invalidation misses for capacity
+    cache.flush();
+    cache.read_u32(0x20_addr);
+    QCOMPARE(analysis->get_miss_count(MISS_CAPACITY), 2u);
+
+    cache.reset();
+    QCOMPARE(analysis->get_miss_count(MISS_CAPACITY), 0u);
+    QVERIFY(analysis->get_pc_misses().empty());
+    cache.read_u32(0x20_addr);
+    QCOMPARE(analysis->get_miss_count(MISS_COMPULSORY), 1u);
+}
+
+static CacheConfig hierarchy_cache_config(
+    unsigned sets,
+    unsigned block_size,
+    unsigned associativity,
+    CacheConfig::WritePolicy write_policy) {
+    CacheConfig config;
+    config.set_enabled(true);
+    config.set_set_count(sets);
+    config.set_block_size(block_size);
+    config.set_associativity(associativity);
+    config.set_replacement_policy(CacheConfig::RP_LRU);
+    config.set_write_policy(write_policy);
+    return config;
+}
+
+void MachineTests::cache_level2_data() {
+    QTest::addColumn<int>("inclusion");
+    QTest::addColumn<int>("l1_write");
+    QTest::addColumn<int>("l2_write");
+    const char *inclusion_names[] = { "nine", "inclusive", "exclusive" };
+    const char *write_names[] = { "wtna", "wta", "wb" };
+    for (int inclusion = 0; inclusion < 3; inclusion++) {
+        for (int l1_write = 0; l1_write < 3; l1_write++) {
+            for (int l2_write = 0; l2_write < 3; l2_write++) {
+                QTest::addRow(
+                    "%s, l1=%s, l2=%s", inclusion_names[inclusion], write_names[l1_write],
+                    write_names[l2_write])
+                    << inclusion << l1_write << l2_write;
+            }
+        }
+    }
+}
+
+/**
+ * Random reads and writes through level 1 and level 2 cache are compared
+ * with reference values, memory has to match them after both levels are
+ * flushed.
+ */
+void MachineTests::cache_level2() {
+    QFETCH(int, inclusion);
+    QFETCH(int, l1_write);
+    QFETCH(int, l2_write);
+
+    const auto ci = (MachineConfig::CacheInclusion)inclusion;
+    const CacheConfig l1_config
+        = hierarchy_cache_config(2, 2, 2, (CacheConfig::WritePolicy)l1_write);
+    const CacheConfig l2_config = hierarchy_cache_config(
+        4, ci == MachineConfig::CI_EXCLUSIVE ? 2 : 4, 2, (CacheConfig::WritePolicy)l2_write);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache l2(&m_frontend, &l2_config);
+    Cache l1(&l2, &l1_config);
+    l2.add_upper_level(&l1, ci);
+
+    std::vector<uint32_t> reference(64, 0);
+    uint32_t random = 1;
+    for (int i = 0; i < 4000; i++) {
+        random = random * 1103515245 + 12345;
+        const size_t word = (random >> 8) % reference.size();
+        const Address address(word * 4);
+        if ((random >> 20) % 3 == 0) {
+            reference[word] = random;
+            l1.write_u32(address, random);
+        } else {
+            QCOMPARE(l1.read_u32(address), reference[word]);
+        }
+    }
+
+    l1.flush();
+    l2.flush();
+    for (size_t word = 0; word < reference.size(); word++) {
+        QCOMPARE(m_frontend.read_u32(Address(word * 4)), reference[word]);
+    }
+}
+
+void MachineTests::cache_level2_inclusion() {
+    const CacheConfig l1_config = hierarchy_cache_config(1, 2, 2, CacheConfig::WP_BACK);
+    const CacheConfig l2_config = hierarchy_cache_config(1, 2, 1, CacheConfig::WP_BACK);
+
+    // Level 2 has single line, its eviction removes the block from level 1
+    {
+        Memory m(BIG);
+        TrivialBus m_frontend(&m);
+        Cache l2(&m_frontend, &l2_config);
+        Cache l1(&l2, &l1_config);
+        l2.add_upper_level(&l1, MachineConfig::CI_INCLUSIVE);
+        l1.write_u32(0x0_addr, 0x1234);
+        l1.read_u32(0x8_addr);
+        QCOMPARE(m_frontend.read_u32(0x0_addr), 0x1234u);
+        QCOMPARE(l1.read_u32(0x0_addr), 0x1234u);
+        QCOMPARE(l1.get_miss_count(), 3u);
+    }
+    {
+        Memory m(BIG);
+        TrivialBus m_frontend(&m);
+        Cache l2(&m_frontend, &l2_config);
+        Cache l1(&l2, &l1_config);
+        l1.write_u32(0x0_addr, 0x1234);
+        l1.read_u32(0x8_addr);
+        QCOMPARE(m_frontend.read_u32(0x0_addr), 0u);
+        QCOMPARE(l1.read_u32(0x0_addr), 0x1234u);
+        QCOMPARE(l1.get_miss_count(), 2u);
+    }
+
+    // Level 2 holds blocks evicted from single line level 1
+    const CacheConfig l1_single = hierarchy_cache_config(1, 2, 1, CacheConfig::WP_BACK);
+    const CacheConfig l2_victim = hierarchy_cache_config(1, 2, 2, CacheConfig::WP_BACK);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache l2(&m_frontend, &l2_victim);
+    Cache l1(&l2, &l1_single);
+    l2.add_upper_level(&l1, MachineConfig::CI_EXCLUSIVE);
+    l1.write_u32(0x0_addr, 0x1234);
+    l1.read_u32(0x8_addr);
+    QCOMPARE(l2.get_miss_count(), 2u);
+    QVERIFY(l2.location_status(0x0_addr) & LOCSTAT_DIRTY);
+    QCOMPARE(l1.read_u32(0x0_addr), 0x1234u);
+    QCOMPARE(l2.get_hit_count(), 1u);
+    QVERIFY(!(l2.location_status(0x0_addr) & LOCSTAT_CACHED));
+    QVERIFY(l2.location_status(0x8_addr) & LOCSTAT_CACHED);
+    QCOMPARE(m_frontend.read_u32(0x0_addr), 0x1234u);
+}
+
+void MachineTests::cache_prefetch_data() {
+    QTest::addColumn<int>("prefetch");
+    QTest::addColumn<int>("write");
+    const char *prefetch_names[] = { "none", "next-line", "stride", "stream" };
+    const char *write_names[] = { "wtna", "wta", "wb" };
+    for (int prefetch = 0; prefetch < 4; prefetch++) {
+        for (int write = 0; write < 3; write++) {
+            QTest::addRow("%s, %s", prefetch_names[prefetch], write_names[write])
+                << prefetch << write;
+        }
+    }
+}
+
+/**
+ * Prefetching must not change values seen by the program, random strided
+ * accesses are compared with reference values and memory after flush.
+ */
+void MachineTests::cache_prefetch() {
+    QFETCH(int, prefetch);
+    QFETCH(int, write);
+
+    CacheConfig config = hierarchy_cache_config(4, 2, 2, (CacheConfig::WritePolicy)write);
+    config.set_prefetch_policy((CacheConfig::PrefetchPolicy)prefetch);
+    config.set_prefetch_degree(2);
+    config.set_prefetch_distance(2);
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &config);
+
+    std::vector<uint32_t> reference(256, 0);
+    uint32_t random = 1;
+    size_t word = 0;
+    for (int i = 0; i < 4000; i++) {
+        random = random * 1103515245 + 12345;
+        // Mostly sequential with occasional jumps, so prefetchers have work
+        word = ((random >> 24) % 8 == 0) ? (random >> 8) : word + 1 + (random >> 28) % 3;
+        word %= reference.size();
+        cache.set_access_pc(Address(0x100 + 4 * ((random >> 16) % 4)));
+        const Address address(word * 4);
+        if ((random >> 20) % 3 == 0) {
+            reference[word] = random;
+            cache.write_u32(address, random);
+        } else {
+            QCOMPARE(cache.read_u32(address), reference[word]);
+        }
+    }
+
+    if (prefetch != CacheConfig::PF_NONE) {
+        QVERIFY(cache.get_prefetch_count() > 0);
+    }
+    QVERIFY(
+        cache.get_prefetch_useful_count() + cache.get_prefetch_useless_count()
+        <= cache.get_prefetch_count());
+    cache.flush();
+    for (size_t i = 0; i < reference.size(); i++) {
+        QCOMPARE(m_frontend.read_u32(Address(i * 4)), reference[i]);
+    }
+}
+
+void MachineTests::cache_prefetch_policies() {
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+
+    // Every block of sequential reads is prefetched by its predecessor
+    CacheConfig config = hierarchy_cache_config(16, 2, 1, CacheConfig::WP_BACK);
+    config.set_prefetch_policy(CacheConfig::PF_NEXT_LINE);
+    {
+        Cache cache(&m_frontend, &config);
+        for (uint32_t address = 0; address < 0x80; address += 4) {
+            cache.read_u32(Address(address));
+        }
+        QCOMPARE(cache.get_miss_count(), 1u);
+        QCOMPARE(cache.get_prefetch_count(), 16u);
+        QCOMPARE(cache.get_prefetch_useful_count(), 15u);
+        QCOMPARE(cache.get_prefetch_late_count(), 0u);
+        // Prefetch fills are charged as memory reads
+        QCOMPARE(cache.get_read_count(), 34u);
+        QCOMPARE(cache.get_prefetch_accuracy(), 15.0 / 16.0 * 100.0);
+        QCOMPARE(cache.get_prefetch_coverage(), 15.0 / 16.0 * 100.0);
+
+        // Nothing is prefetched from uncached area
+        cache.reset();
+        cache.read_u32(0xeffffffc_addr);
+        QCOMPARE(cache.get_prefetch_count(), 0u);
+    }
+    {
+        // Slow memory cannot deliver the block within two accesses
+        Cache cache(&m_frontend, &config, 3, 3, 3);
+        for (uint32_t address = 0; address < 0x80; address += 4) {
+            cache.read_u32(Address(address));
+        }
+        QCOMPARE(cache.get_prefetch_late_count(), 15u);
+        QCOMPARE(cache.get_prefetch_timeliness(), 0.0);
+    }
+
+    // Only the instruction with constant stride is predicted
+    config = hierarchy_cache_config(64, 1, 1, CacheConfig::WP_BACK);
+    config.set_prefetch_policy(CacheConfig::PF_STRIDE);
+    {
+        Cache cache(&m_frontend, &config);
+        for (uint32_t address = 0; address < 96; address += 12) {
+            cache.set_access_pc(0x104_addr);
+            cache.read_u32(Address(address));
+            cache.set_access_pc(0x200_addr);
+            cache.read_u32(0x400_addr);
+        }
+        QCOMPARE(cache.get_miss_count(), 5u);
+        QCOMPARE(cache.get_prefetch_count(), 5u);
+        QCOMPARE(cache.get_prefetch_useful_count(), 4u);
+        QCOMPARE(cache.get_read_count(), 10u);
+        cache.flush();
+        QCOMPARE(cache.get_prefetch_useless_count(), 1u);
+    }
+
+    // Stream runs up to four blocks ahead, two blocks at a time
+    config = hierarchy_cache_config(16, 2, 1, CacheConfig::WP_BACK);
+    config.set_prefetch_policy(CacheConfig::PF_STREAM);
+    config.set_prefetch_degree(2);
+    config.set_prefetch_distance(4);
+    {
+        Cache cache(&m_frontend, &config);
+        for (uint32_t address = 0; address < 0x40; address += 8) {
+            cache.read_u32(Address(address));
+        }
+        QCOMPARE(cache.get_miss_count(), 1u);
+        QCOMPARE(cache.get_hit_count(), 7u);
+        QCOMPARE(cache.get_prefetch_count(), 11u);
+        QCOMPARE(cache.get_prefetch_useful_count(), 7u);
+        cache.reset();
+        QCOMPARE(cache.get_prefetch_count(), 0u);
+        QCOMPARE(cache.get_prefetch_useful_count(), 0u);
+    }
+}
+
+void MachineTests::cache_wait_cycles() {
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+
+    CacheConfig config = hierarchy_cache_config(4, 2, 1, CacheConfig::WP_BACK);
+    {
+        Cache cache(&m_frontend, &config, 10, 10, 0);
+        cache.read_u32(0x0_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)20);
+        cache.write_u32(0x4_addr, 1);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)20);
+        // Dirty block is written back before the miss is served
+        cache.read_u32(0x20_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)60);
+        // Uncached access waits less the cycle of cache access
+        cache.read_u32(0xf0000000_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)69);
+    }
+    {
+        // Burst transfers following words faster
+        Cache cache(&m_frontend, &config, 10, 10, 2);
+        cache.read_u32(0x0_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)12);
+    }
+    config.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
+    {
+        Cache cache(&m_frontend, &config, 10, 10, 0);
+        cache.write_u32(0x0_addr, 1);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)9);
+    }
+
+    // Level 1 waits for level 2 hit time and level 2 for memory
+    config = hierarchy_cache_config(4, 2, 1, CacheConfig::WP_BACK);
+    {
+        Cache l2(&m_frontend, &config, 10, 10, 0);
+        Cache l1(&l2, &config, 4, 4, 0);
+        l1.read_u32(0x0_addr);
+        QCOMPARE(l1.get_wait_cycles(), (uint64_t)28);
+        QCOMPARE(l2.get_wait_cycles(), (uint64_t)20);
+    }
+
+    // Prefetch fill does not wait, too early use waits for the rest
+    config.set_prefetch_policy(CacheConfig::PF_NEXT_LINE);
+    {
+        Cache cache(&m_frontend, &config, 10, 10, 0);
+        cache.read_u32(0x0_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)20);
+        cache.read_u32(0x8_addr);
+        QCOMPARE(cache.get_prefetch_late_count(), 1u);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)39);
+    }
+}
+
+void MachineTests::cache_direct_access() {
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    CacheConfig config;
+    config.set_enabled(false);
+
+    // Disabled cache accounts direct accesses the same as passed through ones
+    Cache cache(&m_frontend, &config, 10, 10, 2);
+    Cache reference(&m_frontend, &config, 10, 10, 2);
+    cache.write_u32(0x100_addr, 0x01020304);
+    cache.write_u32(0x104_addr, 0x05060708);
+    QVERIFY(cache.direct_access_window(0x100_addr).host != nullptr);
+    QCOMPARE(cache.read_u32(0x100_addr), (uint32_t)0x01020304);
+    QCOMPARE(cache.read_u8(0x105_addr), (uint8_t)0x06);
+    QCOMPARE(cache.read_u32(0x104_addr, ae::INTERNAL), (uint32_t)0x05060708);
+    QCOMPARE(cache.read_u64(0x100_addr), (uint64_t)0x0102030405060708);
+    uint32_t word = 0;
+    uint64_t dword = 0;
+    reference.write(0x100_addr, &word, sizeof(word), {});
+    reference.write(0x104_addr, &word, sizeof(word), {});
+    reference.read(&word, 0x100_addr, sizeof(word), { .type = ae::REGULAR });
+    reference.read(&word, 0x105_addr, 1, { .type = ae::REGULAR });
+    reference.read(&word, 0x104_addr, sizeof(word), { .type = ae::INTERNAL });
+    reference.read(&dword, 0x100_addr, sizeof(dword), { .type = ae::REGULAR });
+    QCOMPARE(cache.get_read_count(), 4u);
+    QCOMPARE(cache.get_write_count(), 2u);
+    QCOMPARE(cache.get_read_count(), reference.get_read_count());
+    QCOMPARE(cache.get_write_count(), reference.get_write_count());
+    QCOMPARE(cache.get_wait_cycles(), reference.get_wait_cycles());
+    QCOMPARE(cache.get_stall_count(), reference.get_stall_count());
+
+    cache.reset();
+    cache.read_u32(0x100_addr);
+    QCOMPARE(cache.get_read_count(), 1u);
+
+    config.set_enabled(true);
+    Cache enabled(&m_frontend, &config, 10, 10, 2);
+    QVERIFY(enabled.direct_access_window(0x100_addr).host == nullptr);
+}
+
+static MachineConfig dram_test_config(MachineConfig::DramPagePolicy policy, unsigned queue) {
+    MachineConfig config;
+    config.set_dram_enabled(true);
+    config.set_dram_banks(2);
+    config.set_dram_row_size(64);
+    config.set_dram_page_policy(policy);
+    config.set_dram_t_rcd(3);
+    config.set_dram_t_cas(2);
+    config.set_dram_t_rp(4);
+    config.set_dram_write_queue(queue);
+    return config;
+}
+
+void MachineTests::dram_timing() {
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+
+    {
+        Dram dram(&m_frontend, dram_test_config(MachineConfig::DP_OPEN, 0));
+        dram.read_u32(0x0_addr); // Bank 0 opens row 0
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)5);
+        dram.read_u32(0x4_addr);
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)7);
+        dram.read_u32(0x40_addr); // Next row is in bank 1
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)12);
+        dram.read_u32(0x80_addr); // Bank 0 closes row 0 and opens row 1
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)21);
+        // Words following the first one take burst time
+        uint32_t block[4];
+        dram.read(block, 0x90_addr, sizeof(block), { .type = ae::REGULAR });
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)26);
+        dram.read_u32(0x0_addr, ae::INTERNAL);
+        dram.write_u32(0xf0000000_addr, 1);
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)26);
+
+        QCOMPARE(dram.get_read_count(), 5u);
+        QCOMPARE(dram.get_row_hit_count(), 2u);
+        QCOMPARE(dram.get_row_miss_count(), 2u);
+        QCOMPARE(dram.get_row_conflict_count(), 1u);
+        QCOMPARE(dram.get_row_hit_rate(), 40.0);
+        QCOMPARE(dram.get_average_latency(), 26.0 / 5);
+        dram.reset();
+        QCOMPARE(dram.get_read_count(), 0u);
+        dram.read_u32(0x84_addr);
+        QCOMPARE(dram.get_row_miss_count(), 1u);
+    }
+    {
+        // Every access opens the row again
+        Dram dram(&m_frontend, dram_test_config(MachineConfig::DP_CLOSED, 0));
+        dram.read_u32(0x0_addr);
+        dram.read_u32(0x4_addr);
+        dram.write_u32(0x80_addr, 1);
+        QCOMPARE(dram.get_wait_cycles(), (uint64_t)15);
+        QCOMPARE(dram.get_row_miss_count(), 3u);
+        QCOMPARE(dram.get_row_hit_rate(), 0.0);
+    }
+    {
+        // Cache waits for DRAM latency instead of its access penalties
+        Dram dram(&m_frontend, dram_test_config(MachineConfig::DP_OPEN, 0));
+        CacheConfig config = hierarchy_cache_config(4, 2, 1, CacheConfig::WP_BACK);
+        Cache cache(&dram, &config, 10, 10, 0);
+        cache.read_u32(0x0_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)6);
+        cache.read_u32(0x8_addr);
+        QCOMPARE(cache.get_wait_cycles(), (uint64_t)9);
+    }
+}
+
+void MachineTests::dram_write_queue() {
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Dram dram(&m_frontend, dram_test_config(MachineConfig::DP_OPEN, 2));
+
+    dram.read_u32(0x0_addr);
+    dram.write_u32(0x80_addr, 1);
+    dram.write_u32(0x8_addr, 2);
+    QCOMPARE(dram.get_wait_cycles(), (uint64_t)5);
+    QCOMPARE(dram.get_write_count(), 0u);
+    QCOMPARE(m_frontend.read_u32(0x80_addr), 1u);
+
+    // Full queue is drained, write to the open row goes first
+    dram.write_u32(0x44_addr, 3);
+    QCOMPARE(dram.get_wait_cycles(), (uint64_t)16);
+    QCOMPARE(dram.get_write_count(), 2u);
+    QCOMPARE(dram.get_drain_count(), 1u);
+    QCOMPARE(dram.get_row_hit_count(), 1u);
+    QCOMPARE(dram.get_row_conflict_count(), 1u);
+
+    dram.sync();
+    QCOMPARE(dram.get_wait_cycles(), (uint64_t)21);
+    QCOMPARE(dram.get_write_count(), 3u);
+    QCOMPARE(dram.get_drain_count(), 2u);
+    dram.sync();
+    QCOMPARE(dram.get_drain_count(), 2u);
+}
@@ -0,0 +1,393 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "machine/checkpoint.h"
+#include "machine/machine.h"
+#include "tst_machine.h"
+#include "utils/test_executable.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QVector>
+
+using namespace machine;
+
+static const char *CHECKPOINT_NAME = "checkpoint_test.cpt";
+
+static QVector<uint32_t> checkpoint_test_code() {
+    // Endless loop storing and loading growing array, $1 stays zero
+    return {
+        Instruction(9, 2, 2, 1).data(),                // ADDIU $2, $2, 1
+        Instruction(0, 3, 2, 3, 0, 33).data(),         // ADDU $3, $3, $2
+        Instruction(43, 4, 3, 0).data(),               // SW $3, 0($4)
+        Instruction(9, 4, 4, 4).data(),                // ADDIU $4, $4, 4
+        Instruction(35, 4, 5, (uint16_t)-4).data(),    // LW $5, -4($4)
+        Instruction(5, 2, 1, (uint16_t)-6).data(),     // BNE $2, $1, -6
+        Instruction(0).data(),                         // NOP
+    };
+}
+
+static void checkpoint_test_program(Machine &machine) {
+    Address addr = machine.registers()->read_pc();
+    foreach (uint32_t i, checkpoint_test_code()) {
+        machine.memory_data_bus_rw()->write_u32(addr, i, AccessEffects::INTERNAL);
+        addr += 4;
+    }
+}
+
+void MachineTests::checkpoint_save_restore_data() {
+    QTest::addColumn<bool>("pipelined");
+    QTest::addColumn<CacheConfig>("cache");
+    QTest::addColumn<QString>("predictor"); // Empty for core with delay slot
+
+    CacheConfig cache;
+    QTest::newRow("single") << false << cache << QString();
+    cache.set_enabled(true);
+    cache.set_set_count(4);
+    cache.set_block_size(2);
+    cache.set_associativity(2);
+    cache.set_replacement_policy(CacheConfig::RP_LRU);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    QTest::newRow("pipelined, lru, write back") << true << cache << QString();
+    cache.set_replacement_policy(CacheConfig::RP_LFU);
+    cache.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+    QTest::newRow("pipelined, lfu, write through") << true << cache << QString();
+    cache.set_prefetch_policy(CacheConfig::PF_STRIDE);
+    QTest::newRow("pipelined, stride prefetch") << true << cache << QString();
+    cache.set_prefetch_policy(CacheConfig::PF_STREAM);
+    cache.set_prefetch_degree(2);
+    QTest::newRow("pipelined, stream prefetch") << true << cache << QString();
+    QTest::newRow("pipelined, gshare") << true << cache << QString("gshare");
+    QTest::newRow("pipelined, tournament") << true << cache << QString("tournament");
+}
+
+static MachineConfig checkpoint_test_config(
+    bool pipelined,
+    const CacheConfig &cache,
+    const QString &predictor) {
+    MachineConfig config;
+    config.set_pipelined(pipelined);
+    config.set_cache_program(cache);
+    config.set_cache_data(cache);
+    if (!predictor.isEmpty()) {
+        config.set_delay_slot(false);
+        config.set_branch_predictor(predictor);
+    }
+    return config;
+}
+
+void MachineTests::checkpoint_save_restore() {
+    QFETCH(bool, pipelined);
+    QFETCH(CacheConfig, cache);
+    QFETCH(QString, predictor);
+
+    MachineConfig config = checkpoint_test_config(pipelined, cache, predictor);
+
+    Machine machine(config, false, false);
+    checkpoint_test_program(machine);
+    for (int i = 0; i < 500; i++) {
+        machine.step();
+    }
+    machine.save_checkpoint(CHECKPOINT_NAME);
+
+    for (int i = 0; i < 300; i++) {
+        machine.step();
+    }
+
+    // Fresh machine without the program gets everything from the checkpoint.
+    Machine restored(config, false, false);
+    restored.restore_checkpoint(CHECKPOINT_NAME);
+    QFile::remove(CHECKPOINT_NAME);
+    QCOMPARE(restored.core()->get_cycle_count(), 500u);
+    for (int i = 0; i < 300; i++) {
+        restored.step();
+    }
+
+    QVERIFY(*restored.registers() == *machine.registers());
+    for (int i = Cop0State::UserLocal; i < Cop0State::COP0REGS_CNT; i++) {
+        QCOMPARE(
+            restored.cop0state()->read_cop0reg((Cop0State::Cop0Registers)i),
+            machine.cop0state()->read_cop0reg((Cop0State::Cop0Registers)i));
+    }
+    QVERIFY(*restored.memory() == *machine.memory());
+    QCOMPARE(restored.core()->get_cycle_count(), machine.core()->get_cycle_count());
+    QCOMPARE(restored.core()->get_stall_count(), machine.core()->get_stall_count());
+    if (!predictor.isEmpty()) {
+        QCOMPARE(
+            restored.core()->get_branch_prediction()->get_mispredicted_count(),
+            machine.core()->get_branch_prediction()->get_mispredicted_count());
+    }
+    for (auto caches : { std::make_pair(restored.cache_program(), machine.cache_program()),
+                         std::make_pair(restored.cache_data(), machine.cache_data()) }) {
+        QCOMPARE(caches.first->get_hit_count(), caches.second->get_hit_count());
+        QCOMPARE(caches.first->get_miss_count(), caches.second->get_miss_count());
+        QCOMPARE(caches.first->get_read_count(), caches.second->get_read_count());
+        QCOMPARE(caches.first->get_write_count(), caches.second->get_write_count());
+        QCOMPARE(caches.first->get_prefetch_count(), caches.second->get_prefetch_count());
+        QCOMPARE(
+            caches.first->get_prefetch_useful_count(),
+            caches.second->get_prefetch_useful_count());
+    }
+    // Dirty lines have to be restored too, flush them and compare memory again.
+    restored.cache_sync();
+    machine.cache_sync();
+    QVERIFY(*restored.memory() == *machine.memory());
+}
+
+void MachineTests::checkpoint_invalid() {
+    CacheConfig cache;
+    cache.set_enabled(true);
+    cache.set_set_count(4);
+    cache.set_block_size(2);
+    cache.set_associativity(2);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    MachineConfig config;
+    config.set_pipelined(true);
+    config.set_cache_program(cache);
+    config.set_cache_data(cache);
+    config.set_cache_level2(cache);
+    config.set_cache_level2_inclusion(MachineConfig::CI_INCLUSIVE);
+    config.set_dram_enabled(true);
+    Machine machine(config, false, false);
+    checkpoint_test_program(machine);
+    machine.step();
+    machine.save_checkpoint(CHECKPOINT_NAME);
+
+    // Checkpoint restores only into machine with the same structure and timing
+    std::vector<MachineConfig> others(6, config);
+    others[0].set_pipelined(false);
+    cache.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+    others[1].set_cache_data(cache);
+    others[2].set_memory_stalls(true);
+    others[3].set_cache_level2_inclusion(MachineConfig::CI_NINE);
+    others[4].set_dram_t_cas(config.dram_t_cas() + 1);
+    others[5].set_dram_t_rp(config.dram_t_rp() + 1);
+    for (const MachineConfig &other_config : others) {
+        Machine other(other_config, false, false);
+        QVERIFY_EXCEPTION_THROWN(
+            other.restore_checkpoint(CHECKPOINT_NAME), SimulatorExceptionInput);
+    }
+    Machine same(config, false, false);
+    same.restore_checkpoint(CHECKPOINT_NAME);
+
+    QFile file(CHECKPOINT_NAME);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("QtMipsCP", 8);
+    file.close();
+    QVERIFY_EXCEPTION_THROWN(
+        machine.restore_checkpoint(CHECKPOINT_NAME), SimulatorExceptionInput);
+    QFile::remove(CHECKPOINT_NAME);
+}
+
+void MachineTests::checkpoint_step_back_data() {
+    checkpoint_save_restore_data();
+}
+
+void MachineTests::checkpoint_step_back() {
+    QFETCH(bool, pipelined);
+    QFETCH(CacheConfig, cache);
+    QFETCH(QString, predictor);
+
+    MachineConfig config = checkpoint_test_config(pipelined, cache, predictor);
+
+    Machine machine(config, false, false);
+    checkpoint_test_program(machine);
+    machine.set_history(16 << 20, 64);
+    Machine reference(config, false, false);
+    checkpoint_test_program(reference);
+
+    for (int i = 0; i < 500; i++) {
+        machine.step();
+    }
+    QVERIFY(machine.step_back(137));
+    QCOMPARE(machine.core()->get_cycle_count(), 363u);
+    QCOMPARE(machine.status(), Machine::ST_READY);
+    for (int i = 0; i < 2; i++) {
+        // Compare with the reference at 363 cycles, then again at 500 cycles
+        // after the run continues from the past.
+        while (reference.core()->get_cycle_count() < machine.core()->get_cycle_count()) {
+            reference.step();
+        }
+        QVERIFY(*machine.registers() == *reference.registers());
+        QVERIFY(*machine.memory() == *reference.memory());
+        QCOMPARE(machine.core()->get_stall_count(), reference.core()->get_stall_count());
+        QCOMPARE(
+            machine.cop0state()->read_cop0reg(Cop0State::Count),
+            reference.cop0state()->read_cop0reg(Cop0State::Count));
+        for (auto caches : { std::make_pair(machine.cache_program(), reference.cache_program()),
+                             std::make_pair(machine.cache_data(), reference.cache_data()) }) {
+            QCOMPARE(caches.first->get_hit_count(), caches.second->get_hit_count());
+            QCOMPARE(caches.first->get_miss_count(), caches.second->get_miss_count());
+        }
+        for (int j = 0; j < 137; j++) {
+            machine.step();
+        }
+    }
+
+    // Single cycle steps back over a snapshot boundary
+    for (int i = 0; i < 70; i++) {
+        QVERIFY(machine.step_back());
+    }
+    QCOMPARE(machine.core()->get_cycle_count(), 567u);
+    QVERIFY(machine.step_back(1000));
+    QCOMPARE(machine.core()->get_cycle_count(), 0u);
+    QVERIFY(!machine.can_step_back());
+}
+
+void MachineTests::checkpoint_history_budget() {
+    MachineConfig config;
+    config.set_pipelined(true);
+    Machine machine(config, false, false);
+    checkpoint_test_program(machine);
+    const size_t budget = 1 << 20;
+    machine.set_history(budget, 16);
+    for (int i = 0; i < 4000; i++) {
+        machine.step();
+    }
+    const MachineHistory *history = machine.history();
+    QVERIFY(history->size() > 1);
+    QVERIFY(history->size() < 4000 / 16);
+    QVERIFY(history->size_bytes() <= budget);
+
+    // Oldest snapshots are gone, step back stops at the oldest one.
+    QVERIFY(!machine.step_back(4000));
+    QVERIFY(machine.step_back(16));
+    QCOMPARE(machine.core()->get_cycle_count(), 3984u);
+
+    machine.set_history(0);
+    QVERIFY(machine.history() == nullptr);
+    QVERIFY(!machine.step_back());
+}
+
+/**
+ * Restart reverts memory to the loaded executable also after snapshots shared
+ * sections written by the program, including ones outside of the executable.
+ */
+void MachineTests::checkpoint_history_restart() {
+    std::vector<char> content;
+    foreach (uint32_t i, checkpoint_test_code()) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            content.push_back((char)(i >> shift));
+        }
+    }
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("checkpoint_history_restart.elf"));
+    QVERIFY(write_test_executable(file, 0x80020000, content, content.size()));
+
+    MachineConfig config;
+    config.set_pipelined(true);
+    config.set_elf(file.fileName());
+    Machine machine(config, false, true);
+    machine.set_history(16 << 20, 64);
+    Machine reference(config, false, true);
+    for (int restart = 0; restart < 2; restart++) {
+        for (int i = 0; i < 1000; i++) {
+            machine.step();
+        }
+        QVERIFY(machine.history()->size() > 8);
+        QVERIFY(machine.registers()->read_gp(4).as_u32() > 0);
+        machine.restart();
+        QVERIFY(*machine.memory() == *reference.memory());
+        QVERIFY(*machine.registers() == *reference.registers());
+        QCOMPARE(machine.core()->get_cycle_count(), 0u);
+    }
+    for (int i = 0; i < 500; i++) {
+        machine.step();
+        reference.step();
+    }
+    QVERIFY(*machine.memory() == *reference.memory());
+    QVERIFY(*machine.registers() == *reference.registers());
+}
+
+/**
+ * Serial port input is not recorded in history, step back refuses to replay
+ * over the cycle a byte was received at and replay leaves new input queued.
+ */
+void MachineTests::checkpoint_history_serial_input() {
+    MachineConfig config;
+    Machine machine(config, false, false);
+    Address addr = machine.registers()->read_pc();
+    for (uint32_t i : {
+             Instruction(35, 0, 5, 0xc004).data(),          // LW $5, 0xc004($0)
+             Instruction(0, 3, 5, 3, 0, 33).data(),         // ADDU $3, $3, $5
+             Instruction(9, 2, 2, 1).data(),                // ADDIU $2, $2, 1
+             Instruction(5, 2, 1, (uint16_t)-4).data(),     // BNE $2, $1, -4
+             Instruction(0).data(),                         // NOP
+         }) {
+        machine.memory_data_bus_rw()->write_u32(addr, i, AccessEffects::INTERNAL);
+        addr += 4;
+    }
+    machine.set_history(16 << 20, 16);
+    QVector<unsigned> input;
+    QObject::connect(
+        machine.serial_port(), &SerialPort::rx_byte_pool,
+        [&input](int, unsigned int &data, bool &available) {
+            available = !input.isEmpty();
+            if (available) {
+                data = input.takeFirst();
+            }
+        });
+
+    for (int i = 0; i < 100; i++) {
+        machine.step();
+    }
+    QVERIFY(machine.step_back(50));
+    for (int i = 0; i < 50; i++) {
+        machine.step();
+    }
+    input.append('a');
+    for (int i = 0; i < 100; i++) {
+        machine.step();
+    }
+    QVERIFY(input.isEmpty());
+    QCOMPARE(machine.registers()->read_gp(3).as_u32(), (uint32_t)'a');
+
+    // Replay from the snapshot taken after the byte arrived
+    input.append('b');
+    QVERIFY(machine.step_back(20));
+    QCOMPARE(machine.core()->get_cycle_count(), 180u);
+    QCOMPARE(input.size(), 1);
+    QCOMPARE(machine.registers()->read_gp(3).as_u32(), (uint32_t)'a');
+
+    QVERIFY(!machine.step_back(100));
+    QCOMPARE(machine.core()->get_cycle_count(), 180u);
+    QVERIFY(machine.can_step_back());
+    for (int i = 0; i < 8; i++) {
+        machine.step();
+    }
+    QVERIFY(input.isEmpty());
+    QCOMPARE(machine.registers()->read_gp(3).as_u32(), (uint32_t)('a' + 'b'));
+}
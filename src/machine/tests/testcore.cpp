@@ -673,7 +673,8 @@ static void run_code_fragment(
     Registers &reg_res,
     Memory &mem_init,
     Memory &mem_res,
-    QVector<uint32_t> &code) {
+    QVector<uint32_t> &code,
+    int drain_cycles = 6) {
     uint64_t addr = reg_init.read_pc().get_raw();
 
     foreach (uint32_t i, code) {
@@ -685,11 +686,11 @@ static void run_code_fragment(
     for (int k = 10000; k; k--) {
         core.step(); // Single step should be enought as this is risc without
                      // pipeline
-        if (reg_init.read_pc() == reg_res.read_pc() && k > 6) { // reached end
-                                                                // of
-                                                                // the code
-                                                                // fragment
-            k = 6; // add some cycles to finish processing
+        if (reg_init.read_pc() == reg_res.read_pc() && k > drain_cycles) { // reached end
+                                                                           // of
+                                                                           // the code
+                                                                           // fragment
+            k = drain_cycles; // add some cycles to finish processing
         }
     }
     reg_res.pc_abs_jmp(reg_init.read_pc()); // We do not compare result pc
@@ -1154,3 +1155,581 @@ void MachineTests::pipecore_wb_memory_tests() {
         &reg_init, &i_cache, &d_cache, MachineConfig::HU_STALL_FORWARD);
     run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
 }
+
+/*======================================================================*/
+
+static void run_rewritten_instruction(Core &core, Registers &regs, Memory &mem, int steps) {
+    Address pc = regs.read_pc();
+
+    memory_write_u32(&mem, pc.get_raw(), Instruction(9, 0, 1, 1).data()); // ADDIU
+    for (int k = 0; k < steps; k++) {
+        core.step();
+    }
+    QCOMPARE(regs.read_gp(1).as_u32(), (uint32_t)1);
+
+    // Same address with different encoding has to be decoded again
+    regs.pc_abs_jmp(pc);
+    memory_write_u32(&mem, pc.get_raw(), Instruction(9, 0, 1, 2).data());
+    for (int k = 0; k < steps; k++) {
+        core.step();
+    }
+    QCOMPARE(regs.read_gp(1).as_u32(), (uint32_t)2);
+}
+
+void MachineTests::singlecore_decode_cache() {
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    CoreSingle core(&regs, &mem_frontend, &mem_frontend, false);
+    run_rewritten_instruction(core, regs, mem, 1);
+}
+
+void MachineTests::pipecore_decode_cache() {
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    CorePipelined core(&regs, &mem_frontend, &mem_frontend);
+    run_rewritten_instruction(core, regs, mem, 5);
+}
+
+void MachineTests::branch_predictor_data() {
+    QTest::addColumn<QString>("predictor");
+    QTest::addColumn<unsigned>("mispredicted");
+
+    // Loop branch taken three times and then falling through, 50 times
+    QTest::newRow("not-taken") << QString("not-taken") << 150u;
+    QTest::newRow("taken") << QString("taken") << 50u;
+    QTest::newRow("bimodal") << QString("bimodal") << 51u;
+    QTest::newRow("gshare") << QString("gshare") << 6u;
+    QTest::newRow("tournament") << QString("tournament") << 4u;
+}
+
+void MachineTests::branch_predictor() {
+    QFETCH(QString, predictor);
+    QFETCH(unsigned, mispredicted);
+
+    MachineConfig config;
+    QVERIFY(config.set_branch_predictor(predictor));
+    std::unique_ptr<BranchPredictor> bp = BranchPredictor::get_predictor_instance(config);
+    unsigned wrong = 0;
+    for (int i = 0; i < 200; i++) {
+        const bool taken = i % 4 != 3;
+        // Unrelated branch, its outcome is part of gshare history
+        bp->update(0x80020100_addr, true);
+        if (bp->predict(0x80020010_addr) != taken) {
+            wrong++;
+        }
+        bp->update(0x80020010_addr, taken);
+    }
+    QCOMPARE(wrong, mispredicted);
+}
+
+void MachineTests::branch_target_buffer() {
+    MachineConfig config;
+    config.set_branch_predictor(MachineConfig::BP_BIMODAL);
+    config.set_btb_bits(4);
+    config.set_ras_size(2);
+    BranchPredictionUnit unit(config);
+
+    // Unknown instruction continues sequentially
+    QCOMPARE(unit.predict(0x80020000_addr), 0x80020004_addr);
+    unit.resolve(0x80020000_addr, BK_CALL, true, 0x80020400_addr, 0x80020004_addr);
+    QCOMPARE(unit.predict(0x80020000_addr), 0x80020400_addr);
+    QCOMPARE(unit.get_btb_miss_count(), 1u);
+    // Return target comes from BTB first time, from the stack afterwards
+    unit.resolve(0x8002040c_addr, BK_RETURN, true, 0x80020008_addr, 0x80020410_addr);
+    unit.resolve(0x80020100_addr, BK_CALL, true, 0x80020400_addr, 0x80020104_addr);
+    unit.resolve(0x80020200_addr, BK_CALL, true, 0x80020500_addr, 0x80020204_addr);
+    QCOMPARE(unit.predict(0x8002040c_addr), 0x80020208_addr);
+    unit.resolve(0x8002040c_addr, BK_RETURN, true, 0x80020208_addr, 0x80020208_addr);
+    QCOMPARE(unit.predict(0x8002040c_addr), 0x80020108_addr);
+    unit.resolve(0x8002040c_addr, BK_RETURN, true, 0x80020108_addr, 0x80020108_addr);
+    QCOMPARE(unit.predict(0x8002040c_addr), 0x80020108_addr); // Empty stack
+    // Overflow of the stack drops the oldest entry
+    for (uint64_t i = 0; i < 3; i++) {
+        unit.resolve(
+            Address(0x80020600 + 16 * i), BK_CALL, true, 0x80020400_addr,
+            Address(0x80020604 + 16 * i));
+    }
+    unit.resolve(0x8002040c_addr, BK_RETURN, true, 0x80020628_addr, 0x80020628_addr);
+    unit.resolve(0x8002040c_addr, BK_RETURN, true, 0x80020618_addr, 0x80020618_addr);
+    QCOMPARE(unit.predict(0x8002040c_addr), 0x80020618_addr);
+    // Conditional branch follows direction predictor
+    unit.resolve(0x80020020_addr, BK_CONDITIONAL, true, 0x80020010_addr, 0x80020024_addr);
+    QCOMPARE(unit.predict(0x80020020_addr), 0x80020010_addr);
+    unit.resolve(0x80020020_addr, BK_CONDITIONAL, false, 0x80020024_addr, 0x80020010_addr);
+    unit.resolve(0x80020020_addr, BK_CONDITIONAL, false, 0x80020024_addr, 0x80020024_addr);
+    QCOMPARE(unit.predict(0x80020020_addr), 0x80020024_addr);
+    // Instruction which is no longer branch drops its entry
+    unit.resolve(0x80020000_addr, BK_NONE, false, 0x80020004_addr, 0x80020400_addr);
+    QCOMPARE(unit.predict(0x80020000_addr), 0x80020004_addr);
+
+    QCOMPARE(unit.get_resolved_count(BK_CALL), 6u);
+    QCOMPARE(unit.get_mispredicted_count(BK_CALL), 6u);
+    QCOMPARE(unit.get_resolved_count(BK_RETURN), 5u);
+    QCOMPARE(unit.get_mispredicted_count(BK_RETURN), 1u);
+    QCOMPARE(unit.get_mispredicted_count(BK_CONDITIONAL), 2u);
+    QCOMPARE(unit.get_mispredicted_count(BK_NONE), 1u);
+    QCOMPARE(unit.get_resolved_count(), 14u);
+    QCOMPARE(unit.get_mispredicted_count(), 10u);
+}
+
+// Nested loop calling a function, returns are to the instruction after the
+// one following JAL, as for the core without delay slot
+static QVector<uint32_t> branch_prediction_program(Address start) {
+    const uint32_t func = ((start + 44).get_raw() >> 2) & 0x3ffffff;
+    const uint32_t end = ((start + 56).get_raw() >> 2) & 0x3ffffff;
+    return {
+        Instruction(9, 0, 1, 20).data(),            // ADDIU $1, $0, 20
+        Instruction(0).data(),                      // NOP
+        Instruction(9, 0, 3, 3).data(),             // loop: ADDIU $3, $0, 3
+        Instruction(9, 3, 3, (uint16_t)-1).data(),  // inner: ADDIU $3, $3, -1
+        Instruction(0, 4, 3, 4, 0, 33).data(),      // ADDU $4, $4, $3
+        Instruction(5, 3, 0, (uint16_t)-3).data(),  // BNE $3, $0, inner
+        Instruction(3, Address(func)).data(),       // JAL func
+        Instruction(0).data(),                      // NOP (skipped)
+        Instruction(9, 1, 1, (uint16_t)-1).data(),  // ADDIU $1, $1, -1
+        Instruction(5, 1, 0, (uint16_t)-8).data(),  // BNE $1, $0, loop
+        Instruction(2, Address(end)).data(),        // J end
+        Instruction(0, 5, 4, 5, 0, 33).data(),      // func: ADDU $5, $5, $4
+        Instruction(0, 31, 0, 0, 0, 8).data(),      // JR $31
+        Instruction(0).data(),                      // NOP
+        Instruction(43, 0, 5, 0x100).data(),        // end: SW $5, 0x100($0)
+    };
+}
+
+void MachineTests::pipecore_branch_prediction() {
+    Registers regs_single;
+    Memory mem_single(BIG);
+    TrivialBus mem_single_frontend(&mem_single);
+    QVector<uint32_t> code = branch_prediction_program(regs_single.read_pc());
+    uint64_t addr = regs_single.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem_single, addr, i);
+        addr += 4;
+    }
+    CoreSingle single(&regs_single, &mem_single_frontend, &mem_single_frontend, false);
+    for (int k = 0; k < 1000; k++) {
+        single.step();
+    }
+    QVERIFY(regs_single.read_gp(5).as_u32() != 0);
+
+    unsigned not_taken_mispredicted = 0;
+    for (const char *predictor : { "not-taken", "taken", "bimodal", "gshare", "tournament" }) {
+        MachineConfig config;
+        config.set_branch_predictor(predictor);
+        Registers regs;
+        Memory mem(BIG);
+        TrivialBus mem_frontend(&mem);
+        addr = regs.read_pc().get_raw();
+        foreach (uint32_t i, code) {
+            memory_write_u32(&mem, addr, i);
+            addr += 4;
+        }
+        CorePipelined core(
+            &regs, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD, 1, nullptr,
+            std::make_unique<BranchPredictionUnit>(config));
+        for (int k = 0; k < 1000; k++) {
+            core.step();
+        }
+
+        // Same result as the core without pipeline and delay slot
+        regs.pc_abs_jmp(regs_single.read_pc());
+        QCOMPARE(regs, regs_single);
+        QCOMPARE(mem, mem_single);
+
+        const BranchPredictionUnit *unit = core.get_branch_prediction();
+        QVERIFY(unit != nullptr);
+        // 20 outer loops with 3 inner loops each, call, return and final jump
+        QCOMPARE(unit->get_resolved_count(BK_CONDITIONAL), 80u);
+        QCOMPARE(unit->get_resolved_count(BK_CALL), 20u);
+        QCOMPARE(unit->get_resolved_count(BK_RETURN), 20u);
+        QCOMPARE(unit->get_resolved_count(BK_JUMP), 1u);
+        QCOMPARE(unit->get_mispredicted_count(BK_CALL), 1u);
+        QCOMPARE(unit->get_mispredicted_count(BK_RETURN), 1u);
+        // Each misprediction costs one stall cycle
+        QCOMPARE(core.get_stall_count(SR_BRANCH_MISPREDICT), unit->get_mispredicted_count());
+        if (not_taken_mispredicted == 0) {
+            not_taken_mispredicted = unit->get_mispredicted_count();
+        } else if (QString(predictor) != "taken") {
+            QVERIFY(unit->get_mispredicted_count() < not_taken_mispredicted);
+        }
+    }
+}
+
+void MachineTests::pipecore_stall_reasons_data() {
+    QTest::addColumn<QVector<uint32_t>>("code");
+    QTest::addColumn<int>("hazard_unit");
+    QTest::addColumn<int>("reason");
+    QTest::addColumn<unsigned>("stalls");
+    QTest::addColumn<unsigned>("stalled_index"); // Instruction stalls are attributed to
+
+    QTest::newRow("load-use")
+        << QVector<uint32_t> {
+               Instruction(35, 0, 1, 0x100).data(),  // LW $1, 0x100($0)
+               Instruction(0, 1, 1, 2, 0, 33).data(), // ADDU $2, $1, $1
+           }
+        << (int)MachineConfig::HU_STALL_FORWARD << (int)SR_LOAD_USE << 1u << 1u;
+    QTest::newRow("data hazard")
+        << QVector<uint32_t> {
+               Instruction(9, 0, 1, 1).data(),        // ADDIU $1, $0, 1
+               Instruction(0, 1, 1, 2, 0, 33).data(), // ADDU $2, $1, $1
+           }
+        << (int)MachineConfig::HU_STALL << (int)SR_DATA_HAZARD << 2u << 1u;
+    QTest::newRow("branch operand")
+        << QVector<uint32_t> {
+               Instruction(9, 0, 1, 1).data(), // ADDIU $1, $0, 1
+               Instruction(4, 1, 0, 4).data(), // BEQ $1, $0, 4
+           }
+        << (int)MachineConfig::HU_STALL_FORWARD << (int)SR_BRANCH_OPERAND << 1u << 1u;
+}
+
+void MachineTests::pipecore_stall_reasons() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(int, hazard_unit);
+    QFETCH(int, reason);
+    QFETCH(unsigned, stalls);
+    QFETCH(unsigned, stalled_index);
+
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    uint64_t addr = regs.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr, i);
+        addr += 4;
+    }
+    CorePipelined core(
+        &regs, &mem_frontend, &mem_frontend, (enum MachineConfig::HazardUnit)hazard_unit);
+    for (int k = 0; k < 10; k++) {
+        core.step();
+    }
+
+    QCOMPARE(core.get_stall_count(), stalls);
+    QCOMPARE(core.get_stall_count((enum StallReason)reason), stalls);
+    const uint64_t stalled_addr = (Registers().read_pc() + 4 * stalled_index).get_raw();
+    QCOMPARE(core.get_pc_stalls().size(), (size_t)1);
+    QCOMPARE(core.get_pc_stalls().at(stalled_addr).count[reason], stalls);
+
+    core.reset();
+    QCOMPARE(core.get_stall_count((enum StallReason)reason), 0u);
+    QVERIFY(core.get_pc_stalls().empty());
+}
+
+void MachineTests::pipecore_muldiv_latency_data() {
+    QTest::addColumn<QVector<uint32_t>>("code");
+    QTest::addColumn<unsigned>("mult_latency");
+    QTest::addColumn<unsigned>("div_latency");
+    QTest::addColumn<unsigned>("stalls");
+    QTest::addColumn<uint32_t>("result"); // Value moved to $3
+
+    QVector<uint32_t> mult {
+        Instruction(9, 0, 1, 6).data(),        // ADDIU $1, $0, 6
+        Instruction(9, 0, 2, 7).data(),        // ADDIU $2, $0, 7
+        Instruction(0, 1, 2, 0, 0, 24).data(), // MULT $1, $2
+        Instruction(0, 0, 0, 3, 0, 18).data(), // MFLO $3
+    };
+    QVector<uint32_t> div {
+        Instruction(9, 0, 1, 45).data(),       // ADDIU $1, $0, 45
+        Instruction(9, 0, 2, 7).data(),        // ADDIU $2, $0, 7
+        Instruction(0, 1, 2, 0, 0, 26).data(), // DIV $1, $2
+        Instruction(0, 0, 0, 3, 0, 16).data(), // MFHI $3
+    };
+    QVector<uint32_t> independent {
+        Instruction(9, 0, 1, 6).data(),        // ADDIU $1, $0, 6
+        Instruction(9, 0, 2, 7).data(),        // ADDIU $2, $0, 7
+        Instruction(0, 1, 2, 0, 0, 24).data(), // MULT $1, $2
+        Instruction(0, 1, 2, 4, 0, 33).data(), // ADDU $4, $1, $2
+        Instruction(0, 1, 2, 5, 0, 33).data(), // ADDU $5, $1, $2
+        Instruction(0, 0, 0, 3, 0, 18).data(), // MFLO $3
+    };
+    QTest::newRow("mult, single cycle") << mult << 1u << 1u << 0u << 42u;
+    QTest::newRow("mult, 4 cycles") << mult << 4u << 1u << 3u << 42u;
+    QTest::newRow("mult, divide latency") << mult << 1u << 10u << 0u << 42u;
+    QTest::newRow("div, 10 cycles") << div << 1u << 10u << 9u << 3u;
+    QTest::newRow("independent, 4 cycles") << independent << 4u << 1u << 1u << 42u;
+}
+
+void MachineTests::pipecore_muldiv_latency() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(unsigned, mult_latency);
+    QFETCH(unsigned, div_latency);
+    QFETCH(unsigned, stalls);
+    QFETCH(uint32_t, result);
+
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    uint64_t addr = regs.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr, i);
+        addr += 4;
+    }
+    CorePipelined core(&regs, &mem_frontend, &mem_frontend);
+    core.set_muldiv_latency(mult_latency, div_latency);
+    for (int k = 0; k < 20; k++) {
+        core.step();
+    }
+
+    QCOMPARE(regs.read_gp(3).as_u32(), result);
+    QCOMPARE(core.get_stall_count(), stalls);
+    QCOMPARE(core.get_stall_count(SR_MUL_DIV), stalls);
+    if (stalls > 0) {
+        // Stalls are attributed to the instruction reading HI or LO
+        const uint64_t stalled_addr = (Registers().read_pc() + 4 * (code.size() - 1)).get_raw();
+        QCOMPARE(core.get_pc_stalls().at(stalled_addr).count[SR_MUL_DIV], stalls);
+    }
+}
+
+void MachineTests::superscalar_alu_forward_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::superscalarstall_alu_forward_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::superscalar_memory_tests_data() {
+    core_memory_tests_data();
+}
+
+// Fetch of the target runs ahead of issue, so the final PC is seen before
+// the fragment completes
+static const int SUPERSCALAR_DRAIN_CYCLES = 32;
+
+void MachineTests::superscalar_alu_forward() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init(BIG);
+    TrivialBus mem_init_frontend(&mem_init);
+    Memory mem_res(BIG);
+    TrivialBus mem_res_frontend(&mem_res);
+    CoreSuperscalar core(
+        &reg_init, &mem_init_frontend, &mem_init_frontend, true,
+        MachineConfig::HU_STALL_FORWARD);
+    run_code_fragment(
+        core, reg_init, reg_res, mem_init, mem_res, code, SUPERSCALAR_DRAIN_CYCLES);
+}
+
+void MachineTests::superscalarstall_alu_forward() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init(BIG);
+    TrivialBus mem_init_frontend(&mem_init);
+    Memory mem_res(BIG);
+    TrivialBus mem_res_frontend(&mem_res);
+    CoreSuperscalar core(
+        &reg_init, &mem_init_frontend, &mem_init_frontend, true, MachineConfig::HU_STALL);
+    run_code_fragment(
+        core, reg_init, reg_res, mem_init, mem_res, code, SUPERSCALAR_DRAIN_CYCLES);
+}
+
+void MachineTests::superscalar_memory_tests() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+    TrivialBus mem_init_frontend(&mem_init);
+    TrivialBus mem_res_frontend(&mem_res);
+    CacheConfig cache_conf;
+    cache_conf.set_enabled(true);
+    cache_conf.set_set_count(4);     // Number of sets
+    cache_conf.set_block_size(2);    // Number of blocks
+    cache_conf.set_associativity(2); // Degree of associativity
+    cache_conf.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_conf.set_write_policy(CacheConfig::WP_BACK);
+    Cache i_cache(&mem_init_frontend, &cache_conf);
+    Cache d_cache(&mem_init_frontend, &cache_conf);
+    CoreSuperscalar core(&reg_init, &i_cache, &d_cache, true, MachineConfig::HU_STALL_FORWARD);
+    run_code_fragment(
+        core, reg_init, reg_res, mem_init, mem_res, code, SUPERSCALAR_DRAIN_CYCLES);
+}
+
+void MachineTests::superscalar_branch() {
+    Registers regs_single;
+    Memory mem_single(BIG);
+    TrivialBus mem_single_frontend(&mem_single);
+    QVector<uint32_t> code = branch_prediction_program(regs_single.read_pc());
+    uint64_t addr = regs_single.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem_single, addr, i);
+        addr += 4;
+    }
+    CoreSingle single(&regs_single, &mem_single_frontend, &mem_single_frontend, false);
+    for (int k = 0; k < 1000; k++) {
+        single.step();
+    }
+
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    addr = regs.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr, i);
+        addr += 4;
+    }
+    CoreSuperscalar core(&regs, &mem_frontend, &mem_frontend, false);
+    for (int k = 0; k < 1000; k++) {
+        core.step();
+    }
+
+    // Same result as the core without pipeline and delay slot
+    regs.pc_abs_jmp(regs_single.read_pc());
+    QCOMPARE(regs, regs_single);
+    QCOMPARE(mem, mem_single);
+    // Taken branches and jumps discard instructions fetched after them
+    QVERIFY(core.get_stall_count(SR_BRANCH_MISPREDICT) > 0);
+    QVERIFY(core.get_empty_slot_count(CoreSuperscalar::ES_CONTROL) > 0);
+    QVERIFY(core.get_issue_count(2) > 0);
+}
+
+void MachineTests::superscalar_issue_data() {
+    QTest::addColumn<QVector<uint32_t>>("code");
+    QTest::addColumn<int>("reason");
+    QTest::addColumn<unsigned>("empty_slots");
+    QTest::addColumn<unsigned>("dual_issued"); // Pairs issued including trailing NOPs
+
+    QTest::newRow("independent")
+        << QVector<uint32_t> {
+               Instruction(9, 0, 1, 1).data(), // ADDIU $1, $0, 1
+               Instruction(9, 0, 2, 2).data(), // ADDIU $2, $0, 2
+           }
+        << (int)CoreSuperscalar::ES_DEPENDENCY << 0u << 11u;
+    QTest::newRow("dependency")
+        << QVector<uint32_t> {
+               Instruction(9, 0, 1, 1).data(),        // ADDIU $1, $0, 1
+               Instruction(0, 1, 1, 2, 0, 33).data(), // ADDU $2, $1, $1
+           }
+        << (int)CoreSuperscalar::ES_DEPENDENCY << 1u << 10u;
+    QTest::newRow("memory port")
+        << QVector<uint32_t> {
+               Instruction(35, 0, 1, 0x100).data(), // LW $1, 0x100($0)
+               Instruction(43, 0, 2, 0x104).data(), // SW $2, 0x104($0)
+           }
+        << (int)CoreSuperscalar::ES_MEMORY_PORT << 1u << 10u;
+    QTest::newRow("hi lo")
+        << QVector<uint32_t> {
+               Instruction(0, 1, 2, 0, 0, 24).data(), // MULT $1, $2
+               Instruction(0, 0, 0, 3, 0, 18).data(), // MFLO $3
+           }
+        << (int)CoreSuperscalar::ES_HI_LO << 1u << 10u;
+    QTest::newRow("load use")
+        << QVector<uint32_t> {
+               Instruction(35, 0, 1, 0x100).data(),   // LW $1, 0x100($0)
+               Instruction(0).data(),                 // NOP
+               Instruction(0, 1, 1, 2, 0, 33).data(), // ADDU $2, $1, $1
+           }
+        << (int)CoreSuperscalar::ES_HAZARD << 2u << 10u;
+    QTest::newRow("taken branch")
+        << QVector<uint32_t> {
+               Instruction(9, 0, 3, 3).data(), // ADDIU $3, $0, 3
+               Instruction(4, 0, 0, 2).data(), // BEQ $0, $0, 2 (delay slot fetched alone)
+               Instruction(0).data(),          // NOP (delay slot)
+               Instruction(9, 0, 1, 1).data(), // ADDIU $1, $0, 1 (skipped)
+               Instruction(9, 0, 2, 2).data(), // ADDIU $2, $0, 2
+           }
+        << (int)CoreSuperscalar::ES_CONTROL << 1u << 10u;
+}
+
+void MachineTests::superscalar_issue() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(int, reason);
+    QFETCH(unsigned, empty_slots);
+    QFETCH(unsigned, dual_issued);
+
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    uint64_t addr = regs.read_pc().get_raw();
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr, i);
+        addr += 4;
+    }
+    CoreSuperscalar core(&regs, &mem_frontend, &mem_frontend, true);
+    const unsigned steps = 12;
+    for (unsigned k = 0; k < steps; k++) {
+        core.step();
+    }
+
+    const auto empty_reason = (enum CoreSuperscalar::EmptySlotReason)reason;
+    QCOMPARE(core.get_empty_slot_count(empty_reason), empty_slots);
+    QCOMPARE(core.get_issue_count(2), dual_issued);
+    // Every slot of every cycle either issued or has a reason
+    unsigned issued = 0, filled_slots = 0;
+    for (unsigned width = 0; width <= CoreSuperscalar::ISSUE_WIDTH; width++) {
+        issued += width * core.get_issue_count(width);
+        filled_slots += CoreSuperscalar::ISSUE_WIDTH * core.get_issue_count(width);
+    }
+    for (int i = 0; i < CoreSuperscalar::ES_COUNT; i++) {
+        filled_slots -= core.get_empty_slot_count((enum CoreSuperscalar::EmptySlotReason)i);
+    }
+    QCOMPARE(filled_slots, issued);
+    // Instructions still in execute, memory and write back stages
+    QVERIFY(issued - core.get_retired_count() <= 3 * CoreSuperscalar::ISSUE_WIDTH);
+}
+
+void MachineTests::core_benchmark_data() {
+    QTest::addColumn<bool>("pipelined");
+    QTest::addColumn<unsigned>("groups");
+    QTest::addColumn<bool>("observed");
+
+    // Emission of all groups without receivers is how the core behaved before
+    // signals were gated, all groups with receivers approximates attached GUI.
+    QTest::newRow("single, no signals") << false << (unsigned)Core::SG_NONE << false;
+    QTest::newRow("single, all signals") << false << (unsigned)Core::SG_ALL << false;
+    QTest::newRow("single, observed") << false << (unsigned)Core::SG_ALL << true;
+    QTest::newRow("pipelined, no signals") << true << (unsigned)Core::SG_NONE << false;
+    QTest::newRow("pipelined, all signals") << true << (unsigned)Core::SG_ALL << false;
+    QTest::newRow("pipelined, observed") << true << (unsigned)Core::SG_ALL << true;
+}
+
+void MachineTests::core_benchmark() {
+    QFETCH(bool, pipelined);
+    QFETCH(unsigned, groups);
+    QFETCH(bool, observed);
+
+    Registers regs;
+    Memory mem(BIG);
+    TrivialBus mem_frontend(&mem);
+    uint64_t addr = regs.read_pc().get_raw();
+    // Endless loop, $1 stays zero
+    QVector<uint32_t> code {
+        Instruction(9, 2, 2, 1).data(),              // ADDIU $2, $2, 1
+        Instruction(0, 3, 2, 3, 0, 33).data(),       // ADDU $3, $3, $2
+        Instruction(5, 2, 1, (uint16_t)-3).data(),   // BNE $2, $1, -3
+        Instruction(43, 0, 3, 0x100).data(),         // SW $3, 0x100($0)
+    };
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr, i);
+        addr += 4;
+    }
+
+    Core *core;
+    if (pipelined) {
+        core = new CorePipelined(&regs, &mem_frontend, &mem_frontend);
+    } else {
+        core = new CoreSingle(&regs, &mem_frontend, &mem_frontend, true);
+    }
+    core->subscribe_signals(groups);
+    unsigned received = 0;
+    if (observed) {
+        auto count = [&received]() { received++; };
+        QObject::connect(core, &Core::instruction_fetched, count);
+        QObject::connect(core, &Core::instruction_writeback, count);
+        QObject::connect(core, &Core::decode_reg1_value, count);
+        QObject::connect(core, &Core::execute_alu_value, count);
+        QObject::connect(core, &Core::memory_regw_num_value, count);
+        QObject::connect(core, &Core::cycle_c_value, count);
+    }
+
+    QBENCHMARK {
+        for (int k = 0; k < 100000; k++) {
+            core->step();
+        }
+    }
+    QVERIFY(regs.read_gp(2).as_u32() > 0);
+    delete core;
+}
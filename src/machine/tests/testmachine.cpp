@@ -0,0 +1,509 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+
+#include "machine/machine.h"
+#include "machine/memory/cache/cache_replay.h"
+#include "tst_machine.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QVector>
+#include <memory>
+
+using namespace machine;
+
+/**
+ * Machine running in thread without event loop, result is compared with the
+ * same machine running in other threads.
+ */
+class MachineRunThread : public QThread {
+public:
+    explicit MachineRunThread(const MachineConfig &config) : config(config) {}
+
+    void run() override {
+        Machine machine(config, false, false);
+        Address addr = machine.registers()->read_pc();
+        // Endless loop storing growing array, $1 stays zero
+        QVector<uint32_t> code {
+            Instruction(9, 2, 2, 1).data(),             // ADDIU $2, $2, 1
+            Instruction(43, 4, 2, 0).data(),            // SW $2, 0($4)
+            Instruction(9, 4, 4, 4).data(),             // ADDIU $4, $4, 4
+            Instruction(5, 2, 1, (uint16_t)-4).data(),  // BNE $2, $1, -4
+            Instruction(0).data(),                      // NOP
+        };
+        foreach (uint32_t i, code) {
+            machine.memory_data_bus_rw()->write_u32(addr, i, AccessEffects::INTERNAL);
+            addr += 4;
+        }
+        while (cycles < 30000) {
+            cycles += machine.run_cycles(7000);
+        }
+        machine.cache_sync();
+        regs.reset(new Registers(*machine.registers()));
+        mem.reset(new Memory(*machine.memory()));
+        status = machine.status();
+    }
+
+    const MachineConfig config;
+    unsigned cycles = 0;
+    std::unique_ptr<Registers> regs;
+    std::unique_ptr<Memory> mem;
+    Machine::Status status = Machine::ST_BUSY;
+};
+
+void MachineTests::machine_run_cycles_threads() {
+    MachineConfig config;
+    config.set_pipelined(true);
+    CacheConfig cache;
+    cache.set_enabled(true);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    config.set_cache_data(cache);
+
+    std::vector<std::unique_ptr<MachineRunThread>> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back(new MachineRunThread(config));
+    }
+    for (auto &thread : threads) {
+        thread->start();
+    }
+    for (auto &thread : threads) {
+        QVERIFY(thread->wait());
+    }
+    for (auto &thread : threads) {
+        QCOMPARE(thread->cycles, 35000u);
+        QCOMPARE(thread->status, Machine::ST_READY);
+        QVERIFY(*thread->regs == *threads[0]->regs);
+        QVERIFY(*thread->mem == *threads[0]->mem);
+    }
+    QVERIFY(threads[0]->regs->read_gp(2).as_u32() > 1000);
+}
+
+static void memory_trace_test_program(Machine &machine) {
+    Address addr = machine.registers()->read_pc();
+    // Endless loop with strided word, byte and unaligned accesses
+    QVector<uint32_t> code {
+        Instruction(9, 2, 2, 1).data(),                // ADDIU $2, $2, 1
+        Instruction(43, 4, 2, 0).data(),               // SW $2, 0($4)
+        Instruction(9, 4, 4, 36).data(),               // ADDIU $4, $4, 36
+        Instruction(35, 4, 5, (uint16_t)-108).data(),  // LW $5, -108($4)
+        Instruction(36, 4, 6, (uint16_t)-35).data(),   // LBU $6, -35($4)
+        Instruction(34, 4, 7, (uint16_t)-70).data(),   // LWL $7, -70($4)
+        Instruction(5, 2, 1, (uint16_t)-7).data(),     // BNE $2, $1, -7
+        Instruction(0).data(),                         // NOP
+    };
+    foreach (uint32_t i, code) {
+        machine.memory_data_bus_rw()->write_u32(addr, i, AccessEffects::INTERNAL);
+        addr += 4;
+    }
+}
+
+void MachineTests::machine_memory_trace_replay_data() {
+    QTest::addColumn<bool>("pipelined");
+    QTest::addColumn<CacheConfig>("cache");
+
+    CacheConfig cache;
+    cache.set_enabled(true);
+    cache.set_set_count(4);
+    cache.set_block_size(2);
+    cache.set_associativity(2);
+    cache.set_replacement_policy(CacheConfig::RP_LRU);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    QTest::newRow("single, lru, write back") << false << cache;
+    cache.set_replacement_policy(CacheConfig::RP_LFU);
+    cache.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+    QTest::newRow("pipelined, lfu, write through") << true << cache;
+    cache.set_replacement_policy(CacheConfig::RP_RAND);
+    cache.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
+    cache.set_associativity(4);
+    QTest::newRow("pipelined, random, no allocate") << true << cache;
+}
+
+void MachineTests::machine_memory_trace_replay() {
+    QFETCH(bool, pipelined);
+    QFETCH(CacheConfig, cache);
+    const QString trace_name = "memory_trace_test.trc";
+
+    MachineConfig config;
+    config.set_pipelined(pipelined);
+    config.set_cache_program(cache);
+    config.set_cache_data(cache);
+    Machine machine(config, false, false);
+    memory_trace_test_program(machine);
+
+    machine.set_memory_trace(trace_name);
+    for (int i = 0; i < 1000; i++) {
+        machine.step();
+    }
+    machine.cache_sync();
+    for (int i = 0; i < 500; i++) {
+        machine.step();
+    }
+    machine.set_memory_trace(QString());
+
+    CacheReplay replay(
+        config.memory_access_time_read(), config.memory_access_time_write(),
+        config.memory_access_time_burst());
+    replay.add_cache(cache, TRACE_PROGRAM);
+    replay.add_cache(cache, TRACE_DATA);
+    {
+        MemoryTraceReader reader(trace_name);
+        QVERIFY(replay.replay(reader) > 1500);
+    }
+    QFile::remove(trace_name);
+
+    QVERIFY(machine.cache_data()->get_miss_count() > 100);
+    for (auto caches : { std::make_pair(replay.cache(0), machine.cache_program()),
+                         std::make_pair(replay.cache(1), machine.cache_data()) }) {
+        QCOMPARE(caches.first->get_hit_count(), caches.second->get_hit_count());
+        QCOMPARE(caches.first->get_miss_count(), caches.second->get_miss_count());
+        QCOMPARE(caches.first->get_read_count(), caches.second->get_read_count());
+        QCOMPARE(caches.first->get_write_count(), caches.second->get_write_count());
+        QCOMPARE(caches.first->get_stall_count(), caches.second->get_stall_count());
+    }
+}
+
+void MachineTests::machine_cache_sweep() {
+    const QString trace_name = "memory_trace_test.trc";
+    const std::vector<size_t> set_counts { 1, 2, 4, 8 };
+    const std::vector<size_t> block_sizes { 1, 2, 4 };
+    const std::vector<size_t> ways { 1, 2, 4 };
+
+    MachineConfig config;
+    config.set_pipelined(true);
+    Machine machine(config, false, false);
+    memory_trace_test_program(machine);
+    machine.set_memory_trace(trace_name);
+    for (int i = 0; i < 1000; i++) {
+        machine.step();
+    }
+    machine.cache_sync();
+    for (int i = 0; i < 500; i++) {
+        machine.step();
+    }
+    machine.set_memory_trace(QString());
+
+    // Every configuration of the sweep is simulated by separate cache too
+    CacheReplay replay;
+    for (size_t block_size : block_sizes) {
+        for (size_t set_count : set_counts) {
+            for (size_t associativity : ways) {
+                CacheConfig cache;
+                cache.set_enabled(true);
+                cache.set_set_count(set_count);
+                cache.set_block_size(block_size);
+                cache.set_associativity(associativity);
+                cache.set_replacement_policy(CacheConfig::RP_LRU);
+                cache.set_write_policy(CacheConfig::WP_BACK);
+                replay.add_cache(cache, TRACE_PROGRAM);
+                replay.add_cache(cache, TRACE_DATA);
+            }
+        }
+    }
+    replay.add_sweep(TRACE_PROGRAM, set_counts, block_sizes, ways.back());
+    replay.add_sweep(TRACE_DATA, set_counts, block_sizes, ways.back());
+    {
+        MemoryTraceReader reader(trace_name);
+        replay.replay(reader);
+    }
+    QFile::remove(trace_name);
+
+    for (size_t i = 0; i < replay.cache_count(); i++) {
+        const Cache *cache = replay.cache(i);
+        const CacheConfig &conf = cache->get_config();
+        const CacheSweep *sweep = replay.sweep(replay.cache_stream(i) == TRACE_PROGRAM ? 0 : 1);
+        QCOMPARE(
+            sweep->get_access_count(conf.block_size()),
+            (uint64_t)cache->get_hit_count() + cache->get_miss_count());
+        QCOMPARE(
+            sweep->get_hit_count(conf.set_count(), conf.block_size(), conf.associativity()),
+            (uint64_t)cache->get_hit_count());
+    }
+    QVERIFY(replay.sweep(1)->get_hit_count(8, 4, 4) > replay.sweep(1)->get_hit_count(1, 1, 1));
+}
+
+void MachineTests::machine_cache_sweep_range_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<int>("count");
+    QTest::newRow("range") << QString("1..1024") << true << 11;
+    QTest::newRow("single") << QString("8") << true << 1;
+    QTest::newRow("hex") << QString("0x10..0x40") << true << 3;
+    QTest::newRow("low-not-power") << QString("3..16") << false << 0;
+    QTest::newRow("high-not-power") << QString("1..12") << false << 0;
+    QTest::newRow("single-not-power") << QString("6") << false << 0;
+    QTest::newRow("zero") << QString("0..4") << false << 0;
+    QTest::newRow("reversed") << QString("16..4") << false << 0;
+    QTest::newRow("garbage") << QString("1..x") << false << 0;
+}
+
+void MachineTests::machine_cache_sweep_range() {
+    QFETCH(QString, text);
+    QFETCH(bool, valid);
+    QFETCH(int, count);
+
+    std::vector<size_t> values { 1, 2 };
+    QCOMPARE(CacheSweep::parse_range(text, values), valid);
+    if (valid) {
+        QCOMPARE((int)values.size(), count);
+        for (size_t i = 1; i < values.size(); i++) {
+            QCOMPARE(values[i], values[i - 1] * 2);
+        }
+    } else {
+        // Defaults are kept
+        QCOMPARE((int)values.size(), 2);
+    }
+}
+
+void MachineTests::machine_cache_level2_data() {
+    QTest::addColumn<int>("inclusion");
+    QTest::newRow("nine") << (int)MachineConfig::CI_NINE;
+    QTest::newRow("inclusive") << (int)MachineConfig::CI_INCLUSIVE;
+    QTest::newRow("exclusive") << (int)MachineConfig::CI_EXCLUSIVE;
+}
+
+void MachineTests::machine_cache_level2() {
+    QFETCH(int, inclusion);
+
+    CacheConfig l1;
+    l1.set_enabled(true);
+    l1.set_set_count(1);
+    l1.set_block_size(2);
+    l1.set_associativity(1);
+    l1.set_replacement_policy(CacheConfig::RP_LRU);
+    l1.set_write_policy(CacheConfig::WP_BACK);
+    // Level 2 keeps the loop and data stored in recent iterations
+    CacheConfig l2(l1);
+    l2.set_set_count(16);
+    l2.set_associativity(2);
+
+    // The same program with and without level 2 cache
+    MachineConfig config;
+    config.set_cache_program(l1);
+    config.set_cache_data(l1);
+    Machine reference(config, false, false);
+    config.set_cache_level2(l2);
+    config.set_cache_level2_inclusion((MachineConfig::CacheInclusion)inclusion);
+    Machine machine(config, false, false);
+    for (Machine *m : { &reference, &machine }) {
+        memory_trace_test_program(*m);
+        for (int i = 0; i < 1500; i++) {
+            m->step();
+        }
+        m->cache_sync();
+    }
+
+    QVERIFY(!reference.cache_level2()->get_config().enabled());
+    QVERIFY(machine.cache_level2()->get_hit_count() > 0);
+    QVERIFY(machine.cache_level2()->get_miss_count() > 0);
+    QVERIFY(machine.cache_level2()->get_read_count() < reference.cache_data()->get_read_count());
+    for (int i = 1; i < 8; i++) {
+        QCOMPARE(machine.registers()->read_gp(i), reference.registers()->read_gp(i));
+    }
+    for (Address addr = 0x0_addr; addr < 0x4000_addr; addr += 4) {
+        QCOMPARE(
+            machine.memory_data_bus()->read_u32(addr, AccessEffects::INTERNAL),
+            reference.memory_data_bus()->read_u32(addr, AccessEffects::INTERNAL));
+    }
+
+    // Level 1 blocks larger than level 2 blocks break inclusion
+    if (inclusion != MachineConfig::CI_NINE) {
+        l2.set_block_size(1);
+        config.set_cache_level2(l2);
+        QVERIFY_EXCEPTION_THROWN(Machine(config, false, false), SimulatorExceptionInput);
+    }
+}
+
+void MachineTests::machine_memory_stalls_data() {
+    QTest::addColumn<bool>("pipelined");
+    QTest::newRow("single") << false;
+    QTest::newRow("pipelined") << true;
+}
+
+/**
+ * Memory stalls only delay the program, so running it to the same point
+ * takes exactly the memory stall cycles more.
+ */
+void MachineTests::machine_memory_stalls() {
+    QFETCH(bool, pipelined);
+
+    CacheConfig cache;
+    cache.set_enabled(true);
+    cache.set_set_count(2);
+    cache.set_block_size(2);
+    cache.set_associativity(1);
+    cache.set_replacement_policy(CacheConfig::RP_LRU);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    MachineConfig config;
+    config.set_pipelined(pipelined);
+    config.set_cache_program(cache);
+    config.set_cache_data(cache);
+    Machine reference(config, false, false);
+    config.set_memory_stalls(true);
+    Machine machine(config, false, false);
+    for (Machine *m : { &reference, &machine }) {
+        memory_trace_test_program(*m);
+        while (m->registers()->read_gp(2).as_u32() < 100) {
+            m->step();
+        }
+    }
+
+    const Core *core = machine.core();
+    QCOMPARE(reference.core()->get_memory_stall_count(), 0u);
+    QVERIFY(core->get_memory_stall_count() > 0);
+    QCOMPARE(
+        core->get_cycle_count() - reference.core()->get_cycle_count(),
+        core->get_memory_stall_count());
+    QCOMPARE(
+        core->get_stall_count() - reference.core()->get_stall_count(),
+        core->get_memory_stall_count());
+    for (int i = 1; i < 8; i++) {
+        QCOMPARE(machine.registers()->read_gp(i), reference.registers()->read_gp(i));
+    }
+}
+
+
+/**
+ * Disabled caches pass direct access to memory through to the core. The run
+ * matches traced one, where all accesses take the regular path.
+ */
+void MachineTests::machine_direct_access() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    MachineConfig config;
+    config.set_pipelined(true);
+    config.set_memory_stalls(true);
+    Machine reference(config, false, false);
+    Machine machine(config, false, false);
+    reference.set_memory_trace(dir.filePath("memory_trace_test.trc"));
+    for (Machine *m : { &reference, &machine }) {
+        memory_trace_test_program(*m);
+        for (int i = 0; i < 1000; i++) {
+            m->step();
+        }
+    }
+    const Address pc = machine.registers()->read_pc();
+    QVERIFY(machine.cache_program()->direct_access_window(pc).host != nullptr);
+    QVERIFY(machine.cache_data()->direct_access_window(pc).host != nullptr);
+    QVERIFY(reference.cache_data()->direct_access_window(pc).host == nullptr);
+    reference.set_memory_trace(QString());
+
+    const Core *core = machine.core();
+    QVERIFY(core->get_memory_stall_count() > 0);
+    QCOMPARE(core->get_cycle_count(), reference.core()->get_cycle_count());
+    QCOMPARE(core->get_stall_count(), reference.core()->get_stall_count());
+    QCOMPARE(core->get_memory_stall_count(), reference.core()->get_memory_stall_count());
+    for (auto caches : { std::make_pair(machine.cache_program(), reference.cache_program()),
+                         std::make_pair(machine.cache_data(), reference.cache_data()) }) {
+        QCOMPARE(caches.first->get_read_count(), caches.second->get_read_count());
+        QCOMPARE(caches.first->get_write_count(), caches.second->get_write_count());
+        QCOMPARE(caches.first->get_stall_count(), caches.second->get_stall_count());
+    }
+    for (int i = 1; i < 8; i++) {
+        QCOMPARE(machine.registers()->read_gp(i), reference.registers()->read_gp(i));
+    }
+}
+
+void MachineTests::machine_dram_data() {
+    QTest::addColumn<QString>("page_policy");
+    QTest::newRow("open") << QString("open");
+    QTest::newRow("closed") << QString("closed");
+}
+
+/**
+ * DRAM only delays the program and its state survives stepping back.
+ */
+void MachineTests::machine_dram() {
+    QFETCH(QString, page_policy);
+
+    CacheConfig cache;
+    cache.set_enabled(true);
+    cache.set_set_count(2);
+    cache.set_block_size(2);
+    cache.set_associativity(1);
+    cache.set_replacement_policy(CacheConfig::RP_LRU);
+    cache.set_write_policy(CacheConfig::WP_BACK);
+    MachineConfig config;
+    config.set_pipelined(true);
+    config.set_cache_program(cache);
+    config.set_cache_data(cache);
+    Machine reference(config, false, false);
+    config.set_memory_stalls(true);
+    config.set_dram_enabled(true);
+    config.set_dram_page_policy(page_policy);
+    config.set_dram_write_queue(2);
+    Machine machine(config, false, false);
+    machine.set_history(16 << 20, 64);
+    QVERIFY(reference.dram() != nullptr);
+    for (Machine *m : { &reference, &machine }) {
+        memory_trace_test_program(*m);
+        while (m->registers()->read_gp(2).as_u32() < 100) {
+            m->step();
+        }
+    }
+
+    const Core *core = machine.core();
+    const Dram *dram = machine.dram();
+    QCOMPARE(reference.dram()->get_read_count(), 0u);
+    QVERIFY(dram->get_read_count() > 0);
+    QVERIFY(core->get_memory_stall_count() > 0);
+    QCOMPARE(
+        core->get_cycle_count() - reference.core()->get_cycle_count(),
+        core->get_memory_stall_count());
+    if (page_policy == "open") {
+        QVERIFY(dram->get_row_hit_count() > 0);
+    } else {
+        QCOMPARE(dram->get_row_hit_count(), 0u);
+    }
+    for (int i = 1; i < 8; i++) {
+        QCOMPARE(machine.registers()->read_gp(i), reference.registers()->read_gp(i));
+    }
+
+    unsigned cycles = core->get_cycle_count();
+    uint32_t reads = dram->get_read_count();
+    uint32_t writes = dram->get_write_count();
+    uint32_t row_hits = dram->get_row_hit_count();
+    uint32_t drains = dram->get_drain_count();
+    QVERIFY(machine.step_back(100));
+    while (core->get_cycle_count() < cycles) {
+        machine.step();
+    }
+    QCOMPARE(dram->get_read_count(), reads);
+    QCOMPARE(dram->get_write_count(), writes);
+    QCOMPARE(dram->get_row_hit_count(), row_hits);
+    QCOMPARE(dram->get_drain_count(), drains);
+    QCOMPARE(machine.registers()->read_gp(2), reference.registers()->read_gp(2));
+}
@@ -378,3 +378,237 @@ void MachineTests::memory_read_ctl() {
             (int8_t)result.u8.at(i));
     }
 }
+
+void MachineTests::memory_bus_ranges() {
+    MemoryDataBus bus(BIG);
+    Memory ram(BIG), low(BIG), high(BIG);
+    memory_write_u32(&ram, 0x10, 0x11111111);
+    memory_write_u32(&low, 0x10, 0x22222222);
+    memory_write_u32(&high, 0x10, 0x33333333);
+
+    QVERIFY(bus.insert_device_to_range(&ram, 0x0_addr, 0xefffffff_addr, false));
+    // Two small ranges sharing one directory page, like peripherals do.
+    QVERIFY(bus.insert_device_to_range(
+        &low, 0xffff0000_addr, 0xffff003f_addr, false));
+    QVERIFY(bus.insert_device_to_range(
+        &high, 0xffffc000_addr, 0xffffc03f_addr, false));
+    QVERIFY(!bus.insert_device_to_range(
+        &high, 0xffffc020_addr, 0xffffc0ff_addr, false));
+
+    QCOMPARE(bus.read_u32(0x10_addr), (uint32_t)0x11111111);
+    QCOMPARE(bus.read_u32(0xffff0010_addr), (uint32_t)0x22222222);
+    QCOMPARE(bus.read_u32(0xffffc010_addr), (uint32_t)0x33333333);
+    QCOMPARE(bus.read_u32(0xffff0010_addr), (uint32_t)0x22222222);
+    QCOMPARE(bus.location_status(0xffff8000_addr), LOCSTAT_ILLEGAL);
+    QCOMPARE(bus.location_status(0xf0000000_addr), LOCSTAT_ILLEGAL);
+    QCOMPARE(bus.read_u32(0xffff8000_addr), (uint32_t)0);
+
+    QVERIFY(bus.remove_device(&low));
+    QCOMPARE(bus.read_u32(0xffff0010_addr), (uint32_t)0);
+    QCOMPARE(bus.read_u32(0xffffc010_addr), (uint32_t)0x33333333);
+
+    bus.clean_range(0xfff00000_addr, 0xffffffff_addr);
+    QCOMPARE(bus.location_status(0xffffc010_addr), LOCSTAT_ILLEGAL);
+    QCOMPARE(bus.read_u32(0x10_addr), (uint32_t)0x11111111);
+}
+
+void MachineTests::memory_direct_access() {
+    Memory mem(BIG), other(BIG);
+    TrivialBus trivial(&mem);
+    MemoryDataBus bus(BIG);
+    QVERIFY(bus.insert_device_to_range(&mem, 0x0_addr, 0xefffffff_addr, false));
+
+    // First write allocates section by regular path, second goes directly.
+    QVERIFY(trivial.write_u32(0x1000_addr, 0x01020304));
+    QVERIFY(trivial.write_u32(0x1004_addr, 0x05060708));
+    QCOMPARE(memory_read_u32(&mem, 0x1004), (uint32_t)0x05060708);
+    QCOMPARE(bus.read_u32(0x1004_addr), (uint32_t)0x05060708);
+    QCOMPARE(bus.read_u16(0x1006_addr), (uint16_t)0x0708);
+
+    uint32_t counter = bus.get_change_counter();
+    QVERIFY(!bus.write_u32(0x1004_addr, 0x05060708));
+    QCOMPARE(bus.get_change_counter(), counter);
+    QVERIFY(bus.write_u32(0x1004_addr, 0x0a0b0c0d));
+    QCOMPARE(bus.get_change_counter(), counter + 1);
+    QCOMPARE(trivial.read_u32(0x1004_addr), (uint32_t)0x0a0b0c0d);
+
+    // Access straddling sections falls back to regular path.
+    Address straddle = Address(MEMORY_SECTION_SIZE - 2);
+    bus.write_u32(straddle, 0x11223344);
+    QCOMPARE(trivial.read_u32(straddle), (uint32_t)0x11223344);
+
+    // Reset releases host storage, windows must not be used afterwards.
+    mem.reset();
+    QCOMPARE(trivial.read_u32(0x1004_addr), (uint32_t)0);
+    QCOMPARE(bus.read_u32(0x1004_addr), (uint32_t)0);
+    QVERIFY(bus.write_u32(0x1004_addr, 0x01020304));
+    QCOMPARE(trivial.read_u32(0x1004_addr), (uint32_t)0x01020304);
+
+    // Remapping the bus drops its window.
+    QVERIFY(bus.remove_device(&mem));
+    QCOMPARE(bus.read_u32(0x1004_addr), (uint32_t)0);
+    QVERIFY(bus.insert_device_to_range(&other, 0x0_addr, 0xefffffff_addr, false));
+    QVERIFY(bus.write_u32(0x1004_addr, 0x0f0f0f0f));
+    QCOMPARE(memory_read_u32(&other, 0x1004), (uint32_t)0x0f0f0f0f);
+    QCOMPARE(memory_read_u32(&mem, 0x1004), (uint32_t)0x01020304);
+}
+
+void MachineTests::memory_copy_on_write() {
+    Memory image(BIG);
+    memory_write_u32(&image, 0x1000, 0x11111111);
+    memory_write_u32(&image, 0x80020000, 0x22222222);
+
+    Memory mem(image);
+    QCOMPARE(mem, image);
+    QVERIFY(mem.get_section(0x1000, false)->is_shared());
+    memory_write_u32(&mem, 0x1000, 0x33333333);
+    memory_write_u32(&mem, 0x90000000, 0x44444444);
+    QVERIFY(!mem.get_section(0x1000, false)->is_shared());
+    QCOMPARE(memory_read_u32(&image, 0x1000), (uint32_t)0x11111111);
+    QCOMPARE(memory_read_u32(&image, 0x90000000), (uint32_t)0);
+
+    // Restart reverts only touched sections, the others stay shared.
+    mem.reset(image);
+    QCOMPARE(mem, image);
+    QCOMPARE(mem.get_section(0x90000000, false), (MemorySection *)nullptr);
+    QCOMPARE(memory_read_u32(&mem, 0x1000), (uint32_t)0x11111111);
+    QVERIFY(mem.get_section(0x1000, false)->is_shared());
+
+    // Writes through direct access window must not leak to the image.
+    TrivialBus bus(&mem);
+    QCOMPARE(bus.read_u32(0x80020000_addr), (uint32_t)0x22222222);
+    bus.write_u32(0x80020000_addr, 0x55555555);
+    bus.write_u32(0x80020004_addr, 0x66666666);
+    QCOMPARE(bus.read_u32(0x80020000_addr), (uint32_t)0x55555555);
+    QCOMPARE(memory_read_u32(&image, 0x80020000), (uint32_t)0x22222222);
+    QCOMPARE(memory_read_u32(&image, 0x80020004), (uint32_t)0);
+
+    // Changed image cannot be restored incrementally.
+    memory_write_u32(&image, 0x2000, 0x77777777);
+    mem.reset(image);
+    QCOMPARE(mem, image);
+    QCOMPARE(bus.read_u32(0x80020000_addr), (uint32_t)0x22222222);
+
+    // Copy survives the image.
+    {
+        Memory tmp(BIG);
+        memory_write_u32(&tmp, 0x1000, 0x88888888);
+        mem.reset(tmp);
+    }
+    QCOMPARE(memory_read_u32(&mem, 0x1000), (uint32_t)0x88888888);
+    memory_write_u32(&mem, 0x1000, 0x99999999);
+    QCOMPARE(memory_read_u32(&mem, 0x1000), (uint32_t)0x99999999);
+}
+
+void MachineTests::memory_copy_on_write_snapshots() {
+    Memory image(BIG);
+    memory_write_u32(&image, 0x1000, 0x11111111);
+
+    // Snapshots share sections written before, so they are copied again.
+    // Stack section is not in the image, restart has to release it once.
+    Memory mem(image);
+    memory_write_u32(&mem, 0x7fff0000, 1);
+    memory_write_u32(&mem, 0x1000, 1);
+    Memory snapshot1(mem);
+    memory_write_u32(&mem, 0x7fff0000, 2);
+    memory_write_u32(&mem, 0x1000, 2);
+    Memory snapshot2(mem);
+    memory_write_u32(&mem, 0x7fff0000, 3);
+    memory_write_u32(&mem, 0x1000, 3);
+    mem.reset(image);
+    QCOMPARE(mem, image);
+    QCOMPARE(mem.get_section(0x7fff0000, false), (MemorySection *)nullptr);
+    QCOMPARE(memory_read_u32(&snapshot1, 0x7fff0000), (uint32_t)1);
+    QCOMPARE(memory_read_u32(&snapshot2, 0x1000), (uint32_t)2);
+
+    // Writable windows of memory are dropped when its sections become shared
+    TrivialBus bus(&mem);
+    bus.write_u32(0x2000_addr, 1);
+    bus.write_u32(0x2004_addr, 2);
+    Memory copy(mem);
+    bus.write_u32(0x2004_addr, 3);
+    QCOMPARE(memory_read_u32(&copy, 0x2004), (uint32_t)2);
+    QCOMPARE(memory_read_u32(&mem, 0x2004), (uint32_t)3);
+
+    Memory other(BIG);
+    bus.write_u32(0x2004_addr, 4);
+    other.reset(mem);
+    bus.write_u32(0x2004_addr, 5);
+    QCOMPARE(memory_read_u32(&other, 0x2004), (uint32_t)4);
+    // Reset from unchanged memory reverts only touched sections
+    other.reset(mem);
+    memory_write_u32(&other, 0x2004, 6);
+    bus.write_u32(0x2004_addr, 7);
+    other.reset(mem);
+    bus.write_u32(0x2004_addr, 8);
+    QCOMPARE(memory_read_u32(&other, 0x2004), (uint32_t)7);
+    QCOMPARE(memory_read_u32(&mem, 0x2004), (uint32_t)8);
+}
+
+void MachineTests::memory_restart_benchmark() {
+    // Program with 8 MiB of initialized data which touches few sections.
+    Memory image(BIG);
+    for (uint32_t offset = 0; offset < 0x800000; offset += MEMORY_SECTION_SIZE) {
+        memory_write_u32(&image, 0x10000000 + offset, offset);
+    }
+    Memory mem(image);
+    QBENCHMARK {
+        for (uint32_t i = 0; i < 16; i++) {
+            memory_write_u32(&mem, 0x10000000 + i * MEMORY_SECTION_SIZE, ~i);
+        }
+        memory_write_u32(&mem, 0x7fff0000, 1);
+        mem.reset(image);
+    }
+    QCOMPARE(mem, image);
+    QVERIFY(mem.footprint() < image.footprint() / 4);
+}
+
+static void prepare_memory_benchmark_data() {
+    QTest::addColumn<Offset>("start");
+    QTest::addColumn<Offset>("stride");
+    QTest::addColumn<unsigned>("count");
+
+    // Sequential walk through program sized region
+    QTest::newRow("dense") << (Offset)0x80020000 << (Offset)4 << 65536u;
+    // One word per megabyte over the first quarter of address space
+    QTest::newRow("sparse") << (Offset)0x0 << (Offset)0x100000 << 1024u;
+}
+
+void MachineTests::memory_footprint_benchmark_data() {
+    prepare_memory_benchmark_data();
+}
+
+void MachineTests::memory_footprint_benchmark() {
+    QFETCH(Offset, start);
+    QFETCH(Offset, stride);
+    QFETCH(unsigned, count);
+
+    Memory m(BIG);
+    for (unsigned i = 0; i < count; i++) {
+        memory_write_u32(&m, start + i * stride, i);
+    }
+    QVERIFY(m.footprint() >= count * sizeof(uint32_t));
+    QTest::setBenchmarkResult(m.footprint(), QTest::BytesAllocated);
+}
+
+void MachineTests::memory_access_benchmark_data() {
+    prepare_memory_benchmark_data();
+}
+
+void MachineTests::memory_access_benchmark() {
+    QFETCH(Offset, start);
+    QFETCH(Offset, stride);
+    QFETCH(unsigned, count);
+
+    Memory m(BIG);
+    for (unsigned i = 0; i < count; i++) {
+        memory_write_u32(&m, start + i * stride, i);
+    }
+    uint32_t sum = 0;
+    QBENCHMARK {
+        for (unsigned i = 0; i < count; i++) {
+            sum += memory_read_u32(&m, start + i * stride);
+        }
+    }
+    QVERIFY(sum != 0);
+}
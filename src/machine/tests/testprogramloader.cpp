@@ -38,6 +38,8 @@
 #include "machine/programloader.h"
 #include "memory/backend/memory.h"
 #include "tst_machine.h"
+#include "utils/test_executable.h"
+#include <QTemporaryDir>
 
 using namespace machine;
 
@@ -66,3 +68,37 @@ void MachineTests::program_loader() {
     // TODO add some more code to data and do more compares (for example more
     // sections)
 }
+
+void MachineTests::program_loader_benchmark_data() {
+    QTest::addColumn<uint32_t>("file_size");
+    QTest::addColumn<uint32_t>("mem_size");
+
+    QTest::newRow("small") << (uint32_t)0x1000 << (uint32_t)0x1000;
+    QTest::newRow("large data and bss") << (uint32_t)0x800000 << (uint32_t)0x1000000;
+}
+
+void MachineTests::program_loader_benchmark() {
+    QFETCH(uint32_t, file_size);
+    QFETCH(uint32_t, mem_size);
+
+    std::vector<char> content(file_size);
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = (char)(i * 7 + 1);
+    }
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("program_loader_benchmark.elf"));
+    QVERIFY(write_test_executable(file, PC_INIT, content, mem_size));
+
+    // Same work as Machine does on startup, load and keep pristine copy.
+    QBENCHMARK {
+        ProgramLoader pl(file.fileName());
+        Memory program_only(pl.get_endian());
+        pl.to_memory(&program_only);
+        Memory mem(program_only);
+        QCOMPARE(memory_read_u8(&mem, PC_INIT + file_size - 1), (uint8_t)content.back());
+        if (mem_size > file_size) {
+            QCOMPARE(memory_read_u8(&mem, PC_INIT + mem_size - 1), (uint8_t)0);
+        }
+    }
+}
@@ -39,10 +39,13 @@ SOURCES += tst_machine.cpp \
     testinstruction.cpp \
     testalu.cpp \
     testcore.cpp \
-    testcache.cpp
+    testcache.cpp \
+    testcheckpoint.cpp \
+    testmachine.cpp
 
 HEADERS += tst_machine.h \
            utils/integer_decomposition.h  \
+           utils/test_executable.h \
            data/cache_test_performance_data.h
 
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -61,8 +61,19 @@ private Q_SLOTS:
     static void memory_write_ctl();
     static void memory_read_ctl_data();
     static void memory_read_ctl();
+    static void memory_bus_ranges();
+    static void memory_direct_access();
+    static void memory_copy_on_write();
+    static void memory_copy_on_write_snapshots();
+    static void memory_restart_benchmark();
+    static void memory_footprint_benchmark_data();
+    static void memory_footprint_benchmark();
+    static void memory_access_benchmark_data();
+    static void memory_access_benchmark();
     // Program loader
     void program_loader();
+    void program_loader_benchmark_data();
+    void program_loader_benchmark();
     // Instruction
     void instruction();
     void instruction_access();
@@ -79,6 +90,20 @@ private Q_SLOTS:
     static void cache();
     static void cache_correctness_data();
     static void cache_correctness();
+    static void cache_lookup_benchmark_data();
+    static void cache_lookup_benchmark();
+    static void cache_publish_updates();
+    static void cache_miss_analysis();
+    static void cache_level2_data();
+    static void cache_level2();
+    static void cache_level2_inclusion();
+    static void cache_prefetch_data();
+    static void cache_prefetch();
+    static void cache_prefetch_policies();
+    static void cache_wait_cycles();
+    static void cache_direct_access();
+    static void dram_timing();
+    static void dram_write_queue();
     // Core
     void singlecore_regs();
     void singlecore_regs_data();
@@ -108,6 +133,50 @@ private Q_SLOTS:
     void pipecore_wt_na_memory_tests();
     void pipecore_wt_a_memory_tests();
     void pipecore_wb_memory_tests();
+    void singlecore_decode_cache();
+    void pipecore_decode_cache();
+    void branch_predictor();
+    void branch_predictor_data();
+    void branch_target_buffer();
+    void pipecore_branch_prediction();
+    void pipecore_stall_reasons();
+    void pipecore_stall_reasons_data();
+    void pipecore_muldiv_latency();
+    void pipecore_muldiv_latency_data();
+    void superscalar_alu_forward();
+    void superscalar_alu_forward_data();
+    void superscalarstall_alu_forward();
+    void superscalarstall_alu_forward_data();
+    void superscalar_memory_tests();
+    void superscalar_memory_tests_data();
+    void superscalar_branch();
+    void superscalar_issue();
+    void superscalar_issue_data();
+    void core_benchmark_data();
+    void core_benchmark();
+    // Checkpoint
+    void checkpoint_save_restore_data();
+    void checkpoint_save_restore();
+    void checkpoint_invalid();
+    void checkpoint_step_back_data();
+    void checkpoint_step_back();
+    void checkpoint_history_budget();
+    void checkpoint_history_restart();
+    void checkpoint_history_serial_input();
+    // Machine
+    void machine_run_cycles_threads();
+    void machine_memory_trace_replay_data();
+    void machine_memory_trace_replay();
+    void machine_cache_sweep();
+    void machine_cache_sweep_range_data();
+    void machine_cache_sweep_range();
+    void machine_cache_level2_data();
+    void machine_cache_level2();
+    void machine_memory_stalls_data();
+    void machine_memory_stalls();
+    void machine_direct_access();
+    void machine_dram_data();
+    void machine_dram();
 };
 
 #endif // TST_MACHINE_H
@@ -0,0 +1,59 @@
+#ifndef TEST_EXECUTABLE_H
+#define TEST_EXECUTABLE_H
+
+#include <QFile>
+#include <cstdint>
+#include <gelf.h>
+#include <vector>
+
+/**
+ * Write big endian MIPS executable with single loadable segment.
+ *
+ * Segment is filled by pattern for `file_size` bytes, rest up to `mem_size`
+ * is left for zero fill (like .bss).
+ */
+inline bool write_test_executable(
+    QFile &file,
+    uint32_t address,
+    const std::vector<char> &content,
+    uint32_t mem_size) {
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) { return false; }
+    elf_version(EV_CURRENT);
+    Elf *elf = elf_begin(file.handle(), ELF_C_WRITE, nullptr);
+    Elf32_Ehdr *ehdr = elf32_newehdr(elf);
+    ehdr->e_ident[EI_DATA] = ELFDATA2MSB;
+    ehdr->e_type = ET_EXEC;
+    ehdr->e_machine = EM_MIPS;
+    ehdr->e_version = EV_CURRENT;
+    ehdr->e_entry = address;
+    Elf32_Phdr *phdr = elf32_newphdr(elf, 1);
+
+    Elf_Scn *scn = elf_newscn(elf);
+    Elf_Data *data = elf_newdata(scn);
+    data->d_buf = const_cast<char *>(content.data());
+    data->d_size = content.size();
+    data->d_type = ELF_T_BYTE;
+    data->d_align = 4;
+    Elf32_Shdr *shdr = elf32_getshdr(scn);
+    shdr->sh_type = SHT_PROGBITS;
+    shdr->sh_flags = SHF_ALLOC | SHF_WRITE;
+    shdr->sh_addr = address;
+
+    // First pass computes section offsets used by program header.
+    bool ok = elf_update(elf, ELF_C_NULL) >= 0;
+    phdr->p_type = PT_LOAD;
+    phdr->p_offset = shdr->sh_offset;
+    phdr->p_vaddr = address;
+    phdr->p_paddr = address;
+    phdr->p_filesz = content.size();
+    phdr->p_memsz = mem_size;
+    phdr->p_flags = PF_R | PF_W | PF_X;
+    phdr->p_align = 4;
+    elf_flagphdr(elf, ELF_C_SET, ELF_F_DIRTY);
+    ok = ok && elf_update(elf, ELF_C_WRITE) >= 0;
+    elf_end(elf);
+    file.close();
+    return ok;
+}
+
+#endif // TEST_EXECUTABLE_H